@@ -2,22 +2,55 @@ document.addEventListener('DOMContentLoaded', () => {
     fetch('/api/version')
         .then(response => response.text())
         .then(data => { document.getElementById('version').innerText = data; });
-    const form      = document.getElementById('wol-form');
-    const hostsList = document.getElementById('hosts');
+    const form       = document.getElementById('wol-form');
+    const hostsList  = document.getElementById('hosts');
+    const activity   = document.getElementById('activity');
+    const statusLine = document.getElementById('device-status');
 
-    function renderHosts()
+    // A single packet is easily lost on a busy or bridged network, so the UI sends a
+    // paced burst to several broadcast addresses and ports instead, and has the device
+    // ping the machine to confirm it came up
+    const WAKE_POLICY = {burst : 'reliable', verify : true};
+
+    // Activity entries kept on screen
+    const ACTIVITY_MAX = 20;
+    // How long to wait for a relayed wake's acknowledgement
+    const RELAY_POLL_MS = 500;
+    const RELAY_POLLS   = 10;
+
+    // Saved host names by id, to label wakes started by other clients or schedules
+    let hostNames = {};
+    // Activity entry of each wake job seen, by job id
+    const jobs = {};
+
+    // Saved hosts live on the device (/api/hosts), so every browser sees the same list
+    async function renderHosts()
     {
-        const hosts = JSON.parse(localStorage.getItem('wol_hosts') || '[]');
+        let hosts = [];
+        try
+        {
+            const res = await fetch('/api/hosts');
+            hosts     = await res.json();
+        }
+        catch (e)
+        {
+            return;
+        }
 
         hostsList.innerHTML = '';
-        hosts.forEach((h, i) => {
+        hostNames           = {};
+        hosts.forEach(h => {
+            hostNames[h.id] = h.name || h.mac;
             const li     = document.createElement('li');
             li.className = 'host-item';
             li.innerHTML =
-                `<div>${h.name || h.mac} <small style="color:var(--muted);display:block">${
-                    h.mac}  ${h.broadcast || ''}</small></div>` +
-                `<div><button data-i="${i}" class="wake">Wake</button> <button data-i="${
-                    i}" class="remove" style="margin-left:8px">Remove</button></div>`;
+                `<div><span class="name"></span> <small style="color:var(--muted);display:block">${
+                    h.mac}  ${h.broadcast}</small></div>` +
+                `<div><button data-id="${h.id}" class="wake">Wake</button> <button data-id="${
+                    h.id}" class="remove" style="margin-left:8px">Remove</button></div>`;
+            // Names come from any client, so they are never parsed as HTML
+            li.querySelector('.name').textContent = h.name || h.mac;
+            li.dataset.name                       = h.name;
             hostsList.appendChild(li);
         });
     }
@@ -25,54 +58,212 @@ document.addEventListener('DOMContentLoaded', () => {
     hostsList.addEventListener('click', async (ev) => {
         if (ev.target.matches('.wake'))
         {
-            const i     = Number(ev.target.dataset.i);
-            const hosts = JSON.parse(localStorage.getItem('wol_hosts') || '[]');
-            const host  = hosts[i];
-            await sendWake(host.mac, host.broadcast, host.name);
+            const name = ev.target.closest('li').dataset.name;
+            await report(postJson(`/api/hosts/${ev.target.dataset.id}/wake`, WAKE_POLICY), name);
         }
 
         if (ev.target.matches('.remove'))
         {
-            const i     = Number(ev.target.dataset.i);
-            const hosts = JSON.parse(localStorage.getItem('wol_hosts') || '[]');
-            hosts.splice(i, 1);
-            localStorage.setItem('wol_hosts', JSON.stringify(hosts));
+            await fetch(`/api/hosts/${ev.target.dataset.id}`, {method : 'DELETE'});
             renderHosts();
         }
     });
 
-    async function sendWake(mac, broadcast, name)
+    function addEntry(name)
+    {
+        const li     = document.createElement('li');
+        li.className = 'activity-item';
+        li.innerHTML = '<span class="name"></span><span class="state">queued</span>';
+        li.querySelector('.name').textContent = name;
+        activity.prepend(li);
+        while (activity.children.length > ACTIVITY_MAX)
+            activity.lastElementChild.remove();
+        return li;
+    }
+
+    function setEntry(li, text)
     {
+        li.querySelector('.state').textContent = text;
+    }
+
+    // What a "wake" event from /api/events says, in words
+    function describe(ev)
+    {
+        switch (ev.verify)
+        {
+        case 'up':
+            return `up after ${(ev.time_to_wake_ms / 1000).toFixed(1)} s`;
+        case 'timed_out':
+            return 'sent, but it did not come up';
+        case 'failed':
+            return 'sent (could not check that it came up)';
+        case 'resolving':
+        case 'probing':
+            return 'sent, waiting for it to come up…';
+        }
+        if (ev.state === 'sending')
+            return `sending (${ev.sent} of ${ev.planned})`;
+        if (ev.state === 'failed')
+            return 'could not be sent';
+        return ev.state;
+    }
+
+    // Wake progress comes from the event feed; the POST only ties the job to its entry
+    async function report(request, name)
+    {
+        const entry = addEntry(name || 'Device');
         try
         {
-            const payload = {mac, broadcast};
-            await fetch('/api/wake', {
-                method : 'POST',
-                headers : {'Content-Type' : 'application/json'},
-                body : JSON.stringify(payload)
-            });
-            alert(name ? `${name} should be waking up now.` : 'Device should be waking up now.');
+            const res  = await request;
+            const body = await res.json();
+            if (res.ok && body.relay)
+            {
+                // Another node owns that subnet; its events do not reach this feed
+                setEntry(entry, `relayed via ${body.via}`);
+                followRelay(entry, body.relay, body.via);
+                return;
+            }
+            if (!res.ok || !body.job)
+                throw new Error(res.status);
+            const seen = jobs[body.job];
+            if (seen)
+            {
+                // Its events arrived first and opened an entry of their own
+                setEntry(entry, seen.querySelector('.state').textContent);
+                seen.remove();
+            }
+            jobs[body.job] = entry;
         }
         catch (e)
         {
-            alert(
-                'Could not contact the device. Check the MAC or broadcast address and try again.');
+            setEntry(entry, 'could not reach the device; check the MAC or broadcast address');
+        }
+    }
+
+    // Poll for the relay node's acknowledgement; it retries for a second or two at most
+    async function followRelay(entry, id, via)
+    {
+        for (let i = 0; i < RELAY_POLLS; i++)
+        {
+            await new Promise(resolve => setTimeout(resolve, RELAY_POLL_MS));
+            let st;
+            try
+            {
+                st = await (await fetch(`/api/relay/status?id=${id}`)).json();
+            }
+            catch (e)
+            {
+                continue;
+            }
+            switch (st.state)
+            {
+            case 'pending':
+                continue;
+            case 'queued':
+                setEntry(entry, `relayed via ${via}, sent from there`);
+                return;
+            case 'refused':
+                setEntry(entry, `${via} could not send it`);
+                return;
+            case 'failed':
+                setEntry(entry, `relayed via ${via}, but it never answered`);
+                return;
+            default:
+                return;
+            }
         }
     }
 
+    function onWake(ev)
+    {
+        if (!jobs[ev.job])
+            jobs[ev.job] = addEntry(hostNames[ev.host] || `Job ${ev.job}`);
+        setEntry(jobs[ev.job], describe(ev));
+    }
+
+    function showStatus(st)
+    {
+        const up = st.uptime_s >= 3600 ? `${Math.floor(st.uptime_s / 3600)} h`
+                                       : `${Math.floor(st.uptime_s / 60)} min`;
+        statusLine.textContent = `WiFi ${st.wifi} · ${st.power} power · up ${up} · ${
+            st.clients} open ${st.clients === 1 ? 'view' : 'views'}`;
+    }
+
+    // One feed for every open UI; EventSource reconnects and resumes on its own
+    function connectEvents()
+    {
+        if (!window.EventSource)
+            return;
+        const es = new EventSource('/api/events');
+        es.addEventListener('wake', ev => onWake(JSON.parse(ev.data)));
+        es.addEventListener('status', ev => showStatus(JSON.parse(ev.data)));
+        es.addEventListener('hosts', () => renderHosts());
+        es.onerror = () => { statusLine.textContent = 'Reconnecting to the device…'; };
+    }
+
+    function postJson(url, payload)
+    {
+        return fetch(url, {
+            method : 'POST',
+            headers : {'Content-Type' : 'application/json'},
+            body : JSON.stringify(payload)
+        });
+    }
+
     form.addEventListener('submit', async (ev) => {
         ev.preventDefault();
         const name      = document.getElementById('name').value.trim();
         const mac       = document.getElementById('mac').value.trim();
         const broadcast = document.getElementById('broadcast').value.trim();
 
-        const hosts = JSON.parse(localStorage.getItem('wol_hosts') || '[]');
-        hosts.unshift({name, mac, broadcast});
-        localStorage.setItem('wol_hosts', JSON.stringify(hosts.slice(0, 10)));
+        // Save the host (the device answers with the saved one when it is already known),
+        // then wake it by id; if it could not be saved, wake it directly
+        let saved = null;
+        try
+        {
+            const res = await postJson('/api/hosts', {name, mac, broadcast});
+            if (res.ok)
+                saved = await res.json();
+        }
+        catch (e)
+        {
+            // woken directly below
+        }
         renderHosts();
 
-        await sendWake(mac, broadcast, name);
+        await report(saved ? postJson(`/api/hosts/${saved.id}/wake`, WAKE_POLICY)
+                           : postJson('/api/wake', {mac, broadcast, ...WAKE_POLICY}),
+                     name);
     });
 
-    renderHosts();
+    // Hosts saved by older firmware in this browser move to the device once. Any the
+    // device did not take (invalid, registry full, unreachable) stay here for next time.
+    async function migrateLocalHosts()
+    {
+        const old = JSON.parse(localStorage.getItem('wol_hosts') || '[]');
+        if (!old.length)
+            return;
+        const left = [];
+        for (const h of old.reverse())
+        {
+            try
+            {
+                const res = await postJson('/api/hosts', h);
+                // 409: the device already has it
+                if (!res.ok && res.status !== 409)
+                    left.push(h);
+            }
+            catch (e)
+            {
+                left.push(h);
+            }
+        }
+        if (left.length)
+            localStorage.setItem('wol_hosts', JSON.stringify(left.reverse()));
+        else
+            localStorage.removeItem('wol_hosts');
+    }
+
+    migrateLocalHosts().then(renderHosts);
+    connectEvents();
 });
@@ -0,0 +1,434 @@
+#!/usr/bin/env python3
+"""HTTP load test for the firmware built for the host, with a local magic-packet sink.
+
+Drives `/`, `/assets/*`, `/wol` and `/api/wake` over keep-alive connections at a given
+concurrency and reports throughput and p50/p99/p999 latency, overall and per route.
+Every wake request names its own MAC, and a UDP listener receives the magic packets,
+checks each is byte-correct (6 x 0xFF, then the MAC 16 times) and matches it back to
+its request for the end-to-end request-to-packet latency.
+
+    pio run -e native_app
+    python3 bench/http_load.py --spawn .pio/build/native_app/program -c 16 -d 10 \\
+        --out before.json
+    ...change serve_embedded or WakeOnLan::send, rebuild, run again with --out after.json
+    python3 bench/http_load.py --compare before.json after.json
+
+With --spawn the firmware is started with WOL_NATIVE_BROADCAST pointing at the sink and
+NATIVE_HTTP_PORT set to --port.
+Against an already running build, start it with WOL_NATIVE_BROADCAST=127.0.0.1:<port>
+and pass the same --sink-port. Only the standard library is used.
+
+All requests come from one address, so a build with the per-client rate limits on
+mostly measures 429s. A run where 429 and 503 answers make up more than --max-shed of
+the requests is reported as invalid and the tool exits with status 2.
+"""
+import argparse
+import asyncio
+import collections
+import json
+import os
+import random
+import socket
+import subprocess
+import sys
+import time
+
+DEFAULT_MIX = "/=1,/assets/app.js=4,/assets/style.css=2,/wol=1,/api/wake=1"
+WAKE_ROUTES = ("/wol", "/api/wake")
+PACKET_LEN = 102
+SHED_STATUSES = ("429", "503")
+
+
+def percentile(sorted_values, p):
+    """Nearest-rank percentile of an ascending list."""
+    if not sorted_values:
+        return None
+    rank = -(-len(sorted_values) * p // 100)  # ceil
+    return sorted_values[max(0, min(len(sorted_values), int(rank)) - 1)]
+
+
+def summarize(latencies):
+    """Latencies in seconds -> counts and percentiles in milliseconds."""
+    v = sorted(latencies)
+
+    def ms(x):
+        return None if x is None else round(x * 1000.0, 3)
+
+    return {
+        "count": len(v),
+        "mean_ms": ms(sum(v) / len(v)) if v else None,
+        "p50_ms": ms(percentile(v, 50)),
+        "p99_ms": ms(percentile(v, 99)),
+        "p999_ms": ms(percentile(v, 99.9)),
+        "max_ms": ms(v[-1]) if v else None,
+    }
+
+
+def parse_mix(text):
+    mix = []
+    for part in text.split(","):
+        path, _, weight = part.partition("=")
+        mix.append((path.strip(), float(weight or 1)))
+    return mix
+
+
+def new_stats():
+    return {
+        "latency": collections.defaultdict(list),
+        "status": collections.Counter(),
+        "errors": collections.Counter(),
+    }
+
+
+class MacSource:
+    """Hands out MACs cycling over `distinct` values (locally administered, 02:00:...)."""
+
+    def __init__(self, distinct):
+        self.distinct = max(1, distinct)
+        self.n = 0
+
+    def next(self):
+        i = self.n % self.distinct
+        self.n += 1
+        return bytes([0x02, 0x00]) + i.to_bytes(4, "big")
+
+
+class PacketSink(asyncio.DatagramProtocol):
+    """Receives magic packets and pairs each with the oldest outstanding request for its MAC."""
+
+    def __init__(self):
+        self.reset()
+
+    def reset(self):
+        self.pending = collections.defaultdict(collections.deque)  # mac -> send times
+        self.latencies = []
+        self.valid = 0
+        self.invalid = 0
+        self.unmatched = 0
+
+    def expect(self, mac, sent_at):
+        self.pending[mac].append(sent_at)
+
+    def forget(self, mac, sent_at):
+        # The request failed or was refused, so no packet will come for it
+        try:
+            self.pending[mac].remove(sent_at)
+        except ValueError:
+            pass
+
+    def datagram_received(self, data, addr):
+        now = time.perf_counter()
+        mac = data[6:12]
+        if len(data) != PACKET_LEN or data[:6] != b"\xff" * 6 or data[6:] != mac * 16:
+            self.invalid += 1
+            return
+        self.valid += 1
+        waiting = self.pending.get(mac)
+        if not waiting:
+            self.unmatched += 1
+            return
+        self.latencies.append(now - waiting.popleft())
+
+    def outstanding(self):
+        return sum(len(q) for q in self.pending.values())
+
+
+class Connection:
+    """One keep-alive client connection; reopened whenever the server closes it."""
+
+    def __init__(self, host, port):
+        self.host, self.port = host, port
+        self.reader = self.writer = None
+        self.opened = 0
+        self.served = 0  # responses on the current connection
+        self.retried = 0
+
+    async def ensure(self):
+        if self.writer is None:
+            self.reader, self.writer = await asyncio.open_connection(self.host, self.port)
+            sock = self.writer.get_extra_info("socket")
+            sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+            self.opened += 1
+            self.served = 0
+
+    def close(self):
+        if self.writer is not None:
+            self.writer.close()
+        self.reader = self.writer = None
+
+    async def request(self, method, path, body=b""):
+        """Send one request and read the whole response. Returns (status, body)."""
+        head = f"{method} {path} HTTP/1.1\r\nHost: {self.host}\r\nAccept-Encoding: gzip, br\r\n"
+        if body:
+            head += f"Content-Type: application/json\r\nContent-Length: {len(body)}\r\n"
+        await self.ensure()
+        try:
+            self.writer.write(head.encode() + b"\r\n" + body)
+            status_line = await self.reader.readline()
+        except ConnectionError:
+            status_line = b""
+        if not status_line and self.served > 0:
+            # The server closed an idle kept-alive connection (e.g. to give its slot to
+            # another client) before reading this request; like a browser, retry once
+            self.close()
+            self.retried += 1
+            await self.ensure()
+            self.writer.write(head.encode() + b"\r\n" + body)
+            status_line = await self.reader.readline()
+        if not status_line:
+            raise ConnectionResetError("closed before the response")
+        status = int(status_line.split()[1])
+        headers = {}
+        while True:
+            line = await self.reader.readline()
+            if line in (b"\r\n", b""):
+                break
+            name, _, value = line.decode("latin-1").partition(":")
+            headers[name.strip().lower()] = value.strip()
+        if headers.get("transfer-encoding", "").lower() == "chunked":
+            data = b""
+            while True:
+                size = int((await self.reader.readline()).strip(), 16)
+                chunk = await self.reader.readexactly(size + 2)
+                if size == 0:
+                    break
+                data += chunk[:-2]
+        else:
+            data = await self.reader.readexactly(int(headers.get("content-length", "0")))
+        self.served += 1
+        if headers.get("connection", "").lower() == "close":
+            self.close()
+        return status, data
+
+
+async def worker(conn, mix, macs, sink, stats, deadline, budget):
+    """Issue requests on `conn` until `deadline` or until the shared `budget` runs out."""
+    paths = [p for p, _ in mix]
+    weights = [w for _, w in mix]
+    rng = random.Random()
+    while time.perf_counter() < deadline and budget[0] != 0:
+        if budget[0] > 0:
+            budget[0] -= 1
+        path = rng.choices(paths, weights)[0]
+        method, body, target, mac = "GET", b"", path, None
+        if path in WAKE_ROUTES:
+            mac = macs.next()
+            text = ":".join(f"{b:02x}" for b in mac)
+            if path == "/wol":
+                target = f"/wol?mac={text}"
+            else:
+                method, body = "POST", json.dumps({"mac": text}).encode()
+
+        start = time.perf_counter()
+        if mac is not None:
+            sink.expect(mac, start)
+        try:
+            status, _ = await conn.request(method, target, body)
+        except (ConnectionError, asyncio.IncompleteReadError, ValueError, IndexError) as e:
+            conn.close()
+            stats["errors"][type(e).__name__] += 1
+            if mac is not None:
+                sink.forget(mac, start)
+            continue
+        stats["latency"][path].append(time.perf_counter() - start)
+        stats["status"][str(status)] += 1
+        if mac is not None and status != 202:
+            sink.forget(mac, start)
+
+
+async def wait_for_port(host, port, timeout):
+    end = time.monotonic() + timeout
+    while time.monotonic() < end:
+        try:
+            _, w = await asyncio.open_connection(host, port)
+            w.close()
+            return True
+        except OSError:
+            await asyncio.sleep(0.1)
+    return False
+
+
+async def run(args):
+    loop = asyncio.get_running_loop()
+    sink = PacketSink()
+    transport, _ = await loop.create_datagram_endpoint(
+        lambda: sink, local_addr=("127.0.0.1", args.sink_port)
+    )
+    sink_port = transport.get_extra_info("sockname")[1]
+
+    proc = None
+    if args.spawn:
+        env = dict(os.environ, WOL_NATIVE_BROADCAST=f"127.0.0.1:{sink_port}",
+                   NATIVE_HTTP_PORT=str(args.port))
+        proc = subprocess.Popen([args.spawn], env=env, stdout=subprocess.DEVNULL)
+    try:
+        if not await wait_for_port(args.host, args.port, 10):
+            sys.exit(f"http_load: nothing listening on {args.host}:{args.port}")
+
+        mix = parse_mix(args.mix)
+        macs = MacSource(args.distinct_macs)
+        conns = [Connection(args.host, args.port) for _ in range(args.concurrency)]
+
+        # Warm-up requests (and their packets) are not counted
+        warm = time.perf_counter() + args.warmup
+        await asyncio.gather(*(worker(c, mix, macs, sink, new_stats(), warm, [-1]) for c in conns))
+        await asyncio.sleep(args.drain)
+        sink.reset()
+        opened_before = sum(c.opened for c in conns)
+        retried_before = sum(c.retried for c in conns)
+
+        stats = new_stats()
+        budget = [args.requests if args.requests else -1]
+        start = time.perf_counter()
+        deadline = start + (args.duration if not args.requests else float("inf"))
+        await asyncio.gather(*(worker(c, mix, macs, sink, stats, deadline, budget) for c in conns))
+        elapsed = time.perf_counter() - start
+        await asyncio.sleep(args.drain)  # let the last packets arrive
+        for c in conns:
+            c.close()
+    finally:
+        transport.close()
+        if proc:
+            proc.terminate()
+            proc.wait()
+
+    everything = [x for v in stats["latency"].values() for x in v]
+    status = stats["status"]
+    return {
+        "label": args.label,
+        "timestamp": time.strftime("%Y-%m-%dT%H:%M:%S"),
+        "config": {
+            "host": args.host,
+            "port": args.port,
+            "concurrency": args.concurrency,
+            "duration_s": None if args.requests else args.duration,
+            "requests": args.requests or None,
+            "mix": args.mix,
+            "distinct_macs": args.distinct_macs,
+        },
+        "elapsed_s": round(elapsed, 3),
+        "requests": len(everything),
+        "throughput_rps": round(len(everything) / elapsed, 1) if elapsed else None,
+        "connections_opened": sum(c.opened for c in conns) - opened_before,
+        "retried_on_new_connection": sum(c.retried for c in conns) - retried_before,
+        "status": dict(status),
+        "not_ok": sum(n for code, n in status.items() if not 200 <= int(code) < 400),
+        "shed": sum(status[code] for code in SHED_STATUSES),
+        "errors": dict(stats["errors"]),
+        "latency": summarize(everything),
+        "routes": {p: summarize(v) for p, v in sorted(stats["latency"].items())},
+        "packets": {
+            "valid": sink.valid,
+            "invalid": sink.invalid,
+            "unmatched": sink.unmatched,
+            "missing": sink.outstanding(),
+            "request_to_packet": summarize(sink.latencies),
+        },
+    }
+
+
+def print_report(r):
+    print(
+        f"{r['label'] or 'run'}: {r['requests']} requests in {r['elapsed_s']} s, "
+        f"{r['throughput_rps']} req/s, {r['connections_opened']} connections opened, "
+        f"{r['retried_on_new_connection']} retried after an idle close"
+    )
+    print(f"  status {r['status']}  not 2xx/3xx {r['not_ok']}  errors {r['errors']}")
+    print(f"  {'route':<20} {'count':>7} {'p50 ms':>9} {'p99 ms':>9} {'p999 ms':>9}")
+    rows = list(r["routes"].items())
+    rows.append(("(all)", r["latency"]))
+    rows.append(("request->packet", r["packets"]["request_to_packet"]))
+    for name, s in rows:
+        cells = [s[k] if s[k] is not None else "-" for k in ("p50_ms", "p99_ms", "p999_ms")]
+        print(f"  {name:<20} {s['count']:>7} {cells[0]:>9} {cells[1]:>9} {cells[2]:>9}")
+    p = r["packets"]
+    print(
+        f"  packets: {p['valid']} valid, {p['invalid']} invalid, "
+        f"{p['unmatched']} unmatched, {p['missing']} missing"
+    )
+
+
+def compare(before_path, after_path):
+    with open(before_path) as f:
+        a = json.load(f)
+    with open(after_path) as f:
+        b = json.load(f)
+
+    def pick(result, name):
+        if name == "(all)":
+            return result["latency"]
+        if name == "request->packet":
+            return result["packets"]["request_to_packet"]
+        return result["routes"].get(name, {})
+
+    rows = [("throughput_rps", a["throughput_rps"], b["throughput_rps"])]
+    for name in sorted(set(a["routes"]) | set(b["routes"])) + ["(all)", "request->packet"]:
+        for key in ("p50_ms", "p99_ms", "p999_ms"):
+            rows.append((f"{name} {key}", pick(a, name).get(key), pick(b, name).get(key)))
+
+    print(f"{'':<34} {a['label'] or 'before':>10} {b['label'] or 'after':>10} {'change':>8}")
+    for name, x, y in rows:
+        change = f"{(y - x) / x * 100:+.1f}%" if x and y is not None else "-"
+        x = "-" if x is None else x
+        y = "-" if y is None else y
+        print(f"{name:<34} {x:>10} {y:>10} {change:>8}")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("--host", default="127.0.0.1")
+    ap.add_argument("--port", type=int, default=8080, help="firmware HTTP port (HTTP_PORT)")
+    ap.add_argument("-c", "--concurrency", type=int, default=8, help="keep-alive connections")
+    ap.add_argument("-d", "--duration", type=float, default=10.0, help="seconds of load")
+    ap.add_argument("-n", "--requests", type=int, default=0, help="stop after N requests")
+    ap.add_argument("--warmup", type=float, default=1.0, help="uncounted seconds first")
+    ap.add_argument("--mix", default=DEFAULT_MIX, help="path=weight,... (default %(default)s)")
+    ap.add_argument(
+        "--distinct-macs",
+        type=int,
+        default=1 << 20,
+        help="MACs to cycle through; 8 or fewer all hit the sender's packet cache",
+    )
+    ap.add_argument("--sink-port", type=int, default=0, help="UDP port of the packet sink")
+    ap.add_argument("--drain", type=float, default=0.5, help="seconds to wait for packets")
+    ap.add_argument("--spawn", help="start this native_app binary for the run")
+    ap.add_argument("--label", default="", help="name stored with the results")
+    ap.add_argument("--out", help="write the results as JSON here")
+    ap.add_argument(
+        "--max-shed",
+        type=float,
+        default=0.5,
+        help="fraction of 429/503 answers above which the run is invalid",
+    )
+    ap.add_argument(
+        "--compare",
+        nargs=2,
+        metavar=("BEFORE", "AFTER"),
+        help="print the difference between two result files and exit",
+    )
+    args = ap.parse_args()
+
+    if args.compare:
+        compare(*args.compare)
+        return
+    if not args.spawn and args.sink_port == 0:
+        ap.error("without --spawn, pass the --sink-port the firmware sends to")
+
+    results = asyncio.run(run(args))
+    print_report(results)
+    if args.out:
+        with open(args.out, "w") as f:
+            json.dump(results, f, indent=2)
+            f.write("\n")
+    if results["requests"] and results["shed"] > args.max_shed * results["requests"]:
+        print(
+            f"http_load: INVALID RUN: {results['shed']} of {results['requests']} requests "
+            "were shed (429/503), so the latencies above measure the limiter. Build with "
+            "-DRATE_LIMIT=0 (pio run -e native_app does).",
+            file=sys.stderr,
+        )
+        sys.exit(2)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,150 @@
+// http_server_host.cpp
+// Host (Linux) build of the HttpServer core with stand-ins for the firmware routes,
+// for load-testing concurrency without a device:
+//
+//   pio run -e native_http && .pio/build/native_http/program [port]
+//   wrk -c 64 -t 4 -d 10s http://127.0.0.1:8080/assets/app.js
+//
+// Open a few idle connections first (e.g. `nc 127.0.0.1 8080` without sending) to
+// check that they do not stall other clients.
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "HttpServer.h"
+
+static uint32_t nowMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000u + ts.tv_nsec / 1000000u);
+}
+
+// A body about the size of the embedded, gzipped app.js
+static uint8_t assetBody[1400];
+
+static HttpServer* server = nullptr;
+
+static void handleRoot(HttpRequest&, HttpResponse& res)
+{
+    res.sendStatic(200, "text/html", assetBody, sizeof(assetBody));
+}
+
+static void handleWol(HttpRequest& req, HttpResponse& res)
+{
+    char mac[32];
+    if (!req.arg("mac", mac, sizeof(mac)))
+        strcpy(mac, "d8:43:ae:54:52:01");
+    char out[64];
+    snprintf(out, sizeof(out), "Magic packet sent to %s", mac);
+    res.send(200, "text/plain", out);
+}
+
+static void handleApiWake(HttpRequest& req, HttpResponse& res)
+{
+    if (req.bodyLength() == 0)
+    {
+        res.send(400, "text/plain", "Empty body");
+        return;
+    }
+    res.send(200, "application/json", "{\"status\":\"ok\"}");
+}
+
+static void handleVersion(HttpRequest&, HttpResponse& res)
+{
+    res.send(200, "text/plain", "host");
+}
+
+static void handleStats(HttpRequest&, HttpResponse& res)
+{
+    char out[96];
+    snprintf(out, sizeof(out), "{\"http_connections_opened\":%u,\"http_connections_reused\":%u}",
+             (unsigned)server->connectionsOpened(), (unsigned)server->connectionsReused());
+    res.send(200, "application/json", out);
+}
+
+// Stand-in for /api/logs: numbered lines from `since` up to a moving head, as chunks
+static uint32_t logHead()
+{
+    return nowMs() / 10; // a new "line" every 10 ms
+}
+
+static size_t fillLogs(HttpResponse::Stream& st, char* buf, size_t cap, uint32_t, bool& done)
+{
+    size_t pos = 0;
+    while (st.cursor < logHead() && cap - pos > 48)
+    {
+        st.cursor++;
+        pos += (size_t)snprintf(buf + pos, cap - pos, "%u [INFO] host log line\n",
+                                (unsigned)st.cursor);
+    }
+    done = !st.flags && st.cursor >= logHead();
+    return pos;
+}
+
+static void handleLogs(HttpRequest& req, HttpResponse& res)
+{
+    char     arg[12];
+    uint32_t since = logHead() > 200 ? logHead() - 200 : 0;
+    if (req.arg("since", arg, sizeof(arg)))
+        since = (uint32_t)strtoul(arg, nullptr, 10);
+    bool follow = req.arg("follow", arg, sizeof(arg));
+    res.sendStream(200, "text/plain", fillLogs, since, follow ? 1 : 0);
+}
+
+static size_t fillMetrics(HttpResponse::Stream& st, char* buf, size_t cap, uint32_t, bool& done)
+{
+    return metrics::render(st.cursor, buf, cap, done);
+}
+
+static void handleMetrics(HttpRequest&, HttpResponse& res)
+{
+    res.sendStream(200, "text/plain; version=0.0.4", fillMetrics, 0);
+}
+
+static void handleNotFound(HttpRequest& req, HttpResponse& res)
+{
+    if (strncmp(req.path(), "/assets/", 8) == 0)
+    {
+        res.sendHeader("Content-Encoding", "gzip");
+        res.sendStatic(200, "application/javascript", assetBody, sizeof(assetBody));
+        return;
+    }
+    res.send(404, "text/plain", "Not found");
+}
+
+int main(int argc, char** argv)
+{
+    signal(SIGPIPE, SIG_IGN);
+    uint16_t port = argc > 1 ? (uint16_t)atoi(argv[1]) : 8080;
+    memset(assetBody, 'x', sizeof(assetBody));
+
+    static HttpServer instance(port);
+    server = &instance;
+
+    server->on("/", handleRoot);
+    server->on("/wol", handleWol);
+    server->on("/api/wake", HttpMethod::Post, handleApiWake);
+    server->on("/api/version", handleVersion);
+    server->on("/api/wol/stats", HttpMethod::Get, handleStats);
+    server->on("/api/logs", HttpMethod::Get, handleLogs);
+    server->on("/api/metrics", HttpMethod::Get, handleMetrics);
+    server->onNotFound(handleNotFound);
+    if (!server->begin())
+    {
+        perror("bind");
+        return 1;
+    }
+    printf("listening on http://127.0.0.1:%u/ (%d connection slots)\n", port,
+           HTTP_MAX_CONNECTIONS);
+    fflush(stdout);
+
+    while (true)
+    {
+        server->poll(nowMs());
+        usleep(100);
+    }
+}
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""In-flight cap check for the firmware built for the host.
+
+Holds HTTP_MAX_INFLIGHT requests half-sent on their own connections (each has sent
+part of its request line, so it counts as still being read), then sends one complete
+request on another connection. That request must be refused with 503 and Retry-After,
+and once the held requests are finished, a new one must be served again.
+
+    pio run -e native_app
+    python3 bench/inflight_cap.py --spawn .pio/build/native_app/program
+
+--inflight must match the build's HTTP_MAX_INFLIGHT (HTTP_MAX_CONNECTIONS - 1 = 3 by
+default). Only the standard library is used.
+"""
+import argparse
+import os
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def connect(port):
+    return socket.create_connection(("127.0.0.1", port), timeout=5)
+
+
+def read_response(sock):
+    """Status code and head of the response on `sock`, read until the connection closes
+    or the head is complete."""
+    data = b""
+    while b"\r\n\r\n" not in data:
+        chunk = sock.recv(4096)
+        if not chunk:
+            break
+        data += chunk
+    head = data.split(b"\r\n\r\n", 1)[0].decode(errors="replace")
+    parts = head.split(" ", 2)
+    return (int(parts[1]) if len(parts) > 1 and parts[1].isdigit() else 0), head
+
+
+def get(port, path):
+    sock = connect(port)
+    sock.sendall(f"GET {path} HTTP/1.1\r\nHost: sprout\r\nConnection: close\r\n\r\n".encode())
+    status, head = read_response(sock)
+    sock.close()
+    return status, head
+
+
+def wait_up(port, timeout):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        try:
+            if get(port, "/api/version")[0] == 200:
+                return True
+        except OSError:
+            pass
+        time.sleep(0.2)
+    return False
+
+
+def check(condition, message):
+    print(("ok   " if condition else "FAIL ") + message)
+    return condition
+
+
+def run(args):
+    held = []
+    try:
+        for _ in range(args.inflight):
+            sock = connect(args.port)
+            sock.sendall(b"GET /api/vers")  # the rest comes later
+            held.append(sock)
+        time.sleep(0.2)  # let the server read every partial request
+
+        status, head = get(args.port, "/api/version")
+        ok = check(status == 503 and "Retry-After:" in head,
+                   f"request {args.inflight + 1} with {args.inflight} in flight: {status}")
+
+        for sock in held:
+            sock.sendall(b"ion HTTP/1.1\r\nHost: sprout\r\nConnection: close\r\n\r\n")
+        served = [read_response(sock)[0] for sock in held]
+        ok &= check(all(s == 200 for s in served), f"held requests finished: {served}")
+
+        status, _ = get(args.port, "/api/version")
+        ok &= check(status == 200, f"request after they finished: {status}")
+    finally:
+        for sock in held:
+            sock.close()
+    return ok
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    p.add_argument("--port", type=int, default=8080, help="firmware HTTP port (HTTP_PORT)")
+    p.add_argument("--inflight", type=int, default=3, help="the build's HTTP_MAX_INFLIGHT")
+    p.add_argument("--spawn", help="start this native_app binary for the run")
+    args = p.parse_args()
+
+    proc = None
+    nvs = None
+    if args.spawn:
+        nvs = tempfile.TemporaryDirectory(prefix="inflight-")
+        env = dict(os.environ, NATIVE_HTTP_PORT=str(args.port), NATIVE_NVS_DIR=nvs.name)
+        proc = subprocess.Popen([args.spawn], env=env, stdout=subprocess.DEVNULL,
+                                stderr=subprocess.STDOUT)
+    try:
+        if not wait_up(args.port, 10):
+            print(f"nothing serving on port {args.port}")
+            return 1
+        ok = run(args)
+    finally:
+        if proc:
+            proc.terminate()
+            proc.wait()
+            nvs.cleanup()
+    print("PASS" if ok else "FAILED")
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
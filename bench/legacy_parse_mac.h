@@ -0,0 +1,78 @@
+// legacy_parse_mac.h
+// The MAC parser and packet builder as they shipped before the table-driven rewrite
+// in MagicPacket.h. Kept verbatim as the baseline for mac_parse_bench.cpp; do not
+// "fix" it, the benchmark measures against exactly this code.
+#ifndef LEGACY_PARSE_MAC_H
+#define LEGACY_PARSE_MAC_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace legacy
+{
+
+static const size_t MAC_LEN = 6;
+
+inline bool parseMac(const char* macStr, uint8_t mac[MAC_LEN])
+{
+    if (!macStr || !mac)
+        return false;
+    // Copy to a modifiable buffer
+    constexpr size_t BUF_SZ = 32;
+    char             buf[BUF_SZ];
+    size_t           len = strlen(macStr);
+    if (len >= sizeof(buf))
+        return false;
+    strcpy(buf, macStr);
+
+    // Remove separators
+    char*            p                   = buf;
+    constexpr size_t CLEANED_SZ          = 13; // 12 hex digits + null
+    constexpr size_t CLEANED_HEX         = 12;
+    char             cleaned[CLEANED_SZ] = {0};
+    size_t           ci                  = 0;
+    while (*p && ci < CLEANED_HEX)
+    {
+        if (*p == ':' || *p == '-' || *p == ' ')
+        {
+            p++;
+            continue;
+        }
+        cleaned[ci++] = *p++;
+    }
+    if (ci != CLEANED_HEX)
+        return false;
+
+    // Convert pairs
+    for (size_t i = 0; i < MAC_LEN; ++i)
+    {
+        char           pair[3]     = {cleaned[i * 2], cleaned[i * 2 + 1], '\0'};
+        char*          endptr      = nullptr;
+        constexpr int  STRTOL_BASE = 16;
+        constexpr long BYTE_MAX    = 0xFF;
+        long           val         = strtol(pair, &endptr, STRTOL_BASE);
+        if (endptr == pair || val < 0 || val > BYTE_MAX)
+            return false;
+        mac[i] = (uint8_t)val;
+    }
+    return true;
+}
+
+inline void buildPacket(const uint8_t mac[MAC_LEN], uint8_t* packet)
+{
+    // Build magic packet: 6 x 0xFF followed by MAC repeated 16 times
+    constexpr size_t  SYNC_COUNT = 6;
+    constexpr size_t  MAC_REP    = 16;
+    constexpr uint8_t SYNC_BYTE  = 0xFF;
+    for (size_t i = 0; i < SYNC_COUNT; ++i)
+        packet[i] = SYNC_BYTE;
+    for (size_t i = 0; i < MAC_REP; ++i)
+    {
+        memcpy(&packet[SYNC_COUNT + i * MAC_LEN], mac, MAC_LEN);
+    }
+}
+
+} // namespace legacy
+
+#endif // LEGACY_PARSE_MAC_H
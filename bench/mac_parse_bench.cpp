@@ -0,0 +1,258 @@
+// mac_parse_bench.cpp
+// Host-side check and microbenchmark for the MAC parser / packet builder in
+// MagicPacket.h, measured against the previous implementation (legacy_parse_mac.h).
+//
+//   pio run -e native -t exec                  (uses bench/corpus/mac_parse.txt)
+//   .pio/build/native/program <corpus> [iterations]
+//
+// Three stages, exit status is non-zero if either of the first two finds a problem:
+//   1. corpus:  every corpus line must parse (or be rejected) as annotated
+//   2. fuzz:    mutated corpus inputs must never be accepted by the new parser unless
+//               the legacy parser accepts them with identical bytes, and the
+//               compile-time and runtime builders must agree
+//   3. bench:   ns/parse and ns/packet for both implementations
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "MagicPacket.h"
+#include "legacy_parse_mac.h"
+
+namespace
+{
+
+struct CorpusEntry
+{
+    bool        expectOk;
+    std::string input;
+    std::string hex; // expected bytes as 12 hex digits; empty when not annotated
+};
+
+std::string unescape(const std::string& s)
+{
+    std::string out;
+    for (size_t i = 0; i < s.size(); ++i)
+    {
+        if (s[i] == '\\' && i + 1 < s.size())
+        {
+            char c = s[++i];
+            out += (c == 'n') ? '\n' : (c == 't') ? '\t' : (c == 'r') ? '\r' : c;
+            continue;
+        }
+        out += s[i];
+    }
+    return out;
+}
+
+bool loadCorpus(const char* path, std::vector<CorpusEntry>& out)
+{
+    FILE* f = fopen(path, "r");
+    if (!f)
+    {
+        fprintf(stderr, "cannot open corpus %s\n", path);
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), f))
+    {
+        std::string l(line);
+        while (!l.empty() && (l.back() == '\n' || l.back() == '\r'))
+            l.pop_back();
+        if (l.empty() || l[0] == '#')
+            continue;
+        size_t t1 = l.find('\t');
+        if (t1 == std::string::npos)
+            continue;
+        size_t      t2 = l.find('\t', t1 + 1);
+        CorpusEntry e;
+        e.expectOk = (l.compare(0, t1, "ok") == 0);
+        e.input    = unescape(l.substr(t1 + 1, t2 == std::string::npos ? std::string::npos
+                                                                       : t2 - t1 - 1));
+        if (t2 != std::string::npos)
+            e.hex = l.substr(t2 + 1);
+        out.push_back(e);
+    }
+    fclose(f);
+    return true;
+}
+
+std::string toHex(const uint8_t* b, size_t n)
+{
+    static const char* digits = "0123456789abcdef";
+    std::string        s;
+    for (size_t i = 0; i < n; ++i)
+    {
+        s += digits[b[i] >> 4];
+        s += digits[b[i] & 0xF];
+    }
+    return s;
+}
+
+int checkCorpus(const std::vector<CorpusEntry>& corpus)
+{
+    int failures = 0;
+    for (const CorpusEntry& e : corpus)
+    {
+        uint8_t mac[wol::MAC_LEN];
+        bool    ok = wol::parseMac(e.input.c_str(), mac);
+        if (ok != e.expectOk || (ok && !e.hex.empty() && toHex(mac, wol::MAC_LEN) != e.hex))
+        {
+            fprintf(stderr, "corpus: \"%s\" -> %s%s%s\n", e.input.c_str(), ok ? "ok " : "bad",
+                    ok ? toHex(mac, wol::MAC_LEN).c_str() : "", e.expectOk ? "" : " (want bad)");
+            failures++;
+        }
+    }
+    printf("corpus: %zu entries, %d failures\n", corpus.size(), failures);
+    return failures;
+}
+
+std::string mutate(std::string s, std::mt19937& rng)
+{
+    static const char alphabet[] = "0123456789abcdefABCDEFgG:- .x\t\n";
+    std::uniform_int_distribution<int> op(0, 3);
+    std::uniform_int_distribution<int> ch(0, (int)sizeof(alphabet) - 2);
+    int                                rounds = 1 + (int)(rng() % 3);
+    for (int r = 0; r < rounds; ++r)
+    {
+        size_t pos = s.empty() ? 0 : rng() % (s.size() + 1);
+        switch (op(rng))
+        {
+            case 0: // replace
+                if (pos < s.size())
+                    s[pos] = alphabet[ch(rng)];
+                break;
+            case 1: // insert
+                s.insert(s.begin() + pos, alphabet[ch(rng)]);
+                break;
+            case 2: // delete
+                if (pos < s.size())
+                    s.erase(pos, 1);
+                break;
+            default: // truncate
+                s.resize(pos);
+                break;
+        }
+    }
+    return s;
+}
+
+int fuzz(const std::vector<CorpusEntry>& corpus, size_t iterations)
+{
+    std::mt19937 rng(0x5eed);
+    int          failures = 0;
+    size_t       accepted = 0;
+    for (size_t i = 0; i < iterations && !corpus.empty(); ++i)
+    {
+        std::string in = mutate(corpus[i % corpus.size()].input, rng);
+
+        uint8_t now[wol::MAC_LEN];
+        uint8_t before[wol::MAC_LEN];
+        if (!wol::parseMac(in.c_str(), now))
+            continue;
+        accepted++;
+        if (!legacy::parseMac(in.c_str(), before) || memcmp(now, before, wol::MAC_LEN) != 0)
+        {
+            fprintf(stderr, "fuzz: \"%s\" accepted as %s, legacy disagrees\n", in.c_str(),
+                    toHex(now, wol::MAC_LEN).c_str());
+            failures++;
+            continue;
+        }
+
+        uint8_t           runtime[wol::PACKET_LEN];
+        uint8_t           reference[wol::PACKET_LEN];
+        const wol::Packet compiled = wol::makePacket(wol::parseMac(in.c_str()));
+        wol::fillPacket(now, runtime);
+        legacy::buildPacket(before, reference);
+        if (memcmp(runtime, reference, wol::PACKET_LEN) != 0 ||
+            memcmp(compiled.bytes, reference, wol::PACKET_LEN) != 0)
+        {
+            fprintf(stderr, "fuzz: packet mismatch for \"%s\"\n", in.c_str());
+            failures++;
+        }
+    }
+    printf("fuzz: %zu mutations, %zu accepted, %d failures\n", iterations, accepted, failures);
+    return failures;
+}
+
+template <typename Fn> double nsPerCall(size_t iterations, Fn fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+        fn(i);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / (double)iterations;
+}
+
+// Keeps results observable so the optimizer cannot drop the measured work
+volatile uint8_t sink;
+
+void bench(size_t iterations)
+{
+    const char* inputs[] = {"d8:43:ae:54:52:01", "D8-43-AE-54-52-01", "d843ae545201",
+                            "d8:43:ae:54:52:0g"};
+    const size_t n       = sizeof(inputs) / sizeof(inputs[0]);
+
+    double newParse = nsPerCall(iterations,
+                                [&](size_t i)
+                                {
+                                    uint8_t mac[wol::MAC_LEN] = {};
+                                    wol::parseMac(inputs[i % n], mac);
+                                    sink = mac[5];
+                                });
+    double oldParse = nsPerCall(iterations,
+                                [&](size_t i)
+                                {
+                                    uint8_t mac[wol::MAC_LEN] = {};
+                                    legacy::parseMac(inputs[i % n], mac);
+                                    sink = mac[5];
+                                });
+
+    uint8_t mac[wol::MAC_LEN] = {0xd8, 0x43, 0xae, 0x54, 0x52, 0x01};
+    uint8_t packet[wol::PACKET_LEN];
+    double  newBuild = nsPerCall(iterations,
+                                 [&](size_t i)
+                                 {
+                                     mac[0] = (uint8_t)i;
+                                     wol::fillPacket(mac, packet);
+                                     sink = packet[wol::PACKET_LEN - 1];
+                                 });
+    double  oldBuild = nsPerCall(iterations,
+                                 [&](size_t i)
+                                 {
+                                     mac[0] = (uint8_t)i;
+                                     legacy::buildPacket(mac, packet);
+                                     sink = packet[wol::PACKET_LEN - 1];
+                                 });
+
+    printf("bench: parseMac    legacy %7.1f ns  table %7.1f ns  (%.1fx)\n", oldParse, newParse,
+           oldParse / newParse);
+    printf("bench: buildPacket legacy %7.1f ns  words %7.1f ns  (%.1fx)\n", oldBuild, newBuild,
+           oldBuild / newBuild);
+}
+
+} // namespace
+
+// The default-MAC packet in main.cpp relies on this being a constant expression
+static constexpr wol::Packet compiledPacket = wol::makePacket(wol::parseMac("d8:43:ae:54:52:01"));
+static_assert(compiledPacket.bytes[0] == 0xFF && compiledPacket.bytes[6] == 0xd8 &&
+                  compiledPacket.bytes[wol::PACKET_LEN - 1] == 0x01,
+              "compile-time magic packet is wrong");
+static_assert(!wol::parseMac("d8:43-ae:54:52:01").valid, "mixed separators must be rejected");
+
+int main(int argc, char** argv)
+{
+    const char* corpusPath = argc > 1 ? argv[1] : "bench/corpus/mac_parse.txt";
+    size_t      iterations = argc > 2 ? (size_t)strtoull(argv[2], nullptr, 10) : 2000000;
+
+    std::vector<CorpusEntry> corpus;
+    if (!loadCorpus(corpusPath, corpus))
+        return 2;
+
+    int failures = checkCorpus(corpus);
+    failures += fuzz(corpus, iterations / 4);
+    bench(iterations);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,301 @@
+#!/usr/bin/env python3
+"""Relay test for several host builds of the firmware on loopback.
+
+Starts N copies of the native firmware, each standing for a node on its own subnet
+(NATIVE_WIFI_IP=10.0.<i+1>.10/24) with its own HTTP port, NVS directory, relay port and
+magic-packet sink. Node 0 has no seeds; the others are given node 0 only, so the mesh
+has to form through gossip. The test then checks that:
+
+  - every node comes to know every other one;
+  - a wake sent to any node for another node's subnet broadcast is relayed, acknowledged
+    and sent by the owner alone (a verification asked for is reported as unsupported),
+    and a wake with no broadcast address is sent locally;
+  - a retransmitted wake is acknowledged again with the same job but sent once;
+  - datagrams with a bad tag, or replayed from too far back, are dropped.
+
+    PLATFORMIO_WLAN_SSID=lab PLATFORMIO_WLAN_PSK=loopback pio run -e native_app
+    python3 bench/relay_loopback.py --spawn .pio/build/native_app/program -n 3
+
+A node only owns a subnet in station mode, hence the SSID and PSK.
+
+Only the standard library is used.
+"""
+import argparse
+import http.client
+import json
+import os
+import random
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+PACKET_LEN = 102
+MASK = (1 << 64) - 1
+
+# Datagram layout, as in src/wol/WakeRelay.cpp
+HELLO, WAKE, ACK = 1, 2, 3
+
+
+def rotl(x, b):
+    return ((x << b) | (x >> (64 - b))) & MASK
+
+
+def siphash24(key, data):
+    k0, k1 = struct.unpack("<QQ", key)
+    v = [k0 ^ 0x736F6D6570736575, k1 ^ 0x646F72616E646F6D,
+         k0 ^ 0x6C7967656E657261, k1 ^ 0x7465646279746573]
+
+    def rounds(n):
+        for _ in range(n):
+            v[0] = (v[0] + v[1]) & MASK
+            v[1] = rotl(v[1], 13) ^ v[0]
+            v[0] = rotl(v[0], 32)
+            v[2] = (v[2] + v[3]) & MASK
+            v[3] = rotl(v[3], 16) ^ v[2]
+            v[0] = (v[0] + v[3]) & MASK
+            v[3] = rotl(v[3], 21) ^ v[0]
+            v[2] = (v[2] + v[1]) & MASK
+            v[1] = rotl(v[1], 17) ^ v[2]
+            v[2] = rotl(v[2], 32)
+
+    whole = len(data) - len(data) % 8
+    for i in range(0, whole, 8):
+        (m,) = struct.unpack_from("<Q", data, i)
+        v[3] ^= m
+        rounds(2)
+        v[0] ^= m
+    last = (len(data) & 0xFF) << 56
+    for i, b in enumerate(data[whole:]):
+        last |= b << (8 * i)
+    v[3] ^= last
+    rounds(2)
+    v[0] ^= last
+    v[2] ^= 0xFF
+    rounds(4)
+    return v[0] ^ v[1] ^ v[2] ^ v[3]
+
+
+def seal(key, kind, sender, receiver, seq, body):
+    msg = b"SR" + bytes([1, kind]) + struct.pack(">III", sender, receiver, seq) + body
+    return msg + struct.pack("<Q", siphash24(key, msg))
+
+
+def wake_body(dest, mac, port=9):
+    return socket.inet_aton(dest) + mac + struct.pack(">BHBH", 1, 0, 1, port)
+
+
+def api(port, method, path, body=None):
+    conn = http.client.HTTPConnection("127.0.0.1", port, timeout=5)
+    payload = json.dumps(body).encode() if body is not None else None
+    conn.request(method, path, body=payload,
+                 headers={"Content-Type": "application/json"} if payload else {})
+    resp = conn.getresponse()
+    data = resp.read()
+    conn.close()
+    try:
+        return resp.status, json.loads(data)
+    except ValueError:
+        return resp.status, data.decode(errors="replace")
+
+
+def wait_for(predicate, timeout, what):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        if predicate():
+            return
+        time.sleep(0.5)  # well inside the per-client API rate limit
+    raise AssertionError(f"timed out waiting for {what}")
+
+
+def packets_for(sink, mac, timeout):
+    """Magic packets for `mac` the sink receives within `timeout` seconds."""
+    want = b"\xff" * 6 + mac * 16
+    count = 0
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        sink.settimeout(max(0.01, deadline - time.time()))
+        try:
+            data, _ = sink.recvfrom(2048)
+        except socket.timeout:
+            break
+        if len(data) == PACKET_LEN and data == want:
+            count += 1
+    return count
+
+
+def drain(sink):
+    sink.setblocking(False)
+    try:
+        while True:
+            sink.recvfrom(2048)
+    except BlockingIOError:
+        pass
+    sink.setblocking(True)
+
+
+class Node:
+    def __init__(self, index, args):
+        self.index = index
+        self.http = args.base_http + index
+        self.relay = args.base_relay + index
+        self.subnet = f"10.0.{index + 1}"
+        self.sink = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sink.bind(("127.0.0.1", 0))
+        self.nvs = tempfile.TemporaryDirectory(prefix=f"relay{index}-")
+        env = dict(os.environ,
+                   NATIVE_HTTP_PORT=str(self.http),
+                   NATIVE_NVS_DIR=self.nvs.name,
+                   NATIVE_WIFI_IP=f"{self.subnet}.10/24",
+                   WOL_NATIVE_BROADCAST=f"127.0.0.1:{self.sink.getsockname()[1]}")
+        self.log = open(os.path.join(self.nvs.name, "log.txt"), "w")
+        self.proc = subprocess.Popen([args.spawn], env=env, stdout=self.log,
+                                     stderr=subprocess.STDOUT)
+
+    def up(self):
+        try:
+            return api(self.http, "GET", "/api/version")[0] == 200
+        except OSError:
+            return False
+
+    def relay_info(self):
+        return api(self.http, "GET", "/api/relay")[1]
+
+    def live_peers(self):
+        return {p["subnet"] for p in self.relay_info()["peers"] if p["alive"]}
+
+    def stop(self):
+        self.proc.terminate()
+        self.proc.wait()
+        self.log.close()
+        self.sink.close()
+        self.nvs.cleanup()
+
+
+def check(condition, message):
+    print(("ok   " if condition else "FAIL ") + message)
+    return condition
+
+
+def run(args):
+    key = bytes(random.randrange(256) for _ in range(16))
+    nodes = [Node(i, args) for i in range(args.nodes)]
+    ok = True
+    try:
+        for n in nodes:
+            wait_for(n.up, 10, f"node {n.index} to serve HTTP")
+        for n in nodes:
+            seeds = [] if n.index == 0 else [f"127.0.0.1:{args.base_relay}"]
+            status, _ = api(n.http, "POST", "/api/relay",
+                            {"port": n.relay, "key": key.hex(), "seeds": seeds})
+            assert status == 200, f"node {n.index}: relay settings refused ({status})"
+            assert n.relay_info()["subnet"], f"node {n.index} has no subnet: build with an SSID"
+
+        want = {f"{n.subnet}.0/24" for n in nodes}
+        for n in nodes:
+            others = want - {f"{n.subnet}.0/24"}
+            wait_for(lambda: n.live_peers() >= others, 30, f"node {n.index} to see the mesh")
+        ok &= check(True, f"{len(nodes)} nodes found each other from one seed")
+
+        for src in nodes:
+            for dst in nodes:
+                mac = bytes([0x02, 0x52, src.index, dst.index, 0, random.randrange(256)])
+                mac_text = ":".join(f"{b:02x}" for b in mac)
+                body = {"mac": mac_text}
+                if src is not dst:
+                    body["broadcast"] = f"{dst.subnet}.255"
+                    body["verify"] = True  # not done for relayed wakes, and said so
+                for n in nodes:
+                    drain(n.sink)
+                status, reply = api(src.http, "POST", "/api/wake", body)
+                expected = "relayed" if src is not dst else "queued"
+                got = packets_for(dst.sink, mac, 2.0)
+                stray = sum(packets_for(n.sink, mac, 0.05) for n in nodes if n is not dst)
+                line = f"node {src.index} -> subnet of node {dst.index}: {status} {reply}"
+                ok &= check(status == 202 and reply.get("status") == expected and got == 1
+                            and stray == 0, line)
+                if src is not dst:
+                    ok &= check(reply.get("verify") == "unsupported",
+                                f"  relayed verify: {reply.get('verify')}")
+                    _, st = api(src.http, "GET", f"/api/relay/status?id={reply['relay']}")
+                    ok &= check(st.get("state") == "queued" and st.get("job", 0) > 0,
+                                f"  relay status {st}")
+
+        ok &= replay_checks(nodes[0], key, args)
+    finally:
+        for n in nodes:
+            n.stop()
+    print("PASS" if ok else "FAILED")
+    return 0 if ok else 1
+
+
+def replay_checks(node, key, args):
+    """Act as a relay node by hand against `node`: join, wake, retransmit, replay."""
+    ok = True
+    me = random.randrange(1, 1 << 32)
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("127.0.0.1", 0))
+    sock.settimeout(2)
+    target = ("127.0.0.1", node.relay)
+    seq = 100
+
+    def recv(kind):
+        while True:
+            data, _ = sock.recvfrom(2048)
+            if data[3] == kind:
+                return data
+
+    # First contact: the node answers with its nonce at once
+    hello_body = socket.inet_aton("0.0.0.0") + bytes([0, 0])
+    sock.sendto(seal(key, HELLO, me, 0, seq, hello_body), target)
+    (theirs,) = struct.unpack_from(">I", recv(HELLO), 4)
+    seq += 1
+    sock.sendto(seal(key, HELLO, me, theirs, seq, hello_body), target)
+
+    def rejected():
+        return node.relay_info()["rejected"]
+
+    before = rejected()
+    mac = bytes([0x02, 0x52, 0xEE, 0, 0, random.randrange(256)])
+    seq += 1
+    wake = seal(key, WAKE, me, theirs, seq, wake_body(f"{node.subnet}.255", mac))
+    drain(node.sink)
+    sock.sendto(wake, target)
+    first = recv(ACK)
+    sock.sendto(wake, target)  # as if the first ack were lost
+    second = recv(ACK)
+    job1 = struct.unpack_from(">IBI", first, 16)
+    job2 = struct.unpack_from(">IBI", second, 16)
+    sent = packets_for(node.sink, mac, 1.0)
+    ok &= check(job1 == job2 and job1[1] == 1 and sent == 1,
+                f"retransmitted wake: acks {job1} / {job2}, {sent} packet(s) sent")
+
+    forged = bytearray(seal(key, WAKE, me, theirs, seq + 1, wake_body(f"{node.subnet}.255", mac)))
+    forged[-1] ^= 1
+    sock.sendto(bytes(forged), target)
+    seq += 40
+    sock.sendto(seal(key, HELLO, me, theirs, seq, hello_body), target)  # moves the window
+    sock.sendto(wake, target)  # now too old to tell from a replay
+    time.sleep(0.3)
+    ok &= check(packets_for(node.sink, mac, 0.5) == 0 and rejected() - before == 2,
+                f"bad tag and stale replay dropped ({rejected() - before} rejected)")
+    sock.close()
+    return ok
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    p.add_argument("--spawn", required=True, help="native_app program to run as each node")
+    p.add_argument("-n", "--nodes", type=int, default=3)
+    p.add_argument("--base-http", type=int, default=8101, help="HTTP port of node 0")
+    p.add_argument("--base-relay", type=int, default=9101, help="relay port of node 0")
+    args = p.parse_args()
+    if args.nodes < 2:
+        p.error("need at least two nodes")
+    sys.exit(run(args))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,38 @@
+// Cron.h
+// Five-field cron expressions ("minute hour day-of-month month day-of-week"), compiled
+// to bit masks, and the next matching minute in local time (the TZ environment).
+// Platform independent (no Arduino dependencies) so it builds on the host.
+#ifndef CRON_H
+#define CRON_H
+
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * Each field takes `*`, a number, a range `a-b`, a step `*\/n` or `a-b/n`, or a list of
+ * those; months and weekdays also take names (jan, mon, ...), and Sunday is 0 or 7.
+ * @yearly, @monthly, @weekly, @daily and @hourly are accepted too. As in Vixie cron,
+ * when both day fields are restricted a day matching either one matches.
+ */
+struct CronExpr
+{
+    uint64_t minutes;  // bit n: minute n
+    uint32_t hours;    // bit n: hour n
+    uint32_t days;     // bit n: day of month n (1-31)
+    uint16_t months;   // bit n: month n (1-12)
+    uint8_t  weekdays; // bit n: weekday n (0 = Sunday)
+    bool     anyDay;   // day-of-month field was '*'
+    bool     anyWeekday;
+
+    // False when `text` is not a valid expression; `out` is then unspecified
+    static bool parse(const char* text, CronExpr& out);
+
+    // First matching minute strictly after `after`, or 0 when there is none in the
+    // next five years (e.g. "0 0 30 2 *"). A time skipped when the clocks go forward
+    // is due at the jump; one repeated when they go back is due once.
+    time_t next(time_t after) const;
+
+    bool matchesDay(const struct tm& tm) const;
+};
+
+#endif // CRON_H
@@ -0,0 +1,76 @@
+// EventStream.h
+// Server-Sent Events broadcast to many idle subscribers. A subscriber is a socket handed
+// over by HttpServer (HttpResponse::sendHandOff) plus a cursor into one shared ring of
+// rendered events, so it costs a few bytes rather than an HTTP connection slot. Events
+// are written without blocking as each socket drains; one that falls a whole ring behind
+// is closed, and its EventSource reconnects. Platform independent; one task only.
+#ifndef EVENTSTREAM_H
+#define EVENTSTREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "SseSubscribers.h"
+
+#ifndef EVENTS_MAX_SUBSCRIBERS
+#define EVENTS_MAX_SUBSCRIBERS 16
+#endif
+
+// Recent events kept for subscribers to catch up on (and Last-Event-ID to resume from)
+#ifndef EVENTS_RING_DEPTH
+#define EVENTS_RING_DEPTH 24
+#endif
+
+// Longest rendered event: the id, event and data lines together
+#ifndef EVENTS_MAX_LEN
+#define EVENTS_MAX_LEN 192
+#endif
+
+// A subscriber sent nothing for this long gets a comment line, which keeps proxies from
+// timing it out and finds peers that went away
+#ifndef EVENTS_HEARTBEAT_MS
+#define EVENTS_HEARTBEAT_MS 15000
+#endif
+
+class EventStream
+{
+  public:
+    // Take over `fd`, whose response head was already written. Events after
+    // `lastEventId` still in the ring are sent first; 0 starts with the next one.
+    // False when every subscriber slot is taken.
+    bool adopt(int fd, uint32_t lastEventId, uint32_t nowMs);
+
+    // Queue `data` (one line, e.g. JSON) as an `event` for every subscriber. Returns its
+    // id, or 0 if it is too long.
+    uint32_t publish(const char* event, const char* data);
+
+    // Write what each subscriber is owed, as far as its socket takes it. Call from the
+    // main loop.
+    void poll(uint32_t nowMs);
+
+    size_t   subscribers() const { return subs.size(); }
+    uint32_t lagged() const { return laggedOut; }
+
+  private:
+    struct Event
+    {
+        uint16_t len;
+        char     text[EVENTS_MAX_LEN];
+    };
+
+    struct Subscriber : sse::Peer
+    {
+        uint32_t next;   // id of the event to send next
+        uint16_t offset; // bytes of it already sent
+    };
+
+    // False once the subscriber had to be closed
+    bool flush(Subscriber& s, uint32_t nowMs);
+
+    Event                                                ring[EVENTS_RING_DEPTH];
+    // Ids start at 1, so 0 can mean "none"
+    uint32_t                                             nextId = 1;
+    sse::Subscribers<Subscriber, EVENTS_MAX_SUBSCRIBERS> subs;
+    uint32_t                                             laggedOut = 0;
+};
+
+#endif // EVENTSTREAM_H
@@ -0,0 +1,70 @@
+// HostRegistry.h
+// Saved wake targets, kept on the device so every client sees the same list. Hosts
+// live in a fixed in-RAM table with their magic packet built once, and are persisted
+// to NVS in pages of HOST_NVS_PAGE_SIZE records. Loop task only.
+#ifndef HOSTREGISTRY_H
+#define HOSTREGISTRY_H
+
+#include <Arduino.h>
+#include "WakeOnLan.h"
+
+// Hosts that can be saved. Each costs about 150 bytes of RAM.
+#ifndef HOST_REGISTRY_MAX
+#define HOST_REGISTRY_MAX 256
+#endif
+
+// Records per NVS blob: a change rewrites the one blob holding its host
+#ifndef HOST_NVS_PAGE_SIZE
+#define HOST_NVS_PAGE_SIZE 16
+#endif
+
+class HostRegistry
+{
+  public:
+    static constexpr size_t NAME_LEN = 32; // including the NUL
+
+    struct Host
+    {
+        uint32_t id;        // stable while the host exists; never reused for another
+        uint32_t broadcast; // network byte order
+        uint16_t port;      // 0 = WakeOnLan::DEFAULT_PORT
+        bool     used;
+        char     name[NAME_LEN];
+        uint8_t  mac[WakeOnLan::MAC_LEN];
+        uint8_t  packet[WakeOnLan::PACKET_LEN];
+    };
+
+    enum class Result : uint8_t
+    {
+        Ok,
+        NotFound,
+        Full,
+        StorageFailed, // NVS write failed; nothing was changed
+        Exists,        // the same target is already saved (add(): under the id given back)
+    };
+
+    // Open the NVS namespace and load the saved hosts
+    static bool begin();
+
+    // The host with `id`, or nullptr. O(1): the id names its table slot.
+    static const Host* find(uint32_t id);
+
+    // Save a new host and set `id`. `name` is cut to NAME_LEN - 1 bytes. A host with the
+    // same MAC, broadcast address and port is not saved twice: `id` is set to it instead.
+    static Result add(const char* name, const uint8_t mac[WakeOnLan::MAC_LEN],
+                      const IPAddress& broadcast, uint16_t port, uint32_t& id);
+    // Replace every field of an existing host. Refused with Exists when that would make
+    // it the same target as another saved host.
+    static Result update(uint32_t id, const char* name, const uint8_t mac[WakeOnLan::MAC_LEN],
+                         const IPAddress& broadcast, uint16_t port);
+    static Result remove(uint32_t id);
+
+    // Hosts in table order: returns the first one at or after slot `cursor` and moves
+    // `cursor` past it, or nullptr at the end
+    static const Host* next(uint32_t& cursor);
+
+    static size_t count();
+    static size_t capacity() { return HOST_REGISTRY_MAX; }
+};
+
+#endif // HOSTREGISTRY_H
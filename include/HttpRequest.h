@@ -0,0 +1,127 @@
+// HttpRequest.h
+// Incremental HTTP/1.x request parser with a fixed, per-connection buffer.
+// Platform independent (no Arduino dependencies) so the server core builds on the host.
+#ifndef HTTPREQUEST_H
+#define HTTPREQUEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Maximum size of one request (request line + headers + body), in bytes
+#ifndef HTTP_REQUEST_BUFFER_SIZE
+#define HTTP_REQUEST_BUFFER_SIZE 3072
+#endif
+
+// Maximum number of headers kept per request. Extra headers are ignored, except
+// Content-Length, Transfer-Encoding, Connection and Expect, which take the place of
+// another header.
+#ifndef HTTP_MAX_HEADERS
+#define HTTP_MAX_HEADERS 16
+#endif
+
+// Request methods. Values are bit flags so a route can accept several.
+enum class HttpMethod : uint8_t
+{
+    Get     = 1 << 0,
+    Post    = 1 << 1,
+    Put     = 1 << 2,
+    Delete  = 1 << 3,
+    Head    = 1 << 4,
+    Options = 1 << 5,
+    Other   = 1 << 6,
+    Any     = 0xFF,
+};
+
+constexpr HttpMethod operator|(HttpMethod a, HttpMethod b)
+{
+    return static_cast<HttpMethod>(static_cast<uint8_t>(a) | static_cast<uint8_t>(b));
+}
+
+class HttpRequest
+{
+  public:
+    enum class State : uint8_t
+    {
+        RequestLine,
+        Headers,
+        Body,
+        Complete,
+        Error,
+    };
+
+    // Forget the current request and start over with an empty buffer
+    void reset();
+
+    // Finish a Complete request and start on the next one. Bytes already received past
+    // its end (a pipelined request) are kept and parsed; returns the new state.
+    State next();
+
+    // Receive side: bytes are read straight into the request buffer, then committed.
+    // commit() parses whatever became available and returns the new state.
+    char*  writePtr() { return buf + len; }
+    size_t writeSpace() const { return HTTP_REQUEST_BUFFER_SIZE - len; }
+    State  commit(size_t n);
+
+    State  state() const { return st; }
+    size_t received() const { return len; } // bytes buffered, including pipelined ones
+    // HTTP status to answer with when state() == State::Error
+    int errorStatus() const { return error; }
+    // True once headers are in and the client asked for "Expect: 100-continue"
+    bool expectsContinue() const { return expectContinue; }
+    // Whether the client wants the connection kept open: the HTTP/1.1 default unless
+    // it sent "Connection: close", and only on request for HTTP/1.0
+    bool keepAlive() const;
+    // "HTTP/1.0" request line: no chunked response bodies
+    bool isHttp10() const { return http10; }
+
+    HttpMethod  method() const { return meth; }
+    const char* methodName() const { return methodStr; }
+    const char* path() const { return pathStr; }
+    const char* query() const { return queryStr; } // "" when there is none
+
+    // Case-insensitive header lookup; nullptr when absent
+    const char* header(const char* name) const;
+
+    // Request body (NUL-terminated); "" when there is none
+    const char* body() const { return bodyLen ? buf + bodyStart : ""; }
+    size_t      bodyLength() const { return bodyLen; }
+
+    // Query-string arguments. arg() URL-decodes the value into `out` (always
+    // NUL-terminated) and returns false when the argument is absent or does not fit.
+    bool hasArg(const char* name) const;
+    bool arg(const char* name, char* out, size_t outLen) const;
+
+  private:
+    struct Header
+    {
+        const char* name;
+        const char* value;
+    };
+
+    bool parseLine(char* line, char* end);
+    bool parseRequestLine(char* line);
+    bool parseHeaderLine(char* line);
+    void fail(int status);
+    bool findArg(const char* name, const char** value, size_t* valueLen) const;
+
+    char        buf[HTTP_REQUEST_BUFFER_SIZE + 1]; // +1 keeps the body NUL-terminated
+    size_t      len            = 0;                // bytes received
+    size_t      scan           = 0;                // start of the next unparsed line
+    size_t      bodyStart      = 0;
+    size_t      bodyLen        = 0;
+    size_t      contentLength  = 0;
+    size_t      requestEnd     = 0;    // end of a Complete request within buf
+    char        spill          = '\0'; // byte at requestEnd, overwritten by the body's NUL
+    State       st             = State::RequestLine;
+    int         error          = 0;
+    bool        expectContinue = false;
+    bool        http10         = false;
+    HttpMethod  meth           = HttpMethod::Other;
+    const char* methodStr      = "";
+    const char* pathStr        = "";
+    const char* queryStr       = "";
+    Header      headers[HTTP_MAX_HEADERS];
+    size_t      headerCount = 0;
+};
+
+#endif // HTTPREQUEST_H
@@ -0,0 +1,133 @@
+// HttpResponse.h
+// Buffered HTTP response for one connection. Handlers fill it in; HttpServer drains
+// it to the socket without blocking. Platform independent.
+#ifndef HTTPRESPONSE_H
+#define HTTPRESPONSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Status line, headers and any copied body must fit in this many bytes
+#ifndef HTTP_RESPONSE_BUFFER_SIZE
+#define HTTP_RESPONSE_BUFFER_SIZE 2048
+#endif
+
+// Space for headers added with sendHeader() before send()
+#ifndef HTTP_EXTRA_HEADERS_SIZE
+#define HTTP_EXTRA_HEADERS_SIZE 256
+#endif
+
+class HttpResponse
+{
+  public:
+    // State a streamed body carries between fills; its meaning is up to the fill function
+    struct Stream
+    {
+        uint32_t cursor;
+        uint32_t lastMs; // when the fill last produced data
+        uint8_t  flags;
+    };
+
+    // Writes the next part of a streamed body into `buf` (at most `cap` bytes) and sets
+    // `done` after the last part. Returning 0 without `done` means nothing is ready yet:
+    // the server asks again on a later poll.
+    using StreamFill = size_t (*)(Stream& stream, char* buf, size_t cap, uint32_t nowMs,
+                                  bool& done);
+
+    // Drop any queued response and extra headers
+    void reset();
+
+    // Queue an extra header for the next send*() call
+    void sendHeader(const char* name, const char* value);
+
+    // Queue a complete response. The body is copied into the response buffer; a body
+    // that does not fit is replaced by a 500.
+    void send(int code, const char* contentType, const char* body);
+    void sendBytes(int code, const char* contentType, const uint8_t* body, size_t length);
+
+    // Queue a complete response whose body is sent straight from `body` without a
+    // copy. The caller guarantees it outlives the response (e.g. data in flash).
+    void sendStatic(int code, const char* contentType, const uint8_t* body, size_t length);
+
+    // Queue a response whose status line and headers were rendered ahead of time (e.g.
+    // at build time). Both blocks are written as-is with no copy, so they must outlive
+    // the response; extra headers from sendHeader() are not used. The block ends after
+    // the last header's CRLF: the Connection header and blank line are added here.
+    void sendPrerendered(const char* head, size_t headLength, const uint8_t* body,
+                         size_t bodyLength);
+
+    // Queue a response whose body is produced piece by piece by `fill` as the socket
+    // drains, sent with chunked transfer encoding. Nothing is allocated per piece: each
+    // is written into the response buffer once the previous one is on the wire. An
+    // HTTP/1.0 client gets the body unframed instead, ended by closing the connection.
+    void sendStream(int code, const char* contentType, StreamFill fill, uint32_t cursor,
+                    uint8_t flags = 0);
+
+    // Receives a connection's socket once a hand-off response's head is written, and
+    // owns it from then on; false closes it
+    using HandOff = bool (*)(int fd, uint32_t arg);
+
+    // Queue just the head of a response whose body has no end: once it is written the
+    // server frees the connection's slot and gives the socket to `adopt`, which keeps
+    // writing to it (e.g. a Server-Sent Events feed). Always "Connection: close".
+    void sendHandOff(int code, const char* contentType, HandOff adopt, uint32_t arg);
+    HandOff  handOff() const { return adopter; }
+    uint32_t handOffArg() const { return adopterArg; }
+
+    // Leave the body off the wire (HEAD requests); Content-Length is still reported
+    void setHeadOnly(bool headOnly) { omitBody = headOnly; }
+
+    // Answer with "Connection: keep-alive" instead of "close". Set by the server before
+    // the handler runs.
+    void setKeepAlive(bool on) { persistent = on; }
+    bool keepAlive() const { return persistent; }
+
+    // The client speaks HTTP/1.0 and cannot read a chunked body. Set by the server before
+    // the handler runs.
+    void setHttp10(bool on) { http10 = on; }
+
+    bool started() const { return headLen != 0; }
+    int  status() const { return code; }
+
+    // Transport side: next bytes to write, and how many of them were written
+    const uint8_t* pending(size_t& length) const;
+    void           advance(size_t n);
+    bool           finished() const;
+    // Streamed responses: once pending() is empty, fetch the next piece. False when the
+    // stream has nothing new (or is not a stream).
+    bool refill(uint32_t nowMs);
+
+    static const char* statusText(int code);
+
+  private:
+    // contentLength == CHUNKED announces a chunked body instead of a length, UNTIL_CLOSE
+    // neither (the body ends when the connection does)
+    static constexpr size_t CHUNKED     = (size_t)-1;
+    static constexpr size_t UNTIL_CLOSE = (size_t)-2;
+
+    bool writeHead(int code, const char* contentType, size_t contentLength);
+
+    uint8_t        out[HTTP_RESPONSE_BUFFER_SIZE];
+    size_t         outLen = 0;
+    char           extra[HTTP_EXTRA_HEADERS_SIZE];
+    size_t         extraLen   = 0;
+    const uint8_t* head       = out; // first segment: `out` or a pre-rendered block
+    size_t         headLen    = 0;
+    const uint8_t* tail       = nullptr; // Connection header after a pre-rendered block
+    size_t         tailLen    = 0;
+    const uint8_t* staticBody = nullptr;
+    size_t         staticLen  = 0;
+    size_t         written    = 0; // bytes of head + tail + staticBody already on the wire
+    int            code       = 0;
+    bool           omitBody   = false;
+    bool           persistent = false;
+    bool           http10     = false;
+    bool           chunked    = false; // streamed body is framed as chunks
+    StreamFill     fill       = nullptr; // set while a streamed body is unfinished
+    bool           ended      = false;   // a streamed body's last piece was taken
+    Stream         stream     = {};
+    HandOff        adopter    = nullptr;
+    uint32_t       adopterArg = 0;
+};
+
+#endif // HTTPRESPONSE_H
@@ -0,0 +1,174 @@
+// HttpServer.h
+// Non-blocking, multi-connection HTTP/1.1 server over BSD sockets (lwIP on the ESP32,
+// POSIX on the host). poll() never waits on a client: each connection is read and
+// written as far as the socket allows, so one slow browser cannot hold up the rest.
+#ifndef HTTPSERVER_H
+#define HTTPSERVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "Metrics.h"
+
+// Connections served concurrently; further clients wait in the listen backlog
+#ifndef HTTP_MAX_CONNECTIONS
+#define HTTP_MAX_CONNECTIONS 4
+#endif
+
+// A connection that makes no progress for this long is dropped
+#ifndef HTTP_IDLE_TIMEOUT_MS
+#define HTTP_IDLE_TIMEOUT_MS 5000
+#endif
+
+// How long a kept-alive connection may sit between requests. An idle one is also closed
+// early when a new client needs its slot.
+#ifndef HTTP_KEEPALIVE_TIMEOUT_MS
+#define HTTP_KEEPALIVE_TIMEOUT_MS 5000
+#endif
+
+// Requests served on one connection before it is closed; 1 disables keep-alive
+#ifndef HTTP_KEEPALIVE_MAX_REQUESTS
+#define HTTP_KEEPALIVE_MAX_REQUESTS 32
+#endif
+
+// While a streamed response waits for its next piece, wait() returns at least this often
+// so the stream can be refilled
+#ifndef HTTP_STREAM_POLL_MS
+#define HTTP_STREAM_POLL_MS 50
+#endif
+
+// Requests being read at once (begun but not yet handed to their handler); one arriving
+// beyond that is refused with 503 rather than left to hold its slot. Answers still being
+// written do not count. One below the slot count by default, so slow or stalled senders
+// can never hold every slot.
+#ifndef HTTP_MAX_INFLIGHT
+#define HTTP_MAX_INFLIGHT (HTTP_MAX_CONNECTIONS - 1)
+#endif
+
+// A connection closed after an answer is half-closed and read to its end for up to this
+// long first: closing with input unread resets it, which can lose the answer
+#ifndef HTTP_DRAIN_MS
+#define HTTP_DRAIN_MS 500
+#endif
+
+#ifndef HTTP_MAX_ROUTES
+#define HTTP_MAX_ROUTES 24
+#endif
+
+class HttpServer
+{
+  public:
+    using Handler = void (*)(HttpRequest& req, HttpResponse& res);
+
+    explicit HttpServer(uint16_t port) : port(port) {}
+
+    // Register a handler for an exact path, or for every path starting with `path` up to
+    // a trailing '*' ("/api/hosts/*"). The first registered match wins. Requests whose
+    // path matches but whose method does not fall through to the not-found handler, as
+    // with the Arduino WebServer.
+    // Each route (and the not-found handler, as route "*") gets a latency histogram,
+    // request parsed to last byte written, in the http_request_duration_seconds metric.
+    void on(const char* path, Handler handler) { on(path, HttpMethod::Any, handler); }
+    void on(const char* path, HttpMethod methods, Handler handler);
+    void onNotFound(Handler handler);
+
+    // Open the listening socket. Returns false if it could not be bound.
+    bool begin();
+
+    // Accept, read, dispatch and write as far as possible without blocking.
+    // Call from the main loop with the current time in milliseconds.
+    void poll(uint32_t nowMs);
+
+    // Block until a socket has something for poll() to do, or `timeoutMs` passes, so the
+    // main loop can sleep between requests instead of spinning
+    void wait(uint32_t timeoutMs);
+
+    size_t activeConnections() const;
+
+    // TCP connections accepted, and requests that arrived on an already-open one (each
+    // a handshake saved by keep-alive)
+    uint32_t connectionsOpened() const { return opened; }
+    uint32_t connectionsReused() const { return reused; }
+
+    // millis() when the first request was dispatched, or 0 before then
+    uint32_t firstRequestMs() const { return firstRequest; }
+
+    // Admission control, asked once a request's head is parsed and before its body is
+    // read: 0 serves it, anything else is the status to refuse it with (e.g. 429), with
+    // `retryAfterS` for the Retry-After header. A refusal is a few bytes, and closes the
+    // connection.
+    using Admission = int (*)(uint32_t peerAddr, const HttpRequest& req, uint32_t nowMs,
+                              uint32_t& retryAfterS);
+    void onAdmit(Admission admission) { admit = admission; }
+
+    // Requests refused because HTTP_MAX_INFLIGHT others were still being read
+    const metrics::Counter& shedBusy() const { return busy; }
+
+    // Called with the latency of every request, as also recorded per route
+    using Observer = void (*)(uint32_t us);
+    void onServed(Observer observer) { servedObserver = observer; }
+
+  private:
+    struct Route
+    {
+        const char*        path;
+        uint16_t           prefixLen; // bytes before the '*' of a wildcard route
+        bool               wildcard;
+        uint8_t            methods;
+        Handler            handler;
+        metrics::Histogram latency;
+    };
+
+    static constexpr uint8_t NO_ROUTE = 0xFF; // an error answered by the server itself
+
+    struct Connection
+    {
+        enum class Phase : uint8_t
+        {
+            Free,
+            Reading,
+            Writing,
+            Draining, // answered and half-closed; discarding input until the peer closes
+        };
+
+        int          fd       = -1;
+        Phase        phase    = Phase::Free;
+        uint32_t     lastIo   = 0;
+        uint32_t     peerAddr = 0;        // IPv4, network byte order
+        uint16_t     served   = 0;        // responses completed on this connection
+        uint8_t      route    = NO_ROUTE; // routes[] index, or routeCount for not-found
+        uint32_t     startUs  = 0;        // when the current request was dispatched
+        HttpRequest  req;
+        HttpResponse res;
+    };
+
+    void        acceptClients(uint32_t nowMs);
+    Connection* idleSlot();
+    void        readFrom(Connection& c, uint32_t nowMs);
+    void        writeTo(Connection& c, uint32_t nowMs);
+    void        dispatch(Connection& c);
+    void        handleParsed(Connection& c, HttpRequest::State before, uint32_t nowMs);
+    bool        admitted(Connection& c, uint32_t nowMs);
+    void        refuse(Connection& c, int status, uint32_t retryAfterS);
+    void        linger(Connection& c, uint32_t nowMs);
+    void        drainFrom(Connection& c);
+    void        drop(Connection& c);
+    static bool waiting(const Connection& c);
+
+    uint16_t           port;
+    int                listenFd = -1;
+    Route              routes[HTTP_MAX_ROUTES];
+    size_t             routeCount = 0;
+    Handler            notFound   = nullptr;
+    metrics::Histogram notFoundLatency;
+    Connection         conns[HTTP_MAX_CONNECTIONS];
+    uint32_t           opened         = 0;
+    uint32_t           reused         = 0;
+    uint32_t           firstRequest   = 0;
+    Observer           servedObserver = nullptr;
+    Admission          admit          = nullptr;
+    metrics::Counter   busy;
+};
+
+#endif // HTTPSERVER_H
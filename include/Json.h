@@ -0,0 +1,153 @@
+// Json.h
+// Zero-allocation JSON for the API handlers: a single-pass tokenizer that indexes a
+// request body in place, and a writer that renders into a fixed buffer.
+// Platform independent (no Arduino dependencies) so it builds on the host.
+#ifndef JSON_H
+#define JSON_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Tokens one Document can hold: every value, key, object and array takes one
+#ifndef JSON_MAX_TOKENS
+#define JSON_MAX_TOKENS 256
+#endif
+
+// Deepest nesting of objects and arrays the tokenizer accepts
+#ifndef JSON_MAX_DEPTH
+#define JSON_MAX_DEPTH 8
+#endif
+
+namespace json
+{
+
+enum class Type : uint8_t
+{
+    Object,
+    Array,
+    String,
+    Number,
+    True,
+    False,
+    Null,
+};
+
+enum class Error : uint8_t
+{
+    None,
+    Syntax,    // not JSON, or input ended inside a value
+    TooDeep,   // nesting beyond JSON_MAX_DEPTH
+    TooLarge,  // more than JSON_MAX_TOKENS tokens
+};
+
+/**
+ * One value (or object key) in the input. Strings point inside the quotes and are
+ * still escaped; string() decodes them.
+ */
+struct Token
+{
+    Type     type;
+    uint16_t start;  // offset into the input
+    uint16_t length; // bytes in the input
+    uint16_t span;   // tokens in this subtree, itself included
+    uint16_t count;  // members of an object, elements of an array
+};
+
+/**
+ * Token index of an input, built in one pass without copying or allocating. An
+ * object's children are its keys and values, alternating; an array's are its
+ * elements. Walk them with child() and next():
+ *
+ *     for (size_t i = doc.child(obj), n = 0; n < doc[obj].count; i = doc.next(i), ++n)
+ */
+class Document
+{
+  public:
+    static constexpr size_t NONE = (size_t)-1;
+
+    // Index `text` (which must outlive the document). Anything but exactly one JSON
+    // value, optionally surrounded by whitespace, is rejected.
+    Error parse(const char* text, size_t length);
+
+    Error  error() const { return err; }
+    size_t errorOffset() const { return errorAt; } // byte where parsing stopped
+    size_t size() const { return count; }
+
+    const Token& operator[](size_t i) const { return tokens[i]; }
+
+    size_t child(size_t i) const { return i + 1; }
+    size_t next(size_t i) const { return i + tokens[i].span; }
+
+    // Value of `key` in the object at `object`, or NONE (also when it is not an object)
+    size_t find(size_t object, const char* key) const;
+
+    // Decode the string at `i` into `out` (always NUL-terminated). False when it is not
+    // a string or does not fit.
+    bool string(size_t i, char* out, size_t outLen) const;
+    // Whether the string at `i` decodes to exactly `s`
+    bool equals(size_t i, const char* s) const;
+    // A non-negative integer (no fraction or exponent) that fits in 32 bits
+    bool number(size_t i, uint32_t& out) const;
+
+    bool is(size_t i, Type type) const { return i < count && tokens[i].type == type; }
+
+  private:
+    size_t add(Type type, size_t start);
+    Error  fail(Error e, size_t at);
+
+    const char* text    = "";
+    Token       tokens[JSON_MAX_TOKENS];
+    size_t      count   = 0;
+    Error       err     = Error::None;
+    size_t      errorAt = 0;
+};
+
+// Short reason for an error, for 400 responses
+const char* describe(Error e);
+
+/**
+ * Renders JSON into a fixed buffer, adding commas and escaping strings. Once the
+ * buffer overflows every later call is ignored and ok() turns false; the output is
+ * always NUL-terminated.
+ *
+ *     json::Writer w(buf, sizeof(buf));
+ *     w.beginObject().key("job").number(id).key("status").string("queued").endObject();
+ */
+class Writer
+{
+  public:
+    Writer(char* buf, size_t cap);
+
+    Writer& beginObject();
+    Writer& endObject();
+    Writer& beginArray();
+    Writer& endArray();
+    Writer& key(const char* name);
+    Writer& string(const char* s);
+    Writer& number(uint32_t v);
+    Writer& boolean(bool v);
+    Writer& null();
+
+    bool        ok() const { return !overflow; }
+    const char* c_str() const { return buf; }
+    size_t      length() const { return pos; }
+
+  private:
+    void separate();
+    void put(char c);
+    void put(const char* s, size_t n);
+    void open(char c);
+    void close(char c);
+
+    char*    buf;
+    size_t   cap;
+    size_t   pos      = 0;
+    uint32_t nonEmpty = 0; // bit d: the container at depth d already has an item
+    uint8_t  depth    = 0;
+    bool     afterKey = false;
+    bool     overflow = false;
+};
+
+} // namespace json
+
+#endif // JSON_H
@@ -0,0 +1,59 @@
+// LogTail.h
+// Live tail of the log history (/api/logs?follow=1) as Server-Sent Events. Like
+// EventStream, a subscriber is a socket handed over by HttpServer plus a cursor, here
+// into the numbered lines `read` returns (logger::readHistory), so an open tail does not
+// hold an HTTP connection slot. Each line is one event whose id is its number, for
+// Last-Event-ID. A subscriber whose line is overwritten before its socket took all of it
+// is closed, and its EventSource reconnects. Platform independent; one task only.
+#ifndef LOGTAIL_H
+#define LOGTAIL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "SseSubscribers.h"
+
+#ifndef LOG_TAIL_MAX_SUBSCRIBERS
+#define LOG_TAIL_MAX_SUBSCRIBERS 4
+#endif
+
+// An idle tail gets a comment line this often, which finds peers that went away
+#ifndef LOG_SSE_HEARTBEAT_MS
+#define LOG_SSE_HEARTBEAT_MS 15000
+#endif
+
+class LogTail
+{
+  public:
+    // Reads the oldest line numbered above `after`, as logger::readHistory does
+    using Reader = uint32_t (*)(uint32_t after, char* out, size_t cap, size_t& length);
+
+    explicit LogTail(Reader read) : read(read) {}
+
+    // Take over `fd`, whose response head was already written, and send the lines
+    // numbered above `after` still in the history. False when every slot is taken.
+    bool adopt(int fd, uint32_t after, uint32_t nowMs);
+
+    // Write the lines each subscriber is owed, as far as its socket takes them. Call
+    // from the main loop.
+    void poll(uint32_t nowMs);
+
+    size_t   subscribers() const { return subs.size(); }
+    uint32_t lagged() const { return laggedOut; }
+
+  private:
+    struct Subscriber : sse::Peer
+    {
+        uint32_t cursor; // last line sent whole
+        uint32_t line;   // line being sent, 0 = none
+        uint16_t offset; // bytes of its event already sent
+    };
+
+    // False once the subscriber had to be closed
+    bool flush(Subscriber& s, uint32_t nowMs);
+
+    Reader                                                 read;
+    sse::Subscribers<Subscriber, LOG_TAIL_MAX_SUBSCRIBERS> subs;
+    uint32_t                                               laggedOut = 0;
+};
+
+#endif // LOGTAIL_H
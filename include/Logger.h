@@ -21,6 +21,8 @@
 #include <Arduino.h>
 #include <cstdarg>
 #include <cstdio>
+#include <cstring>
+#include <type_traits>
 
 #if defined(ESP8266)
 #include "core_esp8266_features.h"
@@ -31,15 +33,69 @@
 
 #define WHEEZER_MAX_LOG_LENGTH 255
 
+// Log records that can wait for the drain task (power of two). Records logged while the
+// ring is full are dropped and counted, never waited for.
+#ifndef LOG_RING_DEPTH
+#define LOG_RING_DEPTH 64
+#endif
+
+// Space for one record's arguments; strings are copied in and truncated to fit
+#ifndef LOG_ARG_BYTES
+#define LOG_ARG_BYTES 80
+#endif
+
+// The drain task formats and prints records; it sleeps this long when the ring is empty
+#ifndef LOG_TASK_PRIORITY
+#define LOG_TASK_PRIORITY 1
+#endif
+
+#ifndef LOG_DRAIN_INTERVAL_MS
+#define LOG_DRAIN_INTERVAL_MS 10
+#endif
+
+// Formatted lines kept in RAM for /api/logs, oldest overwritten first. Each slot holds
+// one line cut to LOG_HISTORY_LINE_LEN - 1 characters; 0 lines disables the history.
+#ifndef LOG_HISTORY_LINES
+#define LOG_HISTORY_LINES 64
+#endif
+
+#ifndef LOG_HISTORY_LINE_LEN
+#define LOG_HISTORY_LINE_LEN 128
+#endif
+
+// Calls below this level (0 = Debug ... 5 = Wtf) are compiled out, arguments and all
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+// Per-module thresholds, e.g. -DLOG_LEVEL_HTTP=3 keeps only warnings and up there
+#ifndef LOG_LEVEL_MAIN
+#define LOG_LEVEL_MAIN LOG_MIN_LEVEL
+#endif
+#ifndef LOG_LEVEL_WOL
+#define LOG_LEVEL_WOL LOG_MIN_LEVEL
+#endif
+#ifndef LOG_LEVEL_HTTP
+#define LOG_LEVEL_HTTP LOG_MIN_LEVEL
+#endif
+
+// A source file opts into its module's threshold by defining this before any include
+#ifndef LOG_MODULE_LEVEL
+#define LOG_MODULE_LEVEL LOG_MIN_LEVEL
+#endif
+
+#include "generated/log_sites.h"
+
 namespace logger
 {
 
+// Lines printed so far (counted by whoever drains the ring)
 inline long int logNumber = 0;
 
 /**
  * Log level definitions using strongly-typed enum class for type safety
  */
-enum class Level
+enum class Level : uint8_t
 {
     Debug   = 0,
     Verbose = 1,
@@ -73,6 +129,218 @@ inline const char* levelToString(Level level)
     }
 }
 
+/**
+ * File name without its directories, at compile time
+ */
+constexpr const char* basename(const char* path)
+{
+    const char* base = path;
+    for (const char* p = path; *p; ++p)
+    {
+        if (*p == '/' || *p == '\\')
+            base = p + 1;
+    }
+    return base;
+}
+
+constexpr bool sameString(const char* a, const char* b)
+{
+    while (*a && *a == *b)
+    {
+        ++a;
+        ++b;
+    }
+    return *a == *b;
+}
+
+/**
+ * Id of the log call at `line` of `file` in the generated site table; 0 when missing
+ */
+constexpr uint16_t siteId(const char* file, int line)
+{
+    for (uint16_t i = 1; i < log_site_count; ++i)
+    {
+        const LogSite& s = log_sites[i];
+        if (s.file && line >= s.first && line <= s.last && sameString(file, s.file))
+            return i;
+    }
+    return 0;
+}
+
+/**
+ * One log call in binary form: the call-site id (file, function, line and format live
+ * in the generated table) and the arguments as tagged raw values, so formatting happens
+ * later, off the caller's path
+ */
+struct Record
+{
+    uint32_t timestamp; // millis()
+    uint16_t site;
+    Level    level;
+    uint8_t  argLen; // bytes used in args
+    uint8_t  args[LOG_ARG_BYTES];
+};
+
+namespace detail
+{
+
+enum class ArgType : uint8_t
+{
+    S32,
+    U32,
+    S64,
+    U64,
+    F64,
+    Str, // NUL-terminated copy follows the tag
+    Ptr,
+};
+
+inline void packRaw(Record& r, ArgType type, const void* value, size_t len)
+{
+    if (r.argLen + 1 + len > sizeof(r.args))
+    {
+        r.argLen = sizeof(r.args); // no room: this and later arguments print as "?"
+        return;
+    }
+    r.args[r.argLen] = static_cast<uint8_t>(type);
+    memcpy(r.args + r.argLen + 1, value, len);
+    r.argLen += 1 + len;
+}
+
+inline void packString(Record& r, const char* s)
+{
+    if (!s)
+        s = "(null)";
+    if ((size_t)r.argLen + 2 > sizeof(r.args))
+    {
+        r.argLen = sizeof(r.args);
+        return;
+    }
+    // Copy up to the NUL or the end of the room, whichever comes first. strnlen() bounded
+    // by the room alone trips -Wstringop-overread on short literals.
+    size_t   room = sizeof(r.args) - r.argLen - 2;
+    uint8_t* out  = r.args + r.argLen + 1;
+    size_t   n    = 0;
+    while (n < room && s[n])
+    {
+        out[n] = static_cast<uint8_t>(s[n]);
+        n++;
+    }
+
+    r.args[r.argLen] = static_cast<uint8_t>(ArgType::Str);
+    out[n]           = '\0';
+    r.argLen += 2 + n;
+}
+
+template <typename T> struct Unsupported : std::false_type
+{
+};
+
+template <typename T> inline void pack(Record& r, T v)
+{
+    if constexpr (std::is_same_v<T, const char*> || std::is_same_v<T, char*>)
+    {
+        packString(r, v); // copied: the caller's buffer may be gone by format time
+    }
+    else if constexpr (std::is_floating_point_v<T>)
+    {
+        double d = v;
+        packRaw(r, ArgType::F64, &d, sizeof(d));
+    }
+    else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>)
+    {
+        constexpr bool wide = sizeof(T) > 4;
+        constexpr bool sgn  = std::is_signed_v<T>;
+        if constexpr (wide)
+        {
+            uint64_t u = static_cast<uint64_t>(v);
+            packRaw(r, sgn ? ArgType::S64 : ArgType::U64, &u, sizeof(u));
+        }
+        else
+        {
+            uint32_t u = static_cast<uint32_t>(v);
+            packRaw(r, sgn ? ArgType::S32 : ArgType::U32, &u, sizeof(u));
+        }
+    }
+    else if constexpr (std::is_pointer_v<T>)
+    {
+        const void* p = v;
+        packRaw(r, ArgType::Ptr, &p, sizeof(p));
+    }
+    else
+    {
+        static_assert(Unsupported<T>::value,
+                      "log arguments must be numbers, pointers or C strings");
+    }
+}
+
+} // namespace detail
+
+/**
+ * Queue a record for the drain task. Safe from any task; never blocks. Returns false
+ * (and counts a drop) when the ring is full.
+ */
+bool submit(const Record& record);
+
+/**
+ * Start the low-priority task that formats queued records and writes them to Serial.
+ * Records logged before this are kept (up to LOG_RING_DEPTH) and printed once it runs.
+ */
+bool begin();
+
+/**
+ * Format and print everything queued, on the calling task, and wait for the UART to
+ * finish. For crash paths; must not be called from the drain task itself.
+ */
+void flush();
+
+/**
+ * Records dropped because the ring was full
+ */
+uint32_t dropped();
+
+/**
+ * Sequence number of the newest line in the history (lines are numbered from 1), or 0
+ * before anything was logged
+ */
+uint32_t historyHead();
+
+/**
+ * Copy the oldest retained history line numbered above `after` into `out` (no NUL added)
+ * and return its number. Lines already overwritten are skipped, so a gap in the numbers
+ * means lines were lost. Returns 0 with nothing copied when there is no newer line or it
+ * is longer than `cap`. Never blocks, any task.
+ */
+uint32_t readHistory(uint32_t after, char* out, size_t cap, size_t& length);
+
+/**
+ * Capture a log call from a registered site without formatting it
+ */
+template <typename... Args> inline void logSite(uint16_t site, Level level, Args... args)
+{
+    Record r;
+    r.timestamp = millis();
+    r.site      = site;
+    r.level     = level;
+    r.argLen    = 0;
+    (detail::pack(r, args), ...);
+    submit(r);
+    if (level == Level::Wtf)
+        flush();
+}
+
+/**
+ * Capture a log call made through the function API (site 0): the location and format
+ * pointers travel with the arguments
+ */
+template <typename... Args>
+inline void logDeferred(Level level, const char* file, int line, const char* function,
+                        const char* fmt, Args... args)
+{
+    logSite(0, level, static_cast<const void*>(file), static_cast<const void*>(function),
+            static_cast<uint32_t>(line), static_cast<const void*>(fmt), args...);
+}
+
 /**
  * Internal implementation: log a raw C-string message with source location
  */
@@ -147,7 +415,7 @@ inline void wtf(const char* msg, const char* file, int line, const char* func)
 template <typename... Args>
 inline void debugf(const char* file, int line, const char* func, const char* fmt, Args... args)
 {
-    logImplF(Level::Debug, file, line, func, fmt, args...);
+    logDeferred(Level::Debug, file, line, func, fmt, args...);
 }
 
 /**
@@ -156,7 +424,7 @@ inline void debugf(const char* file, int line, const char* func, const char* fmt
 template <typename... Args>
 inline void verbosef(const char* file, int line, const char* func, const char* fmt, Args... args)
 {
-    logImplF(Level::Verbose, file, line, func, fmt, args...);
+    logDeferred(Level::Verbose, file, line, func, fmt, args...);
 }
 
 /**
@@ -165,7 +433,7 @@ inline void verbosef(const char* file, int line, const char* func, const char* f
 template <typename... Args>
 inline void infof(const char* file, int line, const char* func, const char* fmt, Args... args)
 {
-    logImplF(Level::Info, file, line, func, fmt, args...);
+    logDeferred(Level::Info, file, line, func, fmt, args...);
 }
 
 /**
@@ -174,7 +442,7 @@ inline void infof(const char* file, int line, const char* func, const char* fmt,
 template <typename... Args>
 inline void warningf(const char* file, int line, const char* func, const char* fmt, Args... args)
 {
-    logImplF(Level::Warning, file, line, func, fmt, args...);
+    logDeferred(Level::Warning, file, line, func, fmt, args...);
 }
 
 /**
@@ -183,7 +451,7 @@ inline void warningf(const char* file, int line, const char* func, const char* f
 template <typename... Args>
 inline void errorf(const char* file, int line, const char* func, const char* fmt, Args... args)
 {
-    logImplF(Level::Error, file, line, func, fmt, args...);
+    logDeferred(Level::Error, file, line, func, fmt, args...);
 }
 
 /**
@@ -192,7 +460,7 @@ inline void errorf(const char* file, int line, const char* func, const char* fmt
 template <typename... Args>
 inline void wtff(const char* file, int line, const char* func, const char* fmt, Args... args)
 {
-    logImplF(Level::Wtf, file, line, func, fmt, args...);
+    logDeferred(Level::Wtf, file, line, func, fmt, args...);
 }
 
 } // namespace logger
@@ -200,8 +468,9 @@ inline void wtff(const char* file, int line, const char* func, const char* fmt,
 /**
  * @defgroup LoggerMacros Logger Logging Macros
  *
- * These macros automatically capture source location (__FILE__, __LINE__, __func__)
- * and pass them to the logger namespace functions.
+ * Each call is looked up in the generated call-site table at compile time (see
+ * scripts/generate_log_sites.py) and logs only its id and arguments. Calls below
+ * LOG_MODULE_LEVEL expand to nothing: their arguments are not evaluated either.
  *
  * Usage:
  *   L_INFO("Simple message");
@@ -209,21 +478,74 @@ inline void wtff(const char* file, int line, const char* func, const char* fmt,
  * @{
  */
 
-// Simple string logging macros
-#define L_DEBUG(msg) logger::debug((msg), __FILE__, __LINE__, __func__)
-#define L_VERBOSE(msg) logger::verbose((msg), __FILE__, __LINE__, __func__)
-#define L_INFO(msg) logger::info((msg), __FILE__, __LINE__, __func__)
-#define L_WARNING(msg) logger::warning((msg), __FILE__, __LINE__, __func__)
-#define L_ERROR(msg) logger::error((msg), __FILE__, __LINE__, __func__)
-#define L_WTF(msg) logger::wtf((msg), __FILE__, __LINE__, __func__)
-
-// Printf-style formatting macros
-#define L_DEBUGF(fmt, ...) logger::debugf(__FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__)
-#define L_VERBOSEF(fmt, ...) logger::verbosef(__FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__)
-#define L_INFOF(fmt, ...) logger::infof(__FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__)
-#define L_WARNINGF(fmt, ...) logger::warningf(__FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__)
-#define L_ERRORF(fmt, ...) logger::errorf(__FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__)
-#define L_WTFF(fmt, ...) logger::wtff(__FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__)
+#define LOG_SITE_ID_(format)                                                                       \
+    constexpr uint16_t logSite_ = logger::siteId(logger::basename(__FILE__), __LINE__);          \
+    static_assert(logSite_ != 0 && logger::sameString(logger::log_sites[logSite_].fmt, format),  \
+                  "log call missing from generated/log_sites.h: run scripts/generate_log_sites.py")
+
+#define LOG_TEXT_(level, msg)                                                                      \
+    do                                                                                             \
+    {                                                                                              \
+        LOG_SITE_ID_("%s");                                                                        \
+        logger::logSite(logSite_, level, static_cast<const char*>(msg));                           \
+    } while (0)
+
+#define LOG_FORMAT_(level, fmt, ...)                                                               \
+    do                                                                                             \
+    {                                                                                              \
+        LOG_SITE_ID_(fmt);                                                                         \
+        logger::logSite(logSite_, level, ##__VA_ARGS__);                                           \
+    } while (0)
+
+#define LOG_OFF_ ((void)0)
+
+#if LOG_MODULE_LEVEL <= 0
+#define L_DEBUG(msg) LOG_TEXT_(logger::Level::Debug, msg)
+#define L_DEBUGF(fmt, ...) LOG_FORMAT_(logger::Level::Debug, fmt, ##__VA_ARGS__)
+#else
+#define L_DEBUG(msg) LOG_OFF_
+#define L_DEBUGF(fmt, ...) LOG_OFF_
+#endif
+
+#if LOG_MODULE_LEVEL <= 1
+#define L_VERBOSE(msg) LOG_TEXT_(logger::Level::Verbose, msg)
+#define L_VERBOSEF(fmt, ...) LOG_FORMAT_(logger::Level::Verbose, fmt, ##__VA_ARGS__)
+#else
+#define L_VERBOSE(msg) LOG_OFF_
+#define L_VERBOSEF(fmt, ...) LOG_OFF_
+#endif
+
+#if LOG_MODULE_LEVEL <= 2
+#define L_INFO(msg) LOG_TEXT_(logger::Level::Info, msg)
+#define L_INFOF(fmt, ...) LOG_FORMAT_(logger::Level::Info, fmt, ##__VA_ARGS__)
+#else
+#define L_INFO(msg) LOG_OFF_
+#define L_INFOF(fmt, ...) LOG_OFF_
+#endif
+
+#if LOG_MODULE_LEVEL <= 3
+#define L_WARNING(msg) LOG_TEXT_(logger::Level::Warning, msg)
+#define L_WARNINGF(fmt, ...) LOG_FORMAT_(logger::Level::Warning, fmt, ##__VA_ARGS__)
+#else
+#define L_WARNING(msg) LOG_OFF_
+#define L_WARNINGF(fmt, ...) LOG_OFF_
+#endif
+
+#if LOG_MODULE_LEVEL <= 4
+#define L_ERROR(msg) LOG_TEXT_(logger::Level::Error, msg)
+#define L_ERRORF(fmt, ...) LOG_FORMAT_(logger::Level::Error, fmt, ##__VA_ARGS__)
+#else
+#define L_ERROR(msg) LOG_OFF_
+#define L_ERRORF(fmt, ...) LOG_OFF_
+#endif
+
+#if LOG_MODULE_LEVEL <= 5
+#define L_WTF(msg) LOG_TEXT_(logger::Level::Wtf, msg)
+#define L_WTFF(fmt, ...) LOG_FORMAT_(logger::Level::Wtf, fmt, ##__VA_ARGS__)
+#else
+#define L_WTF(msg) LOG_OFF_
+#define L_WTFF(fmt, ...) LOG_OFF_
+#endif
 
 /** @} */ // end of WheezerMacros group
 
@@ -0,0 +1,156 @@
+// MagicPacket.h
+// Platform-independent MAC parsing and magic-packet building. Has no Arduino
+// dependencies so it can be compiled and benchmarked on the host (see [env:native]).
+#ifndef MAGICPACKET_H
+#define MAGICPACKET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace wol
+{
+
+static constexpr size_t  MAC_LEN    = 6;
+static constexpr size_t  SYNC_LEN   = 6;
+static constexpr size_t  MAC_REP    = 16;
+static constexpr size_t  PACKET_LEN = SYNC_LEN + MAC_REP * MAC_LEN;
+static constexpr uint8_t SYNC_BYTE  = 0xFF;
+
+/**
+ * Hex digit lookup: maps every byte to its nibble value, or HEX_INVALID.
+ */
+static constexpr uint8_t HEX_INVALID = 0xFF;
+
+struct HexTable
+{
+    uint8_t value[256];
+
+    constexpr HexTable() : value()
+    {
+        for (int c = 0; c < 256; ++c)
+            value[c] = HEX_INVALID;
+        for (int c = '0'; c <= '9'; ++c)
+            value[c] = (uint8_t)(c - '0');
+        for (int c = 'a'; c <= 'f'; ++c)
+            value[c] = (uint8_t)(c - 'a' + 10);
+        for (int c = 'A'; c <= 'F'; ++c)
+            value[c] = (uint8_t)(c - 'A' + 10);
+    }
+};
+
+inline constexpr HexTable HEX_TABLE{};
+
+/**
+ * Result of a MAC parse; `valid` is false when the input was rejected.
+ */
+struct MacAddress
+{
+    uint8_t bytes[MAC_LEN];
+    bool    valid;
+};
+
+/**
+ * A fully built magic packet.
+ */
+struct Packet
+{
+    uint8_t bytes[PACKET_LEN];
+};
+
+inline constexpr bool isSeparator(char c)
+{
+    return c == ':' || c == '-' || c == ' ';
+}
+
+/**
+ * Single-pass MAC parser. Accepts exactly 12 hex digits, either contiguous
+ * ("AABBCCDDEEFF") or as six pairs joined by one consistent separator
+ * (':', '-' or ' '), with nothing before or after. Never reads past the terminator.
+ */
+inline constexpr MacAddress parseMac(const char* s)
+{
+    MacAddress out{};
+    if (!s)
+        return out;
+
+    size_t i   = 0;
+    char   sep = '\0';
+    for (size_t b = 0; b < MAC_LEN; ++b)
+    {
+        uint8_t hi = HEX_TABLE.value[(uint8_t)s[i]];
+        if (hi == HEX_INVALID)
+            return out;
+        uint8_t lo = HEX_TABLE.value[(uint8_t)s[i + 1]];
+        if (lo == HEX_INVALID)
+            return out;
+        out.bytes[b] = (uint8_t)((hi << 4) | lo);
+        i += 2;
+
+        if (b == MAC_LEN - 1)
+            break;
+        // The first gap decides the separator; every later gap must match it
+        if (b == 0 && isSeparator(s[i]))
+            sep = s[i];
+        if (sep != '\0')
+        {
+            if (s[i] != sep)
+                return out;
+            i++;
+        }
+    }
+
+    out.valid = (s[i] == '\0');
+    return out;
+}
+
+/**
+ * Runtime convenience wrapper: parse into a caller-provided 6-byte array.
+ */
+inline bool parseMac(const char* s, uint8_t mac[MAC_LEN])
+{
+    MacAddress m = parseMac(s);
+    if (!m.valid || !mac)
+        return false;
+    memcpy(mac, m.bytes, MAC_LEN);
+    return true;
+}
+
+/**
+ * Fill `packet` with the magic packet for `mac` (6 x 0xFF, then the MAC 16 times).
+ * Two MAC repetitions form a 12-byte period that is exactly three 32-bit words, so
+ * the 96-byte body is written as eight copies of a three-word pattern rather than
+ * sixteen 6-byte copies.
+ */
+inline void fillPacket(const uint8_t mac[MAC_LEN], uint8_t packet[PACKET_LEN])
+{
+    constexpr size_t PERIOD_WORDS = 3;
+    constexpr size_t PERIOD_LEN   = PERIOD_WORDS * sizeof(uint32_t); // == 2 * MAC_LEN
+
+    uint32_t pattern[PERIOD_WORDS];
+    memcpy(pattern, mac, MAC_LEN);
+    memcpy(reinterpret_cast<uint8_t*>(pattern) + MAC_LEN, mac, MAC_LEN);
+
+    memset(packet, SYNC_BYTE, SYNC_LEN);
+    uint8_t* body = packet + SYNC_LEN;
+    for (size_t off = 0; off < MAC_REP * MAC_LEN; off += PERIOD_LEN)
+        memcpy(body + off, pattern, PERIOD_LEN);
+}
+
+/**
+ * Compile-time packet builder, e.g. for a MAC literal baked in at build time:
+ *   constexpr wol::Packet p = wol::makePacket(wol::parseMac("d8:43:ae:54:52:01"));
+ */
+inline constexpr Packet makePacket(const MacAddress& mac)
+{
+    Packet p{};
+    for (size_t i = 0; i < SYNC_LEN; ++i)
+        p.bytes[i] = SYNC_BYTE;
+    for (size_t i = 0; i < MAC_REP * MAC_LEN; ++i)
+        p.bytes[SYNC_LEN + i] = mac.bytes[i % MAC_LEN];
+    return p;
+}
+
+} // namespace wol
+
+#endif // MAGICPACKET_H
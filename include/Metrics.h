@@ -0,0 +1,124 @@
+// Metrics.h
+// Counters and fixed-bucket latency histograms that are cheap enough to leave on in
+// production (a relaxed atomic add per event, no locks, no allocation), plus a registry
+// that renders them in the Prometheus text exposition format. Platform independent.
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Series the registry can hold (one per counter, gauge, or labelled histogram)
+#ifndef METRICS_MAX_SERIES
+#define METRICS_MAX_SERIES 64
+#endif
+
+namespace metrics
+{
+
+// Upper bounds of the latency buckets in microseconds; a +Inf bucket follows
+static constexpr uint32_t LATENCY_BOUNDS_US[] = {
+    50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000};
+static constexpr size_t   LATENCY_BUCKETS =
+    sizeof(LATENCY_BOUNDS_US) / sizeof(LATENCY_BOUNDS_US[0]) + 1;
+
+// Monotonic event count; any task may inc(). 32 bits wide, so it wraps eventually,
+// which Prometheus' rate() treats like a restart.
+class Counter
+{
+  public:
+    void     inc(uint32_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+    uint32_t get() const { return value.load(std::memory_order_relaxed); }
+
+  private:
+    std::atomic<uint32_t> value{0};
+};
+
+// Latency distribution over LATENCY_BOUNDS_US. observe() is wait-free but must only be
+// called from one task per histogram; reads may come from anywhere.
+class Histogram
+{
+  public:
+    void observe(uint32_t us)
+    {
+        size_t i = 0;
+        while (i < LATENCY_BUCKETS - 1 && us > LATENCY_BOUNDS_US[i])
+            i++;
+        buckets[i].fetch_add(1, std::memory_order_relaxed);
+
+        // The sum is kept as whole milliseconds plus a microsecond remainder, so it
+        // lasts ~49 days of accumulated latency and a reader racing an update is off by
+        // under a millisecond
+        uint32_t rem = remUs.load(std::memory_order_relaxed) + us;
+        if (rem >= 1000)
+        {
+            sumMs.fetch_add(rem / 1000, std::memory_order_relaxed);
+            rem %= 1000;
+        }
+        remUs.store(rem, std::memory_order_relaxed);
+    }
+
+    // Observations in bucket `i` alone (not cumulative)
+    uint32_t bucket(size_t i) const { return buckets[i].load(std::memory_order_relaxed); }
+    uint32_t count() const
+    {
+        uint32_t n = 0;
+        for (const auto& b : buckets)
+            n += b.load(std::memory_order_relaxed);
+        return n;
+    }
+    // Upper bound of the bucket holding the `q` quantile (0 < q <= 1): 0 while empty,
+    // UINT32_MAX when it falls past the last bound
+    uint32_t quantileBound(float q) const
+    {
+        uint32_t total = count();
+        if (!total)
+            return 0;
+        uint32_t rank = (uint32_t)(q * total);
+        uint32_t seen = 0;
+        if (rank == 0)
+            rank = 1;
+        for (size_t i = 0; i < LATENCY_BUCKETS - 1; ++i)
+        {
+            seen += bucket(i);
+            if (seen >= rank)
+                return LATENCY_BOUNDS_US[i];
+        }
+        return UINT32_MAX;
+    }
+    uint64_t sumMicros() const
+    {
+        return (uint64_t)sumMs.load(std::memory_order_relaxed) * 1000 +
+               remUs.load(std::memory_order_relaxed);
+    }
+
+  private:
+    std::atomic<uint32_t> buckets[LATENCY_BUCKETS] = {};
+    std::atomic<uint32_t> sumMs{0};
+    std::atomic<uint32_t> remUs{0};
+};
+
+// Read on demand when the page is rendered (gauges, or counters kept elsewhere)
+using Reader = uint32_t (*)();
+
+// Register a series for /api/metrics. Series sharing a name form one metric family and
+// are rendered together under a single HELP/TYPE header, in registration order.
+// `labelName`/`labelValue` may be null for an unlabelled series. All strings must stay
+// valid forever (literals). Call during setup, before the page is first served; false
+// once METRICS_MAX_SERIES is reached.
+bool add(const char* name, const char* help, const Counter& counter,
+         const char* labelName = nullptr, const char* labelValue = nullptr);
+bool add(const char* name, const char* help, const Histogram& histogram,
+         const char* labelName = nullptr, const char* labelValue = nullptr);
+bool addGauge(const char* name, const char* help, Reader read);
+bool addCounter(const char* name, const char* help, Reader read);
+
+// Write whole series, starting at index `cursor`, into `buf` until the next one would
+// not fit; advances `cursor` past them and sets `done` after the last. Returns the bytes
+// written. Suits HttpResponse::sendStream, so the page needs no buffer of its own.
+size_t render(uint32_t& cursor, char* buf, size_t cap, bool& done);
+
+} // namespace metrics
+
+#endif // METRICS_H
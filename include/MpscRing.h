@@ -0,0 +1,87 @@
+// MpscRing.h
+// Fixed-capacity, lock-free multi-producer/single-consumer ring buffer. Any number of
+// tasks may push() concurrently; pop() may only be called from one task at a time.
+// Each slot carries a sequence number (Vyukov's bounded queue), so producers only ever
+// contend on one compare-and-swap and never wait for each other.
+#ifndef MPSCRING_H
+#define MPSCRING_H
+
+#include <atomic>
+#include <stddef.h>
+
+template <typename T, size_t N> class MpscRing
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "MpscRing capacity must be a power of two");
+
+  public:
+    MpscRing()
+    {
+        for (size_t i = 0; i < N; ++i)
+            cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    // Producer side, any task. Returns false (and stores nothing) when the ring is full.
+    bool push(const T& item)
+    {
+        size_t pos = head.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell&     cell = cells[pos & (N - 1)];
+            size_t    seq  = cell.seq.load(std::memory_order_acquire);
+            ptrdiff_t dif  = (ptrdiff_t)seq - (ptrdiff_t)pos;
+            if (dif == 0)
+            {
+                // Slot is free for this position: claim it, then fill it in
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.item = item;
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (dif < 0)
+            {
+                return false; // the consumer has not freed this slot yet
+            }
+            else
+            {
+                pos = head.load(std::memory_order_relaxed); // another producer won
+            }
+        }
+    }
+
+    // Consumer side. Returns false when the ring is empty, or when the oldest slot has
+    // been claimed but its producer has not finished writing it.
+    bool pop(T& item)
+    {
+        size_t pos  = tail.load(std::memory_order_relaxed);
+        Cell&  cell = cells[pos & (N - 1)];
+        if (cell.seq.load(std::memory_order_acquire) != pos + 1)
+            return false;
+        item = cell.item;
+        cell.seq.store(pos + N, std::memory_order_release);
+        tail.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Approximate: producers may be mid-push
+    size_t size() const
+    {
+        return head.load(std::memory_order_relaxed) - tail.load(std::memory_order_relaxed);
+    }
+
+    static constexpr size_t capacity() { return N; }
+
+  private:
+    struct Cell
+    {
+        std::atomic<size_t> seq;
+        T                   item;
+    };
+
+    Cell                cells[N];
+    std::atomic<size_t> head{0}; // next position to claim, shared by the producers
+    std::atomic<size_t> tail{0}; // next position to read, owned by the consumer
+};
+
+#endif // MPSCRING_H
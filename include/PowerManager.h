@@ -0,0 +1,69 @@
+// PowerManager.h
+// Operating profiles trading request latency for power. Each sets the CPU clock range
+// for dynamic frequency scaling, the WiFi modem's power-save mode, automatic light
+// sleep, and how long the main loop may block waiting for network activity. The loop
+// holds the CPU at full clock while it works; while it waits the clock may drop and the
+// chip light-sleep until a packet arrives. Time awake and waiting and request latency
+// are recorded per profile, with an estimate of the mean current. Loop task only.
+#ifndef POWERMANAGER_H
+#define POWERMANAGER_H
+
+#include <Arduino.h>
+#include "Metrics.h"
+
+// Profile used until one is chosen through the API: "low-latency", "balanced" or
+// "low-power"
+#ifndef POWER_PROFILE
+#define POWER_PROFILE "balanced"
+#endif
+
+class PowerManager
+{
+  public:
+    enum class Profile : uint8_t
+    {
+        LowLatency, // full clock, radio always on, the loop never waits
+        Balanced,   // clock scaling, modem sleep between beacons
+        LowPower,   // clock scaling, light sleep, modem asleep across several beacons
+    };
+    static constexpr size_t PROFILES = 3;
+
+    // Time spent under one profile. `chargeUaUs` integrates the estimated current over
+    // that time, from datasheet figures for each state.
+    struct Usage
+    {
+        uint64_t activeUs;
+        uint64_t idleUs;
+        uint64_t chargeUaUs;
+    };
+
+    // Load the saved profile, apply it and register its metrics. Call after WiFi is up.
+    static void begin();
+
+    // Switch profile and save it to NVS. False if it could not be saved (it still
+    // applies until the next reboot).
+    static bool    setProfile(Profile profile);
+    static Profile profile();
+
+    static const char* profileName(Profile profile);
+    static bool        parseProfile(const char* name, Profile& out);
+
+    // Whether the SDK accepted clock scaling and light sleep for the current profile
+    static bool clockScaling();
+    static bool lightSleep();
+
+    // End of a loop pass: let `wait` block for up to the profile's idle time, with the
+    // CPU free to slow down and sleep meanwhile, and account the time
+    using Waiter = void (*)(uint32_t timeoutMs);
+    static void idle(Waiter wait);
+
+    // Latency of a served request, for HttpServer::onServed()
+    static void observeRequest(uint32_t us);
+
+    static const Usage&              usage(Profile profile);
+    static const metrics::Histogram& latency(Profile profile);
+    // Mean estimated current under `profile` in microamps, 0 if it was never used
+    static uint32_t estimatedCurrentUa(Profile profile);
+};
+
+#endif // POWERMANAGER_H
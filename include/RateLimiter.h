@@ -0,0 +1,64 @@
+// RateLimiter.h
+// Per-client admission control: a token bucket per source IP for each class of request
+// (API calls; the page and its assets), kept in a fixed table where the client seen
+// least recently gives way to a new one. Platform independent; one task only.
+#ifndef RATELIMITER_H
+#define RATELIMITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Metrics.h"
+
+// Clients tracked at once
+#ifndef RATE_CLIENTS
+#define RATE_CLIENTS 16
+#endif
+
+// Requests per second a client may keep up, and how many it may send in one burst
+#ifndef RATE_API_PER_S
+#define RATE_API_PER_S 5
+#endif
+#ifndef RATE_API_BURST
+#define RATE_API_BURST 20
+#endif
+#ifndef RATE_ASSET_PER_S
+#define RATE_ASSET_PER_S 20
+#endif
+#ifndef RATE_ASSET_BURST
+#define RATE_ASSET_BURST 40
+#endif
+
+class RateLimiter
+{
+  public:
+    enum class Class : uint8_t
+    {
+        Api,   // /api/* and /wol
+        Asset, // everything else
+    };
+    static constexpr size_t CLASSES = 2;
+
+    static Class classify(const char* path);
+
+    // Take a token from the bucket of `peerAddr` for `cls`. False when it is empty, with
+    // `retryAfterS` set to when the next token will be there.
+    bool admit(uint32_t peerAddr, Class cls, uint32_t nowMs, uint32_t& retryAfterS);
+
+    // Requests refused, per class
+    const metrics::Counter& shed(Class cls) const { return refused[(size_t)cls]; }
+
+  private:
+    struct Client
+    {
+        uint32_t addr; // IPv4, network byte order; 0 = free
+        uint32_t lastMs;
+        uint32_t milliTokens[CLASSES];
+    };
+
+    Client& clientFor(uint32_t addr, uint32_t nowMs);
+
+    Client           clients[RATE_CLIENTS] = {};
+    metrics::Counter refused[CLASSES];
+};
+
+#endif // RATELIMITER_H
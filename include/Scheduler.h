@@ -0,0 +1,111 @@
+// Scheduler.h
+// On-device wake schedules: one-shot (at a given time) or recurring (a cron
+// expression in local time), each waking a saved host or a MAC. Due times sit on a
+// timing wheel ticking once a second, so poll() costs the same whatever the number of
+// schedules. Schedules are persisted to NVS. Loop task only.
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+#include "Cron.h"
+#include "WakeOnLan.h"
+
+// Schedules that can exist at once
+#ifndef SCHEDULE_MAX
+#define SCHEDULE_MAX 64
+#endif
+
+// Records per NVS blob: a change rewrites the one blob holding its schedule
+#ifndef SCHEDULE_NVS_PAGE_SIZE
+#define SCHEDULE_NVS_PAGE_SIZE 8
+#endif
+
+// POSIX TZ string cron times are in until one is set through the API
+#ifndef SCHEDULE_TZ
+#define SCHEDULE_TZ "UTC0"
+#endif
+
+#ifndef SCHEDULE_NTP_SERVER
+#define SCHEDULE_NTP_SERVER "pool.ntp.org"
+#endif
+
+// Forward clock jumps up to this many seconds are replayed tick by tick, so nothing
+// due in between is missed. After a bigger jump, or any backward one, every schedule
+// is planned again from the new time.
+#ifndef SCHEDULE_MAX_CATCHUP_S
+#define SCHEDULE_MAX_CATCHUP_S 3600
+#endif
+
+// A one-shot wake found up to this late (e.g. after a reboot) still fires; older ones
+// are dropped
+#ifndef SCHEDULE_GRACE_S
+#define SCHEDULE_GRACE_S 300
+#endif
+
+class Scheduler
+{
+  public:
+    static constexpr size_t NAME_LEN = 32; // including the NUL
+    static constexpr size_t CRON_LEN = 48; // including the NUL
+
+    struct Schedule
+    {
+        uint32_t id; // stable while the schedule exists; never reused for another
+        bool     used;
+        char     name[NAME_LEN];
+        char     cron[CRON_LEN]; // "" for a one-shot
+        CronExpr expr;
+        uint32_t at;     // one-shot: when, in Unix seconds
+        uint32_t hostId; // saved host to wake, or 0 to wake `mac`
+        uint8_t  mac[WakeOnLan::MAC_LEN];
+        uint32_t broadcast; // network byte order
+        uint16_t port;      // 0 = WakeOnLan::DEFAULT_PORT
+        uint32_t next;      // next wake in Unix seconds; 0 while the time is unknown
+        uint32_t lastJob;   // WakeQueue job of the last wake, 0 if none yet
+    };
+
+    enum class Result : uint8_t
+    {
+        Ok,
+        NotFound,
+        Full,
+        StorageFailed, // NVS write failed; nothing was changed
+    };
+
+    enum class TimeSource : uint8_t
+    {
+        None,   // not known yet: schedules wait
+        System, // the system clock was already set (the host build)
+        Ntp,
+        Manual, // set through setTime(); NTP takes over once it syncs
+    };
+
+    // Load the saved schedules and time zone and start NTP
+    static bool begin();
+
+    // Fire what came due since the last call. Call from the main loop.
+    static void poll(uint32_t nowMs);
+
+    // `s` gives every field but id, used, expr, next and lastJob; `cron` must parse
+    // (check with CronExpr::parse()) or be "" with `at` set. Sets `id`.
+    static Result add(const Schedule& s, uint32_t& id);
+    static Result remove(uint32_t id);
+
+    // The schedule with `id`, or nullptr. O(1).
+    static const Schedule* find(uint32_t id);
+    // Schedules in table order, as HostRegistry::next()
+    static const Schedule* next(uint32_t& cursor);
+    static size_t          count();
+
+    // Unix time in seconds, or 0 while unknown
+    static uint32_t    now();
+    static TimeSource  timeSource();
+    static const char* timeSourceName(TimeSource source);
+    static void        setTime(uint32_t unixSeconds);
+
+    // POSIX TZ string, e.g. "CET-1CEST,M3.5.0,M10.5.0/3"; saved to NVS
+    static bool        setTimezone(const char* tz);
+    static const char* timezone();
+};
+
+#endif // SCHEDULER_H
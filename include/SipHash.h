@@ -0,0 +1,22 @@
+// SipHash.h
+// SipHash-2-4 (Aumasson and Bernstein): a keyed hash made for short messages, and cheap
+// enough to run on every relay datagram. Platform independent (no Arduino dependencies)
+// so it builds and is checked against the reference vectors on the host.
+#ifndef SIPHASH_H
+#define SIPHASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace siphash
+{
+
+static constexpr size_t KEY_LEN = 16;
+
+// 64-bit SipHash-2-4 of `data` under `key`; its little-endian bytes are the reference
+// implementation's output
+uint64_t hash24(const uint8_t key[KEY_LEN], const uint8_t* data, size_t len);
+
+} // namespace siphash
+
+#endif // SIPHASH_H
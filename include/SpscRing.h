@@ -0,0 +1,51 @@
+// SpscRing.h
+// Fixed-capacity, lock-free single-producer/single-consumer ring buffer.
+// push() may only be called from one task and pop() from one (other) task.
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <atomic>
+#include <stddef.h>
+
+template <typename T, size_t N> class SpscRing
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+  public:
+    // Producer side. Returns false (and drops nothing) when the ring is full.
+    bool push(const T& item)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == N)
+            return false;
+        items[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false when the ring is empty.
+    bool pop(T& item)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+            return false;
+        item = items[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called from a third task; exact from either end
+    size_t size() const
+    {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return N; }
+
+  private:
+    T                   items[N];
+    std::atomic<size_t> head{0}; // next slot to write, owned by the producer
+    std::atomic<size_t> tail{0}; // next slot to read, owned by the consumer
+};
+
+#endif // SPSCRING_H
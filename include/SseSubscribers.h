@@ -0,0 +1,86 @@
+// SseSubscribers.h
+// Subscriber bookkeeping shared by the Server-Sent Events streams (EventStream,
+// LogTail): sockets handed over by HttpServer once a response head is written, each
+// with the stream's own cursor. This part claims and frees the slots, greets a new
+// subscriber, writes without blocking, and sends a heartbeat to idle ones, closing
+// those whose peer went away. What is sent next, and from where, stays with each
+// stream. Platform independent; one task only.
+#ifndef SSESUBSCRIBERS_H
+#define SSESUBSCRIBERS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace sse
+{
+// Socket state every subscriber carries; streams add their cursor in a derived struct
+struct Peer
+{
+    int      fd     = -1;
+    uint32_t lastMs = 0; // last write
+};
+
+// Tell a new subscriber's EventSource how long to wait before reconnecting
+void greet(int fd);
+
+// Write as much of `data` as the socket takes now. Returns the bytes taken (0 when it is
+// full), or -1 when the peer is gone.
+long write(Peer& p, const char* data, size_t len, uint32_t nowMs);
+
+// A subscriber idle for `heartbeatMs` gets a comment line, which keeps proxies from
+// timing it out. False when its peer went away.
+bool keepAlive(Peer& p, uint32_t nowMs, uint32_t heartbeatMs);
+
+void closeSocket(int fd);
+
+template <typename Sub, size_t N> class Subscribers
+{
+  public:
+    // Claim a free slot for `fd` and greet it; the caller then sets its cursor. Nullptr
+    // when all N are taken.
+    Sub* adopt(int fd, uint32_t nowMs)
+    {
+        for (Sub& s : subs)
+        {
+            if (s.fd >= 0)
+                continue;
+            s.fd     = fd;
+            s.lastMs = nowMs;
+            count++;
+            greet(fd);
+            return &s;
+        }
+        return nullptr;
+    }
+
+    // Run `flush(s)` for each subscriber, which writes what it is owed and returns
+    // false once it had to close it; then keep the idle ones alive
+    template <typename Flush> void poll(uint32_t nowMs, uint32_t heartbeatMs, Flush flush)
+    {
+        if (!count)
+            return;
+        for (Sub& s : subs)
+        {
+            if (s.fd < 0 || !flush(s))
+                continue;
+            if (!keepAlive(s, nowMs, heartbeatMs))
+                close(s);
+        }
+    }
+
+    void close(Sub& s)
+    {
+        closeSocket(s.fd);
+        s.fd = -1;
+        count--;
+    }
+
+    size_t size() const { return count; }
+
+  private:
+    Sub    subs[N];
+    size_t count = 0;
+};
+} // namespace sse
+
+#endif // SSESUBSCRIBERS_H
@@ -0,0 +1,151 @@
+// TimingWheel.h
+// Hierarchical timing wheel over a fixed pool of N timers, on a 32-bit tick count.
+// Arming, cancelling and each tick cost O(1) however many timers there are: a timer
+// waits in the slot of the coarsest level whose span covers its delay and drops a
+// level ("cascades") when that slot comes round. Platform independent.
+#ifndef TIMINGWHEEL_H
+#define TIMINGWHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+template <size_t N> class TimingWheel
+{
+    static_assert(N > 0 && N < 0xFFFF, "timer ids are 16-bit");
+
+  public:
+    static constexpr unsigned SLOT_BITS = 6;
+    static constexpr unsigned SLOTS     = 1u << SLOT_BITS;
+    // 64 s, 68 min, 3 days and 194 days at one tick per second; timers further out
+    // wait in the top level's last slot and are filed again when it comes round
+    static constexpr unsigned LEVELS = 4;
+
+    TimingWheel() { start(0); }
+
+    // Disarm every timer and set the current tick
+    void start(uint32_t tick)
+    {
+        now = tick;
+        for (auto& level : heads)
+            for (auto& head : level)
+                head = NIL;
+        for (auto& n : nodes)
+            n.armed = false;
+    }
+
+    uint32_t current() const { return now; }
+    bool     armed(size_t id) const { return nodes[id].armed; }
+
+    // Arm timer `id` (re-arming it if needed) to fire at tick `expires`. One at or before
+    // the current tick fires on the next one.
+    void arm(size_t id, uint32_t expires)
+    {
+        cancel(id);
+        nodes[id].expires = expires;
+        file((uint16_t)id);
+    }
+
+    void cancel(size_t id)
+    {
+        Node& n = nodes[id];
+        if (!n.armed)
+            return;
+        if (n.prev != NIL)
+            nodes[n.prev].next = n.next;
+        else
+            heads[n.level][n.slot] = n.next;
+        if (n.next != NIL)
+            nodes[n.next].prev = n.prev;
+        n.armed = false;
+    }
+
+    // Step the wheel up to tick `to`, calling fire(id) for each timer that comes due.
+    // A timer is disarmed before its call, so fire() may arm it again.
+    template <typename F> void advance(uint32_t to, F&& fire)
+    {
+        while ((int32_t)(to - now) > 0)
+        {
+            now++;
+            // Every level whose lower levels all wrapped round hands one slot down
+            for (unsigned l = 1; l < LEVELS; ++l)
+            {
+                if (now & ((1u << (SLOT_BITS * l)) - 1))
+                    break;
+                refile(l, (now >> (SLOT_BITS * l)) & (SLOTS - 1));
+            }
+
+            uint16_t& head = heads[0][now & (SLOTS - 1)];
+            uint16_t  id   = head;
+            head           = NIL;
+            while (id != NIL)
+            {
+                Node&    n    = nodes[id];
+                uint16_t next = n.next;
+                n.armed       = false;
+                if ((int32_t)(n.expires - now) > 0)
+                    file(id); // parked beyond the top level's span
+                else
+                    fire((size_t)id);
+                id = next;
+            }
+        }
+    }
+
+  private:
+    static constexpr uint16_t NIL = 0xFFFF;
+
+    struct Node
+    {
+        uint32_t expires;
+        uint16_t prev;
+        uint16_t next;
+        uint8_t  level;
+        uint8_t  slot;
+        bool     armed;
+    };
+
+    // Put a timer in its slot. Cascading happens before the current tick's level-0 slot
+    // fires, so a timer due now can still go there; any other one in the past waits
+    // for the next tick.
+    void file(uint16_t id, bool cascading = false)
+    {
+        Node&    n     = nodes[id];
+        uint32_t delta = (int32_t)(n.expires - now) > 0 ? n.expires - now : 0;
+        uint32_t at    = delta ? n.expires : cascading ? now : now + 1;
+        unsigned level = 0;
+        while (level < LEVELS - 1 && delta >= (1u << (SLOT_BITS * (level + 1))))
+            level++;
+        unsigned slot;
+        if (level == LEVELS - 1 && delta >= (1ull << (SLOT_BITS * LEVELS)))
+            slot = ((now >> (SLOT_BITS * level)) - 1) & (SLOTS - 1); // last to come round
+        else
+            slot = (at >> (SLOT_BITS * level)) & (SLOTS - 1);
+
+        n.level = (uint8_t)level;
+        n.slot  = (uint8_t)slot;
+        n.prev  = NIL;
+        n.next  = heads[level][slot];
+        if (n.next != NIL)
+            nodes[n.next].prev = id;
+        heads[level][slot] = id;
+        n.armed            = true;
+    }
+
+    void refile(unsigned level, unsigned slot)
+    {
+        uint16_t id        = heads[level][slot];
+        heads[level][slot] = NIL;
+        while (id != NIL)
+        {
+            uint16_t next = nodes[id].next;
+            file(id, true);
+            id = next;
+        }
+    }
+
+    uint16_t heads[LEVELS][SLOTS];
+    Node     nodes[N];
+    uint32_t now = 0;
+};
+
+#endif // TIMINGWHEEL_H
@@ -0,0 +1,31 @@
+// WakeEvents.h
+// Publishes the progress of every wake job as "wake" events on an EventStream: queued,
+// sending (again after each round of a burst), sent or failed, then the verification's
+// state when the wake is verified, up to up, timed_out or failed. Jobs are followed by
+// reading WakeQueue and WakeVerifier, so the send worker never touches the stream.
+// Loop task only.
+#ifndef WAKEEVENTS_H
+#define WAKEEVENTS_H
+
+#include <Arduino.h>
+#include "EventStream.h"
+
+// Jobs followed at once; a newer job takes the slot of the one this many before it
+#ifndef WAKE_EVENTS_TRACKED
+#define WAKE_EVENTS_TRACKED 16
+#endif
+
+class WakeEvents
+{
+  public:
+    static void begin(EventStream& stream);
+
+    // Add what the queue does not know about `job`: the saved host it woke and its
+    // verification. Optional; other jobs are found on their own.
+    static void annotate(uint32_t job, uint32_t hostId, uint32_t verifyId);
+
+    // Publish what changed since the last call. Call from the main loop.
+    static void poll(uint32_t nowMs);
+};
+
+#endif // WAKEEVENTS_H
@@ -4,23 +4,78 @@
 #define WAKEONLAN_H
 
 #include <Arduino.h>
+#include <WiFiUdp.h>
+#include "MagicPacket.h"
+#include "Metrics.h"
 
 class WakeOnLan
 {
   public:
     // Constants
-    static constexpr size_t      MAC_LEN           = 6;
+    static constexpr size_t      MAC_LEN           = wol::MAC_LEN;
+    static constexpr size_t      PACKET_LEN        = wol::PACKET_LEN; // sync + 16 MAC repeats
     static constexpr uint16_t    DEFAULT_PORT      = 9; // standard WOL port
     static constexpr const char* DEFAULT_BROADCAST = "255.255.255.255";
 
-    // Send magic packet to MAC address string ("AA:BB:CC:DD:EE:FF" or "AABBCCDDEEFF").
-    // broadcastIp optionally specifies the target broadcast IP (default 255.255.255.255).
-    // port defaults to DEFAULT_PORT
-    static bool send(const char* macStr, const char* broadcastIp = DEFAULT_BROADCAST,
-                     uint16_t port = DEFAULT_PORT);
-
-    // Parse MAC string into 6-byte array. Returns true on success.
+    // Parse MAC string into 6-byte array. Returns true on success. Accepts 12 contiguous
+    // hex digits or six pairs joined by one consistent ':', '-' or ' ' separator.
     static bool parseMac(const char* macStr, uint8_t mac[MAC_LEN]);
+
+    // Fill `packet` with the magic packet for `mac`: 6 x 0xFF followed by the MAC 16 times.
+    static void buildPacket(const uint8_t mac[MAC_LEN], uint8_t packet[PACKET_LEN]);
+
+    // Long-lived magic-packet sender. Owns one bound UDP socket for the life of the
+    // firmware and keeps a small LRU of prebuilt packets keyed by MAC, so a repeat wake
+    // is a cache lookup plus a single write. Not thread-safe: use from one task only.
+    class Sender
+    {
+      public:
+        static constexpr size_t CACHE_SIZE = 8;
+
+        // Send the magic packet for `mac` to dest:port (port 0 -> DEFAULT_PORT).
+        bool send(const uint8_t mac[MAC_LEN], const IPAddress& dest, uint16_t port);
+
+        // Send an already-built magic packet to dest:port (port 0 -> DEFAULT_PORT).
+        bool sendPacket(const uint8_t packet[PACKET_LEN], const IPAddress& dest, uint16_t port);
+
+        uint32_t cacheHits() const { return hits; }
+        uint32_t cacheMisses() const { return misses; }
+
+      private:
+        struct Entry
+        {
+            uint8_t  mac[MAC_LEN];
+            uint8_t  packet[PACKET_LEN];
+            uint32_t lastUse; // 0 = empty slot
+        };
+
+        bool           ensureSocket();
+        const uint8_t* packetFor(const uint8_t mac[MAC_LEN]);
+
+        WiFiUDP  udp;
+        bool     udpReady = false;
+        Entry    cache[CACHE_SIZE] = {};
+        uint32_t useClock          = 0;
+        uint32_t hits              = 0;
+        uint32_t misses            = 0;
+    };
+
+    // The firmware-wide sender, owned by the WakeQueue send worker
+    static Sender& sender();
+
+    // Outcome of every send, by cause of failure. Updated from any task.
+    struct Stats
+    {
+        metrics::Counter sent;
+        metrics::Counter parseFailures;  // wake, host or relayed wake that did not parse
+        metrics::Counter socketFailures; // udp.begin() failed
+        metrics::Counter sendFailures;   // udp.endPacket() failed
+    };
+    static Stats& stats();
+
+    // Resolve a broadcast address string, falling back to 255.255.255.255 when null or
+    // unparseable.
+    static IPAddress resolveBroadcast(const char* broadcastIp);
 };
 
 #endif // WAKEONLAN_H
@@ -0,0 +1,127 @@
+// WakeQueue.h
+// Hands wake jobs from the HTTP (loop) task to a dedicated send worker pinned to the
+// other core, over a lock-free SPSC ring. enqueue() never waits on the network.
+#ifndef WAKEQUEUE_H
+#define WAKEQUEUE_H
+
+#include <Arduino.h>
+#include "WakeOnLan.h"
+
+// Jobs that can be waiting for the worker at once (power of two)
+#ifndef WOL_QUEUE_DEPTH
+#define WOL_QUEUE_DEPTH 32
+#endif
+
+// Number of recent jobs whose final state can still be looked up
+#ifndef WOL_JOB_HISTORY
+#define WOL_JOB_HISTORY 64
+#endif
+
+// Limits of one burst: every round sends to each address on each port
+#ifndef WOL_BURST_MAX_ADDRS
+#define WOL_BURST_MAX_ADDRS 4
+#endif
+#ifndef WOL_BURST_MAX_PORTS
+#define WOL_BURST_MAX_PORTS 2
+#endif
+#ifndef WOL_BURST_MAX_REPEATS
+#define WOL_BURST_MAX_REPEATS 10
+#endif
+#ifndef WOL_BURST_MAX_INTERVAL_MS
+#define WOL_BURST_MAX_INTERVAL_MS 10000
+#endif
+
+// Bursts the worker paces at once; further jobs wait in the queue until one finishes
+#ifndef WOL_ACTIVE_BURSTS
+#define WOL_ACTIVE_BURSTS 8
+#endif
+
+// Core the send worker is pinned to: the one the Arduino loop does not run on
+#ifndef WOL_WORKER_CORE
+#if CONFIG_FREERTOS_UNICORE
+#define WOL_WORKER_CORE 0
+#else
+#define WOL_WORKER_CORE (ARDUINO_RUNNING_CORE == 0 ? 1 : 0)
+#endif
+#endif
+
+class WakeQueue
+{
+  public:
+    enum class JobState : uint8_t
+    {
+        Unknown = 0, // never issued, or aged out of the history
+        Queued  = 1,
+        Sent    = 2, // done, and at least one packet went out
+        Failed  = 3, // done, and every packet failed
+        Sending = 4, // a burst with rounds still to go
+    };
+
+    // How a job transmits: `repeats` rounds, `intervalMs` apart, each sending the packet
+    // to every address on every port. The worker paces rounds with a timeout on its
+    // wait, so neither task ever sleeps between them.
+    struct Burst
+    {
+        uint32_t addrs[WOL_BURST_MAX_ADDRS]; // network byte order
+        uint16_t ports[WOL_BURST_MAX_PORTS];
+        uint8_t  addrCount;
+        uint8_t  portCount;
+        uint8_t  repeats;
+        uint16_t intervalMs;
+
+        // One packet to dest:port (port 0 -> WakeOnLan::DEFAULT_PORT)
+        static Burst single(const IPAddress& dest, uint16_t port);
+
+        // Add a destination; duplicates are ignored. False when there is no room.
+        bool addAddr(const IPAddress& addr);
+        bool addPort(uint16_t port);
+
+        size_t transmissions() const { return (size_t)addrCount * portCount * repeats; }
+    };
+
+    struct Job
+    {
+        uint32_t id;
+        uint8_t  mac[WakeOnLan::MAC_LEN];
+        bool     prebuilt; // `packet` holds a copy of the caller's packet
+        uint8_t  packet[WakeOnLan::PACKET_LEN];
+        Burst    burst;
+    };
+
+    // What became of a job's transmissions so far
+    struct Report
+    {
+        JobState state;
+        uint8_t  planned;
+        uint8_t  sent;
+        uint8_t  failed;
+    };
+
+    // Start the send worker. Must be called once before enqueue().
+    static bool begin();
+
+    // Queue a wake for `mac`. If `packet` is given (e.g. a constexpr packet, or a saved
+    // host's) it is copied into the job and sent as-is, so the caller may rewrite it as
+    // soon as this returns. Loop task only. Returns the job id, or 0 when the queue is
+    // full or the worker is not running.
+    static uint32_t enqueue(const uint8_t mac[WakeOnLan::MAC_LEN], const IPAddress& broadcast,
+                            uint16_t port, const uint8_t* packet = nullptr);
+    // The same, transmitting as `burst` says
+    static uint32_t enqueue(const uint8_t mac[WakeOnLan::MAC_LEN], const Burst& burst,
+                            const uint8_t* packet = nullptr);
+
+    // Id of the job queued last, or 0 before the first. Loop task only.
+    static uint32_t lastId();
+
+    static JobState    state(uint32_t id);
+    static const char* stateName(JobState state);
+    // False (and `out` untouched) when the job is unknown or aged out of the history
+    static bool report(uint32_t id, Report& out);
+
+    static size_t   depth();
+    static size_t   highWater();
+    static size_t   capacity() { return WOL_QUEUE_DEPTH; }
+    static uint32_t rejected();
+};
+
+#endif // WAKEQUEUE_H
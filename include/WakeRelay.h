@@ -0,0 +1,154 @@
+// WakeRelay.h
+// Relays wakes between Sprout nodes on different subnets: a wake for an address in
+// another node's subnet is sent to that node, which broadcasts it on its own segment.
+// Nodes find each other from a few seed addresses. Each node announces its subnet and
+// the peers it knows to every peer it knows, so one seed is enough to join the mesh.
+// Messages are single UDP datagrams authenticated with SipHash-2-4 under a shared key.
+// A wake is retransmitted until acknowledged. Receivers drop replays and answer
+// duplicates with the first answer. Loop task only.
+#ifndef WAKERELAY_H
+#define WAKERELAY_H
+
+#include <Arduino.h>
+#include "Metrics.h"
+#include "WakeOnLan.h"
+#include "WakeQueue.h"
+
+// UDP port of the relay until one is configured
+#ifndef RELAY_PORT
+#define RELAY_PORT 9009
+#endif
+
+// Shared key until one is configured: 32 hex digits, or empty to leave relaying off
+#ifndef RELAY_KEY
+#define RELAY_KEY ""
+#endif
+
+// Addresses that are always announced to
+#ifndef RELAY_SEEDS
+#define RELAY_SEEDS 4
+#endif
+
+// Nodes known at once, seeds included
+#ifndef RELAY_MAX_PEERS
+#define RELAY_MAX_PEERS 8
+#endif
+
+// How often every known node is told about this one; one not heard from for
+// RELAY_PEER_TTL_MS is no longer routed to
+#ifndef RELAY_HELLO_MS
+#define RELAY_HELLO_MS 5000
+#endif
+#ifndef RELAY_PEER_TTL_MS
+#define RELAY_PEER_TTL_MS 16000
+#endif
+
+// Forwarded wakes whose outcome is kept; a newer one takes the slot of the one this
+// many before it
+#ifndef RELAY_PENDING
+#define RELAY_PENDING 8
+#endif
+
+// A forwarded wake is sent up to RELAY_ATTEMPTS times, first RELAY_RETRY_MS apart and
+// twice as long after each try
+#ifndef RELAY_ATTEMPTS
+#define RELAY_ATTEMPTS 5
+#endif
+#ifndef RELAY_RETRY_MS
+#define RELAY_RETRY_MS 300
+#endif
+
+class WakeRelay
+{
+  public:
+    static constexpr size_t KEY_LEN = 16;
+
+    enum class State : uint8_t
+    {
+        Unknown = 0, // never issued, or its slot was reused
+        Pending,     // waiting for the owner's acknowledgement
+        Queued,      // the owner queued it; `job` is its job there
+        Refused,     // the owner's queue was full, or the address is not in its subnet
+        Failed,      // never acknowledged
+    };
+
+    struct Seed
+    {
+        uint32_t addr; // network byte order; 0 = unused
+        uint16_t port;
+    };
+
+    struct Config
+    {
+        uint16_t port; // 0 = relaying off
+        uint8_t  key[KEY_LEN];
+        Seed     seeds[RELAY_SEEDS];
+    };
+
+    struct Peer
+    {
+        uint32_t addr; // network byte order; 0 = free
+        uint16_t port;
+        uint32_t net; // subnet it announced, network byte order
+        uint8_t  prefix;
+        uint32_t nonce; // its boot nonce; 0 until heard from
+        uint32_t heardMs;
+        uint32_t highSeq; // replay window: newest sequence number taken...
+        uint32_t seen;    // ...and which of the 32 before it were
+    };
+
+    struct Status
+    {
+        State    state;
+        uint32_t peerAddr; // network byte order
+        uint16_t peerPort;
+        uint32_t job; // at the owner, once Queued
+        uint8_t  attempts;
+    };
+
+    // Counters for /api/metrics
+    struct Stats
+    {
+        metrics::Counter forwarded; // wakes sent to another node
+        metrics::Counter accepted;  // wakes queued here for another node
+        metrics::Counter rejected;  // datagrams with a bad tag, stale nonce or replayed
+        metrics::Counter failed;    // forwarded wakes never acknowledged
+    };
+
+    // Load the saved configuration (RELAY_PORT and RELAY_KEY before the first save)
+    // and open the socket if relaying is on
+    static void begin();
+
+    static const Config& config();
+    // Save `c` and restart with it; false if it could not be saved
+    static bool configure(const Config& c);
+    static bool enabled();
+
+    // Hex key to bytes; false unless exactly 2 * KEY_LEN hex digits
+    static bool parseKey(const char* hex, uint8_t key[KEY_LEN]);
+
+    // Receive, answer and retransmit. Call from the main loop.
+    static void poll(uint32_t nowMs);
+
+    // The live peer whose subnet holds `dest`, or nullptr when none other than this
+    // node's own does (the wake is then sent from here)
+    static const Peer* owner(const IPAddress& dest);
+
+    // Send the wake to the owner of `dest`. Returns the relay id, or 0 when there is no
+    // owner or no free slot.
+    static uint32_t forward(const uint8_t mac[WakeOnLan::MAC_LEN], const IPAddress& dest,
+                            const WakeQueue::Burst& burst);
+
+    // False when `id` is unknown or its slot was reused
+    static bool        status(uint32_t id, Status& out);
+    static const char* stateName(State state);
+
+    // RELAY_MAX_PEERS entries; those with addr 0 are free
+    static const Peer* peers();
+    static bool        alive(const Peer& p, uint32_t nowMs);
+    static uint32_t    livePeers();
+
+    static Stats& stats();
+};
+
+#endif // WAKERELAY_H
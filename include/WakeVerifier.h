@@ -0,0 +1,105 @@
+// WakeVerifier.h
+// Checks that a woken machine came up: pings its IP (or first finds the IP for its MAC
+// by sweeping the subnet with ARP requests) with exponential backoff, and records how
+// long it took. Everything is non-blocking: one raw ICMP socket serves every pending
+// verification and poll() only reads what has arrived. Loop task only.
+#ifndef WAKEVERIFIER_H
+#define WAKEVERIFIER_H
+
+#include <Arduino.h>
+#include "WakeOnLan.h"
+
+// Verifications that can be pending at once
+#ifndef WOL_VERIFY_MAX
+#define WOL_VERIFY_MAX 16
+#endif
+
+// Give up on a machine that has not answered after this long
+#ifndef WOL_VERIFY_TIMEOUT_MS
+#define WOL_VERIFY_TIMEOUT_MS 180000
+#endif
+
+// The first ping goes out this long after the wake; each unanswered one doubles the
+// wait for the next, up to WOL_VERIFY_MAX_BACKOFF_MS
+#ifndef WOL_VERIFY_FIRST_PROBE_MS
+#define WOL_VERIFY_FIRST_PROBE_MS 1000
+#endif
+#ifndef WOL_VERIFY_MAX_BACKOFF_MS
+#define WOL_VERIFY_MAX_BACKOFF_MS 16000
+#endif
+
+// While a MAC's IP is unknown, this many ARP requests go out every
+// WOL_VERIFY_ARP_PERIOD_MS (one subnet sweep shared by all such verifications), and
+// the ARP table is searched for the MAC as often
+#ifndef WOL_VERIFY_ARP_BATCH
+#define WOL_VERIFY_ARP_BATCH 8
+#endif
+#ifndef WOL_VERIFY_ARP_PERIOD_MS
+#define WOL_VERIFY_ARP_PERIOD_MS 250
+#endif
+
+// Saved hosts whose time-to-wake histogram is kept; the least recently woken is
+// forgotten first
+#ifndef WOL_VERIFY_HOST_STATS
+#define WOL_VERIFY_HOST_STATS 32
+#endif
+
+class WakeVerifier
+{
+  public:
+    enum class State : uint8_t
+    {
+        Unknown = 0, // never issued, or its slot was reused
+        Resolving,   // looking for the MAC's IP
+        Probing,     // pinging the IP
+        Up,
+        TimedOut,
+        Failed, // no ICMP socket, or nothing to sweep for the MAC
+    };
+
+    struct Status
+    {
+        State     state;
+        uint32_t  job;       // WakeQueue job of the wake
+        uint32_t  hostId;    // saved host, or 0
+        IPAddress ip;        // 0.0.0.0 while resolving
+        uint16_t  probes;    // pings sent
+        uint32_t  elapsedMs; // time to wake once Up, else time since the wake
+    };
+
+    // Upper bounds of the time-to-wake buckets in seconds; an overflow bucket follows
+    static constexpr uint16_t BOUNDS_S[] = {5, 10, 15, 20, 30, 45, 60, 90, 120, 180};
+    static constexpr size_t   BUCKETS    = sizeof(BOUNDS_S) / sizeof(BOUNDS_S[0]) + 1;
+
+    struct HostStats
+    {
+        uint32_t hostId;
+        uint32_t count; // machines seen up
+        uint32_t timeouts;
+        uint32_t sumMs;
+        uint32_t maxMs;
+        uint16_t buckets[BUCKETS]; // not cumulative
+        uint32_t lastUse;
+    };
+
+    // Start verifying the wake queued as `job` for `mac`. With `ip` 0.0.0.0 the IP is
+    // found through ARP first. Returns the verification id, or 0 when all slots are busy.
+    static uint32_t start(uint32_t job, const uint8_t mac[WakeOnLan::MAC_LEN],
+                          const IPAddress& ip, uint32_t hostId = 0);
+
+    // Send due probes and collect replies. Call from the main loop.
+    static void poll(uint32_t nowMs);
+
+    // False when `id` is unknown or its slot was reused
+    static bool        status(uint32_t id, Status& out);
+    static const char* stateName(State state);
+
+    // Time-to-wake of a saved host, or nullptr if none was measured
+    static const HostStats* hostStats(uint32_t hostId);
+
+    // Totals over all verifications, for /api/metrics
+    static uint32_t upCount();
+    static uint32_t timeoutCount();
+};
+
+#endif // WAKEVERIFIER_H
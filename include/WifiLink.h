@@ -0,0 +1,69 @@
+// WifiLink.h
+// Non-blocking WiFi bring-up. In station mode the soft AP comes up at once next to the
+// station, so the web UI is reachable from the first second, while association runs in
+// the background; once it succeeds the AP is switched off. The last good BSSID, channel
+// and IP lease are kept in NVS, so after a reboot the station skips the scan and DHCP.
+// A link lost for WIFI_AP_FALLBACK_MS brings the AP back until it returns. An AP not
+// started at boot still comes up if the station has not connected after
+// WIFI_CONNECT_TIMEOUT_MS, so a wrong password does not leave the device unreachable.
+// Loop task only.
+#ifndef WIFILINK_H
+#define WIFILINK_H
+
+#include <Arduino.h>
+
+// How long association with the cached BSSID/channel may take before it is forgotten
+// and the station scans for the network instead
+#ifndef WIFI_FAST_CONNECT_MS
+#define WIFI_FAST_CONNECT_MS 5000
+#endif
+
+// Reuse the cached IP lease as a static configuration on a fast connect. The DHCP
+// server may have handed the address on since, so networks with short leases should
+// build with 0.
+#ifndef WIFI_REUSE_LEASE
+#define WIFI_REUSE_LEASE 1
+#endif
+
+// A station that has not connected this long after boot turns the soft AP on, if it
+// is not already
+#ifndef WIFI_CONNECT_TIMEOUT_MS
+#define WIFI_CONNECT_TIMEOUT_MS 20000
+#endif
+
+// A station link down for this long turns the soft AP back on
+#ifndef WIFI_AP_FALLBACK_MS
+#define WIFI_AP_FALLBACK_MS 10000
+#endif
+
+class WifiLink
+{
+  public:
+    enum class State : uint8_t
+    {
+        AccessPoint, // AP only, as configured
+        Connecting,  // station associating (AP up, if started at boot or timed out)
+        Connected,   // station up, AP off
+        Lost,        // station was up and dropped; retrying
+    };
+
+    // AP-only mode when `ssid` is null; otherwise join `ssid` as a station. The AP then
+    // runs next to it from the start when `apAtBoot`, and otherwise only if the station
+    // fails to connect in time; a null `apSsid` means no AP at all. Returns without
+    // waiting for either.
+    static void begin(const char* ssid, const char* psk, const char* apSsid, const char* apPsk,
+                      bool apAtBoot = true);
+
+    // Follow the station's progress. Call from the main loop.
+    static void poll(uint32_t nowMs);
+
+    static State       state();
+    static const char* stateName(State state);
+
+    // millis() when the station first got its address, or 0 before then
+    static uint32_t connectedAtMs();
+    // Whether that connection came from the cached BSSID and channel
+    static bool fastConnected();
+};
+
+#endif // WIFILINK_H
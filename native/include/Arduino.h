@@ -0,0 +1,76 @@
+// Arduino.h (native)
+// Thin stand-in for the ESP32 Arduino core so the firmware in src/ builds and runs as a
+// Linux process ([env:native_app]). Only what the firmware uses is provided; behaviour
+// follows the ESP32 core where the firmware depends on it.
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "IPAddress.h"
+#include "WString.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+#define OUTPUT 0x03
+
+unsigned long millis();
+unsigned long micros();
+void          delay(uint32_t ms);
+void          delayMicroseconds(uint32_t us);
+
+// The clock is only recorded, for getCpuFrequencyMhz()
+bool     setCpuFrequencyMhz(uint32_t mhz);
+uint32_t getCpuFrequencyMhz();
+
+// Port of the web UI for [env:native_app] (-DHTTP_PORT=NATIVE_HTTP_PORT): 8080, or
+// NATIVE_HTTP_PORT from the environment so several instances can run side by side
+uint16_t nativeHttpPort(uint16_t fallback);
+#define NATIVE_HTTP_PORT nativeHttpPort(8080)
+
+// GPIOs do not exist here; writes are ignored and reads return LOW
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int  digitalRead(uint8_t) { return LOW; }
+
+// The host's clock is already set; SNTP is left to the OS
+inline void configTime(long, int, const char*) {}
+
+inline bool isWhitespace(int c)
+{
+    return c == ' ' || c == '\t' || c == '\v' || c == '\f' || c == '\r' || c == '\n';
+}
+
+// UART0 is stdout
+class HardwareSerial
+{
+  public:
+    void   begin(unsigned long) {}
+    size_t print(const char* s) { return fputs(s, stdout) < 0 ? 0 : strlen(s); }
+    size_t println(const char* s) { return print(s) + print("\n"); }
+    size_t println() { return print("\n"); }
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+    void   flush() { fflush(stdout); }
+};
+
+extern HardwareSerial Serial;
+
+// Heap figures come from the C library's allocator statistics
+class EspClass
+{
+  public:
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getHeapSize();
+};
+
+extern EspClass ESP;
+
+#endif // NATIVE_ARDUINO_H
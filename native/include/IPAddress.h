@@ -0,0 +1,51 @@
+// IPAddress.h (native)
+// IPv4 address as in the ESP32 core: stored in network byte order, so the uint32_t
+// conversion matches in_addr.s_addr.
+#ifndef NATIVE_IPADDRESS_H
+#define NATIVE_IPADDRESS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "WString.h"
+
+class IPAddress
+{
+  public:
+    IPAddress() = default;
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes{a, b, c, d} {}
+    IPAddress(uint32_t address) { memcpy(bytes, &address, sizeof(bytes)); }
+
+    operator uint32_t() const
+    {
+        uint32_t v;
+        memcpy(&v, bytes, sizeof(v));
+        return v;
+    }
+
+    uint8_t operator[](int i) const { return bytes[i]; }
+
+    // Dotted quad only; leaves the address untouched on failure
+    bool fromString(const char* s)
+    {
+        unsigned a, b, c, d;
+        char     tail;
+        if (!s || sscanf(s, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4 || a > 255 ||
+            b > 255 || c > 255 || d > 255)
+            return false;
+        *this = IPAddress((uint8_t)a, (uint8_t)b, (uint8_t)c, (uint8_t)d);
+        return true;
+    }
+
+    String toString() const
+    {
+        char out[16];
+        snprintf(out, sizeof(out), "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+        return String(out);
+    }
+
+  private:
+    uint8_t bytes[4] = {0, 0, 0, 0};
+};
+
+#endif // NATIVE_IPADDRESS_H
@@ -0,0 +1,29 @@
+// Preferences.h (native)
+// NVS key/value store as files: namespace `ns` key `k` is the file
+// $NATIVE_NVS_DIR/ns/k (default ./nvs), written to a temporary file and renamed into
+// place so a crash never leaves half a value. Only the blob API is provided.
+#ifndef NATIVE_PREFERENCES_H
+#define NATIVE_PREFERENCES_H
+
+#include <stddef.h>
+
+class Preferences
+{
+  public:
+    bool begin(const char* name, bool readOnly = false);
+    void end();
+
+    size_t putBytes(const char* key, const void* value, size_t len);
+    size_t getBytes(const char* key, void* buf, size_t maxLen);
+    size_t getBytesLength(const char* key);
+    bool   remove(const char* key);
+
+  private:
+    bool path(const char* key, char* out, size_t outLen) const;
+
+    char dir[256] = "";
+    bool writable = false;
+    bool started  = false;
+};
+
+#endif // NATIVE_PREFERENCES_H
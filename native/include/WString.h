@@ -0,0 +1,87 @@
+// WString.h (native)
+// Arduino String over std::string, with the subset of the API the firmware uses.
+#ifndef NATIVE_WSTRING_H
+#define NATIVE_WSTRING_H
+
+#include <stdlib.h>
+#include <string>
+
+class String
+{
+  public:
+    String() = default;
+    String(const char* s) : s(s ? s : "") {}
+    String(const std::string& s) : s(s) {}
+    explicit String(char c) : s(1, c) {}
+    explicit String(int v) : s(std::to_string(v)) {}
+    explicit String(unsigned int v) : s(std::to_string(v)) {}
+    explicit String(long v) : s(std::to_string(v)) {}
+    explicit String(unsigned long v) : s(std::to_string(v)) {}
+
+    const char*  c_str() const { return s.c_str(); }
+    unsigned int length() const { return (unsigned int)s.size(); }
+
+    char  operator[](unsigned int i) const { return i < s.size() ? s[i] : '\0'; }
+    char& operator[](unsigned int i) { return s[i]; }
+
+    String& operator+=(const String& o)
+    {
+        s += o.s;
+        return *this;
+    }
+    String& operator+=(const char* o)
+    {
+        s += o ? o : "";
+        return *this;
+    }
+    String& operator+=(char c)
+    {
+        s += c;
+        return *this;
+    }
+
+    friend String operator+(const String& a, const String& b) { return String(a.s + b.s); }
+    friend String operator+(const String& a, const char* b) { return a + String(b); }
+    friend String operator+(const char* a, const String& b) { return String(a) + b; }
+
+    bool operator==(const String& o) const { return s == o.s; }
+    bool operator==(const char* o) const { return s == (o ? o : ""); }
+    bool operator!=(const String& o) const { return s != o.s; }
+
+    int indexOf(char c, unsigned int from = 0) const { return find(s.find(c, from)); }
+    int indexOf(const String& str, unsigned int from = 0) const
+    {
+        return find(s.find(str.s, from));
+    }
+
+    // Clamped like the Arduino core: out-of-range bounds give a shorter (or empty) string
+    String substring(unsigned int from) const { return substring(from, length()); }
+    String substring(unsigned int from, unsigned int to) const
+    {
+        if (from > to)
+        {
+            unsigned int t = from;
+            from           = to;
+            to             = t;
+        }
+        if (from >= s.size())
+            return String();
+        return String(s.substr(from, to - from));
+    }
+
+    void trim()
+    {
+        size_t b = s.find_first_not_of(" \t\r\n\v\f");
+        size_t e = s.find_last_not_of(" \t\r\n\v\f");
+        s        = b == std::string::npos ? std::string() : s.substr(b, e - b + 1);
+    }
+
+    long toInt() const { return strtol(s.c_str(), nullptr, 10); }
+
+  private:
+    static int find(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+
+    std::string s;
+};
+
+#endif // NATIVE_WSTRING_H
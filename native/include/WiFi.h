@@ -0,0 +1,65 @@
+// WiFi.h (native)
+// The host's network stands in for the radio: station mode "connects" with the loopback
+// address (or NATIVE_WIFI_IP), at once or NATIVE_WIFI_CONNECT_MS after begin(), and a
+// soft AP reports the address the ESP32 would use.
+#ifndef NATIVE_WIFI_H
+#define NATIVE_WIFI_H
+
+#include "Arduino.h"
+#include "WiFiUdp.h"
+
+typedef enum
+{
+    WIFI_OFF    = 0,
+    WIFI_STA    = 1,
+    WIFI_AP     = 2,
+    WIFI_AP_STA = 3,
+} wifi_mode_t;
+
+typedef enum
+{
+    WL_IDLE_STATUS  = 0,
+    WL_CONNECTED    = 3,
+    WL_DISCONNECTED = 6,
+} wl_status_t;
+
+typedef enum
+{
+    WIFI_PS_NONE,
+    WIFI_PS_MIN_MODEM,
+    WIFI_PS_MAX_MODEM,
+} wifi_ps_type_t;
+
+class WiFiClass
+{
+  public:
+    bool        mode(wifi_mode_t m);
+    wifi_mode_t getMode() const { return current; }
+    wl_status_t begin(const char* ssid, const char* passphrase = nullptr, int32_t channel = 0,
+                      const uint8_t* bssid = nullptr);
+    wl_status_t status() const;
+    bool        config(IPAddress localIp, IPAddress gateway, IPAddress subnet,
+                       IPAddress dns = IPAddress());
+    bool        disconnect(bool wifiOff = false);
+    bool        setAutoReconnect(bool) { return true; }
+    bool        setSleep(wifi_ps_type_t) { return true; }
+    IPAddress   localIP() const;
+    IPAddress   subnetMask() const;
+    IPAddress   gatewayIP() const;
+    IPAddress   dnsIP() const;
+    uint8_t*    BSSID();
+    int32_t     channel() const;
+    bool        softAP(const char* ssid, const char* passphrase = nullptr);
+    bool        softAPdisconnect(bool wifiOff = false);
+    IPAddress   softAPIP() const;
+
+  private:
+    wifi_mode_t   current    = WIFI_OFF;
+    bool          joining    = false;
+    unsigned long joinedAtMs = 0;
+    uint8_t       bssid[6]   = {0x02, 0, 0, 0, 0, 0x01};
+};
+
+extern WiFiClass WiFi;
+
+#endif // NATIVE_WIFI_H
@@ -0,0 +1,37 @@
+// WiFiUdp.h (native)
+// WiFiUDP over a POSIX datagram socket with SO_BROADCAST set. Packets for the limited
+// broadcast address 255.255.255.255 go to WOL_NATIVE_BROADCAST ("addr" or "addr:port")
+// from the environment, or 127.255.255.255 (loopback) by default, so wakes can be
+// watched on the host.
+#ifndef NATIVE_WIFIUDP_H
+#define NATIVE_WIFIUDP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "IPAddress.h"
+
+class WiFiUDP
+{
+  public:
+    ~WiFiUDP() { stop(); }
+
+    // Bind to `port` (0 = any). Returns 1 on success, 0 on failure.
+    uint8_t begin(uint16_t port);
+    void    stop();
+
+    int    beginPacket(IPAddress ip, uint16_t port);
+    size_t write(const uint8_t* data, size_t len);
+    int    endPacket(); // 1 once the datagram is sent
+
+  private:
+    static constexpr size_t MAX_PACKET = 1472;
+
+    int      fd       = -1;
+    uint32_t destAddr = 0; // network byte order
+    uint16_t destPort = 0;
+    size_t   len      = 0;
+    bool     overflow = false;
+    uint8_t  packet[MAX_PACKET];
+};
+
+#endif // NATIVE_WIFIUDP_H
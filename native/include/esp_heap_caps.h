@@ -0,0 +1,15 @@
+// esp_heap_caps.h (native)
+#ifndef NATIVE_ESP_HEAP_CAPS_H
+#define NATIVE_ESP_HEAP_CAPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+// The largest free chunk the C library's allocator holds (it can always grow beyond it)
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+size_t heap_caps_get_free_size(uint32_t caps);
+
+#endif // NATIVE_ESP_HEAP_CAPS_H
@@ -0,0 +1,11 @@
+// esp_sntp.h (native)
+#ifndef NATIVE_ESP_SNTP_H
+#define NATIVE_ESP_SNTP_H
+
+struct timeval;
+typedef void (*sntp_sync_time_cb_t)(struct timeval* tv);
+
+// The host's clock is kept by the OS, so no sync is ever reported
+inline void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t) {}
+
+#endif // NATIVE_ESP_SNTP_H
@@ -0,0 +1,10 @@
+// esp_system.h (native)
+// Only the hardware random number generator, from the host's entropy source
+#ifndef NATIVE_ESP_SYSTEM_H
+#define NATIVE_ESP_SYSTEM_H
+
+#include <stdint.h>
+
+uint32_t esp_random();
+
+#endif // NATIVE_ESP_SYSTEM_H
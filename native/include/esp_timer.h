@@ -0,0 +1,10 @@
+// esp_timer.h (native)
+#ifndef NATIVE_ESP_TIMER_H
+#define NATIVE_ESP_TIMER_H
+
+#include <stdint.h>
+
+// Microseconds since the process started
+int64_t esp_timer_get_time();
+
+#endif // NATIVE_ESP_TIMER_H
@@ -0,0 +1,26 @@
+// freertos/FreeRTOS.h (native)
+// Types and constants of the FreeRTOS API the firmware uses; tasks are std::threads
+// (see freertos/task.h). One tick is one millisecond.
+#ifndef NATIVE_FREERTOS_H
+#define NATIVE_FREERTOS_H
+
+#include <stdint.h>
+
+typedef int32_t  BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+
+#define configTICK_RATE_HZ 1000
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+// The Arduino loop runs on core 1 of a dual-core ESP32; cores are not modelled here
+#define ARDUINO_RUNNING_CORE 1
+#define CONFIG_FREERTOS_UNICORE 0
+
+#endif // NATIVE_FREERTOS_H
@@ -0,0 +1,25 @@
+// freertos/task.h (native)
+// FreeRTOS tasks as detached std::threads. Priorities and core affinity are accepted
+// and ignored; direct-to-task notifications keep their counting semantics.
+#ifndef NATIVE_FREERTOS_TASK_H
+#define NATIVE_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+struct NativeTask;
+typedef NativeTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* param,
+                       UBaseType_t priority, TaskHandle_t* created);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth,
+                                   void* param, UBaseType_t priority, TaskHandle_t* created,
+                                   BaseType_t core);
+void       vTaskDelay(TickType_t ticks);
+
+// Notifications to and from the calling task (the main thread counts as a task too)
+TaskHandle_t xTaskGetCurrentTaskHandle();
+BaseType_t   xTaskNotifyGive(TaskHandle_t task);
+uint32_t     ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait);
+
+#endif // NATIVE_FREERTOS_TASK_H
@@ -0,0 +1,22 @@
+// lwip/etharp.h (native)
+// The ARP table is the kernel's (/proc/net/arp), and a request is a datagram to the
+// discard port, which makes the kernel resolve the address.
+#ifndef NATIVE_LWIP_ETHARP_H
+#define NATIVE_LWIP_ETHARP_H
+
+#include <stddef.h>
+#include "lwip/netif.h"
+
+#define ARP_TABLE_SIZE 64
+
+struct eth_addr
+{
+    uint8_t addr[6];
+};
+
+// Entry `i` of the table as last read; the table is read again when i is 0
+int   etharp_get_entry(size_t i, ip4_addr_t** ipaddr, struct netif** netif,
+                       struct eth_addr** eth_ret);
+err_t etharp_request(struct netif* netif, const ip4_addr_t* ipaddr);
+
+#endif // NATIVE_LWIP_ETHARP_H
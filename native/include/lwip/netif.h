@@ -0,0 +1,25 @@
+// lwip/netif.h (native)
+// The few lwIP types the firmware touches. There is one "interface": the host's own
+// network stack, which does ARP by itself.
+#ifndef NATIVE_LWIP_NETIF_H
+#define NATIVE_LWIP_NETIF_H
+
+#include <stdint.h>
+
+typedef int8_t err_t;
+#define ERR_OK 0
+#define ERR_IF -12
+
+typedef struct ip4_addr
+{
+    uint32_t addr; // network byte order
+} ip4_addr_t;
+
+struct netif
+{
+    int index;
+};
+
+extern struct netif* netif_default;
+
+#endif // NATIVE_LWIP_NETIF_H
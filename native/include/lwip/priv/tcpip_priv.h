@@ -0,0 +1,20 @@
+// lwip/priv/tcpip_priv.h (native)
+// There is no tcpip thread: an API call runs on the calling task.
+#ifndef NATIVE_LWIP_TCPIP_PRIV_H
+#define NATIVE_LWIP_TCPIP_PRIV_H
+
+#include "lwip/netif.h"
+
+struct tcpip_api_call_data
+{
+    err_t err;
+};
+
+typedef err_t (*tcpip_api_call_fn)(struct tcpip_api_call_data* call);
+
+inline err_t tcpip_api_call(tcpip_api_call_fn fn, struct tcpip_api_call_data* call)
+{
+    return fn(call);
+}
+
+#endif // NATIVE_LWIP_TCPIP_PRIV_H
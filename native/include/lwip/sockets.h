@@ -0,0 +1,12 @@
+// lwip/sockets.h (native)
+// lwIP's BSD socket API is the host's own
+#ifndef NATIVE_LWIP_SOCKETS_H
+#define NATIVE_LWIP_SOCKETS_H
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#endif // NATIVE_LWIP_SOCKETS_H
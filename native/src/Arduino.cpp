@@ -0,0 +1,113 @@
+// Arduino.cpp (native)
+#include "Arduino.h"
+#include <malloc.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+
+HardwareSerial Serial;
+EspClass       ESP;
+
+static uint64_t monotonicMicros()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+// Time counts from the first call, like the ESP32 counts from boot
+static uint64_t bootMicros()
+{
+    static const uint64_t boot = monotonicMicros();
+    return boot;
+}
+
+int64_t esp_timer_get_time()
+{
+    return (int64_t)(monotonicMicros() - bootMicros());
+}
+
+unsigned long millis()
+{
+    return (unsigned long)(uint32_t)(esp_timer_get_time() / 1000);
+}
+
+unsigned long micros()
+{
+    return (unsigned long)(uint32_t)esp_timer_get_time();
+}
+
+void delay(uint32_t ms)
+{
+    usleep((useconds_t)ms * 1000);
+}
+
+void delayMicroseconds(uint32_t us)
+{
+    usleep(us);
+}
+
+static uint32_t cpuMhz = 240;
+
+bool setCpuFrequencyMhz(uint32_t mhz)
+{
+    if (mhz != 240 && mhz != 160 && mhz != 80)
+        return false;
+    cpuMhz = mhz;
+    return true;
+}
+
+uint32_t getCpuFrequencyMhz()
+{
+    return cpuMhz;
+}
+
+uint16_t nativeHttpPort(uint16_t fallback)
+{
+    const char*   env  = getenv("NATIVE_HTTP_PORT");
+    unsigned long port = env ? strtoul(env, nullptr, 10) : 0;
+    return port && port <= 65535 ? (uint16_t)port : fallback;
+}
+
+size_t HardwareSerial::printf(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int n = vprintf(fmt, args);
+    va_end(args);
+    return n < 0 ? 0 : (size_t)n;
+}
+
+static uint32_t minFree = UINT32_MAX;
+
+uint32_t EspClass::getFreeHeap()
+{
+    uint32_t f = (uint32_t)heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    if (f < minFree)
+        minFree = f;
+    return f;
+}
+
+uint32_t EspClass::getMinFreeHeap()
+{
+    getFreeHeap();
+    return minFree;
+}
+
+uint32_t EspClass::getHeapSize()
+{
+    return (uint32_t)mallinfo2().arena;
+}
+
+size_t heap_caps_get_free_size(uint32_t)
+{
+    return mallinfo2().fordblks;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t)
+{
+    // glibc does not report its largest chunk; the top chunk is a fair lower bound
+    return mallinfo2().keepcost;
+}
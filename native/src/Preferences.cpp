@@ -0,0 +1,89 @@
+// Preferences.cpp (native)
+#include "Preferences.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool Preferences::begin(const char* name, bool readOnly)
+{
+    const char* root = getenv("NATIVE_NVS_DIR");
+    if (!root || !*root)
+        root = "nvs";
+    if (mkdir(root, 0755) != 0 && errno != EEXIST)
+        return false;
+    int n = snprintf(dir, sizeof(dir), "%s/%s", root, name);
+    if (n < 0 || (size_t)n >= sizeof(dir) || (mkdir(dir, 0755) != 0 && errno != EEXIST))
+        return false;
+    writable = !readOnly;
+    started  = true;
+    return true;
+}
+
+void Preferences::end()
+{
+    started = false;
+}
+
+bool Preferences::path(const char* key, char* out, size_t outLen) const
+{
+    // NVS keys are at most 15 characters
+    if (!started || !key || !*key || strlen(key) > 15 || strchr(key, '/'))
+        return false;
+    int n = snprintf(out, outLen, "%s/%s", dir, key);
+    return n > 0 && (size_t)n < outLen;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len)
+{
+    char file[300], tmp[310];
+    if (!writable || !path(key, file, sizeof(file)))
+        return 0;
+    snprintf(tmp, sizeof(tmp), "%s.tmp", file);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return 0;
+    bool ok = write(fd, value, len) == (ssize_t)len;
+    ok      = close(fd) == 0 && ok;
+    if (!ok || rename(tmp, file) != 0)
+    {
+        unlink(tmp);
+        return 0;
+    }
+    return len;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen)
+{
+    char file[300];
+    if (!path(key, file, sizeof(file)))
+        return 0;
+    // Like NVS, a value larger than the buffer is not read at all
+    size_t len = getBytesLength(key);
+    if (len == 0 || len > maxLen)
+        return 0;
+    int fd = open(file, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    ssize_t n = read(fd, buf, len);
+    close(fd);
+    return n == (ssize_t)len ? len : 0;
+}
+
+size_t Preferences::getBytesLength(const char* key)
+{
+    char        file[300];
+    struct stat st;
+    if (!path(key, file, sizeof(file)) || stat(file, &st) != 0)
+        return 0;
+    return (size_t)st.st_size;
+}
+
+bool Preferences::remove(const char* key)
+{
+    char file[300];
+    return writable && path(key, file, sizeof(file)) && unlink(file) == 0;
+}
@@ -0,0 +1,112 @@
+// WiFi.cpp (native)
+#include "WiFi.h"
+#include <arpa/inet.h>
+#include <stdlib.h>
+#include "Arduino.h"
+
+WiFiClass WiFi;
+
+// The station's address and mask: loopback, or NATIVE_WIFI_IP ("addr/prefix") so that
+// several instances can stand for devices on different subnets
+static void stationAddress(IPAddress& ip, IPAddress& mask)
+{
+    ip              = IPAddress(127, 0, 0, 1);
+    mask            = IPAddress(255, 0, 0, 0);
+    const char* env = getenv("NATIVE_WIFI_IP");
+    char        addr[16];
+    unsigned    prefix = 0;
+    if (!env || sscanf(env, "%15[0-9.]/%u", addr, &prefix) != 2 || prefix < 1 || prefix > 32)
+        return;
+    IPAddress parsed;
+    if (!parsed.fromString(addr))
+        return;
+    ip   = parsed;
+    mask = IPAddress(htonl(prefix == 32 ? 0xFFFFFFFFu : ~(0xFFFFFFFFu >> prefix)));
+}
+
+bool WiFiClass::mode(wifi_mode_t m)
+{
+    current = m;
+    if (!(m & WIFI_STA))
+        joining = false;
+    return true;
+}
+
+wl_status_t WiFiClass::begin(const char*, const char*, int32_t, const uint8_t*)
+{
+    const char* delay = getenv("NATIVE_WIFI_CONNECT_MS");
+    joining           = true;
+    joinedAtMs        = millis() + (delay ? strtoul(delay, nullptr, 10) : 0);
+    return status();
+}
+
+wl_status_t WiFiClass::status() const
+{
+    if (!joining)
+        return WL_DISCONNECTED;
+    return (long)(millis() - joinedAtMs) >= 0 ? WL_CONNECTED : WL_IDLE_STATUS;
+}
+
+bool WiFiClass::config(IPAddress, IPAddress, IPAddress, IPAddress)
+{
+    return true;
+}
+
+bool WiFiClass::disconnect(bool wifiOff)
+{
+    joining = false;
+    if (wifiOff)
+        current = WIFI_OFF;
+    return true;
+}
+
+IPAddress WiFiClass::localIP() const
+{
+    IPAddress ip, mask;
+    stationAddress(ip, mask);
+    return status() == WL_CONNECTED ? ip : IPAddress();
+}
+
+IPAddress WiFiClass::subnetMask() const
+{
+    IPAddress ip, mask;
+    stationAddress(ip, mask);
+    return status() == WL_CONNECTED ? mask : IPAddress();
+}
+
+IPAddress WiFiClass::gatewayIP() const
+{
+    return status() == WL_CONNECTED ? IPAddress(127, 0, 0, 1) : IPAddress();
+}
+
+IPAddress WiFiClass::dnsIP() const
+{
+    return gatewayIP();
+}
+
+uint8_t* WiFiClass::BSSID()
+{
+    return status() == WL_CONNECTED ? bssid : nullptr;
+}
+
+int32_t WiFiClass::channel() const
+{
+    return status() == WL_CONNECTED ? 1 : 0;
+}
+
+bool WiFiClass::softAP(const char*, const char*)
+{
+    return true;
+}
+
+bool WiFiClass::softAPdisconnect(bool wifiOff)
+{
+    if (wifiOff)
+        current = WIFI_OFF;
+    return true;
+}
+
+IPAddress WiFiClass::softAPIP() const
+{
+    return IPAddress(192, 168, 4, 1);
+}
@@ -0,0 +1,112 @@
+// WiFiUdp.cpp (native)
+#include "WiFiUdp.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Where limited broadcasts are redirected: WOL_NATIVE_BROADCAST="addr[:port]", see
+// WiFiUdp.h. A port there replaces the packet's own, so an unprivileged sink can listen.
+struct Redirect
+{
+    uint32_t addr; // network byte order
+    uint16_t port; // 0 = keep the packet's port
+};
+
+static const Redirect& broadcastTarget()
+{
+    static const Redirect target = []
+    {
+        Redirect    r   = {0, 0};
+        const char* env = getenv("WOL_NATIVE_BROADCAST");
+        char        host[32];
+        in_addr     a;
+        if (env)
+        {
+            snprintf(host, sizeof(host), "%s", env);
+            char* colon = strchr(host, ':');
+            if (colon)
+            {
+                *colon = '\0';
+                r.port = (uint16_t)atoi(colon + 1);
+            }
+        }
+        if (!env || inet_pton(AF_INET, host, &a) != 1)
+            inet_pton(AF_INET, "127.255.255.255", &a);
+        r.addr = a.s_addr;
+        return r;
+    }();
+    return target;
+}
+
+uint8_t WiFiUDP::begin(uint16_t port)
+{
+    stop();
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+        return 0;
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+    {
+        stop();
+        return 0;
+    }
+    return 1;
+}
+
+void WiFiUDP::stop()
+{
+    if (fd >= 0)
+        close(fd);
+    fd = -1;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port)
+{
+    destAddr = (uint32_t)ip;
+    destPort = port;
+    if (destAddr == 0xFFFFFFFFu)
+    {
+        destAddr = broadcastTarget().addr;
+        if (broadcastTarget().port)
+            destPort = broadcastTarget().port;
+    }
+    len      = 0;
+    overflow = false;
+    return fd >= 0 ? 1 : 0;
+}
+
+size_t WiFiUDP::write(const uint8_t* data, size_t n)
+{
+    if (len + n > MAX_PACKET)
+    {
+        overflow = true;
+        return 0;
+    }
+    memcpy(packet + len, data, n);
+    len += n;
+    return n;
+}
+
+int WiFiUDP::endPacket()
+{
+    if (fd < 0 || overflow)
+        return 0;
+    sockaddr_in to;
+    memset(&to, 0, sizeof(to));
+    to.sin_family      = AF_INET;
+    to.sin_port        = htons(destPort);
+    to.sin_addr.s_addr = destAddr;
+    ssize_t n = sendto(fd, packet, len, 0, reinterpret_cast<sockaddr*>(&to), sizeof(to));
+    return n == (ssize_t)len ? 1 : 0;
+}
@@ -0,0 +1,37 @@
+// esp_pm.cpp (native)
+#include "esp_pm.h"
+#include <atomic>
+#include "Arduino.h"
+
+struct esp_pm_lock
+{
+    std::atomic<int> count{0};
+};
+
+esp_err_t esp_pm_configure(const void* config)
+{
+    const esp_pm_config_esp32_t* c = static_cast<const esp_pm_config_esp32_t*>(config);
+    if (!c || c->min_freq_mhz > c->max_freq_mhz || !setCpuFrequencyMhz(c->max_freq_mhz))
+        return ESP_FAIL;
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t, int, const char*, esp_pm_lock_handle_t* handle)
+{
+    *handle = new esp_pm_lock;
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t handle)
+{
+    handle->count++;
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t handle)
+{
+    if (handle->count <= 0)
+        return ESP_FAIL;
+    handle->count--;
+    return ESP_OK;
+}
@@ -0,0 +1,12 @@
+// esp_system.cpp (native)
+#include "esp_system.h"
+#include <stdlib.h>
+#include <sys/random.h>
+
+uint32_t esp_random()
+{
+    uint32_t v = 0;
+    if (getrandom(&v, sizeof(v), 0) != sizeof(v))
+        return (uint32_t)random(); // no entropy source: at least not a constant
+    return v;
+}
@@ -0,0 +1,73 @@
+// lwip.cpp (native)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "lwip/etharp.h"
+
+static struct netif host = {0};
+struct netif*       netif_default = &host;
+
+struct ArpEntry
+{
+    ip4_addr_t      ip;
+    struct eth_addr eth;
+};
+
+static ArpEntry table[ARP_TABLE_SIZE];
+static size_t   tableSize = 0;
+
+// Complete entries only, as lwIP's stable ones
+static void readTable()
+{
+    tableSize = 0;
+    FILE* f   = fopen("/proc/net/arp", "r");
+    if (!f)
+        return;
+    char line[160];
+    fgets(line, sizeof(line), f); // header
+    while (tableSize < ARP_TABLE_SIZE && fgets(line, sizeof(line), f))
+    {
+        char         ip[16], mac[18];
+        unsigned     type, flags;
+        unsigned int b[6];
+        if (sscanf(line, "%15s 0x%x 0x%x %17s", ip, &type, &flags, mac) != 4 || !(flags & 2) ||
+            sscanf(mac, "%x:%x:%x:%x:%x:%x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6)
+            continue;
+        ArpEntry& e = table[tableSize];
+        if (inet_pton(AF_INET, ip, &e.ip.addr) != 1)
+            continue;
+        for (int i = 0; i < 6; ++i)
+            e.eth.addr[i] = (uint8_t)b[i];
+        tableSize++;
+    }
+    fclose(f);
+}
+
+int etharp_get_entry(size_t i, ip4_addr_t** ipaddr, struct netif** netif,
+                     struct eth_addr** eth_ret)
+{
+    if (i == 0)
+        readTable();
+    if (i >= tableSize)
+        return 0;
+    *ipaddr  = &table[i].ip;
+    *netif   = &host;
+    *eth_ret = &table[i].eth;
+    return 1;
+}
+
+err_t etharp_request(struct netif*, const ip4_addr_t* ipaddr)
+{
+    static int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0)
+        return ERR_IF;
+    sockaddr_in to     = {};
+    to.sin_family      = AF_INET;
+    to.sin_port        = htons(9);
+    to.sin_addr.s_addr = ipaddr->addr;
+    sendto(sock, "", 0, MSG_DONTWAIT, (const sockaddr*)&to, sizeof(to));
+    return ERR_OK;
+}
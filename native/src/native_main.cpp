@@ -0,0 +1,26 @@
+// native_main.cpp
+// Process entry point for [env:native_app]: runs the firmware's setup() once and then
+// loop() forever, as the ESP32 core's loop task does. Left out of `pio test` builds,
+// where each suite in test/ brings its own main().
+#ifndef PIO_UNIT_TESTING
+#include <signal.h>
+#include <unistd.h>
+#include "Arduino.h"
+
+void setup();
+void loop();
+
+int main()
+{
+    signal(SIGPIPE, SIG_IGN); // a client that hangs up must not kill the "device"
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    setup();
+    for (;;)
+    {
+        loop();
+        // The ESP32 loop task yields to the idle task between iterations
+        usleep(100);
+    }
+}
+
+#endif // PIO_UNIT_TESTING
@@ -0,0 +1,79 @@
+// task.cpp (native)
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include "freertos/task.h"
+
+struct NativeTask
+{
+    explicit NativeTask(const char* name) : name(name) {}
+
+    const char*             name;
+    std::mutex              lock;
+    std::condition_variable wake;
+    uint32_t                notifications = 0;
+};
+
+static NativeTask               mainTask{"loopTask"};
+static thread_local NativeTask* current = &mainTask;
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t, void* param, UBaseType_t,
+                       TaskHandle_t* created)
+{
+    // Tasks live as long as the process, as firmware tasks do
+    NativeTask* task = new NativeTask(name);
+    if (created)
+        *created = task;
+    std::thread(
+        [fn, param, task]
+        {
+            current = task;
+            fn(param);
+        })
+        .detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth,
+                                   void* param, UBaseType_t priority, TaskHandle_t* created,
+                                   BaseType_t)
+{
+    return xTaskCreate(fn, name, stackDepth, param, priority, created);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    usleep((useconds_t)ticks * 1000);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    return current;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    {
+        std::lock_guard<std::mutex> guard(task->lock);
+        task->notifications++;
+    }
+    task->wake.notify_one();
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait)
+{
+    NativeTask&                  self = *current;
+    std::unique_lock<std::mutex> guard(self.lock);
+    auto                         ready = [&self] { return self.notifications != 0; };
+    if (ticksToWait == portMAX_DELAY)
+        self.wake.wait(guard, ready);
+    else
+        self.wake.wait_for(guard, std::chrono::milliseconds(ticksToWait), ready);
+
+    uint32_t value = self.notifications;
+    if (value)
+        self.notifications = clearOnExit ? 0 : value - 1;
+    return value;
+}
@@ -1,14 +1,32 @@
 #!/usr/bin/env python3
 """Generate C header from files in assets/.
 
-Scans the `assets/` directory and embeds each file as a gzipped byte array in
-`include/generated/assets.h`. This script is intended to be run before build.
+Scans the `assets/` directory, minifies HTML/CSS/JS and embeds each file in
+`include/generated/assets.h` as up to three encoded variants: brotli (when the
+`brotli` module is installed), gzip at level 9, and identity when the minified
+file is at most ASSET_IDENTITY_MAX bytes. Each variant has its own pre-rendered
+HTTP response header block; the server picks the smallest one the client's
+Accept-Encoding allows. A collision-free (perfect) hash index over the asset
+paths is generated as well, and a per-asset size report is printed.
+
+Every asset gets a content-hash ETag (and a pre-rendered 304 block). Assets other
+than HTML are also published under a fingerprinted path (`/app.<hash>.js`) that is
+served as immutable; references to them in the HTML are rewritten to that path, so
+a repeat visit only revalidates index.html. This script is intended to be run
+before build.
 """
 import os
 import gzip
+import hashlib
 import re
+from dataclasses import dataclass, field
 from pathlib import Path
 
+try:
+    import brotli
+except ImportError:  # optional: without it only gzip and identity are embedded
+    brotli = None
+
 ROOT = Path(__file__).resolve().parent.parent
 ASSETS_DIR = ROOT / "assets"
 OUT_DIR = ROOT / "include" / "generated"
@@ -22,6 +40,256 @@ def sanitize_identifier(rel_path: str) -> str:
     return "asset_" + ident
 
 
+MIME_TYPES = {
+    ".html": "text/html",
+    ".htm": "text/html",
+    ".js": "application/javascript",
+    ".css": "text/css",
+    ".json": "application/json",
+    ".png": "image/png",
+    ".jpg": "image/jpeg",
+    ".jpeg": "image/jpeg",
+    ".svg": "image/svg+xml",
+}
+
+# Cache policy for plain paths (always revalidate, cheap with the ETag) and for
+# fingerprinted paths, whose content can never change
+CACHE_REVALIDATE = "no-cache"
+CACHE_IMMUTABLE = "public, max-age=31536000, immutable"
+
+# Largest minified asset that is also stored uncompressed, for clients that accept
+# neither gzip nor brotli. Larger ones fall back to gzip.
+IDENTITY_MAX = int(os.environ.get("ASSET_IDENTITY_MAX", "4096"))
+
+# Content codings; the bit values match ASSET_ENC_* in the generated header
+ENC_IDENTITY = 0x01
+ENC_GZIP = 0x02
+ENC_BR = 0x04
+ENCODING_NAMES = {ENC_IDENTITY: "identity", ENC_GZIP: "gzip", ENC_BR: "br"}
+ENCODING_SUFFIX = {ENC_IDENTITY: "", ENC_GZIP: "-gz", ENC_BR: "-br"}
+
+FNV_OFFSET = 0x811C9DC5
+FNV_PRIME = 0x01000193
+
+
+def mime_for_path(path: str) -> str:
+    return MIME_TYPES.get(os.path.splitext(path)[1].lower(), "text/plain")
+
+
+def asset_hash(path: str, seed: int) -> int:
+    # 32-bit FNV-1a with the seed folded into the offset basis; must match
+    # asset_hash() in the generated header.
+    h = (FNV_OFFSET ^ seed) & 0xFFFFFFFF
+    for b in path.encode():
+        h ^= b
+        h = (h * FNV_PRIME) & 0xFFFFFFFF
+    return h
+
+
+def build_perfect_hash(paths):
+    """Find a seed for which every path lands in its own slot of a power-of-two table."""
+    size = 1
+    while size < 2 * max(len(paths), 1):
+        size *= 2
+    while True:
+        for seed in range(1 << 16):
+            slots = [-1] * size
+            for i, p in enumerate(paths):
+                s = asset_hash(p, seed) & (size - 1)
+                if slots[s] != -1:
+                    break
+                slots[s] = i
+            else:
+                return seed, slots
+        size *= 2
+
+
+def _scan(text: str, quotes: str, line_comments: bool):
+    """Strip comments from source and pull out its string literals.
+
+    Returns the code with every string (and JS template literal) replaced by a
+    NUL-delimited index, plus the list of strings to put back. Regex
+    literals are not recognised, so assets must not contain `//` or `/*` inside one.
+    """
+    code = []
+    strings = []
+    i, n = 0, len(text)
+    while i < n:
+        c = text[i]
+        if c in quotes:
+            j = i + 1
+            while j < n and text[j] != c:
+                j += 2 if text[j] == "\\" else 1
+            code.append(f"\x00{len(strings)}\x00")
+            strings.append(text[i : j + 1])
+            i = j + 1
+        elif text.startswith("/*", i):
+            end = text.find("*/", i + 2)
+            i = n if end < 0 else end + 2
+            code.append(" ")
+        elif line_comments and text.startswith("//", i):
+            end = text.find("\n", i)
+            i = n if end < 0 else end
+        else:
+            code.append(c)
+            i += 1
+    return "".join(code), strings
+
+
+def _squeeze(scanned, after: str, before: str, keep_newlines: bool) -> str:
+    # Collapse whitespace outside strings and drop it after any char in `after` or
+    # before any in `before`. JS keeps a newline wherever one may end a statement (only
+    # `after`/`before` cannot), so automatic semicolon insertion is unaffected.
+    code, strings = scanned
+
+    def repl(m):
+        prev = code[m.start() - 1] if m.start() > 0 else ""
+        nxt = code[m.end()] if m.end() < len(code) else ""
+        if not prev or not nxt:
+            return ""
+        if prev + nxt in ("++", "--", "+-", "-+"):
+            return " "
+        if prev in after or nxt in before:
+            return ""
+        return "\n" if keep_newlines and "\n" in m.group(0) else " "
+
+    code = re.sub(r"\s+", repl, code)
+    return re.sub("\x00(\\d+)\x00", lambda m: strings[int(m.group(1))], code)
+
+
+def minify_css(text: str) -> str:
+    # Space before ':' is kept (descendant selectors like `a :hover`), and so is space
+    # around parentheses and operators (`and (max-width...)`, `calc(1px + 2px)`)
+    css = _squeeze(_scan(text, "\"'", False), "{};,>:", "{};,>", False)
+    return css.replace(";}", "}")
+
+
+def minify_js(text: str) -> str:
+    # No statement ends right after these (or right before the second set), so any
+    # whitespace there can go. `+`/`-` are excluded on the left: `a++\nb`.
+    return _squeeze(_scan(text, "\"'`", True), "{([,;:=<>*/%&|!?", "{}()[],;:.=<>*/%&|?", True)
+
+
+# Elements whose surrounding whitespace never renders
+BLOCK_TAGS = {
+    "html", "head", "body", "meta", "link", "title", "script", "style", "header", "main",
+    "footer", "section", "article", "nav", "aside", "div", "form", "fieldset", "p", "ul",
+    "ol", "li", "table", "thead", "tbody", "tr", "td", "th", "h1", "h2", "h3", "h4", "h5",
+    "h6", "br", "hr",
+}
+
+
+def _drop_block_space(m):
+    # Whitespace between two tags, kept only when both are inline
+    if m.group(3).lower() in BLOCK_TAGS or m.group(5).lower() in BLOCK_TAGS:
+        return m.group(1)
+    return m.group(1) + " "
+
+
+def minify_html(text: str) -> str:
+    # Comments go and whitespace runs become one space (a single space between inline
+    # elements is significant). <pre>/<textarea> are left alone; inline <script> and
+    # <style> bodies go through the JS/CSS minifiers.
+    text = re.sub(r"<!--(?!\[).*?-->", "", text, flags=re.S)
+    parts = re.split(r"(?is)(<(pre|textarea|script|style)\b[^>]*>.*?</\2\s*>)", text)
+    out = []
+    for i, part in enumerate(parts):
+        if i % 3 == 2:
+            continue  # tag name captured by the inner group
+        if i % 3 == 1:
+            m = re.match(r"(?is)(<(\w+)[^>]*>)(.*?)(</\w+\s*>)$", part)
+            tag = m.group(2).lower()
+            body = m.group(3)
+            if tag == "script" and body.strip():
+                body = minify_js(body)
+            elif tag == "style":
+                body = minify_css(body)
+            out.append(m.group(1) + body + m.group(4))
+        else:
+            out.append(re.sub(r"\s+", " ", part))
+    return re.sub(r"(<(/?)(\w+)[^>]*>)\s+(?=<(/?)(\w+))", _drop_block_space, "".join(out)).strip()
+
+
+MINIFIERS = {"text/html": minify_html, "text/css": minify_css, "application/javascript": minify_js}
+
+
+def minify(rel: str, data: bytes) -> bytes:
+    fn = MINIFIERS.get(mime_for_path(rel))
+    return fn(data.decode("utf-8")).encode("utf-8") if fn else data
+
+
+@dataclass
+class Variant:
+    encoding: int  # ENC_*
+    blob: str  # identifier of the byte array holding the body (shared by aliases)
+    data: bytes
+    etag: str  # quoted strong validator, distinct per encoding
+
+
+@dataclass
+class Asset:
+    name: str  # web path, e.g. '/index.html'
+    cache_control: str
+    variants: list = field(default_factory=list)  # smallest first
+
+
+def content_hash(data: bytes) -> str:
+    return hashlib.sha256(data).hexdigest()
+
+
+def fingerprinted(name: str, digest: str) -> str:
+    # '/app.js' -> '/app.1a2b3c4d.js'
+    stem, ext = os.path.splitext(name)
+    return f"{stem}.{digest[:8]}{ext}"
+
+
+def encode_variants(blob: str, data: bytes, digest: str):
+    """Encoded forms of `data` worth embedding, smallest first."""
+    encoded = {ENC_GZIP: gzip.compress(data, compresslevel=9, mtime=0)}
+    if brotli is not None:
+        encoded[ENC_BR] = brotli.compress(data, quality=11)
+    if len(data) <= IDENTITY_MAX:
+        encoded[ENC_IDENTITY] = data
+    variants = [
+        Variant(enc, blob + ENCODING_SUFFIX[enc].replace("-", "_"), body,
+                f'"{digest[:16]}{ENCODING_SUFFIX[enc]}"')
+        for enc, body in encoded.items()
+    ]
+    return sorted(variants, key=lambda v: (len(v.data), v.encoding))
+
+
+def render_headers(a: Asset, v: Variant) -> str:
+    # Status line and headers, sent verbatim ahead of the body. The server appends the
+    # Connection header (close or keep-alive) and the blank line.
+    coding = "" if v.encoding == ENC_IDENTITY else f"Content-Encoding: {ENCODING_NAMES[v.encoding]}\r\n"
+    return (
+        "HTTP/1.1 200 OK\r\n"
+        f"Content-Type: {mime_for_path(a.name)}\r\n"
+        f"{coding}"
+        f"Content-Length: {len(v.data)}\r\n"
+        f"ETag: {v.etag}\r\n"
+        f"Cache-Control: {a.cache_control}\r\n"
+        "Vary: Accept-Encoding\r\n"
+    )
+
+
+def render_not_modified(a: Asset, v: Variant) -> str:
+    return (
+        "HTTP/1.1 304 Not Modified\r\n"
+        f"ETag: {v.etag}\r\n"
+        f"Cache-Control: {a.cache_control}\r\n"
+        "Vary: Accept-Encoding\r\n"
+    )
+
+
+def c_string(text: str) -> str:
+    # Quote `text` as a C string literal
+    escaped = (
+        text.replace("\\", "\\\\").replace('"', '\\"').replace("\r", "\\r").replace("\n", "\\n")
+    )
+    return f'"{escaped}"'
+
+
 def make_header(entries):
     hdr = []
     hdr.append("// Auto-generated by scripts/generate_assets.py - DO NOT EDIT")
@@ -29,51 +297,167 @@ def make_header(entries):
     hdr.append("#include <stdint.h>")
     hdr.append("#include <stddef.h>")
     hdr.append("#include <stdbool.h>")
+    hdr.append("#include <string.h>")
+    for enc, name in ENCODING_NAMES.items():
+        hdr.append(f"#define ASSET_ENC_{name.upper()} 0x{enc:02x}u")
+    hdr.append(
+        "struct asset_variant { uint8_t encoding; const uint8_t *data; size_t len;"
+        " const char *headers; size_t headers_len; const char *etag; const char *not_modified;"
+        " size_t not_modified_len; };"
+    )
     hdr.append(
-        "struct asset { const char *path; const uint8_t *data; size_t len; size_t gzlen; bool gz; };"
+        "struct asset { const char *path; const char *mime; const struct asset_variant *variants;"
+        " uint8_t variant_count; };"
     )
     hdr.append("")
-    for name, path, gzdata in entries:
-        # name is the web path like '/index.html'
-        rel = name.lstrip("/")
-        ident = sanitize_identifier(rel)
-        hdr.append(f"static const unsigned char {ident}[] = {{")
-        # format bytes 12 per line
-        bchunks = [f"0x{b:02x}" for b in gzdata]
-        for i in range(0, len(bchunks), 12):
-            chunk = bchunks[i : i + 12]
-            hdr.append("  " + ", ".join(chunk) + ",")
+    emitted = set()
+    for a in entries:
+        ident = sanitize_identifier(a.name.lstrip("/"))
+        for v in a.variants:
+            if v.blob not in emitted:
+                emitted.add(v.blob)
+                hdr.append(f"static const unsigned char {v.blob}[] = {{")
+                # format bytes 12 per line
+                bchunks = [f"0x{b:02x}" for b in v.data]
+                for i in range(0, len(bchunks), 12):
+                    chunk = bchunks[i : i + 12]
+                    hdr.append("  " + ", ".join(chunk) + ",")
+                hdr.append("};")
+            suffix = ENCODING_NAMES[v.encoding]
+            hdr.append(
+                f"static const char {ident}_{suffix}_headers[] = {c_string(render_headers(a, v))};"
+            )
+            hdr.append(
+                f"static const char {ident}_{suffix}_304[] = {c_string(render_not_modified(a, v))};"
+            )
+        # variants, smallest first: the first one the client accepts is the one to send
+        hdr.append(f"static const struct asset_variant {ident}_variants[] = {{")
+        for v in a.variants:
+            suffix = ENCODING_NAMES[v.encoding]
+            hdr.append(
+                f"  {{0x{v.encoding:02x}u, {v.blob}, sizeof({v.blob}), {ident}_{suffix}_headers,"
+                f" sizeof({ident}_{suffix}_headers) - 1, {c_string(v.etag)}, {ident}_{suffix}_304,"
+                f" sizeof({ident}_{suffix}_304) - 1}},"
+            )
         hdr.append("};")
-        hdr.append(f"static const size_t {ident}_len = {len(gzdata)};")
         hdr.append("")
 
     # assets array
     hdr.append("static const struct asset embedded_assets[] = {")
-    for name, path, gzdata in entries:
-        rel = name.lstrip("/")
-        ident = sanitize_identifier(rel)
-        hdr.append(f'  {{"{name}", {ident}, {ident}_len, {ident}_len, true}},')
+    for a in entries:
+        ident = sanitize_identifier(a.name.lstrip("/"))
+        hdr.append(
+            f'  {{"{a.name}", "{mime_for_path(a.name)}", {ident}_variants, {len(a.variants)}}},'
+        )
     hdr.append("};")
     hdr.append(
         "static const size_t embedded_assets_count = sizeof(embedded_assets)/sizeof(embedded_assets[0]);"
     )
+    hdr.append("")
+
+    # perfect hash index over the asset paths
+    seed, slots = build_perfect_hash([a.name for a in entries])
+    hdr.append(f"#define ASSET_HASH_SEED 0x{seed:08x}u")
+    hdr.append(f"#define ASSET_TABLE_SIZE {len(slots)}u")
+    hdr.append("static const int16_t asset_slots[ASSET_TABLE_SIZE] = {")
+    hdr.append("  " + ", ".join(str(s) for s in slots) + ",")
+    hdr.append("};")
+    hdr.append("")
+    hdr.append("static inline uint32_t asset_hash(const char *s)")
+    hdr.append("{")
+    hdr.append(f"    uint32_t h = 0x{FNV_OFFSET:08x}u ^ ASSET_HASH_SEED;")
+    hdr.append("    while (*s)")
+    hdr.append(f"        h = (h ^ (uint8_t)*s++) * 0x{FNV_PRIME:08x}u;")
+    hdr.append("    return h;")
+    hdr.append("}")
+    hdr.append("")
+    hdr.append("// One hash, one slot, one strcmp: returns NULL for anything not embedded")
+    hdr.append("static inline const struct asset *asset_lookup(const char *path)")
+    hdr.append("{")
+    hdr.append("    int16_t i = asset_slots[asset_hash(path) & (ASSET_TABLE_SIZE - 1)];")
+    hdr.append("    if (i < 0 || strcmp(embedded_assets[i].path, path) != 0)")
+    hdr.append("        return NULL;")
+    hdr.append("    return &embedded_assets[i];")
+    hdr.append("}")
+    hdr.append("")
+    hdr.append("// Smallest variant whose ASSET_ENC_* bit is in `accepted`. When the client accepts")
+    hdr.append("// none of them, identity is sent if stored and gzip otherwise (always stored).")
+    hdr.append(
+        "static inline const struct asset_variant *asset_select(const struct asset *a, uint8_t accepted)"
+    )
+    hdr.append("{")
+    hdr.append("    const struct asset_variant *fallback = NULL;")
+    hdr.append("    for (uint8_t i = 0; i < a->variant_count; i++)")
+    hdr.append("    {")
+    hdr.append("        const struct asset_variant *v = &a->variants[i];")
+    hdr.append("        if (v->encoding & accepted)")
+    hdr.append("            return v;")
+    hdr.append("        if (v->encoding == ASSET_ENC_IDENTITY ||")
+    hdr.append("            (v->encoding == ASSET_ENC_GZIP && fallback == NULL))")
+    hdr.append("            fallback = v;")
+    hdr.append("    }")
+    hdr.append("    return fallback;")
+    hdr.append("}")
     return "\n".join(hdr)
 
 
+def print_report(entries, sources):
+    """Per-asset sizes: what it costs in flash and what a client downloads."""
+    cols = ["raw", "minified", "gzip", "br", "identity"]
+    width = max(len(a.name) for a in entries)
+    print(f"{'asset':<{width}}  " + "  ".join(f"{c:>8}" for c in cols))
+    flash = {}
+    for a in entries:
+        if a.name not in sources:
+            continue  # fingerprinted alias: same blobs as the plain path
+        raw, minified = sources[a.name]
+        sizes = {v.encoding: len(v.data) for v in a.variants}
+        for v in a.variants:
+            flash[v.blob] = len(v.data)
+        row = [raw, minified] + [sizes.get(e, "-") for e in (ENC_GZIP, ENC_BR, ENC_IDENTITY)]
+        print(f"{a.name:<{width}}  " + "  ".join(f"{c:>8}" for c in row))
+    raw_total = sum(r for r, _ in sources.values())
+    best = sum(min(len(v.data) for v in a.variants) for a in entries if a.name in sources)
+    print(f"flash: {sum(flash.values())} bytes in {len(flash)} blobs;"
+          f" transfer (best encoding, all assets): {best} of {raw_total} raw bytes")
+    if brotli is None:
+        print("note: python 'brotli' module not installed, brotli variants skipped")
+
+
 def main():
-    entries = []
-    for root, dirs, files in os.walk(ASSETS_DIR):
-        for f in files:
+    files = {}
+    for root, dirs, names in os.walk(ASSETS_DIR):
+        for f in names:
             p = Path(root) / f
             rel = "/" + str(p.relative_to(ASSETS_DIR)).replace("\\", "/")
-            data = p.read_bytes()
-            gz = gzip.compress(data, compresslevel=6)
-            entries.append((rel, p, gz))
+            files[rel] = p.read_bytes()
+
+    # Non-HTML assets first: their fingerprints are needed to rewrite the HTML
+    entries = []
+    renames = {}
+    sources = {}
+    for rel in sorted(files, key=lambda r: (mime_for_path(r) == "text/html", r)):
+        data = files[rel]
+        if mime_for_path(rel) == "text/html":
+            text = data.decode("utf-8")
+            for old, new in renames.items():
+                text = text.replace(f"/assets{old}", f"/assets{new}")
+            data = text.encode("utf-8")
+
+        small = minify(rel, data)
+        sources[rel] = (len(files[rel]), len(small))
+        digest = content_hash(small)
+        variants = encode_variants(sanitize_identifier(rel.lstrip("/")), small, digest)
+        entries.append(Asset(rel, CACHE_REVALIDATE, variants))
+        if mime_for_path(rel) != "text/html":
+            renames[rel] = fingerprinted(rel, digest)
+            entries.append(Asset(renames[rel], CACHE_IMMUTABLE, variants))
 
     OUT_DIR.mkdir(parents=True, exist_ok=True)
     OUT_FILE.write_text(make_header(entries))
     os.system("clang-format -i " + str(OUT_FILE))
     print(f"Wrote {OUT_FILE} with {len(entries)} assets")
+    print_report(entries, sources)
 
 
 if __name__ == "__main__":
@@ -0,0 +1,199 @@
+#!/usr/bin/env python3
+"""Generate the log call-site table from the L_* macro calls in the sources.
+
+Every L_INFO/L_INFOF/... call in `src/` and `include/` gets a small integer id. The
+table in `include/generated/log_sites.h` maps the id back to file name, enclosing
+function, line range and format string, so a log record only carries the id and its
+raw arguments. Logger.h finds a call's id at compile time from basename(__FILE__) and
+__LINE__, and refuses to build if the table is stale. This script is intended to be
+run before build.
+"""
+import re
+import sys
+from pathlib import Path
+
+ROOT = Path(__file__).resolve().parent.parent
+SOURCE_DIRS = [ROOT / "src", ROOT / "include"]
+SKIP = {ROOT / "include" / "Logger.h"}
+OUT_DIR = ROOT / "include" / "generated"
+OUT_FILE = OUT_DIR / "log_sites.h"
+
+LEVELS = {"DEBUG": 0, "VERBOSE": 1, "INFO": 2, "WARNING": 3, "ERROR": 4, "WTF": 5}
+CALL_RE = re.compile(r"\bL_(DEBUG|VERBOSE|INFO|WARNING|ERROR|WTF)(F?)\s*\(")
+MODULE_RE = re.compile(r"^\s*#\s*define\s+LOG_MODULE_LEVEL\s+(\w+)", re.M)
+FUNC_RE = re.compile(r"^(?!(?:if|for|while|switch|return|else|do)\b)[\w:<>,\*& ]*?([A-Za-z_~][\w]*)\s*\(")
+
+
+def blank_comments(text: str) -> str:
+    """Replace comments with spaces (newlines kept) so offsets and lines still line up."""
+    out = []
+    i, n = 0, len(text)
+    while i < n:
+        c = text[i]
+        if c in "\"'":
+            j = i + 1
+            while j < n and text[j] != c and text[j] != "\n":
+                j += 2 if text[j] == "\\" else 1
+            out.append(text[i : j + 1])
+            i = j + 1
+        elif text.startswith("//", i):
+            j = text.find("\n", i)
+            j = n if j < 0 else j
+            out.append(" " * (j - i))
+            i = j
+        elif text.startswith("/*", i):
+            j = text.find("*/", i + 2)
+            j = n if j < 0 else j + 2
+            out.append(re.sub(r"[^\n]", " ", text[i:j]))
+            i = j
+        else:
+            out.append(c)
+            i += 1
+    return "".join(out)
+
+
+def call_end(text: str, start: int) -> int:
+    """Offset just past the parenthesis that closes the call opened at `start`."""
+    depth = 0
+    i = start
+    while i < len(text):
+        c = text[i]
+        if c in "\"'":
+            j = i + 1
+            while text[j] != c:
+                j += 2 if text[j] == "\\" else 1
+            i = j
+        elif c == "(":
+            depth += 1
+        elif c == ")":
+            depth -= 1
+            if depth == 0:
+                return i + 1
+        i += 1
+    raise ValueError("unterminated log call")
+
+
+def leading_literal(args: str):
+    """Concatenated string literal at the start of `args`, or None if it is not one."""
+    parts = []
+    pos = 0
+    while True:
+        m = re.match(r'\s*"((?:[^"\\]|\\.)*)"', args[pos:])
+        if not m:
+            break
+        parts.append(m.group(1))
+        pos += m.end()
+    if not parts or not re.match(r"\s*(,|$)", args[pos:]):
+        return None
+    return "".join(parts)
+
+
+def enclosing_function(lines, index: int) -> str:
+    # Nearest definition that starts in column 0 above the call
+    for line in reversed(lines[:index]):
+        if line[:1].isspace() or not line.strip() or line.startswith("#"):
+            continue
+        m = FUNC_RE.match(line)
+        if m and not line.rstrip().endswith(";"):
+            return m.group(1)
+    return "?"
+
+
+def scan(path: Path):
+    text = blank_comments(path.read_text(encoding="utf-8"))
+    module = MODULE_RE.search(text)
+    module = module.group(1) if module else "LOG_MIN_LEVEL"
+    lines = text.split("\n")
+    sites = []
+    for m in CALL_RE.finditer(text):
+        if text[: m.start()].rstrip().endswith("#define"):
+            continue
+        end = call_end(text, m.end() - 1)
+        first = text.count("\n", 0, m.start()) + 1
+        last = text.count("\n", 0, end) + 1
+        if m.group(2):
+            fmt = leading_literal(text[m.end() : end - 1])
+            if fmt is None:
+                sys.exit(f"{path}:{first}: L_{m.group(1)}F needs a string literal format")
+        else:
+            fmt = "%s"
+        sites.append(
+            {
+                "file": path.name,
+                "function": enclosing_function(lines, first - 1),
+                "fmt": fmt,
+                "first": first,
+                "last": last,
+                "level": LEVELS[m.group(1)],
+                "module": module,
+            }
+        )
+    return sites
+
+
+def main():
+    sources = []
+    for d in SOURCE_DIRS:
+        sources += [p for p in d.rglob("*") if p.suffix in (".cpp", ".h") and p not in SKIP]
+    sources = sorted(p for p in sources if OUT_DIR not in p.parents)
+
+    # Calls are matched on basename and line, so both must be unambiguous
+    names = {}
+    for p in sources:
+        if p.name in names:
+            sys.exit(f"generate_log_sites: {p} and {names[p.name]} share a file name")
+        names[p.name] = p
+
+    sites = []
+    for p in sources:
+        found = scan(p)
+        for a, b in zip(found, found[1:]):
+            if b["first"] <= a["last"]:
+                sys.exit(f"{p}:{b['first']}: only one log call per line")
+        sites += found
+    if len(sites) >= 0xFFFF:
+        sys.exit("generate_log_sites: too many call sites for a 16-bit id")
+
+    hdr = []
+    hdr.append("// Auto-generated by scripts/generate_log_sites.py - DO NOT EDIT")
+    hdr.append("#pragma once")
+    hdr.append("#include <stdint.h>")
+    hdr.append("")
+    hdr.append("namespace logger")
+    hdr.append("{")
+    hdr.append("struct LogSite")
+    hdr.append("{")
+    hdr.append("    const char* file;")
+    hdr.append("    const char* function;")
+    hdr.append("    const char* fmt;")
+    hdr.append("    uint16_t    first; // the call's line range, for either __LINE__ convention")
+    hdr.append("    uint16_t    last;")
+    hdr.append("};")
+    hdr.append("")
+    hdr.append("// Sites compiled out by their module's level keep their id but not their text")
+    hdr.append("#define LOG_SITE_TEXT(level, moduleLevel, s) ((level) >= (moduleLevel) ? (s) : nullptr)")
+    hdr.append("")
+    hdr.append("inline constexpr LogSite log_sites[] = {")
+    hdr.append('    {"?", "?", "%s", 0, 0}, // 0: logged through the function API, not a macro')
+    for i, s in enumerate(sites, start=1):
+        lvl, mod = s["level"], s["module"]
+        hdr.append(
+            f'    {{LOG_SITE_TEXT({lvl}, {mod}, "{s["file"]}"),'
+            f' LOG_SITE_TEXT({lvl}, {mod}, "{s["function"]}"),'
+            f' LOG_SITE_TEXT({lvl}, {mod}, "{s["fmt"]}"), {s["first"]}, {s["last"]}}}, // {i}'
+        )
+    hdr.append("};")
+    hdr.append("")
+    hdr.append("inline constexpr uint16_t log_site_count = sizeof(log_sites) / sizeof(log_sites[0]);")
+    hdr.append("} // namespace logger")
+    hdr.append("")
+
+    OUT_DIR.mkdir(parents=True, exist_ok=True)
+    text = "\n".join(hdr)
+    if not OUT_FILE.exists() or OUT_FILE.read_text() != text:
+        OUT_FILE.write_text(text)
+    print(f"Wrote {OUT_FILE} with {len(sites)} log call sites")
+
+
+if __name__ == "__main__":
+    main()
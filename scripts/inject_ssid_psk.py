@@ -18,6 +18,7 @@ except FileNotFoundError:
 Import("env")  # pyright: ignore[reportUndefinedVariable]
 
 os.system("python scripts/generate_assets.py")
+os.system("python scripts/generate_log_sites.py")
 ssid = os.getenv("PLATFORMIO_WLAN_SSID")
 psk = os.getenv("PLATFORMIO_WLAN_PSK")
 version = os.popen("git describe --tags --abbrev=0").read().strip()
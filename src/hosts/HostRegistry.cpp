@@ -0,0 +1,221 @@
+// HostRegistry.cpp
+#define LOG_MODULE_LEVEL LOG_LEVEL_WOL
+#include "HostRegistry.h"
+#include <Preferences.h>
+#include "Logger.h"
+
+static constexpr const char* NVS_NAMESPACE = "hosts";
+static constexpr size_t      PAGES =
+    (HOST_REGISTRY_MAX + HOST_NVS_PAGE_SIZE - 1) / HOST_NVS_PAGE_SIZE;
+
+// A host as stored in NVS: everything but the packet, which is rebuilt on load. A
+// removed host keeps its id (with used = 0) so the slot's next id differs from it.
+struct Record
+{
+    uint32_t id;
+    uint32_t broadcast;
+    uint16_t port;
+    uint8_t  used;
+    uint8_t  mac[WakeOnLan::MAC_LEN];
+    char     name[HostRegistry::NAME_LEN];
+};
+
+static HostRegistry::Host hosts[HOST_REGISTRY_MAX];
+static size_t             used = 0;
+static Preferences        prefs;
+static bool               ready = false;
+static Record             page[HOST_NVS_PAGE_SIZE]; // staging for one blob
+
+static size_t slotOf(uint32_t id)
+{
+    return (id - 1) % HOST_REGISTRY_MAX;
+}
+
+static void pageKey(size_t p, char key[8])
+{
+    snprintf(key, 8, "p%u", (unsigned)p);
+}
+
+// Write the page holding `slot` back to NVS
+static bool savePage(size_t slot)
+{
+    if (!ready)
+        return false;
+    size_t first = slot - slot % HOST_NVS_PAGE_SIZE;
+    bool   empty = true;
+    memset(page, 0, sizeof(page));
+    for (size_t i = 0; i < HOST_NVS_PAGE_SIZE && first + i < HOST_REGISTRY_MAX; ++i)
+    {
+        const HostRegistry::Host& h = hosts[first + i];
+        Record&                   r = page[i];
+        r.id                        = h.id;
+        r.broadcast                 = h.broadcast;
+        r.port                      = h.port;
+        r.used                      = h.used;
+        memcpy(r.mac, h.mac, sizeof(r.mac));
+        memcpy(r.name, h.name, sizeof(r.name));
+        empty = empty && h.id == 0;
+    }
+    char key[8];
+    pageKey(first / HOST_NVS_PAGE_SIZE, key);
+    if (empty)
+        return prefs.getBytesLength(key) == 0 || prefs.remove(key);
+    return prefs.putBytes(key, page, sizeof(page)) == sizeof(page);
+}
+
+static void fill(HostRegistry::Host& h, const char* name, const uint8_t mac[WakeOnLan::MAC_LEN],
+                 const IPAddress& broadcast, uint16_t port)
+{
+    snprintf(h.name, sizeof(h.name), "%s", name ? name : "");
+    memcpy(h.mac, mac, sizeof(h.mac));
+    h.broadcast = (uint32_t)broadcast;
+    h.port      = port;
+    WakeOnLan::buildPacket(h.mac, h.packet);
+}
+
+bool HostRegistry::begin()
+{
+    if (ready)
+        return true;
+    if (!prefs.begin(NVS_NAMESPACE, false))
+    {
+        L_ERROR("Could not open NVS for the host registry");
+        return false;
+    }
+    ready = true;
+
+    for (size_t p = 0; p < PAGES; ++p)
+    {
+        char key[8];
+        pageKey(p, key);
+        // A blob of another size was written with a different HOST_NVS_PAGE_SIZE
+        if (prefs.getBytesLength(key) != sizeof(page) ||
+            prefs.getBytes(key, page, sizeof(page)) != sizeof(page))
+            continue;
+        for (size_t i = 0; i < HOST_NVS_PAGE_SIZE; ++i)
+        {
+            const Record& r    = page[i];
+            size_t        slot = p * HOST_NVS_PAGE_SIZE + i;
+            if (slot >= HOST_REGISTRY_MAX || r.id == 0 || slotOf(r.id) != slot)
+                continue;
+            Host& h = hosts[slot];
+            h.id    = r.id;
+            h.used  = r.used;
+            if (!h.used)
+                continue;
+            char name[NAME_LEN];
+            memcpy(name, r.name, sizeof(name));
+            name[NAME_LEN - 1] = '\0';
+            fill(h, name, r.mac, IPAddress(r.broadcast), r.port);
+            used++;
+        }
+    }
+    L_INFOF("Host registry: %u of %u hosts loaded", (unsigned)used,
+            (unsigned)HOST_REGISTRY_MAX);
+    return true;
+}
+
+const HostRegistry::Host* HostRegistry::find(uint32_t id)
+{
+    if (id == 0)
+        return nullptr;
+    const Host& h = hosts[slotOf(id)];
+    return h.used && h.id == id ? &h : nullptr;
+}
+
+// The saved host other than `skipId` with this MAC, broadcast address and port, or
+// nullptr
+static const HostRegistry::Host* findTarget(const uint8_t mac[WakeOnLan::MAC_LEN],
+                                            const IPAddress& broadcast, uint16_t port,
+                                            uint32_t skipId)
+{
+    uint16_t wantPort = port ? port : WakeOnLan::DEFAULT_PORT;
+    for (const HostRegistry::Host& h : hosts)
+    {
+        uint16_t hPort = h.port ? h.port : WakeOnLan::DEFAULT_PORT;
+        if (h.used && h.id != skipId && hPort == wantPort &&
+            h.broadcast == (uint32_t)broadcast && memcmp(h.mac, mac, sizeof(h.mac)) == 0)
+            return &h;
+    }
+    return nullptr;
+}
+
+HostRegistry::Result HostRegistry::add(const char* name, const uint8_t mac[WakeOnLan::MAC_LEN],
+                                       const IPAddress& broadcast, uint16_t port, uint32_t& id)
+{
+    if (const Host* same = findTarget(mac, broadcast, port, 0))
+    {
+        id = same->id;
+        return Result::Exists;
+    }
+
+    size_t slot = 0;
+    while (slot < HOST_REGISTRY_MAX && hosts[slot].used)
+        slot++;
+    if (slot == HOST_REGISTRY_MAX)
+        return Result::Full;
+
+    Host& h   = hosts[slot];
+    Host  old = h;
+    h.id      = h.id ? h.id + HOST_REGISTRY_MAX : (uint32_t)slot + 1;
+    h.used    = true;
+    fill(h, name, mac, broadcast, port);
+    if (!savePage(slot))
+    {
+        h = old;
+        return Result::StorageFailed;
+    }
+    used++;
+    id = h.id;
+    return Result::Ok;
+}
+
+HostRegistry::Result HostRegistry::update(uint32_t id, const char* name,
+                                          const uint8_t mac[WakeOnLan::MAC_LEN],
+                                          const IPAddress& broadcast, uint16_t port)
+{
+    if (!find(id))
+        return Result::NotFound;
+    if (findTarget(mac, broadcast, port, id))
+        return Result::Exists;
+    Host& h   = hosts[slotOf(id)];
+    Host  old = h;
+    fill(h, name, mac, broadcast, port);
+    if (!savePage(slotOf(id)))
+    {
+        h = old;
+        return Result::StorageFailed;
+    }
+    return Result::Ok;
+}
+
+HostRegistry::Result HostRegistry::remove(uint32_t id)
+{
+    if (!find(id))
+        return Result::NotFound;
+    Host& h = hosts[slotOf(id)];
+    h.used  = false;
+    if (!savePage(slotOf(id)))
+    {
+        h.used = true;
+        return Result::StorageFailed;
+    }
+    used--;
+    return Result::Ok;
+}
+
+const HostRegistry::Host* HostRegistry::next(uint32_t& cursor)
+{
+    while (cursor < HOST_REGISTRY_MAX)
+    {
+        const Host& h = hosts[cursor++];
+        if (h.used)
+            return &h;
+    }
+    return nullptr;
+}
+
+size_t HostRegistry::count()
+{
+    return used;
+}
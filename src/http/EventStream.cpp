@@ -0,0 +1,62 @@
+// EventStream.cpp
+#include "EventStream.h"
+#include <stdio.h>
+
+bool EventStream::adopt(int fd, uint32_t lastEventId, uint32_t nowMs)
+{
+    Subscriber* s = subs.adopt(fd, nowMs);
+    if (!s)
+        return false;
+    // Resume after lastEventId when the ring still holds what followed it
+    uint32_t oldest = nextId > EVENTS_RING_DEPTH ? nextId - EVENTS_RING_DEPTH : 1;
+    bool     resume = lastEventId && lastEventId < nextId && lastEventId + 1 >= oldest;
+    s->next         = resume ? lastEventId + 1 : nextId;
+    s->offset       = 0;
+    return true;
+}
+
+uint32_t EventStream::publish(const char* event, const char* data)
+{
+    Event& e = ring[nextId % EVENTS_RING_DEPTH];
+    int    n = snprintf(e.text, sizeof(e.text), "id: %u\nevent: %s\ndata: %s\n\n",
+                        (unsigned)nextId, event, data);
+    if (n < 0 || (size_t)n >= sizeof(e.text))
+        return 0;
+    e.len = (uint16_t)n;
+    return nextId++;
+}
+
+void EventStream::poll(uint32_t nowMs)
+{
+    subs.poll(nowMs, EVENTS_HEARTBEAT_MS, [&](Subscriber& s) { return flush(s, nowMs); });
+}
+
+bool EventStream::flush(Subscriber& s, uint32_t nowMs)
+{
+    while (s.next != nextId)
+    {
+        if (nextId - s.next > EVENTS_RING_DEPTH)
+        {
+            // Its event was overwritten before the socket took it
+            laggedOut++;
+            subs.close(s);
+            return false;
+        }
+        const Event& e = ring[s.next % EVENTS_RING_DEPTH];
+        long         n = sse::write(s, e.text + s.offset, e.len - s.offset, nowMs);
+        if (n < 0)
+        {
+            subs.close(s);
+            return false;
+        }
+        if (n == 0)
+            return true; // the socket is full
+        s.offset += (uint16_t)n;
+        if (s.offset == e.len)
+        {
+            s.offset = 0;
+            s.next++;
+        }
+    }
+    return true;
+}
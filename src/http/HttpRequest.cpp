@@ -0,0 +1,348 @@
+// HttpRequest.cpp
+#include "HttpRequest.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+void HttpRequest::reset()
+{
+    len            = 0;
+    scan           = 0;
+    bodyStart      = 0;
+    bodyLen        = 0;
+    contentLength  = 0;
+    requestEnd     = 0;
+    spill          = '\0';
+    st             = State::RequestLine;
+    error          = 0;
+    expectContinue = false;
+    http10         = false;
+    meth           = HttpMethod::Other;
+    methodStr      = "";
+    pathStr        = "";
+    queryStr       = "";
+    headerCount    = 0;
+    buf[0]         = '\0';
+}
+
+HttpRequest::State HttpRequest::next()
+{
+    size_t end  = (st == State::Complete) ? requestEnd : len;
+    size_t rest = len - end;
+    if (rest)
+        buf[end] = spill;
+    reset();
+    memmove(buf, buf + end, rest);
+    len = rest;
+    return commit(0);
+}
+
+void HttpRequest::fail(int status)
+{
+    st    = State::Error;
+    error = status;
+}
+
+HttpRequest::State HttpRequest::commit(size_t n)
+{
+    if (n > writeSpace())
+        n = writeSpace();
+    len += n;
+    buf[len] = '\0';
+
+    // Request line and headers are parsed a line at a time as they arrive
+    while (st == State::RequestLine || st == State::Headers)
+    {
+        char* start = buf + scan;
+        char* nl    = static_cast<char*>(memchr(start, '\n', len - scan));
+        if (!nl)
+        {
+            if (writeSpace() == 0)
+                fail(431); // Request Header Fields Too Large
+            return st;
+        }
+        char* end = nl;
+        if (end > start && end[-1] == '\r')
+            end--;
+        *end = '\0';
+        *nl  = '\0';
+        scan = (size_t)(nl + 1 - buf);
+        if (!parseLine(start, end))
+            return st;
+    }
+
+    if (st == State::Body && len - bodyStart >= contentLength)
+    {
+        bodyLen = contentLength;
+        st      = State::Complete;
+    }
+    if (st == State::Complete && requestEnd == 0)
+    {
+        // Anything past the end already belongs to the next (pipelined) request; its
+        // first byte is set aside so the body can be NUL-terminated in place
+        requestEnd      = bodyStart + bodyLen;
+        spill           = buf[requestEnd];
+        buf[requestEnd] = '\0';
+    }
+    return st;
+}
+
+bool HttpRequest::parseLine(char* line, char* end)
+{
+    if (st == State::RequestLine)
+    {
+        // Tolerate stray blank lines ahead of the request line (RFC 7230 3.5)
+        if (line == end)
+            return true;
+        return parseRequestLine(line);
+    }
+
+    if (line != end)
+        return parseHeaderLine(line);
+
+    // Blank line: headers are complete
+    bodyStart = scan;
+    if (header("Transfer-Encoding"))
+    {
+        fail(501); // chunked request bodies are not supported
+        return false;
+    }
+    const char* cl = header("Content-Length");
+    if (cl)
+    {
+        // 1*DIGIT: strtoul alone would also take a sign and leading blanks
+        char*         endp = nullptr;
+        unsigned long v    = strtoul(cl, &endp, 10);
+        if (cl[0] < '0' || cl[0] > '9' || *endp != '\0')
+        {
+            fail(400);
+            return false;
+        }
+        contentLength = v;
+    }
+    if (contentLength > HTTP_REQUEST_BUFFER_SIZE - bodyStart)
+    {
+        fail(413); // Payload Too Large
+        return false;
+    }
+    const char* expect = header("Expect");
+    expectContinue     = expect && strcasecmp(expect, "100-continue") == 0;
+    st                 = contentLength ? State::Body : State::Complete;
+    return true;
+}
+
+bool HttpRequest::parseRequestLine(char* line)
+{
+    // METHOD SP request-target SP HTTP-version
+    char* sp1 = strchr(line, ' ');
+    if (!sp1)
+    {
+        fail(400);
+        return false;
+    }
+    *sp1      = '\0';
+    char* sp2 = strchr(sp1 + 1, ' ');
+    if (!sp2 || strncmp(sp2 + 1, "HTTP/1.", 7) != 0)
+    {
+        fail(sp2 ? 505 : 400);
+        return false;
+    }
+    *sp2   = '\0';
+    http10 = (sp2[8] == '0');
+
+    methodStr = line;
+    if (strcmp(line, "GET") == 0)
+        meth = HttpMethod::Get;
+    else if (strcmp(line, "POST") == 0)
+        meth = HttpMethod::Post;
+    else if (strcmp(line, "PUT") == 0)
+        meth = HttpMethod::Put;
+    else if (strcmp(line, "DELETE") == 0)
+        meth = HttpMethod::Delete;
+    else if (strcmp(line, "HEAD") == 0)
+        meth = HttpMethod::Head;
+    else if (strcmp(line, "OPTIONS") == 0)
+        meth = HttpMethod::Options;
+    else
+        meth = HttpMethod::Other;
+
+    char* target = sp1 + 1;
+    if (target[0] != '/')
+    {
+        fail(400);
+        return false;
+    }
+    char* q = strchr(target, '?');
+    if (q)
+    {
+        *q       = '\0';
+        queryStr = q + 1;
+    }
+    pathStr = target;
+    st      = State::Headers;
+    return true;
+}
+
+// Headers that frame the request or decide what becomes of the connection
+static bool isFraming(const char* name)
+{
+    return strcasecmp(name, "Content-Length") == 0 ||
+           strcasecmp(name, "Transfer-Encoding") == 0 || strcasecmp(name, "Connection") == 0 ||
+           strcasecmp(name, "Expect") == 0;
+}
+
+bool HttpRequest::parseHeaderLine(char* line)
+{
+    // Obsolete line folding is not accepted (RFC 7230 3.2.4)
+    if (line[0] == ' ' || line[0] == '\t')
+    {
+        fail(400);
+        return false;
+    }
+    char* colon = strchr(line, ':');
+    if (!colon || colon == line)
+    {
+        fail(400);
+        return false;
+    }
+    *colon      = '\0';
+    char* value = colon + 1;
+    while (*value == ' ' || *value == '\t')
+        value++;
+    char* vend = value + strlen(value);
+    while (vend > value && (vend[-1] == ' ' || vend[-1] == '\t'))
+        *--vend = '\0';
+
+    if (headerCount < HTTP_MAX_HEADERS)
+    {
+        headers[headerCount++] = {line, value};
+        return true;
+    }
+    if (!isFraming(line))
+        return true;
+    // The table is full, but a body length must never be missed: the latest header
+    // that is not a framing one makes room
+    size_t i = headerCount;
+    while (i > 0 && isFraming(headers[i - 1].name))
+        i--;
+    if (i == 0)
+    {
+        fail(431);
+        return false;
+    }
+    headers[i - 1] = {line, value};
+    return true;
+}
+
+// Case-insensitive search for `token` in a comma-separated header value
+static bool hasToken(const char* list, const char* token)
+{
+    size_t n = strlen(token);
+    for (const char* p = list; p && *p;)
+    {
+        while (*p == ' ' || *p == '\t' || *p == ',')
+            p++;
+        const char* end = p;
+        while (*end && *end != ',')
+            end++;
+        const char* tend = end;
+        while (tend > p && (tend[-1] == ' ' || tend[-1] == '\t'))
+            tend--;
+        if ((size_t)(tend - p) == n && strncasecmp(p, token, n) == 0)
+            return true;
+        p = end;
+    }
+    return false;
+}
+
+bool HttpRequest::keepAlive() const
+{
+    const char* conn = header("Connection");
+    if (http10)
+        return hasToken(conn, "keep-alive");
+    return !hasToken(conn, "close");
+}
+
+const char* HttpRequest::header(const char* name) const
+{
+    for (size_t i = 0; i < headerCount; ++i)
+    {
+        if (strcasecmp(headers[i].name, name) == 0)
+            return headers[i].value;
+    }
+    return nullptr;
+}
+
+bool HttpRequest::findArg(const char* name, const char** value, size_t* valueLen) const
+{
+    size_t      nameLen = strlen(name);
+    const char* p       = queryStr;
+    while (*p)
+    {
+        const char* amp  = strchr(p, '&');
+        const char* pend = amp ? amp : p + strlen(p);
+        const char* eq   = static_cast<const char*>(memchr(p, '=', (size_t)(pend - p)));
+        const char* kend = eq ? eq : pend;
+        if ((size_t)(kend - p) == nameLen && strncmp(p, name, nameLen) == 0)
+        {
+            *value    = eq ? eq + 1 : pend;
+            *valueLen = (size_t)(pend - *value);
+            return true;
+        }
+        if (!amp)
+            break;
+        p = amp + 1;
+    }
+    return false;
+}
+
+bool HttpRequest::hasArg(const char* name) const
+{
+    const char* v;
+    size_t      n;
+    return findArg(name, &v, &n);
+}
+
+static int hexNibble(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+bool HttpRequest::arg(const char* name, char* out, size_t outLen) const
+{
+    if (!out || outLen == 0)
+        return false;
+    out[0] = '\0';
+
+    const char* v;
+    size_t      n;
+    if (!findArg(name, &v, &n))
+        return false;
+
+    size_t o = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        char c = v[i];
+        if (c == '+')
+            c = ' ';
+        else if (c == '%' && i + 2 < n && hexNibble(v[i + 1]) >= 0 && hexNibble(v[i + 2]) >= 0)
+        {
+            c = (char)(hexNibble(v[i + 1]) << 4 | hexNibble(v[i + 2]));
+            i += 2;
+        }
+        if (o + 1 >= outLen)
+        {
+            out[0] = '\0';
+            return false;
+        }
+        out[o++] = c;
+    }
+    out[o] = '\0';
+    return true;
+}
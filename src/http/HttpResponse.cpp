@@ -0,0 +1,293 @@
+// HttpResponse.cpp
+#include "HttpResponse.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char CONNECTION_CLOSE[]      = "Connection: close\r\n\r\n";
+static const char CONNECTION_KEEP_ALIVE[] = "Connection: keep-alive\r\n\r\n";
+
+void HttpResponse::reset()
+{
+    outLen     = 0;
+    extraLen   = 0;
+    head       = out;
+    headLen    = 0;
+    tail       = nullptr;
+    tailLen    = 0;
+    staticBody = nullptr;
+    staticLen  = 0;
+    written    = 0;
+    code       = 0;
+    omitBody   = false;
+    persistent = false;
+    http10     = false;
+    chunked    = false;
+    fill       = nullptr;
+    ended      = false;
+    stream     = {};
+    adopter    = nullptr;
+    adopterArg = 0;
+}
+
+const char* HttpResponse::statusText(int code)
+{
+    switch (code)
+    {
+        case 100:
+            return "Continue";
+        case 200:
+            return "OK";
+        case 201:
+            return "Created";
+        case 202:
+            return "Accepted";
+        case 204:
+            return "No Content";
+        case 304:
+            return "Not Modified";
+        case 400:
+            return "Bad Request";
+        case 404:
+            return "Not Found";
+        case 405:
+            return "Method Not Allowed";
+        case 408:
+            return "Request Timeout";
+        case 409:
+            return "Conflict";
+        case 413:
+            return "Payload Too Large";
+        case 429:
+            return "Too Many Requests";
+        case 431:
+            return "Request Header Fields Too Large";
+        case 500:
+            return "Internal Server Error";
+        case 501:
+            return "Not Implemented";
+        case 503:
+            return "Service Unavailable";
+        case 505:
+            return "HTTP Version Not Supported";
+        case 507:
+            return "Insufficient Storage";
+        default:
+            return "";
+    }
+}
+
+void HttpResponse::sendHeader(const char* name, const char* value)
+{
+    int n = snprintf(extra + extraLen, sizeof(extra) - extraLen, "%s: %s\r\n", name, value);
+    // Headers that do not fit are dropped whole rather than truncated
+    if (n > 0 && (size_t)n < sizeof(extra) - extraLen)
+        extraLen += (size_t)n;
+    else
+        extra[extraLen] = '\0';
+}
+
+bool HttpResponse::writeHead(int status, const char* contentType, size_t contentLength)
+{
+    char length[32] = "";
+    if (contentLength == CHUNKED)
+        snprintf(length, sizeof(length), "Transfer-Encoding: chunked\r\n");
+    else if (contentLength != UNTIL_CLOSE)
+        snprintf(length, sizeof(length), "Content-Length: %u\r\n", (unsigned)contentLength);
+
+    int n = snprintf(reinterpret_cast<char*>(out), sizeof(out),
+                     "HTTP/1.1 %d %s\r\n"
+                     "Content-Type: %s\r\n"
+                     "%s"
+                     "%.*s"
+                     "%s",
+                     status, statusText(status), contentType, length, (int)extraLen, extra,
+                     persistent ? CONNECTION_KEEP_ALIVE : CONNECTION_CLOSE);
+    head    = out;
+    tail    = nullptr;
+    tailLen = 0;
+    if (n < 0 || (size_t)n >= sizeof(out))
+    {
+        outLen  = 0;
+        headLen = 0;
+        return false;
+    }
+    code    = status;
+    outLen  = (size_t)n;
+    headLen = outLen;
+    return true;
+}
+
+void HttpResponse::send(int status, const char* contentType, const char* body)
+{
+    sendBytes(status, contentType, reinterpret_cast<const uint8_t*>(body),
+              body ? strlen(body) : 0);
+}
+
+void HttpResponse::sendBytes(int status, const char* contentType, const uint8_t* body,
+                             size_t length)
+{
+    staticBody = nullptr;
+    staticLen  = 0;
+    if (writeHead(status, contentType, length) && length <= sizeof(out) - outLen)
+    {
+        if (length && !omitBody)
+            memcpy(out + outLen, body, length);
+        if (!omitBody)
+            outLen += length;
+        headLen = outLen;
+        return;
+    }
+
+    static const char TOO_LARGE[] = "Response too large";
+    extraLen                      = 0;
+    writeHead(500, "text/plain", sizeof(TOO_LARGE) - 1);
+    if (!omitBody)
+    {
+        memcpy(out + outLen, TOO_LARGE, sizeof(TOO_LARGE) - 1);
+        outLen += sizeof(TOO_LARGE) - 1;
+    }
+    headLen = outLen;
+}
+
+void HttpResponse::sendStatic(int status, const char* contentType, const uint8_t* body,
+                              size_t length)
+{
+    if (!writeHead(status, contentType, length))
+    {
+        send(500, "text/plain", "Response headers too large");
+        return;
+    }
+    staticBody = omitBody ? nullptr : body;
+    staticLen  = omitBody ? 0 : length;
+}
+
+void HttpResponse::sendPrerendered(const char* headBlock, size_t headLength, const uint8_t* body,
+                                   size_t bodyLength)
+{
+    // Status code is read back from the block's status line ("HTTP/1.1 200 ...")
+    code       = headLength > 12 ? atoi(headBlock + 9) : 0;
+    head       = reinterpret_cast<const uint8_t*>(headBlock);
+    headLen    = headLength;
+    tail       = reinterpret_cast<const uint8_t*>(persistent ? CONNECTION_KEEP_ALIVE
+                                                             : CONNECTION_CLOSE);
+    tailLen    = persistent ? sizeof(CONNECTION_KEEP_ALIVE) - 1 : sizeof(CONNECTION_CLOSE) - 1;
+    staticBody = omitBody ? nullptr : body;
+    staticLen  = omitBody ? 0 : bodyLength;
+}
+
+void HttpResponse::sendStream(int status, const char* contentType, StreamFill streamFill,
+                              uint32_t cursor, uint8_t flags)
+{
+    staticBody = nullptr;
+    staticLen  = 0;
+    chunked    = !http10;
+    if (!chunked)
+        persistent = false; // the end of the body is the end of the connection
+    if (!writeHead(status, contentType, chunked ? CHUNKED : UNTIL_CLOSE))
+    {
+        send(500, "text/plain", "Response headers too large");
+        return;
+    }
+    fill   = omitBody ? nullptr : streamFill;
+    stream = {cursor, 0, flags};
+}
+
+void HttpResponse::sendHandOff(int status, const char* contentType, HandOff adopt,
+                               uint32_t arg)
+{
+    staticBody = nullptr;
+    staticLen  = 0;
+    persistent = false;
+    if (!writeHead(status, contentType, UNTIL_CLOSE))
+    {
+        send(500, "text/plain", "Response headers too large");
+        return;
+    }
+    adopter    = omitBody ? nullptr : adopt;
+    adopterArg = arg;
+}
+
+bool HttpResponse::refill(uint32_t nowMs)
+{
+    if (!fill)
+        return false;
+
+    // Each piece goes out as one chunk: the data is written after room for the longest
+    // size line, and the size line is then placed right in front of it. Unframed pieces
+    // (HTTP/1.0) are written as they are.
+    static constexpr size_t SIZE_ROOM = 8; // "7ff\r\n" and then some
+    static const char       LAST_CHUNK[] = "0\r\n\r\n";
+    const size_t            room         = chunked ? SIZE_ROOM : 0;
+    const size_t            cap =
+        chunked ? sizeof(out) - SIZE_ROOM - 2 - (sizeof(LAST_CHUNK) - 1) : sizeof(out);
+
+    bool   done = false;
+    size_t n    = fill(stream, reinterpret_cast<char*>(out) + room, cap, nowMs, done);
+    if (n > cap)
+        n = cap;
+    if (n == 0 && !done)
+        return false;
+    if (n)
+        stream.lastMs = nowMs;
+
+    size_t start = room, end = room + (chunked ? 0 : n);
+    if (n && chunked)
+    {
+        char sizeLine[SIZE_ROOM + 1];
+        int  len = snprintf(sizeLine, sizeof(sizeLine), "%x\r\n", (unsigned)n);
+        start    = SIZE_ROOM - (size_t)len;
+        memcpy(out + start, sizeLine, (size_t)len);
+        end += n;
+        memcpy(out + end, "\r\n", 2);
+        end += 2;
+    }
+    if (done)
+    {
+        if (chunked)
+        {
+            memcpy(out + end, LAST_CHUNK, sizeof(LAST_CHUNK) - 1);
+            end += sizeof(LAST_CHUNK) - 1;
+        }
+        fill  = nullptr;
+        ended = true;
+    }
+
+    // The previous piece (or the headers) is fully written, so `out` can be reused
+    head    = out + start;
+    headLen = end - start;
+    tail    = nullptr;
+    tailLen = 0;
+    written = 0;
+    return true;
+}
+
+const uint8_t* HttpResponse::pending(size_t& length) const
+{
+    if (written < headLen)
+    {
+        length = headLen - written;
+        return head + written;
+    }
+    size_t off = written - headLen;
+    if (off < tailLen)
+    {
+        length = tailLen - off;
+        return tail + off;
+    }
+    off -= tailLen;
+    length = staticLen - off;
+    return length ? staticBody + off : nullptr;
+}
+
+void HttpResponse::advance(size_t n)
+{
+    written += n;
+}
+
+bool HttpResponse::finished() const
+{
+    // A stream's last piece can be empty (an unframed body with nothing more to say), so
+    // an ended stream is finished even with nothing left queued
+    return (headLen != 0 || ended) && !fill && written >= headLen + tailLen + staticLen;
+}
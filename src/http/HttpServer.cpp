@@ -0,0 +1,482 @@
+// HttpServer.cpp
+#include "HttpServer.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(ARDUINO)
+#include <esp_timer.h>
+#include <lwip/sockets.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <time.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static_assert(HTTP_MAX_ROUTES < 0xFF, "route indexes must fit in a byte, with one to spare");
+
+// Pending connections the stack holds for us while every slot is busy
+static constexpr int LISTEN_BACKLOG = 8;
+
+static const char CONTINUE_RESPONSE[] = "HTTP/1.1 100 Continue\r\n\r\n";
+
+static bool setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static bool wouldBlock()
+{
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+// Microsecond clock for request latencies
+static uint32_t nowUs()
+{
+#if defined(ARDUINO)
+    return (uint32_t)esp_timer_get_time();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000u + ts.tv_nsec / 1000u);
+#endif
+}
+
+static const char* LATENCY_METRIC = "http_request_duration_seconds";
+static const char* LATENCY_HELP   = "Time from request parsed to last response byte written.";
+
+void HttpServer::on(const char* path, HttpMethod methods, Handler handler)
+{
+    if (routeCount >= HTTP_MAX_ROUTES)
+        return;
+    Route& r    = routes[routeCount++];
+    size_t len  = strlen(path);
+    r.path      = path;
+    r.wildcard  = len && path[len - 1] == '*';
+    r.prefixLen = r.wildcard ? (uint16_t)(len - 1) : 0;
+    r.methods   = static_cast<uint8_t>(methods);
+    r.handler   = handler;
+    metrics::add(LATENCY_METRIC, LATENCY_HELP, r.latency, "route", path);
+}
+
+void HttpServer::onNotFound(Handler handler)
+{
+    if (!notFound)
+        metrics::add(LATENCY_METRIC, LATENCY_HELP, notFoundLatency, "route", "*");
+    notFound = handler;
+}
+
+bool HttpServer::begin()
+{
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0)
+        return false;
+
+    int one = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(listenFd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(listenFd, LISTEN_BACKLOG) != 0 || !setNonBlocking(listenFd))
+    {
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    return true;
+}
+
+size_t HttpServer::activeConnections() const
+{
+    size_t n = 0;
+    for (const Connection& c : conns)
+    {
+        if (c.phase != Connection::Phase::Free)
+            n++;
+    }
+    return n;
+}
+
+void HttpServer::poll(uint32_t nowMs)
+{
+    if (listenFd < 0)
+        return;
+
+    acceptClients(nowMs);
+    for (Connection& c : conns)
+    {
+        if (c.phase == Connection::Phase::Reading)
+            readFrom(c, nowMs);
+        if (c.phase == Connection::Phase::Writing)
+            writeTo(c, nowMs);
+        if (c.phase == Connection::Phase::Draining)
+            drainFrom(c);
+        uint32_t limit = c.phase == Connection::Phase::Draining ? HTTP_DRAIN_MS
+                         : waiting(c)                           ? HTTP_KEEPALIVE_TIMEOUT_MS
+                                                                : HTTP_IDLE_TIMEOUT_MS;
+        if (c.phase != Connection::Phase::Free && nowMs - c.lastIo > limit)
+            drop(c);
+    }
+}
+
+void HttpServer::wait(uint32_t timeoutMs)
+{
+    if (listenFd < 0)
+        return;
+
+    fd_set rd, wr;
+    FD_ZERO(&rd);
+    FD_ZERO(&wr);
+    int  maxFd    = -1;
+    bool haveSlot = false;
+    for (const Connection& c : conns)
+    {
+        if (c.phase == Connection::Phase::Free || c.phase == Connection::Phase::Draining ||
+            waiting(c))
+            haveSlot = true;
+        if (c.phase == Connection::Phase::Reading || c.phase == Connection::Phase::Draining)
+        {
+            FD_SET(c.fd, &rd);
+        }
+        else if (c.phase == Connection::Phase::Writing)
+        {
+            size_t len;
+            if (c.res.pending(len) && len > 0)
+                FD_SET(c.fd, &wr);
+            else if (timeoutMs > HTTP_STREAM_POLL_MS)
+                timeoutMs = HTTP_STREAM_POLL_MS;
+        }
+        if (c.phase != Connection::Phase::Free && c.fd > maxFd)
+            maxFd = c.fd;
+    }
+    // New clients are only worth waking for when acceptClients() has a slot for them
+    if (haveSlot)
+    {
+        FD_SET(listenFd, &rd);
+        if (listenFd > maxFd)
+            maxFd = listenFd;
+    }
+    if (maxFd < 0)
+        return;
+
+    struct timeval tv;
+    tv.tv_sec  = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    select(maxFd + 1, &rd, &wr, nullptr, &tv);
+}
+
+bool HttpServer::waiting(const Connection& c)
+{
+    return c.phase == Connection::Phase::Reading && c.served > 0 && c.req.received() == 0;
+}
+
+HttpServer::Connection* HttpServer::idleSlot()
+{
+    Connection* oldest = nullptr;
+    for (Connection& c : conns)
+    {
+        if (c.phase == Connection::Phase::Draining)
+            return &c; // already answered; only waiting for the peer to close
+        if (!waiting(c))
+            continue;
+        // Skip one whose next request is already on its way in
+        char b;
+        if (recv(c.fd, &b, 1, MSG_PEEK | MSG_DONTWAIT) > 0)
+            continue;
+        if (!oldest || (int32_t)(c.lastIo - oldest->lastIo) < 0)
+            oldest = &c;
+    }
+    return oldest;
+}
+
+void HttpServer::acceptClients(uint32_t nowMs)
+{
+    for (;;)
+    {
+        Connection* c = nullptr;
+        for (Connection& s : conns)
+        {
+            if (s.phase == Connection::Phase::Free)
+            {
+                c = &s;
+                break;
+            }
+        }
+        // With every slot busy, a draining connection, or a kept-alive one that is only
+        // waiting for its next request, gives way to a new client instead of leaving it
+        // in the backlog
+        Connection* idle = c ? nullptr : idleSlot();
+        if (!c && !idle)
+            return;
+
+        struct sockaddr_in peer;
+        socklen_t          peerLen = sizeof(peer);
+        int fd = accept(listenFd, reinterpret_cast<struct sockaddr*>(&peer), &peerLen);
+        if (fd < 0)
+            return; // nothing pending (or a transient error); try again next poll
+        if (!setNonBlocking(fd))
+        {
+            ::close(fd);
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        if (idle)
+        {
+            drop(*idle);
+            c = idle;
+        }
+        c->fd       = fd;
+        c->phase    = Connection::Phase::Reading;
+        c->lastIo   = nowMs;
+        c->peerAddr = peer.sin_addr.s_addr;
+        c->served   = 0;
+        c->req.reset();
+        c->res.reset();
+        opened++;
+    }
+}
+
+void HttpServer::readFrom(Connection& c, uint32_t nowMs)
+{
+    while (c.phase == Connection::Phase::Reading)
+    {
+        ssize_t n = recv(c.fd, c.req.writePtr(), c.req.writeSpace(), MSG_DONTWAIT);
+        if (n == 0 || (n < 0 && !wouldBlock()))
+        {
+            drop(c); // peer went away
+            return;
+        }
+        if (n < 0)
+            return;
+
+        c.lastIo                  = nowMs;
+        HttpRequest::State before = c.req.state();
+        c.req.commit((size_t)n);
+        handleParsed(c, before, nowMs);
+    }
+}
+
+void HttpServer::handleParsed(Connection& c, HttpRequest::State before, uint32_t nowMs)
+{
+    HttpRequest::State st = c.req.state();
+    // Admission is decided once per request, as soon as its head has been parsed
+    if (before < HttpRequest::State::Body &&
+        (st == HttpRequest::State::Body || st == HttpRequest::State::Complete) &&
+        !admitted(c, nowMs))
+        return;
+
+    if (st == HttpRequest::State::Body && before != HttpRequest::State::Body &&
+        c.req.expectsContinue())
+    {
+        // Best effort: a client that misses this just waits out its own timer
+        send(c.fd, CONTINUE_RESPONSE, sizeof(CONTINUE_RESPONSE) - 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+    }
+
+    if (st == HttpRequest::State::Complete)
+    {
+        dispatch(c);
+    }
+    else if (st == HttpRequest::State::Error)
+    {
+        // The rest of the stream cannot be trusted, so the connection ends here
+        int status = c.req.errorStatus();
+        c.route    = NO_ROUTE;
+        c.res.reset();
+        c.res.send(status, "text/plain", HttpResponse::statusText(status));
+        c.phase = Connection::Phase::Writing;
+    }
+}
+
+bool HttpServer::admitted(Connection& c, uint32_t nowMs)
+{
+    // Requests not yet handed to their handler, this one included. An answer still
+    // being written does not count: a page's assets go out side by side on their own
+    // connections and must not turn each other away.
+    size_t inflight = 0;
+    for (const Connection& o : conns)
+    {
+        if (o.phase == Connection::Phase::Reading && o.req.received() > 0)
+            inflight++;
+    }
+    if (inflight > HTTP_MAX_INFLIGHT)
+    {
+        busy.inc();
+        refuse(c, 503, 1);
+        return false;
+    }
+
+    uint32_t retryAfterS = 1;
+    int      status      = admit ? admit(c.peerAddr, c.req, nowMs, retryAfterS) : 0;
+    if (status)
+    {
+        refuse(c, status, retryAfterS);
+        return false;
+    }
+    return true;
+}
+
+// Answer without running a handler or reading the body, and close
+void HttpServer::refuse(Connection& c, int status, uint32_t retryAfterS)
+{
+    char retry[12];
+    snprintf(retry, sizeof(retry), "%u", (unsigned)retryAfterS);
+    c.route = NO_ROUTE;
+    c.res.reset();
+    c.res.setKeepAlive(false);
+    c.res.sendHeader("Retry-After", retry);
+    c.res.send(status, "text/plain", HttpResponse::statusText(status));
+    c.phase = Connection::Phase::Writing;
+}
+
+void HttpServer::dispatch(Connection& c)
+{
+    HttpRequest&  req = c.req;
+    HttpResponse& res = c.res;
+
+    res.reset();
+    bool head = (req.method() == HttpMethod::Head);
+    res.setHeadOnly(head);
+    res.setKeepAlive(req.keepAlive() && c.served + 1 < HTTP_KEEPALIVE_MAX_REQUESTS);
+    res.setHttp10(req.isHttp10());
+    if (c.served > 0)
+        reused++;
+    if (!firstRequest)
+        firstRequest = c.lastIo ? c.lastIo : 1; // read just now
+
+    // HEAD is answered by the GET handler with the body left off
+    uint8_t method =
+        head ? static_cast<uint8_t>(HttpMethod::Get) : static_cast<uint8_t>(req.method());
+    Handler handler = notFound;
+    c.route         = (uint8_t)routeCount;
+    c.startUs       = nowUs();
+    for (size_t i = 0; i < routeCount; ++i)
+    {
+        const Route& r     = routes[i];
+        bool         match = r.wildcard ? strncmp(r.path, req.path(), r.prefixLen) == 0
+                                        : strcmp(r.path, req.path()) == 0;
+        if ((r.methods & method) && match)
+        {
+            handler = routes[i].handler;
+            c.route = (uint8_t)i;
+            break;
+        }
+    }
+
+    if (handler)
+        handler(req, res);
+    else
+        res.send(404, "text/plain", "Not found");
+    if (!res.started())
+        res.send(500, "text/plain", "Handler sent no response");
+    c.phase = Connection::Phase::Writing;
+}
+
+void HttpServer::writeTo(Connection& c, uint32_t nowMs)
+{
+    // Loops while pipelined requests are already buffered and their responses go out
+    // without blocking
+    while (c.phase == Connection::Phase::Writing)
+    {
+        size_t         len;
+        const uint8_t* p;
+        while ((p = c.res.pending(len)) != nullptr && len > 0)
+        {
+            ssize_t n = send(c.fd, p, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (n < 0)
+            {
+                if (!wouldBlock())
+                    drop(c);
+                return;
+            }
+            c.res.advance((size_t)n);
+            c.lastIo = nowMs;
+        }
+
+        if (!c.res.finished())
+        {
+            // A streamed body may have its next piece ready
+            if (c.res.refill(nowMs))
+                continue;
+            return;
+        }
+        if (c.route != NO_ROUTE)
+        {
+            uint32_t us = nowUs() - c.startUs;
+            (c.route < routeCount ? routes[c.route].latency : notFoundLatency).observe(us);
+            if (servedObserver)
+                servedObserver(us);
+        }
+        if (HttpResponse::HandOff adopt = c.res.handOff())
+        {
+            // The socket now belongs to `adopt`; the slot is free for the next client
+            int      fd  = c.fd;
+            uint32_t arg = c.res.handOffArg();
+            c.fd         = -1;
+            drop(c);
+            if (!adopt(fd, arg))
+                ::close(fd);
+            return;
+        }
+        if (!c.res.keepAlive())
+        {
+            linger(c, nowMs);
+            return;
+        }
+
+        // Keep the connection for the next request, which may already be buffered
+        c.served++;
+        c.res.reset();
+        c.phase = Connection::Phase::Reading;
+        c.req.next();
+        handleParsed(c, HttpRequest::State::RequestLine, nowMs);
+    }
+}
+
+// Done writing: half-close so the client sees the end of the answer, and let poll()
+// read whatever it still sends (a refused request's body) until it closes too
+void HttpServer::linger(Connection& c, uint32_t nowMs)
+{
+    shutdown(c.fd, SHUT_WR);
+    c.phase  = Connection::Phase::Draining;
+    c.lastIo = nowMs; // not moved again: the drain lasts HTTP_DRAIN_MS at most
+}
+
+void HttpServer::drainFrom(Connection& c)
+{
+    char scrap[128];
+    for (int i = 0; i < 8; ++i) // bounded, so a client still sending cannot hold up poll()
+    {
+        ssize_t n = recv(c.fd, scrap, sizeof(scrap), MSG_DONTWAIT);
+        if (n > 0)
+            continue;
+        if (n == 0 || !wouldBlock())
+            drop(c); // closed by the peer, or broken
+        return;
+    }
+}
+
+void HttpServer::drop(Connection& c)
+{
+    if (c.fd >= 0)
+        ::close(c.fd);
+    c.fd     = -1;
+    c.phase  = Connection::Phase::Free;
+    c.served = 0;
+    c.req.reset();
+    c.res.reset();
+}
@@ -0,0 +1,82 @@
+// LogTail.cpp
+#include "LogTail.h"
+#include <stdio.h>
+#include <string.h>
+
+// "id: <seq>\ndata: " before the line and a blank line after it. History lines keep
+// their length in a byte, so none is longer than LINE_MAX.
+static constexpr size_t LEAD_MAX  = sizeof("id: 4294967295\ndata: ") - 1;
+static constexpr size_t LINE_MAX  = 255;
+static constexpr size_t EVENT_MAX = LEAD_MAX + LINE_MAX + 2;
+
+// Render the oldest history line numbered above `after` as one event. Returns its number,
+// or 0 when there is none.
+static uint32_t render(LogTail::Reader read, uint32_t after, char (&out)[EVENT_MAX],
+                       size_t& length)
+{
+    size_t   len = 0;
+    uint32_t seq = read(after, out + LEAD_MAX, LINE_MAX, len);
+    if (seq == 0)
+        return 0;
+    char lead[LEAD_MAX + 1];
+    int  p = snprintf(lead, sizeof(lead), "id: %u\ndata: ", (unsigned)seq);
+    memmove(out + p, out + LEAD_MAX, len);
+    memcpy(out, lead, (size_t)p);
+    for (char* c = out + p; c < out + p + len; ++c)
+        if (*c == '\n' || *c == '\r')
+            *c = ' '; // one record, one line
+    memcpy(out + p + len, "\n\n", 2);
+    length = (size_t)p + len + 2;
+    return seq;
+}
+
+bool LogTail::adopt(int fd, uint32_t after, uint32_t nowMs)
+{
+    Subscriber* s = subs.adopt(fd, nowMs);
+    if (!s)
+        return false;
+    s->cursor = after;
+    s->line   = 0;
+    s->offset = 0;
+    return true;
+}
+
+void LogTail::poll(uint32_t nowMs)
+{
+    subs.poll(nowMs, LOG_SSE_HEARTBEAT_MS, [&](Subscriber& s) { return flush(s, nowMs); });
+}
+
+bool LogTail::flush(Subscriber& s, uint32_t nowMs)
+{
+    static char event[EVENT_MAX]; // one task only, and rendered again after each send
+    for (;;)
+    {
+        size_t   len;
+        uint32_t seq = render(read, s.line ? s.line - 1 : s.cursor, event, len);
+        if (seq == 0 && !s.line)
+            return true; // caught up
+        if (s.line && seq != s.line)
+        {
+            // Its line was overwritten before the socket took all of it
+            laggedOut++;
+            subs.close(s);
+            return false;
+        }
+        s.line = seq;
+        long n = sse::write(s, event + s.offset, len - s.offset, nowMs);
+        if (n < 0)
+        {
+            subs.close(s);
+            return false;
+        }
+        if (n == 0)
+            return true; // the socket is full
+        s.offset += (uint16_t)n;
+        if (s.offset == len)
+        {
+            s.cursor = s.line;
+            s.line   = 0;
+            s.offset = 0;
+        }
+    }
+}
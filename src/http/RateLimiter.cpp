@@ -0,0 +1,66 @@
+// RateLimiter.cpp
+#include "RateLimiter.h"
+#include <string.h>
+
+struct Budget
+{
+    uint32_t perS;
+    uint32_t burst;
+};
+
+static constexpr Budget BUDGETS[RateLimiter::CLASSES] = {
+    {RATE_API_PER_S, RATE_API_BURST},
+    {RATE_ASSET_PER_S, RATE_ASSET_BURST},
+};
+
+RateLimiter::Class RateLimiter::classify(const char* path)
+{
+    return strncmp(path, "/api/", 5) == 0 || strcmp(path, "/wol") == 0 ? Class::Api
+                                                                        : Class::Asset;
+}
+
+RateLimiter::Client& RateLimiter::clientFor(uint32_t addr, uint32_t nowMs)
+{
+    Client* oldest = &clients[0];
+    for (Client& c : clients)
+    {
+        if (c.addr == addr)
+            return c;
+        if (!c.addr || (oldest->addr && (int32_t)(c.lastMs - oldest->lastMs) < 0))
+            oldest = &c;
+    }
+    // A newcomer, or one forgotten since, starts with full buckets
+    oldest->addr   = addr;
+    oldest->lastMs = nowMs;
+    for (size_t i = 0; i < CLASSES; ++i)
+        oldest->milliTokens[i] = BUDGETS[i].burst * 1000;
+    return *oldest;
+}
+
+bool RateLimiter::admit(uint32_t peerAddr, Class cls, uint32_t nowMs, uint32_t& retryAfterS)
+{
+    Client& c = clientFor(peerAddr, nowMs);
+
+    // Refill every bucket for the time since the last request: perS tokens a second is
+    // perS milli-tokens a millisecond
+    uint32_t elapsed = nowMs - c.lastMs;
+    c.lastMs         = nowMs;
+    for (size_t i = 0; i < CLASSES; ++i)
+    {
+        uint32_t cap     = BUDGETS[i].burst * 1000;
+        uint64_t tokens  = c.milliTokens[i] + (uint64_t)elapsed * BUDGETS[i].perS;
+        c.milliTokens[i] = tokens > cap ? cap : (uint32_t)tokens;
+    }
+
+    uint32_t& bucket = c.milliTokens[(size_t)cls];
+    if (bucket >= 1000)
+    {
+        bucket -= 1000;
+        return true;
+    }
+    uint32_t perS = BUDGETS[(size_t)cls].perS;
+    uint32_t ms   = perS ? (1000 - bucket + perS - 1) / perS : 60000;
+    retryAfterS   = (ms + 999) / 1000;
+    refused[(size_t)cls].inc();
+    return false;
+}
@@ -0,0 +1,55 @@
+// SseSubscribers.cpp
+#include "SseSubscribers.h"
+#include <errno.h>
+#include <unistd.h>
+#if defined(ARDUINO)
+#include <lwip/sockets.h>
+#else
+#include <sys/socket.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static const char HEARTBEAT[] = ":\n\n";
+
+// Sent once on adoption: how long EventSource waits before reconnecting
+static const char PREAMBLE[] = "retry: 2000\n\n";
+
+static bool wouldBlock()
+{
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+void sse::greet(int fd)
+{
+    // Best effort: without it the browser's default retry delay applies
+    send(fd, PREAMBLE, sizeof(PREAMBLE) - 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+long sse::write(Peer& p, const char* data, size_t len, uint32_t nowMs)
+{
+    ssize_t n = send(p.fd, data, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n < 0)
+        return wouldBlock() ? 0 : -1;
+    p.lastMs = nowMs;
+    return (long)n;
+}
+
+bool sse::keepAlive(Peer& p, uint32_t nowMs, uint32_t heartbeatMs)
+{
+    if (nowMs - p.lastMs < heartbeatMs)
+        return true;
+    // Nothing to send for a while: check the peer is still there
+    char    b;
+    ssize_t r = recv(p.fd, &b, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (r == 0 || (r < 0 && !wouldBlock()))
+        return false;
+    return write(p, HEARTBEAT, sizeof(HEARTBEAT) - 1, nowMs) >= 0;
+}
+
+void sse::closeSocket(int fd)
+{
+    close(fd);
+}
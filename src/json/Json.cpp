@@ -0,0 +1,641 @@
+// Json.cpp
+#include "Json.h"
+#include <string.h>
+
+namespace json
+{
+
+static_assert(JSON_MAX_TOKENS <= 0xFFFF, "token indexes are 16-bit");
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+static uint32_t hex4(const char* p)
+{
+    return (uint32_t)(hexValue(p[0]) << 12 | hexValue(p[1]) << 8 | hexValue(p[2]) << 4 |
+                      hexValue(p[3]));
+}
+
+// Length of the string body starting after the opening quote, up to the closing one.
+// `ok` is false when it is unterminated or holds a bad escape or control byte; the
+// length is then the offset of the problem.
+static size_t scanString(const char* p, const char* end, bool& ok)
+{
+    const char* s = p;
+    ok            = false;
+    while (p < end)
+    {
+        char c = *p;
+        if (c == '"')
+        {
+            ok = true;
+            return (size_t)(p - s);
+        }
+        if ((unsigned char)c < 0x20)
+            return (size_t)(p - s);
+        if (c != '\\')
+        {
+            p++;
+            continue;
+        }
+        if (end - p < 2)
+            return (size_t)(p - s);
+        switch (p[1])
+        {
+            case '"':
+            case '\\':
+            case '/':
+            case 'b':
+            case 'f':
+            case 'n':
+            case 'r':
+            case 't':
+                p += 2;
+                break;
+            case 'u':
+                if (end - p < 6 || hexValue(p[2]) < 0 || hexValue(p[3]) < 0 ||
+                    hexValue(p[4]) < 0 || hexValue(p[5]) < 0)
+                    return (size_t)(p - s);
+                p += 6;
+                break;
+            default:
+                return (size_t)(p - s);
+        }
+    }
+    return (size_t)(p - s);
+}
+
+// -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)? ; returns its length, 0 if malformed
+static size_t scanNumber(const char* p, const char* end)
+{
+    const char* s = p;
+    if (p < end && *p == '-')
+        p++;
+    if (p == end || !isDigit(*p))
+        return 0;
+    if (*p == '0')
+        p++;
+    else
+        while (p < end && isDigit(*p))
+            p++;
+    if (p < end && *p == '.')
+    {
+        if (++p == end || !isDigit(*p))
+            return 0;
+        while (p < end && isDigit(*p))
+            p++;
+    }
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        if (++p < end && (*p == '+' || *p == '-'))
+            p++;
+        if (p == end || !isDigit(*p))
+            return 0;
+        while (p < end && isDigit(*p))
+            p++;
+    }
+    return (size_t)(p - s);
+}
+
+size_t Document::add(Type type, size_t start)
+{
+    if (count == JSON_MAX_TOKENS)
+        return NONE;
+    tokens[count] = {type, (uint16_t)start, 0, 1, 0};
+    return count++;
+}
+
+Error Document::fail(Error e, size_t at)
+{
+    err     = e;
+    errorAt = at;
+    count   = 0;
+    return e;
+}
+
+Error Document::parse(const char* input, size_t length)
+{
+    // What may come next: a value, an object key, the colon after a key, or a comma or
+    // closing bracket after a value. The *OrClose states follow an opening bracket.
+    enum class Expect : uint8_t
+    {
+        Value,
+        ValueOrClose,
+        Key,
+        KeyOrClose,
+        Colon,
+        CommaOrClose,
+        End,
+    };
+
+    text    = input;
+    count   = 0;
+    err     = Error::None;
+    errorAt = 0;
+    if (length > 0xFFFF)
+        return fail(Error::TooLarge, 0);
+
+    const char* end = input + length;
+    const char* p   = input;
+    size_t      open[JSON_MAX_DEPTH]; // token index of each enclosing container
+    size_t      depth  = 0;
+    Expect      expect = Expect::Value;
+
+    while (true)
+    {
+        while (p < end && isSpace(*p))
+            p++;
+        if (p == end)
+            break;
+
+        size_t at = (size_t)(p - input);
+        char   c  = *p;
+
+        if ((c == '}' && expect == Expect::KeyOrClose) ||
+            (c == ']' && expect == Expect::ValueOrClose) ||
+            ((c == '}' || c == ']') && expect == Expect::CommaOrClose))
+        {
+            Token& t = tokens[open[depth - 1]];
+            if ((c == '}') != (t.type == Type::Object))
+                return fail(Error::Syntax, at);
+            t.span   = (uint16_t)(count - open[depth - 1]);
+            t.length = (uint16_t)(at + 1 - t.start);
+            depth--;
+            p++;
+            expect = depth ? Expect::CommaOrClose : Expect::End;
+            continue;
+        }
+
+        switch (expect)
+        {
+            case Expect::Colon:
+                if (c != ':')
+                    return fail(Error::Syntax, at);
+                p++;
+                expect = Expect::Value;
+                continue;
+
+            case Expect::CommaOrClose:
+                if (c != ',')
+                    return fail(Error::Syntax, at);
+                p++;
+                expect = tokens[open[depth - 1]].type == Type::Object ? Expect::Key
+                                                                       : Expect::Value;
+                continue;
+
+            case Expect::Key:
+            case Expect::KeyOrClose:
+            {
+                if (c != '"')
+                    return fail(Error::Syntax, at);
+                bool   ok;
+                size_t len = scanString(p + 1, end, ok);
+                if (!ok)
+                    return fail(Error::Syntax, at + 1 + len);
+                size_t key = add(Type::String, at + 1);
+                if (key == NONE)
+                    return fail(Error::TooLarge, at);
+                tokens[key].length = (uint16_t)len;
+                tokens[open[depth - 1]].count++;
+                p += len + 2;
+                expect = Expect::Colon;
+                continue;
+            }
+
+            case Expect::End:
+                return fail(Error::Syntax, at);
+
+            default: // a value
+                break;
+        }
+
+        size_t tok;
+        size_t len = 0;
+        if (c == '{' || c == '[')
+        {
+            if (depth == JSON_MAX_DEPTH)
+                return fail(Error::TooDeep, at);
+            tok = add(c == '{' ? Type::Object : Type::Array, at);
+        }
+        else if (c == '"')
+        {
+            bool ok;
+            len = scanString(p + 1, end, ok);
+            if (!ok)
+                return fail(Error::Syntax, at + 1 + len);
+            tok = add(Type::String, at + 1);
+        }
+        else if (c == '-' || isDigit(c))
+        {
+            len = scanNumber(p, end);
+            if (len == 0)
+                return fail(Error::Syntax, at);
+            tok = add(Type::Number, at);
+        }
+        else
+        {
+            static const struct
+            {
+                const char* word;
+                Type        type;
+            } literals[] = {{"true", Type::True}, {"false", Type::False}, {"null", Type::Null}};
+            const char* word = nullptr;
+            Type        type = Type::Null;
+            for (const auto& l : literals)
+            {
+                if ((size_t)(end - p) >= strlen(l.word) &&
+                    memcmp(p, l.word, strlen(l.word)) == 0)
+                {
+                    word = l.word;
+                    type = l.type;
+                }
+            }
+            if (!word)
+                return fail(Error::Syntax, at);
+            len = strlen(word);
+            tok = add(type, at);
+        }
+        if (tok == NONE)
+            return fail(Error::TooLarge, at);
+
+        // Object members are counted at their key
+        if (depth && tokens[open[depth - 1]].type == Type::Array)
+            tokens[open[depth - 1]].count++;
+
+        if (c == '{' || c == '[')
+        {
+            open[depth++] = tok;
+            p++;
+            expect = c == '{' ? Expect::KeyOrClose : Expect::ValueOrClose;
+            continue;
+        }
+        tokens[tok].length = (uint16_t)len;
+        p += c == '"' ? len + 2 : len;
+        // A number must not run into a letter ("12abc") or a literal into anything
+        if (c != '"' && p < end && !isSpace(*p) && *p != ',' && *p != '}' && *p != ']')
+            return fail(Error::Syntax, (size_t)(p - input));
+        expect = depth ? Expect::CommaOrClose : Expect::End;
+    }
+
+    if (expect != Expect::End)
+        return fail(Error::Syntax, length);
+    return err;
+}
+
+// Decode one character of an escaped string at `p`, advancing it; returns the number
+// of bytes written to `out` (UTF-8, at most 4). The input was validated by parse().
+static size_t decodeChar(const char*& p, const char* end, char out[4])
+{
+    if (*p != '\\')
+    {
+        out[0] = *p++;
+        return 1;
+    }
+    char e = p[1];
+    p += 2;
+    switch (e)
+    {
+        case 'b':
+            out[0] = '\b';
+            return 1;
+        case 'f':
+            out[0] = '\f';
+            return 1;
+        case 'n':
+            out[0] = '\n';
+            return 1;
+        case 'r':
+            out[0] = '\r';
+            return 1;
+        case 't':
+            out[0] = '\t';
+            return 1;
+        case 'u':
+            break;
+        default:
+            out[0] = e;
+            return 1;
+    }
+
+    uint32_t cp = hex4(p);
+    p += 4;
+    if (cp >= 0xD800 && cp <= 0xDBFF && end - p >= 6 && p[0] == '\\' && p[1] == 'u')
+    {
+        uint32_t low = hex4(p + 2);
+        if (low >= 0xDC00 && low <= 0xDFFF)
+        {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            p += 6;
+        }
+    }
+    if (cp >= 0xD800 && cp <= 0xDFFF)
+        cp = 0xFFFD; // unpaired surrogate
+
+    if (cp < 0x80)
+    {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800)
+    {
+        out[0] = (char)(0xC0 | cp >> 6);
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000)
+    {
+        out[0] = (char)(0xE0 | cp >> 12);
+        out[1] = (char)(0x80 | (cp >> 6 & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | cp >> 18);
+    out[1] = (char)(0x80 | (cp >> 12 & 0x3F));
+    out[2] = (char)(0x80 | (cp >> 6 & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+bool Document::string(size_t i, char* out, size_t outLen) const
+{
+    if (outLen == 0)
+        return false;
+    out[0] = '\0';
+    if (!is(i, Type::String))
+        return false;
+    const char* p   = text + tokens[i].start;
+    const char* end = p + tokens[i].length;
+    size_t      pos = 0;
+    while (p < end)
+    {
+        char   c[4];
+        size_t n = decodeChar(p, end, c);
+        if (pos + n >= outLen)
+        {
+            out[0] = '\0';
+            return false;
+        }
+        memcpy(out + pos, c, n);
+        pos += n;
+    }
+    out[pos] = '\0';
+    return true;
+}
+
+bool Document::equals(size_t i, const char* s) const
+{
+    if (!is(i, Type::String))
+        return false;
+    const char* p   = text + tokens[i].start;
+    const char* end = p + tokens[i].length;
+    while (p < end)
+    {
+        char   c[4];
+        size_t n = decodeChar(p, end, c);
+        if (strncmp(s, c, n) != 0)
+            return false;
+        s += n;
+    }
+    return *s == '\0';
+}
+
+bool Document::number(size_t i, uint32_t& out) const
+{
+    if (!is(i, Type::Number))
+        return false;
+    const char* p     = text + tokens[i].start;
+    uint64_t    value = 0;
+    for (size_t n = 0; n < tokens[i].length; ++n)
+    {
+        if (!isDigit(p[n]))
+            return false;
+        value = value * 10 + (uint64_t)(p[n] - '0');
+        if (value > 0xFFFFFFFFu)
+            return false;
+    }
+    out = (uint32_t)value;
+    return true;
+}
+
+size_t Document::find(size_t object, const char* key) const
+{
+    if (!is(object, Type::Object))
+        return NONE;
+    size_t k = child(object);
+    for (size_t n = 0; n < tokens[object].count; ++n)
+    {
+        if (equals(k, key))
+            return k + 1;
+        k = next(k + 1);
+    }
+    return NONE;
+}
+
+const char* describe(Error e)
+{
+    switch (e)
+    {
+        case Error::None:
+            return "ok";
+        case Error::Syntax:
+            return "malformed JSON";
+        case Error::TooDeep:
+            return "JSON nested too deeply";
+        default:
+            return "JSON too large";
+    }
+}
+
+Writer::Writer(char* buf, size_t cap) : buf(buf), cap(cap)
+{
+    if (cap)
+        buf[0] = '\0';
+    else
+        overflow = true;
+}
+
+void Writer::put(const char* s, size_t n)
+{
+    if (overflow)
+        return;
+    if (cap - pos <= n)
+    {
+        overflow = true;
+        return;
+    }
+    memcpy(buf + pos, s, n);
+    pos += n;
+    buf[pos] = '\0';
+}
+
+void Writer::put(char c)
+{
+    put(&c, 1);
+}
+
+// Comma before every item of a container but the first; nothing between key and value
+void Writer::separate()
+{
+    if (afterKey)
+    {
+        afterKey = false;
+        return;
+    }
+    if (depth == 0)
+        return;
+    uint32_t bit = 1u << (depth - 1);
+    if (nonEmpty & bit)
+        put(',');
+    nonEmpty |= bit;
+}
+
+void Writer::open(char c)
+{
+    separate();
+    if (depth == 32)
+    {
+        overflow = true;
+        return;
+    }
+    put(c);
+    depth++;
+    nonEmpty &= ~(1u << (depth - 1));
+}
+
+void Writer::close(char c)
+{
+    if (depth)
+        depth--;
+    put(c);
+}
+
+Writer& Writer::beginObject()
+{
+    open('{');
+    return *this;
+}
+
+Writer& Writer::endObject()
+{
+    close('}');
+    return *this;
+}
+
+Writer& Writer::beginArray()
+{
+    open('[');
+    return *this;
+}
+
+Writer& Writer::endArray()
+{
+    close(']');
+    return *this;
+}
+
+Writer& Writer::key(const char* name)
+{
+    string(name);
+    put(':');
+    afterKey = true;
+    return *this;
+}
+
+Writer& Writer::string(const char* s)
+{
+    static const char hex[] = "0123456789abcdef";
+    separate();
+    put('"');
+    // Copy runs of plain bytes at once; escape quotes, backslashes and control bytes
+    const char* run = s;
+    for (; *s; ++s)
+    {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+        put(run, (size_t)(s - run));
+        run = s + 1;
+        char esc[6] = {'\\', (char)c, 0, 0, 0, 0};
+        switch (c)
+        {
+            case '"':
+            case '\\':
+                put(esc, 2);
+                continue;
+            case '\n':
+                esc[1] = 'n';
+                put(esc, 2);
+                continue;
+            case '\r':
+                esc[1] = 'r';
+                put(esc, 2);
+                continue;
+            case '\t':
+                esc[1] = 't';
+                put(esc, 2);
+                continue;
+            default:
+                break;
+        }
+        esc[1] = 'u';
+        esc[2] = '0';
+        esc[3] = '0';
+        esc[4] = hex[c >> 4];
+        esc[5] = hex[c & 0xF];
+        put(esc, 6);
+    }
+    put(run, (size_t)(s - run));
+    put('"');
+    return *this;
+}
+
+Writer& Writer::number(uint32_t v)
+{
+    char   digits[10];
+    size_t n = 0;
+    do
+    {
+        digits[sizeof(digits) - ++n] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    separate();
+    put(digits + sizeof(digits) - n, n);
+    return *this;
+}
+
+Writer& Writer::boolean(bool v)
+{
+    separate();
+    if (v)
+        put("true", 4);
+    else
+        put("false", 5);
+    return *this;
+}
+
+Writer& Writer::null()
+{
+    separate();
+    put("null", 4);
+    return *this;
+}
+
+} // namespace json
@@ -12,37 +12,403 @@
  */
 
 #include "Logger.h"
+#include <atomic>
+#include "MpscRing.h"
 
 namespace logger
 {
-void logImpl(Level level, const char* text, const char* file, int line, const char* function)
+
+static constexpr uint32_t DRAIN_STACK = 3072;
+
+static MpscRing<Record, LOG_RING_DEPTH> ring;
+static std::atomic<uint32_t>            dropCount{0};    // since the last drain
+static std::atomic<uint32_t>            droppedTotal{0}; // reported by earlier drains
+static std::atomic<bool>                draining{false}; // one consumer at a time
+static TaskHandle_t                     drainTask = nullptr;
+
+// History of formatted lines, slot = seq % LOG_HISTORY_LINES. Only the drain side writes;
+// readers copy a slot and then check its seq is unchanged, so they never wait on it.
+struct HistorySlot
+{
+    std::atomic<uint32_t> seq{0}; // 0 while the slot is being rewritten
+    uint8_t               length = 0;
+    char                  text[LOG_HISTORY_LINE_LEN];
+};
+
+static_assert(LOG_HISTORY_LINE_LEN <= 256, "history line length must fit in a byte");
+
+#if LOG_HISTORY_LINES > 0
+static HistorySlot history[LOG_HISTORY_LINES];
+#endif
+static std::atomic<uint32_t> historySeq{0}; // newest complete line
+
+using detail::ArgType;
+
+// Cursor over a record's packed arguments
+struct ArgReader
+{
+    const Record& r;
+    size_t        pos = 0;
+
+    // Next argument as a 64-bit value (strings are returned through `str`). False once
+    // the arguments run out.
+    bool next(ArgType& type, uint64_t& bits, double& d, const char*& str)
+    {
+        if (pos >= r.argLen)
+            return false;
+        type                 = static_cast<ArgType>(r.args[pos++]);
+        const uint8_t* value = r.args + pos;
+        switch (type)
+        {
+            case ArgType::S32:
+            {
+                int32_t v;
+                memcpy(&v, value, sizeof(v));
+                bits = static_cast<uint64_t>(static_cast<int64_t>(v));
+                pos += sizeof(v);
+                break;
+            }
+            case ArgType::U32:
+            {
+                uint32_t v;
+                memcpy(&v, value, sizeof(v));
+                bits = v;
+                pos += sizeof(v);
+                break;
+            }
+            case ArgType::S64:
+            case ArgType::U64:
+                memcpy(&bits, value, sizeof(bits));
+                pos += sizeof(bits);
+                break;
+            case ArgType::F64:
+                memcpy(&d, value, sizeof(d));
+                pos += sizeof(d);
+                break;
+            case ArgType::Str:
+                str = reinterpret_cast<const char*>(value);
+                pos += strlen(str) + 1;
+                break;
+            case ArgType::Ptr:
+            {
+                const void* p;
+                memcpy(&p, value, sizeof(p));
+                bits = reinterpret_cast<uintptr_t>(p);
+                pos += sizeof(p);
+                break;
+            }
+            default:
+                pos = r.argLen;
+                return false;
+        }
+        return true;
+    }
+};
+
+static bool isIntType(ArgType t)
+{
+    return t == ArgType::S32 || t == ArgType::U32 || t == ArgType::S64 || t == ArgType::U64;
+}
+
+// printf for a Record: walks the format string and formats each conversion with the
+// next stored argument. Length modifiers in the format are replaced by the stored
+// argument's width. `*` widths are not supported.
+static size_t formatRecord(ArgReader& args, const char* fmt, char* out, size_t outLen)
+{
+    size_t      o    = 0;
+    const char* f    = fmt;
+    auto        room = [&]() { return outLen - o; };
+    // snprintf reports the untruncated length; stop at the last byte of `out`
+    auto put = [&](int n)
+    {
+        if (n > 0)
+            o = (o + (size_t)n < outLen) ? o + (size_t)n : outLen - 1;
+    };
+
+    while (*f && o + 1 < outLen)
+    {
+        if (*f != '%')
+        {
+            out[o++] = *f++;
+            continue;
+        }
+        if (f[1] == '%')
+        {
+            out[o++] = '%';
+            f += 2;
+            continue;
+        }
+
+        // %[flags][width][.precision][length]conversion
+        char        spec[32];
+        size_t      s     = 0;
+        const char* start = f++;
+        while (*f && strchr("-+ #0", *f) && s < 8)
+            spec[++s] = *f++;
+        while (*f >= '0' && *f <= '9' && s < 14)
+            spec[++s] = *f++;
+        if (*f == '.')
+        {
+            spec[++s] = *f++;
+            while (*f >= '0' && *f <= '9' && s < 20)
+                spec[++s] = *f++;
+        }
+        while (*f && strchr("hlLqjzt", *f))
+            f++;
+        char conv = *f;
+        if (!conv)
+            break;
+        f++;
+        spec[0] = '%';
+        s++;
+
+        ArgType     type;
+        uint64_t    bits = 0;
+        double      d    = 0;
+        const char* str  = nullptr;
+        if (!args.next(type, bits, d, str))
+        {
+            put(snprintf(out + o, room(), "?"));
+            continue;
+        }
+        bool narrow = (type == ArgType::S32 || type == ArgType::U32);
+
+        switch (conv)
+        {
+            case 'd':
+            case 'i':
+                memcpy(spec + s, "lld", 4);
+                put(snprintf(out + o, room(), spec,
+                             isIntType(type) ? (long long)bits : (long long)d));
+                break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+                spec[s++] = 'l';
+                spec[s++] = 'l';
+                spec[s++] = conv;
+                spec[s]   = '\0';
+                if (narrow)
+                    bits &= 0xFFFFFFFFu;
+                put(snprintf(out + o, room(), spec,
+                             isIntType(type) ? (unsigned long long)bits : (unsigned long long)d));
+                break;
+            case 'c':
+                memcpy(spec + s, "c", 2);
+                put(snprintf(out + o, room(), spec, (int)bits));
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                spec[s++] = conv;
+                spec[s]   = '\0';
+                put(snprintf(out + o, room(), spec, type == ArgType::F64 ? d : (double)bits));
+                break;
+            case 's':
+                memcpy(spec + s, "s", 2);
+                put(snprintf(out + o, room(), spec, type == ArgType::Str ? str : "?"));
+                break;
+            case 'p':
+                put(snprintf(out + o, room(), "%p", reinterpret_cast<void*>((uintptr_t)bits)));
+                break;
+            default:
+                // Unknown conversion: print it as written
+                put(snprintf(out + o, room(), "%.*s", (int)(f - start), start));
+                break;
+        }
+    }
+    out[o] = '\0';
+    return o;
+}
+
+// Site 0 records (function API) carry their location and format ahead of the arguments
+static LogSite dynamicSite(ArgReader& args)
+{
+    LogSite     site = log_sites[0];
+    ArgType     type;
+    uint64_t    bits = 0;
+    double      d    = 0;
+    const char* str  = nullptr;
+    if (args.next(type, bits, d, str))
+        site.file = reinterpret_cast<const char*>((uintptr_t)bits);
+    if (args.next(type, bits, d, str))
+        site.function = reinterpret_cast<const char*>((uintptr_t)bits);
+    if (args.next(type, bits, d, str))
+        site.first = (uint16_t)bits;
+    if (args.next(type, bits, d, str))
+        site.fmt = reinterpret_cast<const char*>((uintptr_t)bits);
+    site.file = basename(site.file);
+    return site;
+}
+
+// Append a line to the history; drain side only
+static void remember(const char* text)
+{
+#if LOG_HISTORY_LINES > 0
+    uint32_t     seq    = historySeq.load(std::memory_order_relaxed) + 1;
+    HistorySlot& slot   = history[seq % LOG_HISTORY_LINES];
+    size_t       length = strnlen(text, sizeof(slot.text));
+
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(slot.text, text, length);
+    slot.length = (uint8_t)length;
+    slot.seq.store(seq, std::memory_order_release);
+    historySeq.store(seq, std::memory_order_release);
+#else
+    (void)text;
+#endif
+}
+
+uint32_t historyHead()
+{
+    return historySeq.load(std::memory_order_acquire);
+}
+
+uint32_t readHistory(uint32_t after, char* out, size_t cap, size_t& length)
+{
+#if LOG_HISTORY_LINES > 0
+    uint32_t head   = historySeq.load(std::memory_order_acquire);
+    uint32_t oldest = head > LOG_HISTORY_LINES ? head - LOG_HISTORY_LINES + 1 : 1;
+    for (uint32_t seq = after < oldest ? oldest : after + 1; seq <= head; ++seq)
+    {
+        const HistorySlot& slot = history[seq % LOG_HISTORY_LINES];
+        if (slot.seq.load(std::memory_order_acquire) != seq)
+            continue; // already overwritten by a newer line
+        size_t n = slot.length;
+        if (n > cap)
+            return 0;
+        memcpy(out, slot.text, n);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != seq)
+            continue; // rewritten while we copied
+        length = n;
+        return seq;
+    }
+#else
+    (void)after;
+    (void)out;
+    (void)cap;
+    (void)length;
+#endif
+    return 0;
+}
+
+static void printRecord(const Record& r)
 {
+    char      msg[WHEEZER_MAX_LOG_LENGTH];
+    char      line[WHEEZER_MAX_LOG_LENGTH];
+    ArgReader args{r};
+    LogSite   site = (r.site == 0 || r.site >= log_site_count) ? dynamicSite(args)
+                                                               : log_sites[r.site];
+    formatRecord(args, site.fmt ? site.fmt : "?", msg, sizeof(msg));
+    int n = snprintf(line, sizeof(line), "\r[%d] %s:%s:%d [%s]  %s", (int)r.timestamp,
+                     site.file, site.function, site.first, levelToString(r.level), msg);
+    if (n >= (int)sizeof(line))
+        memcpy(line + sizeof(line) - 4, "...", 4); // cut short: say so
+    Serial.println(line);
+    remember(line + 1); // without the leading \r
     logNumber++;
-    char buffer[WHEEZER_MAX_LOG_LENGTH];
+}
+
+// Print everything queued. False if another task is already draining.
+static bool drain()
+{
+    if (draining.exchange(true, std::memory_order_acquire))
+        return false;
+    Record r;
+    while (ring.pop(r))
+        printRecord(r);
+    uint32_t lost = dropCount.exchange(0, std::memory_order_relaxed);
+    if (lost)
+    {
+        char note[64]; // fits any timestamp and count
+        snprintf(note, sizeof(note), "\r[%d] logger: %u records dropped", (int)millis(),
+                 (unsigned)lost);
+        Serial.println(note);
+        remember(note + 1);
+        droppedTotal.fetch_add(lost, std::memory_order_relaxed);
+    }
+    draining.store(false, std::memory_order_release);
+    return true;
+}
 
-    snprintf(buffer, sizeof(buffer), "\r[%d] %s:%s:%d [%s]  %s", (int)millis(), file, function,
-             line, levelToString(level), text);
+static void drainLoop(void*)
+{
+    for (;;)
+    {
+        drain();
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+    }
+}
+
+bool submit(const Record& record)
+{
+    if (ring.push(record))
+        return true;
+    dropCount.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
 
-    Serial.println(buffer);
+bool begin()
+{
+    if (drainTask)
+        return true;
+    BaseType_t rc =
+        xTaskCreate(drainLoop, "log_drain", DRAIN_STACK, nullptr, LOG_TASK_PRIORITY, &drainTask);
+    if (rc != pdPASS)
+    {
+        drainTask = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void flush()
+{
+    while (!drain())
+        delay(1); // the drain task is mid-batch; it finishes shortly
+    Serial.flush();
+}
+
+uint32_t dropped()
+{
+    return droppedTotal.load(std::memory_order_relaxed) +
+           dropCount.load(std::memory_order_relaxed);
+}
+
+// Queue an already formatted message as a "%s" record
+static void submitText(Level level, const char* text, const char* file, int line,
+                       const char* function)
+{
+    logDeferred(level, file, line, function, "%s", text);
+}
+
+void logImpl(Level level, const char* text, const char* file, int line, const char* function)
+{
+    submitText(level, text, file, line, function);
 }
 
 void logImplV(Level level, const char* file, int line, const char* function, const char* fmt,
               va_list args)
 {
+    // A va_list cannot be stored, so this path formats on the caller's task
     char msg[WHEEZER_MAX_LOG_LENGTH];
     vsnprintf(msg, sizeof(msg), fmt, args);
-    logImpl(level, msg, file, line, function);
+    submitText(level, msg, file, line, function);
 }
 
 void logImplF(Level level, const char* file, int line, const char* function, const char* fmt, ...)
 {
-    char msg[WHEEZER_MAX_LOG_LENGTH];
-
     va_list args;
     va_start(args, fmt);
-    vsnprintf(msg, sizeof(msg), fmt, args);
+    logImplV(level, file, line, function, fmt, args);
     va_end(args);
-
-    logImpl(level, msg, file, line, function);
 }
-} // namespace logger
\ No newline at end of file
+} // namespace logger
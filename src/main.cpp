@@ -3,10 +3,25 @@
 // This software is released under the MIT License.
 // https://opensource.org/licenses/MIT
 
+#define LOG_MODULE_LEVEL LOG_LEVEL_MAIN
 #include <Arduino.h>
 #include <WiFi.h>
-#include <WebServer.h>
+#include <esp_heap_caps.h>
+#include "HostRegistry.h"
+#include "HttpServer.h"
+#include "EventStream.h"
+#include "Json.h"
+#include "LogTail.h"
+#include "Metrics.h"
+#include "PowerManager.h"
+#include "RateLimiter.h"
+#include "Scheduler.h"
+#include "WakeEvents.h"
 #include "WakeOnLan.h"
+#include "WakeQueue.h"
+#include "WakeRelay.h"
+#include "WakeVerifier.h"
+#include "WifiLink.h"
 #include "generated/assets.h"
 #include "Logger.h"
 // Use the board-defined LED pin when available; fall back to GPIO2 which is
@@ -27,6 +42,12 @@ static const unsigned long SERIAL_BAUD_RATE = 115200;
 #define DEFAULT_MAC_LITERAL DEFAULT_MAC
 #endif
 
+// The default MAC is parsed and its magic packet built at compile time, so a bad
+// DEFAULT_MAC fails the build instead of every /wol request.
+static constexpr wol::MacAddress default_mac = wol::parseMac(DEFAULT_MAC_LITERAL);
+static_assert(default_mac.valid, "DEFAULT_MAC is not a valid MAC address");
+static constexpr wol::Packet default_packet = wol::makePacket(default_mac);
+
 // WLAN compile-time configuration
 // To be tolerant of how WLAN_MODE is passed (numeric, unquoted token, or quoted
 // string), stringify the macro token and decide mode at runtime. Example usages:
@@ -115,296 +136,1751 @@ static const char* get_wlan_psk()
     return buf;
 }
 
-WebServer server(80);
+// Soft AP that serves the UI while the station connects, and whenever its link is lost.
+// There is no default password: without WLAN_AP_PSK at build time there is no such AP,
+// and the UI is only reachable over the station link, unless the station never
+// connects (see WIFI_CONNECT_TIMEOUT_MS): then, as before the station ran in the
+// background, the AP comes up with the WLAN_SSID/WLAN_PSK credentials.
+#ifndef WLAN_AP_SSID
+#define WLAN_AP_SSID "WOL-ESP32"
+#endif
+#ifdef WLAN_AP_PSK
+static const char* const sta_ap_ssid = WLAN_AP_SSID;
+static const char* const sta_ap_psk  = WLAN_AP_PSK;
+#else
+static const char* const sta_ap_ssid = nullptr;
+static const char* const sta_ap_psk  = nullptr;
+#endif
+
+// TCP port of the web UI and API (the native build uses an unprivileged one)
+#ifndef HTTP_PORT
+#define HTTP_PORT 80
+#endif
+
+HttpServer server(HTTP_PORT);
+
+// Per-client request budgets (see RateLimiter.h); build with 0 to serve every request,
+// e.g. for load tests from one machine
+#ifndef RATE_LIMIT
+#define RATE_LIMIT 1
+#endif
+
+static RateLimiter limiter;
+
+// HttpServer admission hook: over-budget clients get a 429 before their body is read
+static int admit_request(uint32_t peerAddr, const HttpRequest& req, uint32_t nowMs,
+                         uint32_t& retryAfterS)
+{
+    RateLimiter::Class cls = RateLimiter::classify(req.path());
+    return limiter.admit(peerAddr, cls, nowMs, retryAfterS) ? 0 : 429;
+}
+
+// True when an If-None-Match header value lists `etag` (or is "*"). Weak
+// comparison, as RFC 7232 prescribes for If-None-Match: a W/ prefix is ignored.
+static bool etag_matches(const char* ifNoneMatch, const char* etag)
+{
+    size_t etagLen = strlen(etag);
+    for (const char* p = ifNoneMatch; *p;)
+    {
+        while (*p == ' ' || *p == ',')
+            p++;
+        if (*p == '*')
+            return true;
+        if (p[0] == 'W' && p[1] == '/')
+            p += 2;
+        const char* end = p;
+        while (*end && *end != ',')
+            end++;
+        const char* tokEnd = end;
+        while (tokEnd > p && tokEnd[-1] == ' ')
+            tokEnd--;
+        if ((size_t)(tokEnd - p) == etagLen && strncmp(p, etag, etagLen) == 0)
+            return true;
+        p = end;
+    }
+    return false;
+}
+
+// ASSET_ENC_* bits for the codings an Accept-Encoding header allows. Codings listed
+// with q=0 are refused, "*" covers anything not named, and identity is acceptable
+// unless refused explicitly. No header at all means identity only.
+static uint8_t accepted_encodings(const char* acceptEncoding)
+{
+    if (!acceptEncoding)
+        return ASSET_ENC_IDENTITY;
+
+    uint8_t allowed = 0, refused = 0, named = 0;
+    bool    star = false, starRefused = false;
+    for (const char* p = acceptEncoding; *p;)
+    {
+        while (*p == ' ' || *p == ',')
+            p++;
+        const char* name = p;
+        while (*p && *p != ',' && *p != ';' && *p != ' ')
+            p++;
+        size_t nameLen = p - name;
+
+        // Only "q=0", "q=0.", "q=0.000" etc. refuse; any other weight accepts
+        bool zero = false;
+        while (*p && *p != ',')
+        {
+            if ((p[0] == 'q' || p[0] == 'Q') && p[1] == '=')
+            {
+                const char* q = p + 2;
+                zero          = (*q == '0');
+                for (q++; zero && *q && *q != ',' && *q != ';' && *q != ' '; q++)
+                    zero = (*q == '.' || *q == '0');
+            }
+            p++;
+        }
+
+        uint8_t bit = 0;
+        if (nameLen == 1 && *name == '*')
+        {
+            star        = true;
+            starRefused = zero;
+            continue;
+        }
+        if (nameLen == 2 && strncasecmp(name, "br", 2) == 0)
+            bit = ASSET_ENC_BR;
+        else if ((nameLen == 4 && strncasecmp(name, "gzip", 4) == 0) ||
+                 (nameLen == 6 && strncasecmp(name, "x-gzip", 6) == 0))
+            bit = ASSET_ENC_GZIP;
+        else if (nameLen == 8 && strncasecmp(name, "identity", 8) == 0)
+            bit = ASSET_ENC_IDENTITY;
+        named |= bit;
+        if (zero)
+            refused |= bit;
+        else
+            allowed |= bit;
+    }
+
+    if (star)
+    {
+        uint8_t rest = (uint8_t)((ASSET_ENC_IDENTITY | ASSET_ENC_GZIP | ASSET_ENC_BR) & ~named);
+        if (starRefused)
+            refused |= rest;
+        else
+            allowed |= rest;
+    }
+    if (!(named & ASSET_ENC_IDENTITY) && !(refused & ASSET_ENC_IDENTITY))
+        allowed |= ASSET_ENC_IDENTITY;
+    return allowed & ~refused;
+}
+
+// Serve an embedded asset. The lookup is a build-time perfect hash, the smallest
+// variant (brotli/gzip/identity) the client accepts is picked, and its status line +
+// headers were rendered by generate_assets.py, so this is one hash probe and two
+// writes straight from flash. A matching If-None-Match gets the variant's
+// pre-rendered 304 instead.
+static void serve_embedded(HttpRequest& req, HttpResponse& res, const char* cpath)
+{
+    L_INFOF("Serving embedded asset: %s", cpath);
+    const struct asset* a = asset_lookup(cpath);
+    if (!a)
+    {
+        res.send(404, "text/plain", "Not found");
+        return;
+    }
+
+    uint8_t                     accepted = accepted_encodings(req.header("Accept-Encoding"));
+    const struct asset_variant* v        = asset_select(a, accepted);
+    const char*                 inm      = req.header("If-None-Match");
+    if (inm && etag_matches(inm, v->etag))
+    {
+        res.sendPrerendered(v->not_modified, v->not_modified_len, nullptr, 0);
+        return;
+    }
+    res.sendPrerendered(v->headers, v->headers_len, v->data, v->len);
+}
+
+// Handler: serve root -> redirect to embedded index under /assets/
+void handleRoot(HttpRequest& req, HttpResponse& res)
+{
+    serve_embedded(req, res, "/index.html");
+}
+
+// Handler: /wol?mac=...
+void handleWol(HttpRequest& req, HttpResponse& res)
+{
+    // Only a missing ?mac= means the default; one too long to hold is as bad as any
+    // other unparseable value
+    char macArg[32];
+    bool useDefault = !req.hasArg("mac");
+    if (!useDefault && !req.arg("mac", macArg, sizeof(macArg)))
+    {
+        WakeOnLan::stats().parseFailures.inc();
+        res.send(400, "text/plain", "Invalid MAC address");
+        return;
+    }
+    String mac = useDefault ? String(DEFAULT_MAC_LITERAL) : String(macArg);
+
+    L_INFOF("Received WOL request for %s", mac.c_str());
+
+    // The default MAC's packet was built at compile time; anything else is parsed here
+    // so a bad MAC is rejected before it reaches the send worker.
+    uint8_t parsed[WakeOnLan::MAC_LEN];
+    if (!useDefault && !WakeOnLan::parseMac(mac.c_str(), parsed))
+    {
+        WakeOnLan::stats().parseFailures.inc();
+        res.send(400, "text/plain", (String("Invalid MAC address ") + mac).c_str());
+        return;
+    }
+
+    IPAddress dest = WakeOnLan::resolveBroadcast(WakeOnLan::DEFAULT_BROADCAST);
+    uint32_t  job  = useDefault ? WakeQueue::enqueue(default_mac.bytes, dest, 0,
+                                                     default_packet.bytes)
+                                : WakeQueue::enqueue(parsed, dest, 0);
+    if (job)
+    {
+        res.send(202, "text/plain",
+                 (String("Magic packet queued for ") + mac + " (job " + String(job) + ")").c_str());
+        L_INFOF("Magic packet for %s queued as job %u", mac.c_str(), (unsigned)job);
+    }
+    else
+    {
+        res.send(503, "text/plain", (String("Wake queue full, not sent to ") + mac).c_str());
+        L_ERRORF("Wake queue full, dropped magic packet for %s", mac.c_str());
+    }
+}
+
+// Server-Sent Events feed of wake progress and device status (/api/events)
+static EventStream events;
 
-// Helper: find embedded asset by path (exact match)
-static const struct asset* find_asset(const char* path)
+// Handlers run one at a time on the server's task, so the API handlers share one token
+// index and one output buffer rather than putting them on the stack
+static json::Document api_doc;
+static char           api_out[HTTP_RESPONSE_BUFFER_SIZE];
+
+// Index the request body as JSON; on failure answer 400 (413 if too big) and return false
+static bool parse_json_body(HttpRequest& req, HttpResponse& res)
+{
+    if (req.bodyLength() == 0)
+    {
+        res.send(400, "text/plain", "Empty body");
+        return false;
+    }
+    json::Error err = api_doc.parse(req.body(), req.bodyLength());
+    if (err == json::Error::None)
+        return true;
+    char msg[64];
+    snprintf(msg, sizeof(msg), "Invalid JSON body: %s at byte %u", json::describe(err),
+             (unsigned)api_doc.errorOffset());
+    res.send(err == json::Error::TooLarge ? 413 : 400, "text/plain", msg);
+    return false;
+}
+
+// Send what `w` rendered, or a 500 if it overflowed
+static void send_json(HttpResponse& res, int code, const json::Writer& w)
 {
-    if (!path)
+    if (w.ok())
+        res.send(code, "application/json", w.c_str());
+    else
+        res.send(500, "text/plain", "Response too large");
+}
+
+// "aa:bb:cc:dd:ee:ff"
+static void format_mac(const uint8_t mac[WakeOnLan::MAC_LEN], char out[18])
+{
+    snprintf(out, 18, "%02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1], mac[2], mac[3], mac[4],
+             mac[5]);
+}
+
+// Dotted quad of an address in network byte order
+static void format_ip(uint32_t addr, char out[16])
+{
+    IPAddress ip(addr);
+    snprintf(out, 16, "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+}
+
+// Rounds of the "reliable" burst preset
+#ifndef WOL_RELIABLE_REPEATS
+#define WOL_RELIABLE_REPEATS 3
+#endif
+
+// Spacing of the preset's rounds, and of a burst object's without "interval_ms"
+#ifndef WOL_BURST_INTERVAL_MS
+#define WOL_BURST_INTERVAL_MS 100
+#endif
+
+// One wake target as given in a JSON object
+struct WakeTarget
+{
+    char             mac[32];
+    uint8_t          bytes[WakeOnLan::MAC_LEN];
+    bool             valid; // `mac` parsed
+    IPAddress        dest;
+    uint16_t         port;
+    WakeQueue::Burst burst;
+    bool             verify;   // check that the machine comes up
+    IPAddress        verifyIp; // 0.0.0.0 = find it by its MAC
+};
+
+// Directed broadcast of the network the board is on: the station's subnet, or the soft
+// AP's (a /24 in the ESP32 core)
+static IPAddress subnet_broadcast()
+{
+    if (WiFi.status() == WL_CONNECTED)
+        return IPAddress((uint32_t)WiFi.localIP() | ~(uint32_t)WiFi.subnetMask());
+    if (WiFi.getMode() & WIFI_AP)
+    {
+        IPAddress ap = WiFi.softAPIP();
+        return IPAddress(ap[0], ap[1], ap[2], 255);
+    }
+    return IPAddress(255, 255, 255, 255);
+}
+
+// Read the optional "burst" of the target at token `obj` into t.burst. Absent, it is one
+// packet to dest:port. "reliable" sends WOL_RELIABLE_REPEATS rounds to dest, the subnet's
+// broadcast and 255.255.255.255, on the target's port and port 7. An object gives
+// { repeats?, interval_ms?, to?: [address or "subnet"], ports?: [number] }, where `to`
+// and `ports` default to the target's own.
+static const char* read_burst(size_t obj, WakeTarget& t)
+{
+    WakeQueue::Burst& b = t.burst;
+    b                   = WakeQueue::Burst::single(t.dest, t.port);
+    size_t v            = api_doc.find(obj, "burst");
+    if (v == json::Document::NONE || api_doc.is(v, json::Type::Null))
         return nullptr;
-    // Try exact match
-    for (size_t i = 0; i < embedded_assets_count; ++i)
+    if (api_doc.equals(v, "reliable"))
     {
-        if (strcmp(embedded_assets[i].path, path) == 0)
-            return &embedded_assets[i];
+        b.repeats    = WOL_RELIABLE_REPEATS;
+        b.intervalMs = WOL_BURST_INTERVAL_MS;
+        b.addAddr(subnet_broadcast());
+        b.addAddr(IPAddress(255, 255, 255, 255));
+        b.addPort(7);
+        return nullptr;
     }
-    // Try with leading slash (if not provided)
-    if (path[0] != '/')
+    if (!api_doc.is(v, json::Type::Object))
+        return "invalid 'burst'";
+
+    uint32_t n;
+    size_t   f = api_doc.find(v, "repeats");
+    if (f != json::Document::NONE)
     {
-        String withSlash = String("/") + String(path);
-        for (size_t i = 0; i < embedded_assets_count; ++i)
+        if (!api_doc.number(f, n) || n < 1 || n > WOL_BURST_MAX_REPEATS)
+            return "invalid 'burst.repeats'";
+        b.repeats = (uint8_t)n;
+    }
+    b.intervalMs = WOL_BURST_INTERVAL_MS;
+    f            = api_doc.find(v, "interval_ms");
+    if (f != json::Document::NONE)
+    {
+        if (!api_doc.number(f, n) || n > WOL_BURST_MAX_INTERVAL_MS)
+            return "invalid 'burst.interval_ms'";
+        b.intervalMs = (uint16_t)n;
+    }
+
+    f = api_doc.find(v, "to");
+    if (f != json::Document::NONE)
+    {
+        if (!api_doc.is(f, json::Type::Array) || api_doc[f].count == 0)
+            return "invalid 'burst.to'";
+        b.addrCount = 0;
+        size_t e    = api_doc.child(f);
+        for (size_t i = 0; i < api_doc[f].count; ++i, e = api_doc.next(e))
+        {
+            char      addr[16];
+            IPAddress ip;
+            if (api_doc.equals(e, "subnet"))
+                ip = subnet_broadcast();
+            else if (!api_doc.string(e, addr, sizeof(addr)) || !ip.fromString(addr))
+                return "invalid 'burst.to'";
+            if (!b.addAddr(ip))
+                return "too many 'burst.to' addresses";
+        }
+    }
+
+    f = api_doc.find(v, "ports");
+    if (f != json::Document::NONE)
+    {
+        if (!api_doc.is(f, json::Type::Array) || api_doc[f].count == 0)
+            return "invalid 'burst.ports'";
+        b.portCount = 0;
+        size_t e    = api_doc.child(f);
+        for (size_t i = 0; i < api_doc[f].count; ++i, e = api_doc.next(e))
         {
-            if (String(embedded_assets[i].path) == withSlash)
-                return &embedded_assets[i];
+            if (!api_doc.number(e, n) || n > 65535)
+                return "invalid 'burst.ports'";
+            if (!b.addPort((uint16_t)n))
+                return "too many 'burst.ports'";
         }
     }
     return nullptr;
 }
 
-// Simple MIME type detection by extension
-static const char* mime_for_path(const String& p)
+// Read the optional "verify" of the target at token `obj`: true to find the machine by
+// its MAC and ping it, or the IP address to ping
+static const char* read_verify(size_t obj, WakeTarget& t)
 {
-    if (p.endsWith(".html") || p.endsWith(".htm"))
-        return "text/html";
-    if (p.endsWith(".js"))
-        return "application/javascript";
-    if (p.endsWith(".css"))
-        return "text/css";
-    if (p.endsWith(".json"))
-        return "application/json";
-    if (p.endsWith(".png"))
-        return "image/png";
-    if (p.endsWith(".jpg") || p.endsWith(".jpeg"))
-        return "image/jpeg";
-    if (p.endsWith(".svg"))
-        return "image/svg+xml";
-    return "text/plain";
+    t.verify   = false;
+    t.verifyIp = IPAddress();
+    size_t v   = api_doc.find(obj, "verify");
+    char   ip[16];
+    if (v == json::Document::NONE || api_doc.is(v, json::Type::Null) ||
+        api_doc.is(v, json::Type::False))
+        return nullptr;
+    if (!api_doc.is(v, json::Type::True) &&
+        (!api_doc.string(v, ip, sizeof(ip)) || !t.verifyIp.fromString(ip)))
+        return "invalid 'verify'";
+    t.verify = true;
+    return nullptr;
 }
 
-// Serve an embedded asset (gzip-aware)
-static void serve_embedded(const char* cpath)
+// How to send and check a wake: the target's "burst" and "verify"
+static const char* read_wake_options(size_t obj, WakeTarget& t)
 {
-    L_INFOF("Serving embedded asset: %s", cpath);
-    const struct asset* a = find_asset(cpath);
-    if (!a)
+    const char* problem = read_burst(obj, t);
+    return problem ? problem : read_verify(obj, t);
+}
+
+// Start checking that the machine woken by `job` comes up, if the target asked for it,
+// and add the verification's id to `w` (null when none could start). The job's wake
+// events then carry its host and verification.
+static void start_verify(json::Writer& w, const WakeTarget& t, uint32_t job,
+                         const uint8_t mac[WakeOnLan::MAC_LEN], uint32_t hostId = 0)
+{
+    uint32_t id = 0;
+    if (t.verify && job)
+    {
+        id = WakeVerifier::start(job, mac, t.verifyIp, hostId);
+        w.key("verify");
+        if (id)
+            w.number(id);
+        else
+            w.null();
+    }
+    WakeEvents::annotate(job, hostId, id);
+}
+
+// "addr:port" of a relay node
+static void format_node(uint32_t addr, uint16_t port, char out[22])
+{
+    char ip[16];
+    format_ip(addr, ip);
+    snprintf(out, 22, "%s:%u", ip, (unsigned)port);
+}
+
+// Add the outcome of a wake handed to the relay node `owner` (relay id `id`, 0 if it
+// could not be sent) to `w`. The owner only acknowledges the wake, so a verification
+// asked for is reported as unsupported rather than left for the client to wait on.
+static void write_relayed(json::Writer& w, const WakeRelay::Peer& owner, uint32_t id,
+                          bool verify)
+{
+    char via[22];
+    format_node(owner.addr, owner.port, via);
+    w.key("status").string(id ? "relayed" : "error");
+    if (id)
+        w.key("relay").number(id).key("via").string(via);
+    if (id && verify)
+        w.key("verify").string("unsupported");
+}
+
+// Read { mac: string, broadcast?: string|null, port?: number, burst?, verify? } at token
+// `obj` (see read_burst and read_verify). Returns nullptr, or what is wrong with it; an
+// unparseable MAC is not an error here (valid is false) so it can be reported per target.
+static const char* read_wake_target(size_t obj, WakeTarget& t)
+{
+    if (!api_doc.is(obj, json::Type::Object))
+        return "expected a JSON object";
+    if (!api_doc.string(api_doc.find(obj, "mac"), t.mac, sizeof(t.mac)) || !t.mac[0])
+        return "missing or invalid 'mac'";
+
+    char   broadcast[16] = "";
+    size_t b             = api_doc.find(obj, "broadcast");
+    if (b != json::Document::NONE && !api_doc.is(b, json::Type::Null) &&
+        !api_doc.string(b, broadcast, sizeof(broadcast)))
+        return "invalid 'broadcast'";
+
+    uint32_t port = 0;
+    size_t   p    = api_doc.find(obj, "port");
+    if (p != json::Document::NONE && (!api_doc.number(p, port) || port > 65535))
+        return "invalid 'port'";
+
+    t.valid = WakeOnLan::parseMac(t.mac, t.bytes);
+    t.dest  = WakeOnLan::resolveBroadcast(broadcast[0] ? broadcast : nullptr);
+    t.port  = (uint16_t)port;
+    if (!t.valid)
+        WakeOnLan::stats().parseFailures.inc();
+    return read_wake_options(obj, t);
+}
+
+// Handler: POST /api/wake — accepts JSON { mac: string, broadcast?: string, port?: number,
+// burst?: "reliable"|object, verify?: true|string }
+void handleApiWake(HttpRequest& req, HttpResponse& res)
+{
+    if (req.method() != HttpMethod::Post)
     {
-        server.send(404, "text/plain", "Not found");
+        res.send(405, "text/plain", "Method Not Allowed");
         return;
     }
+    if (!parse_json_body(req, res))
+        return;
 
-    String      path = String(cpath);
-    const char* mime = mime_for_path(path);
+    WakeTarget  t;
+    const char* problem = read_wake_target(0, t);
+    if (problem)
+    {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "Bad wake request: %s", problem);
+        res.send(400, "text/plain", msg);
+        return;
+    }
+
+    L_INFOF("API WOL request for %s (broadcast=%u.%u.%u.%u)", t.mac, t.dest[0], t.dest[1],
+            t.dest[2], t.dest[3]);
 
-    // Get raw client and write full HTTP response to avoid conflicting headers
-    WiFiClient client = server.client();
-    if (!client || !client.connected())
+    json::Writer w(api_out, sizeof(api_out));
+    if (!t.valid)
     {
-        // fallback to server's send
-        if (a->gz)
-            server.sendHeader("Content-Encoding", "gzip");
-        server.send(200, mime, "");
+        w.beginObject().key("status").string("invalid").key("mac").string(t.mac).endObject();
+        send_json(res, 400, w);
         return;
     }
 
-    // Build and send status + headers
-    client.print("HTTP/1.1 200 OK\r\n");
-    client.print("Content-Type: ");
-    client.print(mime);
-    client.print("\r\n");
-    if (a->gz)
+    // A broadcast into another node's subnet is that node's to send
+    const WakeRelay::Peer* owner = WakeRelay::owner(t.dest);
+    if (owner)
     {
-        client.print("Content-Encoding: gzip\r\n");
+        uint32_t id = WakeRelay::forward(t.bytes, t.dest, t.burst);
+        w.beginObject();
+        write_relayed(w, *owner, id, t.verify);
+        w.key("mac").string(t.mac).endObject();
+        send_json(res, id ? 202 : 503, w);
+        return;
     }
-    client.print("Content-Length: ");
-    client.print((unsigned long)a->len);
-    client.print("\r\n");
-    client.print("Connection: close\r\n");
-    client.print("\r\n");
 
-    // Write raw gzipped bytes
-    client.write(a->data, a->len);
-    client.flush();
-    // close connection
-    client.stop();
+    uint32_t job = WakeQueue::enqueue(t.bytes, t.burst);
+    w.beginObject().key("status").string(job ? "queued" : "error").key("mac").string(t.mac);
+    if (job)
+        w.key("job").number(job).key("transmissions").number((uint32_t)t.burst.transmissions());
+    start_verify(w, t, job, t.bytes);
+    w.endObject();
+    send_json(res, job ? 202 : 503, w);
 }
 
-// Handler: serve root -> redirect to embedded index under /assets/
-void handleRoot()
+static constexpr size_t MAX_BATCH = 32; // targets per /api/wake/batch request
+
+// Handler: POST /api/wake/batch — accepts a JSON array of
+// { mac: string, broadcast?: string, port?: number } and queues one wake job per target.
+// Replies with one result (and job id) per target, in request order.
+void handleApiWakeBatch(HttpRequest& req, HttpResponse& res)
+{
+    if (req.method() != HttpMethod::Post)
+    {
+        res.send(405, "text/plain", "Method Not Allowed");
+        return;
+    }
+    if (!parse_json_body(req, res))
+        return;
+    if (!api_doc.is(0, json::Type::Array))
+    {
+        res.send(400, "text/plain", "Expected a JSON array");
+        return;
+    }
+
+    size_t count = api_doc[0].count;
+    if (count == 0)
+    {
+        res.send(400, "text/plain", "Empty batch");
+        return;
+    }
+    if (count > MAX_BATCH)
+    {
+        res.send(413, "text/plain", "Too many targets in batch");
+        return;
+    }
+
+    static WakeTarget      targets[MAX_BATCH];
+    uint32_t               jobs[MAX_BATCH];
+    const WakeRelay::Peer* owners[MAX_BATCH]; // relay nodes, for relayed targets
+    size_t                 nValid = 0;
+    size_t                 nLocal = 0; // valid targets for the local queue
+    size_t                 entry  = api_doc.child(0);
+    for (size_t i = 0; i < count; ++i, entry = api_doc.next(entry))
+    {
+        const char* problem = read_wake_target(entry, targets[i]);
+        if (problem)
+        {
+            char msg[80];
+            snprintf(msg, sizeof(msg), "Bad batch entry %u: %s", (unsigned)i, problem);
+            res.send(400, "text/plain", msg);
+            return;
+        }
+        const WakeTarget& t = targets[i];
+        owners[i]           = t.valid ? WakeRelay::owner(t.dest) : nullptr;
+        if (t.valid)
+            nValid++;
+        if (t.valid && !owners[i])
+            nLocal++;
+    }
+
+    L_INFOF("API batch WOL request for %u targets", (unsigned)count);
+
+    // All or nothing: a batch whose local targets cannot all be queued is refused.
+    // Relayed ones never touch this queue.
+    if (WakeQueue::capacity() - WakeQueue::depth() < nLocal)
+    {
+        res.send(503, "text/plain", "Wake queue full");
+        return;
+    }
+
+    size_t queued = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const WakeTarget& t = targets[i];
+        if (owners[i])
+            jobs[i] = WakeRelay::forward(t.bytes, t.dest, t.burst);
+        else
+            jobs[i] = t.valid ? WakeQueue::enqueue(t.bytes, t.burst) : 0;
+        if (jobs[i])
+            queued++;
+    }
+
+    json::Writer w(api_out, sizeof(api_out));
+    w.beginObject();
+    w.key("status").string(queued == count ? "queued" : queued ? "partial" : "error");
+    w.key("queued").number((uint32_t)queued);
+    w.key("results").beginArray();
+    for (size_t i = 0; i < count; ++i)
+    {
+        w.beginObject().key("mac").string(targets[i].mac);
+        if (owners[i])
+        {
+            write_relayed(w, *owners[i], jobs[i], targets[i].verify);
+            w.endObject();
+            continue;
+        }
+        w.key("status").string(jobs[i] ? "queued" : targets[i].valid ? "error" : "invalid");
+        if (jobs[i])
+            w.key("job").number(jobs[i]);
+        start_verify(w, targets[i], jobs[i], targets[i].bytes);
+        w.endObject();
+    }
+    w.endArray().endObject();
+
+    if (queued < count)
+        L_WARNINGF("Batch WOL: %u of %u targets queued", (unsigned)queued, (unsigned)count);
+    // 400 only when nothing in the batch was a valid target; valid targets that could
+    // not be queued or forwarded are the device's problem, not the request's
+    send_json(res, queued ? 202 : nValid ? 503 : 400, w);
+}
+
+// Handler: GET /api/wake/status?id=N — state of a queued wake job, and how many of its
+// packets went out or failed so far
+void handleApiWakeStatus(HttpRequest& req, HttpResponse& res)
 {
-    serve_embedded("/index.html");
+    char idArg[12];
+    if (!req.arg("id", idArg, sizeof(idArg)))
+    {
+        res.send(400, "text/plain", "Missing 'id'");
+        return;
+    }
+    uint32_t          id = (uint32_t)strtoul(idArg, nullptr, 10);
+    WakeQueue::Report r;
+    json::Writer      w(api_out, sizeof(api_out));
+    w.beginObject().key("job").number(id);
+    if (!WakeQueue::report(id, r))
+    {
+        w.key("status").string(WakeQueue::stateName(WakeQueue::JobState::Unknown)).endObject();
+        send_json(res, 404, w);
+        return;
+    }
+    w.key("status").string(WakeQueue::stateName(r.state));
+    w.key("transmissions").number(r.planned);
+    w.key("sent").number(r.sent);
+    w.key("failed").number(r.failed);
+    w.endObject();
+    send_json(res, 200, w);
 }
 
-// Handler: /wol?mac=...
-void handleWol()
+// Handler: GET /api/wake/verify?id=N — whether a woken machine came up, and when
+void handleApiWakeVerify(HttpRequest& req, HttpResponse& res)
+{
+    char idArg[12];
+    if (!req.arg("id", idArg, sizeof(idArg)))
+    {
+        res.send(400, "text/plain", "Missing 'id'");
+        return;
+    }
+    uint32_t             id = (uint32_t)strtoul(idArg, nullptr, 10);
+    WakeVerifier::Status st;
+    json::Writer         w(api_out, sizeof(api_out));
+    w.beginObject().key("verify").number(id);
+    if (!WakeVerifier::status(id, st))
+    {
+        w.key("state").string(WakeVerifier::stateName(WakeVerifier::State::Unknown));
+        w.endObject();
+        send_json(res, 404, w);
+        return;
+    }
+    w.key("state").string(WakeVerifier::stateName(st.state));
+    w.key("job").number(st.job);
+    if (st.hostId)
+        w.key("host").number(st.hostId);
+    if ((uint32_t)st.ip)
+    {
+        char ip[16];
+        format_ip((uint32_t)st.ip, ip);
+        w.key("ip").string(ip);
+    }
+    w.key("probes").number(st.probes);
+    w.key(st.state == WakeVerifier::State::Up ? "time_to_wake_ms" : "elapsed_ms")
+        .number(st.elapsedMs);
+    w.endObject();
+    send_json(res, 200, w);
+}
+
+// Handler: GET /api/wol/stats — sender cache counters and send-queue occupancy
+void handleApiWolStats(HttpRequest&, HttpResponse& res)
 {
-    String mac = server.arg("mac");
-    if (mac.length() == 0)
-        mac = String(DEFAULT_MAC_LITERAL);
+    const WakeOnLan::Sender& s = WakeOnLan::sender();
+    json::Writer             w(api_out, sizeof(api_out));
+    w.beginObject();
+    w.key("cache_hits").number(s.cacheHits());
+    w.key("cache_misses").number(s.cacheMisses());
+    w.key("cache_size").number((uint32_t)WakeOnLan::Sender::CACHE_SIZE);
+    w.key("queue_depth").number((uint32_t)WakeQueue::depth());
+    w.key("queue_high_water").number((uint32_t)WakeQueue::highWater());
+    w.key("queue_capacity").number((uint32_t)WakeQueue::capacity());
+    w.key("queue_rejected").number(WakeQueue::rejected());
+    w.key("http_connections_opened").number(server.connectionsOpened());
+    w.key("http_connections_reused").number(server.connectionsReused());
+    w.endObject();
+    send_json(res, 200, w);
+}
 
-    L_INFOF("Received WOL request for %s", mac.c_str());
+// "net/prefix" of a subnet, or null when there is none
+static void write_subnet(json::Writer& w, uint32_t net, uint8_t prefix)
+{
+    char ip[16], subnet[20];
+    format_ip(net, ip);
+    snprintf(subnet, sizeof(subnet), "%s/%u", ip, (unsigned)prefix);
+    if (prefix)
+        w.string(subnet);
+    else
+        w.null();
+}
 
-    bool ok = WakeOnLan::send(mac.c_str());
-    if (ok)
+// Read the optional fields of a POST /api/relay at token `obj` into `c`
+static const char* read_relay_config(size_t obj, WakeRelay::Config& c)
+{
+    if (!api_doc.is(obj, json::Type::Object))
+        return "expected a JSON object";
+    uint32_t n;
+    size_t   f = api_doc.find(obj, "port");
+    if (f != json::Document::NONE)
     {
-        server.send(200, "text/plain", String("Magic packet sent to ") + mac);
-        L_INFOF("Magic packet sent to %s", mac.c_str());
+        if (!api_doc.number(f, n) || n > 65535)
+            return "invalid 'port'";
+        c.port = (uint16_t)n;
     }
-    else
+
+    f = api_doc.find(obj, "key");
+    if (f != json::Document::NONE)
+    {
+        char key[2 * WakeRelay::KEY_LEN + 1];
+        if (!api_doc.string(f, key, sizeof(key)))
+            return "invalid 'key'";
+        if (!key[0])
+            memset(c.key, 0, sizeof(c.key));
+        else if (!WakeRelay::parseKey(key, c.key))
+            return "'key' must be 32 hex digits";
+    }
+
+    f = api_doc.find(obj, "seeds");
+    if (f != json::Document::NONE)
     {
-        server.send(500, "text/plain", String("Failed to send packet to ") + mac);
-        L_ERRORF("Failed to send magic packet to %s", mac.c_str());
+        if (!api_doc.is(f, json::Type::Array))
+            return "invalid 'seeds'";
+        if (api_doc[f].count > RELAY_SEEDS)
+            return "too many 'seeds'";
+        memset(c.seeds, 0, sizeof(c.seeds));
+        size_t e = api_doc.child(f);
+        for (size_t i = 0; i < api_doc[f].count; ++i, e = api_doc.next(e))
+        {
+            // "addr" or "addr:port"
+            char      seed[22];
+            IPAddress ip;
+            char*     colon = nullptr;
+            if (api_doc.string(e, seed, sizeof(seed)))
+                colon = strchr(seed, ':');
+            if (colon)
+                *colon = '\0';
+            unsigned long port = colon ? strtoul(colon + 1, nullptr, 10) : RELAY_PORT;
+            if (!seed[0] || !ip.fromString(seed) || port == 0 || port > 65535)
+                return "invalid 'seeds'";
+            c.seeds[i].addr = (uint32_t)ip;
+            c.seeds[i].port = (uint16_t)port;
+        }
     }
+    return nullptr;
 }
 
-// Handler: POST /api/wake — accepts JSON { mac: string, broadcast?: string }
-void handleApiWake()
+// Handler: /api/relay — GET this node's relay settings, subnet and the nodes it knows;
+// POST { port?, key?, seeds? } changes the settings. The key is never shown.
+void handleApiRelay(HttpRequest& req, HttpResponse& res)
 {
-    if (server.method() != HTTP_POST)
+    if (req.method() == HttpMethod::Post)
     {
-        server.send(405, "text/plain", "Method Not Allowed");
+        if (!parse_json_body(req, res))
+            return;
+        WakeRelay::Config c       = WakeRelay::config();
+        const char*       problem = read_relay_config(0, c);
+        if (problem)
+        {
+            char msg[64];
+            snprintf(msg, sizeof(msg), "Bad relay settings: %s", problem);
+            res.send(400, "text/plain", msg);
+            return;
+        }
+        if (!WakeRelay::configure(c))
+            L_WARNING("Could not save relay settings");
+    }
+
+    const WakeRelay::Config& c     = WakeRelay::config();
+    WakeRelay::Stats&        st    = WakeRelay::stats();
+    uint32_t                 nowMs = millis();
+    char                     node[22];
+    json::Writer             w(api_out, sizeof(api_out));
+    w.beginObject().key("enabled").boolean(WakeRelay::enabled());
+    w.key("port").number(c.port);
+    uint32_t mask = WiFi.status() == WL_CONNECTED ? (uint32_t)WiFi.subnetMask() : 0;
+    write_subnet(w.key("subnet"), (uint32_t)WiFi.localIP() & mask,
+                 (uint8_t)__builtin_popcount(mask));
+    w.key("seeds").beginArray();
+    for (const WakeRelay::Seed& seed : c.seeds)
+    {
+        if (!seed.addr)
+            continue;
+        format_node(seed.addr, seed.port, node);
+        w.string(node);
+    }
+    w.endArray().key("peers").beginArray();
+    for (size_t i = 0; i < RELAY_MAX_PEERS; ++i)
+    {
+        const WakeRelay::Peer& p = WakeRelay::peers()[i];
+        if (!p.addr)
+            continue;
+        format_node(p.addr, p.port, node);
+        w.beginObject().key("node").string(node);
+        write_subnet(w.key("subnet"), p.net, p.prefix);
+        w.key("alive").boolean(WakeRelay::alive(p, nowMs));
+        w.key("heard_ms_ago").number(nowMs - p.heardMs);
+        w.endObject();
+    }
+    w.endArray();
+    w.key("forwarded").number(st.forwarded.get());
+    w.key("accepted").number(st.accepted.get());
+    w.key("rejected").number(st.rejected.get());
+    w.key("failed").number(st.failed.get());
+    w.endObject();
+    send_json(res, 200, w);
+}
+
+// Handler: GET /api/relay/status?id=N — whether the node a wake was relayed to queued it
+void handleApiRelayStatus(HttpRequest& req, HttpResponse& res)
+{
+    char idArg[12];
+    if (!req.arg("id", idArg, sizeof(idArg)))
+    {
+        res.send(400, "text/plain", "Missing 'id'");
+        return;
+    }
+    uint32_t          id = (uint32_t)strtoul(idArg, nullptr, 10);
+    WakeRelay::Status st;
+    json::Writer      w(api_out, sizeof(api_out));
+    w.beginObject().key("relay").number(id);
+    if (!WakeRelay::status(id, st))
+    {
+        w.key("state").string(WakeRelay::stateName(WakeRelay::State::Unknown)).endObject();
+        send_json(res, 404, w);
         return;
     }
+    char via[22];
+    format_node(st.peerAddr, st.peerPort, via);
+    w.key("state").string(WakeRelay::stateName(st.state));
+    w.key("via").string(via);
+    w.key("attempts").number(st.attempts);
+    if (st.state == WakeRelay::State::Queued)
+        w.key("job").number(st.job);
+    w.endObject();
+    send_json(res, 200, w);
+}
+
+static void write_host(json::Writer& w, const HostRegistry::Host& h)
+{
+    char mac[18];
+    char broadcast[16];
+    format_mac(h.mac, mac);
+    format_ip(h.broadcast, broadcast);
+    w.beginObject();
+    w.key("id").number(h.id);
+    w.key("name").string(h.name);
+    w.key("mac").string(mac);
+    w.key("broadcast").string(broadcast);
+    w.key("port").number(h.port ? h.port : WakeOnLan::DEFAULT_PORT);
 
-    String body = server.arg("plain");
-    if (body.length() == 0)
+    // Measured by verified wakes: seconds-bucketed like a Prometheus histogram, but the
+    // counts are per bucket rather than cumulative
+    const WakeVerifier::HostStats* ttw = WakeVerifier::hostStats(h.id);
+    if (ttw)
     {
-        server.send(400, "text/plain", "Empty body");
+        w.key("time_to_wake").beginObject();
+        w.key("count").number(ttw->count).key("timeouts").number(ttw->timeouts);
+        w.key("sum_ms").number(ttw->sumMs).key("max_ms").number(ttw->maxMs);
+        w.key("le_s").beginArray();
+        for (uint16_t bound : WakeVerifier::BOUNDS_S)
+            w.number(bound);
+        w.endArray().key("buckets").beginArray();
+        for (uint16_t n : ttw->buckets)
+            w.number(n);
+        w.endArray().endObject();
+    }
+    w.endObject();
+}
+
+// Tell every open UI the saved hosts changed, so it fetches the list again
+static void publish_hosts_changed(uint32_t id, const char* change)
+{
+    char data[48];
+    snprintf(data, sizeof(data), "{\"id\":%u,\"change\":\"%s\"}", (unsigned)id, change);
+    events.publish("hosts", data);
+}
+
+// Answer a registry change that did not go through
+static void send_registry_error(HttpResponse& res, HostRegistry::Result r)
+{
+    switch (r)
+    {
+        case HostRegistry::Result::NotFound:
+            res.send(404, "text/plain", "No such host");
+            break;
+        case HostRegistry::Result::Full:
+            res.send(507, "text/plain", "Host registry full");
+            break;
+        case HostRegistry::Result::Exists:
+            res.send(409, "text/plain", "Another host has the same MAC, broadcast and port");
+            break;
+        default:
+            res.send(500, "text/plain", "Could not save the host registry");
+            break;
+    }
+}
+
+// Apply { name?, mac?, broadcast?, port? } from the object at the root of api_doc onto
+// `h`. Returns nullptr, or what is wrong with the input.
+static const char* read_host_fields(HostRegistry::Host& h)
+{
+    if (!api_doc.is(0, json::Type::Object))
+        return "expected a JSON object";
+
+    size_t v = api_doc.find(0, "name");
+    if (v != json::Document::NONE && !api_doc.string(v, h.name, sizeof(h.name)))
+        return "invalid or too long 'name'";
+
+    char mac[32];
+    v = api_doc.find(0, "mac");
+    if (v != json::Document::NONE &&
+        (!api_doc.string(v, mac, sizeof(mac)) || !WakeOnLan::parseMac(mac, h.mac)))
+    {
+        WakeOnLan::stats().parseFailures.inc();
+        return "invalid 'mac'";
+    }
+
+    char      broadcast[16];
+    IPAddress ip;
+    v = api_doc.find(0, "broadcast");
+    if (api_doc.is(v, json::Type::Null) || (api_doc.string(v, broadcast, sizeof(broadcast)) &&
+                                            !broadcast[0]))
+        h.broadcast = (uint32_t)WakeOnLan::resolveBroadcast(nullptr);
+    else if (v != json::Document::NONE)
+    {
+        if (!api_doc.string(v, broadcast, sizeof(broadcast)) || !ip.fromString(broadcast))
+            return "invalid 'broadcast'";
+        h.broadcast = (uint32_t)ip;
+    }
+
+    uint32_t port = h.port;
+    v             = api_doc.find(0, "port");
+    if (v != json::Document::NONE && (!api_doc.number(v, port) || port > 65535))
+        return "invalid 'port'";
+    h.port = (uint16_t)port;
+    return nullptr;
+}
+
+static constexpr uint8_t LIST_STREAM_OPEN = 0x01; // '[' is out
+static constexpr uint8_t LIST_STREAM_ITEM = 0x02; // an entry is out, so the next needs a comma
+
+// Stream fill for a JSON array of table entries (hosts, schedules): renders one after
+// another straight into the response buffer, so the list is not limited by its size.
+// The cursor is a table slot, as taken by Next.
+template <typename T, const T* (*Next)(uint32_t&), void (*Write)(json::Writer&, const T&)>
+static size_t fill_list(HttpResponse::Stream& st, char* buf, size_t cap, uint32_t, bool& done)
+{
+    size_t pos = 0;
+    if (!(st.flags & LIST_STREAM_OPEN))
+    {
+        buf[pos++] = '[';
+        st.flags |= LIST_STREAM_OPEN;
+    }
+    uint32_t cursor = st.cursor;
+    const T* item;
+    while ((item = Next(cursor)))
+    {
+        // The comma goes in only once the entry is known to fit after it
+        size_t lead = (st.flags & LIST_STREAM_ITEM) ? 1 : 0;
+        if (cap - pos <= lead)
+            break;
+        json::Writer w(buf + pos + lead, cap - pos - lead);
+        Write(w, *item);
+        if (!w.ok())
+            break;
+        if (lead)
+            buf[pos] = ',';
+        pos += lead + w.length();
+        st.flags |= LIST_STREAM_ITEM;
+        st.cursor = cursor;
+    }
+    if (!item && pos < cap)
+    {
+        buf[pos++] = ']';
+        done       = true;
+    }
+    return pos;
+}
+
+// Handler: /api/hosts — GET lists the saved hosts, POST saves a new one from
+// { name?, mac, broadcast?, port? } and answers with it (including its id). A target
+// that is already saved is answered with the existing host and 200 instead of 201.
+void handleApiHosts(HttpRequest& req, HttpResponse& res)
+{
+    if (req.method() == HttpMethod::Get || req.method() == HttpMethod::Head)
+    {
+        res.sendHeader("Cache-Control", "no-store");
+        res.sendStream(200, "application/json",
+                       fill_list<HostRegistry::Host, HostRegistry::next, write_host>, 0);
         return;
     }
 
-    // Very small JSON parsing — look for "mac" and "broadcast" values.
-    // This avoids pulling in a heavy JSON library on the ESP.
-    auto extract = [](const String& s, const char* key) -> String
+    if (!parse_json_body(req, res))
+        return;
+    HostRegistry::Host h = {};
+    h.broadcast          = (uint32_t)WakeOnLan::resolveBroadcast(nullptr);
+    const char* problem  = api_doc.find(0, "mac") == json::Document::NONE
+                               ? "missing 'mac'"
+                               : read_host_fields(h);
+    if (problem)
     {
-        String k   = String("\"") + key + String("\"") + String(":");
-        int    idx = s.indexOf(k);
-        if (idx < 0)
-            return String();
-        idx += k.length();
-        // skip whitespace
-        while (idx < s.length() && isWhitespace(s[idx]))
-            idx++;
-        // Accept string value or bareword
-        if (s[idx] == '"')
+        char msg[64];
+        snprintf(msg, sizeof(msg), "Bad host: %s", problem);
+        res.send(400, "text/plain", msg);
+        return;
+    }
+
+    uint32_t             id;
+    HostRegistry::Result r = HostRegistry::add(h.name, h.mac, IPAddress(h.broadcast), h.port, id);
+    if (r != HostRegistry::Result::Ok && r != HostRegistry::Result::Exists)
+    {
+        send_registry_error(res, r);
+        return;
+    }
+    if (r == HostRegistry::Result::Ok)
+    {
+        L_INFOF("Saved host %u '%s'", (unsigned)id, h.name);
+        publish_hosts_changed(id, "added");
+    }
+    json::Writer w(api_out, sizeof(api_out));
+    write_host(w, *HostRegistry::find(id));
+    send_json(res, r == HostRegistry::Result::Ok ? 201 : 200, w);
+}
+
+// Handler: /api/hosts/{id} — GET one host, PUT changes the fields given, DELETE removes
+// it. POST /api/hosts/{id}/wake queues its prebuilt magic packet: no parsing at all,
+// unless a body gives a { burst } as /api/wake takes.
+void handleApiHost(HttpRequest& req, HttpResponse& res)
+{
+    const char* rest = req.path() + strlen("/api/hosts/");
+    char*       end;
+    uint32_t    id   = (uint32_t)strtoul(rest, &end, 10);
+    bool        wake = strcmp(end, "/wake") == 0;
+    if (end == rest || (*end && !wake))
+    {
+        res.send(404, "text/plain", "Not found");
+        return;
+    }
+    const HostRegistry::Host* h = HostRegistry::find(id);
+    if (!h)
+    {
+        send_registry_error(res, HostRegistry::Result::NotFound);
+        return;
+    }
+
+    HttpMethod   method = req.method();
+    json::Writer w(api_out, sizeof(api_out));
+    if (wake)
+    {
+        if (method != HttpMethod::Post)
         {
-            idx++;
-            int end = s.indexOf('"', idx);
-            if (end < 0)
-                return String();
-            return s.substring(idx, end);
+            res.send(405, "text/plain", "Method Not Allowed");
+            return;
         }
-        // bare token until comma or brace
-        int end = idx;
-        while (end < s.length() && s[end] != ',' && s[end] != '}' && s[end] != '\n' &&
-               s[end] != '\r')
-            end++;
-        String token = s.substring(idx, end);
-        token.trim();
-        return token;
-    };
+        WakeTarget t = {};
+        t.dest       = IPAddress(h->broadcast);
+        t.port       = h->port;
+        t.burst      = WakeQueue::Burst::single(t.dest, t.port);
+        if (req.bodyLength())
+        {
+            if (!parse_json_body(req, res))
+                return;
+            const char* problem = api_doc.is(0, json::Type::Object) ? read_wake_options(0, t)
+                                                                    : "expected a JSON object";
+            if (problem)
+            {
+                char msg[64];
+                snprintf(msg, sizeof(msg), "Bad wake request: %s", problem);
+                res.send(400, "text/plain", msg);
+                return;
+            }
+        }
+        const WakeRelay::Peer* owner = WakeRelay::owner(t.dest);
+        if (owner)
+        {
+            uint32_t relay = WakeRelay::forward(h->mac, t.dest, t.burst);
+            w.beginObject();
+            write_relayed(w, *owner, relay, t.verify);
+            w.key("id").number(id).endObject();
+            send_json(res, relay ? 202 : 503, w);
+            return;
+        }
+        uint32_t job = WakeQueue::enqueue(h->mac, t.burst, h->packet);
+        w.beginObject().key("status").string(job ? "queued" : "error").key("id").number(id);
+        if (job)
+            w.key("job").number(job).key("transmissions").number((uint32_t)t.burst.transmissions());
+        start_verify(w, t, job, h->mac, id);
+        w.endObject();
+        send_json(res, job ? 202 : 503, w);
+        return;
+    }
 
-    String mac       = extract(body, "mac");
-    String broadcast = extract(body, "broadcast");
+    if (method == HttpMethod::Get || method == HttpMethod::Head)
+    {
+        write_host(w, *h);
+        send_json(res, 200, w);
+    }
+    else if (method == HttpMethod::Put)
+    {
+        if (!parse_json_body(req, res))
+            return;
+        HostRegistry::Host changed = *h;
+        const char*        problem = read_host_fields(changed);
+        if (problem)
+        {
+            char msg[64];
+            snprintf(msg, sizeof(msg), "Bad host: %s", problem);
+            res.send(400, "text/plain", msg);
+            return;
+        }
+        HostRegistry::Result r = HostRegistry::update(
+            id, changed.name, changed.mac, IPAddress(changed.broadcast), changed.port);
+        if (r != HostRegistry::Result::Ok)
+        {
+            send_registry_error(res, r);
+            return;
+        }
+        publish_hosts_changed(id, "updated");
+        write_host(w, *h);
+        send_json(res, 200, w);
+    }
+    else if (method == HttpMethod::Delete)
+    {
+        HostRegistry::Result r = HostRegistry::remove(id);
+        if (r != HostRegistry::Result::Ok)
+        {
+            send_registry_error(res, r);
+            return;
+        }
+        publish_hosts_changed(id, "removed");
+        res.send(204, "text/plain", "");
+    }
+    else
+    {
+        res.send(405, "text/plain", "Method Not Allowed");
+    }
+}
 
-    if (mac.length() == 0)
+static void write_schedule(json::Writer& w, const Scheduler::Schedule& s)
+{
+    w.beginObject();
+    w.key("id").number(s.id);
+    w.key("name").string(s.name);
+    if (s.cron[0])
+        w.key("cron").string(s.cron);
+    else
+        w.key("at").number(s.at);
+    if (s.hostId)
+    {
+        w.key("host").number(s.hostId);
+    }
+    else
     {
-        server.send(400, "text/plain", "Missing 'mac' in JSON body");
+        char mac[18];
+        char broadcast[16];
+        format_mac(s.mac, mac);
+        format_ip(s.broadcast, broadcast);
+        w.key("mac").string(mac);
+        w.key("broadcast").string(broadcast);
+        w.key("port").number(s.port ? s.port : WakeOnLan::DEFAULT_PORT);
+    }
+    w.key("next");
+    if (s.next)
+        w.number(s.next);
+    else
+        w.null();
+    if (s.lastJob)
+        w.key("last_job").number(s.lastJob);
+    w.endObject();
+}
+
+static void send_schedule_error(HttpResponse& res, Scheduler::Result r)
+{
+    switch (r)
+    {
+        case Scheduler::Result::NotFound:
+            res.send(404, "text/plain", "No such schedule");
+            break;
+        case Scheduler::Result::Full:
+            res.send(507, "text/plain", "Schedule table full");
+            break;
+        default:
+            res.send(500, "text/plain", "Could not save the schedules");
+            break;
+    }
+}
+
+// Read { name?, cron | at, host | mac, broadcast?, port? } from the object at the root of
+// api_doc into `s`. Returns nullptr, or what is wrong with the input.
+static const char* read_schedule(Scheduler::Schedule& s)
+{
+    // The target fields are the same as a saved host's
+    HostRegistry::Host h = {};
+    h.broadcast          = (uint32_t)WakeOnLan::resolveBroadcast(nullptr);
+    const char* problem  = read_host_fields(h);
+    if (problem)
+        return problem;
+    memcpy(s.name, h.name, sizeof(s.name));
+
+    size_t   cron = api_doc.find(0, "cron");
+    size_t   at   = api_doc.find(0, "at");
+    CronExpr expr;
+    if ((cron == json::Document::NONE) == (at == json::Document::NONE))
+        return "give one of 'cron' and 'at'";
+    if (cron != json::Document::NONE &&
+        (!api_doc.string(cron, s.cron, sizeof(s.cron)) || !CronExpr::parse(s.cron, expr)))
+        return "invalid 'cron'";
+    if (at != json::Document::NONE && (!api_doc.number(at, s.at) || s.at == 0))
+        return "invalid 'at'";
+    if (s.at && Scheduler::now() && s.at < Scheduler::now())
+        return "'at' is in the past";
+
+    size_t host = api_doc.find(0, "host");
+    if (host != json::Document::NONE)
+    {
+        if (!api_doc.number(host, s.hostId) || !HostRegistry::find(s.hostId))
+            return "no such 'host'";
+        return nullptr;
+    }
+    if (api_doc.find(0, "mac") == json::Document::NONE)
+        return "give one of 'host' and 'mac'";
+    memcpy(s.mac, h.mac, sizeof(s.mac));
+    s.broadcast = h.broadcast;
+    s.port      = h.port;
+    return nullptr;
+}
+
+// Handler: /api/schedules — GET lists the schedules, POST adds one (see read_schedule())
+// and answers with it, including its id and next wake
+void handleApiSchedules(HttpRequest& req, HttpResponse& res)
+{
+    if (req.method() == HttpMethod::Get || req.method() == HttpMethod::Head)
+    {
+        res.sendHeader("Cache-Control", "no-store");
+        res.sendStream(200, "application/json",
+                       fill_list<Scheduler::Schedule, Scheduler::next, write_schedule>, 0);
         return;
     }
 
-    L_INFOF("API WOL request for %s (broadcast=%s)", mac.c_str(), broadcast.c_str());
+    if (!parse_json_body(req, res))
+        return;
+    Scheduler::Schedule s       = {};
+    const char*         problem = api_doc.is(0, json::Type::Object) ? read_schedule(s)
+                                                                    : "expected a JSON object";
+    if (problem)
+    {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "Bad schedule: %s", problem);
+        res.send(400, "text/plain", msg);
+        return;
+    }
 
-    bool ok;
-    if (broadcast.length())
-        ok = WakeOnLan::send(mac.c_str(), broadcast.c_str());
+    uint32_t          id;
+    Scheduler::Result r = Scheduler::add(s, id);
+    if (r != Scheduler::Result::Ok)
+    {
+        send_schedule_error(res, r);
+        return;
+    }
+    L_INFOF("Added schedule %u '%s'", (unsigned)id, s.cron[0] ? s.cron : "once");
+    const Scheduler::Schedule* added = Scheduler::find(id);
+    json::Writer               w(api_out, sizeof(api_out));
+    if (added)
+        write_schedule(w, *added);
     else
-        ok = WakeOnLan::send(mac.c_str());
+        w.beginObject().key("id").number(id).key("next").null().endObject(); // already due
+    send_json(res, 201, w);
+}
 
-    if (ok)
+// Handler: /api/schedules/{id} — GET one schedule, DELETE removes it
+void handleApiSchedule(HttpRequest& req, HttpResponse& res)
+{
+    const char* rest = req.path() + strlen("/api/schedules/");
+    char*       end;
+    uint32_t    id   = (uint32_t)strtoul(rest, &end, 10);
+    if (end == rest || *end)
     {
-        server.send(200, "application/json", String("{\"status\":\"ok\",\"mac\":\"") + mac + "\"}");
+        res.send(404, "text/plain", "Not found");
+        return;
+    }
+    const Scheduler::Schedule* s = Scheduler::find(id);
+    if (!s)
+    {
+        send_schedule_error(res, Scheduler::Result::NotFound);
+        return;
+    }
+
+    HttpMethod method = req.method();
+    if (method == HttpMethod::Get || method == HttpMethod::Head)
+    {
+        json::Writer w(api_out, sizeof(api_out));
+        write_schedule(w, *s);
+        send_json(res, 200, w);
+    }
+    else if (method == HttpMethod::Delete)
+    {
+        Scheduler::Result r = Scheduler::remove(id);
+        if (r != Scheduler::Result::Ok)
+            send_schedule_error(res, r);
+        else
+            res.send(204, "text/plain", "");
     }
     else
     {
-        server.send(500, "application/json",
-                    String("{\"status\":\"error\",\"mac\":\"") + mac + "\"}");
+        res.send(405, "text/plain", "Method Not Allowed");
     }
 }
 
+// Handler: /api/time — GET the scheduler's clock, POST { epoch?, tz? } sets the time
+// (until NTP syncs) and/or the POSIX time zone cron expressions are read in
+void handleApiTime(HttpRequest& req, HttpResponse& res)
+{
+    if (req.method() == HttpMethod::Post)
+    {
+        if (!parse_json_body(req, res))
+            return;
+        uint32_t epoch = 0;
+        char     tz[64];
+        size_t   e     = api_doc.find(0, "epoch");
+        size_t   z     = api_doc.find(0, "tz");
+        if (e != json::Document::NONE && (!api_doc.number(e, epoch) || epoch == 0))
+        {
+            res.send(400, "text/plain", "Bad time: invalid 'epoch'");
+            return;
+        }
+        if (z != json::Document::NONE && (!api_doc.string(z, tz, sizeof(tz)) || !tz[0]))
+        {
+            res.send(400, "text/plain", "Bad time: invalid 'tz'");
+            return;
+        }
+        if (z != json::Document::NONE && !Scheduler::setTimezone(tz))
+        {
+            res.send(500, "text/plain", "Could not save the time zone");
+            return;
+        }
+        if (epoch)
+        {
+            Scheduler::setTime(epoch);
+            L_INFOF("Clock set to %u", (unsigned)epoch);
+        }
+    }
+
+    uint32_t     now = Scheduler::now();
+    json::Writer w(api_out, sizeof(api_out));
+    w.beginObject().key("epoch");
+    if (now)
+        w.number(now);
+    else
+        w.null();
+    w.key("source").string(Scheduler::timeSourceName(Scheduler::timeSource()));
+    w.key("tz").string(Scheduler::timezone());
+    w.endObject();
+    send_json(res, 200, w);
+}
+
+// A histogram bucket bound; null for the overflow bucket
+static void write_bound(json::Writer& w, uint32_t us)
+{
+    if (us == UINT32_MAX)
+        w.null();
+    else
+        w.number(us);
+}
+
+// Handler: /api/power — GET the power profile and what each profile has measured, POST
+// { profile } switches to another
+void handleApiPower(HttpRequest& req, HttpResponse& res)
+{
+    if (req.method() == HttpMethod::Post)
+    {
+        if (!parse_json_body(req, res))
+            return;
+        char                  name[16];
+        PowerManager::Profile profile;
+        size_t                p = api_doc.find(0, "profile");
+        if (p == json::Document::NONE || !api_doc.string(p, name, sizeof(name)) ||
+            !PowerManager::parseProfile(name, profile))
+        {
+            res.send(400, "text/plain",
+                     "Bad power profile: 'profile' must be low-latency, balanced or low-power");
+            return;
+        }
+        if (!PowerManager::setProfile(profile))
+            L_WARNINGF("Could not save power profile %s", name);
+    }
+
+    json::Writer w(api_out, sizeof(api_out));
+    w.beginObject().key("profile").string(PowerManager::profileName(PowerManager::profile()));
+    w.key("cpu_mhz").number(getCpuFrequencyMhz());
+    w.key("clock_scaling").boolean(PowerManager::clockScaling());
+    w.key("light_sleep").boolean(PowerManager::lightSleep());
+    w.key("profiles").beginArray();
+    for (size_t i = 0; i < PowerManager::PROFILES; ++i)
+    {
+        PowerManager::Profile      profile = (PowerManager::Profile)i;
+        const PowerManager::Usage& u       = PowerManager::usage(profile);
+        const metrics::Histogram&  lat     = PowerManager::latency(profile);
+        w.beginObject().key("name").string(PowerManager::profileName(profile));
+        w.key("requests").number(lat.count());
+        write_bound(w.key("latency_p50_us"), lat.quantileBound(0.5f));
+        write_bound(w.key("latency_p99_us"), lat.quantileBound(0.99f));
+        w.key("active_ms").number((uint32_t)(u.activeUs / 1000));
+        w.key("idle_ms").number((uint32_t)(u.idleUs / 1000));
+        w.key("estimated_ua").number(PowerManager::estimatedCurrentUa(profile));
+        w.endObject();
+    }
+    w.endArray().endObject();
+    send_json(res, 200, w);
+}
+
+// Live tails of the log (/api/logs?follow=1), off the server's connection slots
+static LogTail log_tail(logger::readHistory);
+
+// Stream fill for /api/logs: copies history lines, as "<seq> <line>\n", straight into the
+// response buffer and ends once caught up
+static size_t fill_logs(HttpResponse::Stream& st, char* buf, size_t cap, uint32_t,
+                        bool& done)
+{
+    const size_t prefix = 11;
+    size_t       pos    = 0;
+    while (cap - pos > prefix + 1)
+    {
+        // Copy the text past room for the prefix, then slide it up behind the prefix
+        size_t   len = 0;
+        char*    at  = buf + pos;
+        uint32_t seq = logger::readHistory(st.cursor, at + prefix, cap - pos - prefix - 1, len);
+        if (seq == 0)
+            break;
+        char lead[12];
+        int  p = snprintf(lead, sizeof(lead), "%u ", (unsigned)seq);
+        memmove(at + p, at + prefix, len);
+        memcpy(at, lead, (size_t)p);
+        for (char* c = at + p; c < at + p + len; ++c)
+            if (*c == '\n' || *c == '\r')
+                *c = ' '; // one record, one line
+        pos += (size_t)p + len;
+        buf[pos++] = '\n';
+        st.cursor  = seq;
+    }
+    done = st.cursor >= logger::historyHead();
+    return pos;
+}
+
+static bool adopt_log_tail(int fd, uint32_t after)
+{
+    return log_tail.adopt(fd, after, millis());
+}
+
+// Handler: GET /api/logs[?since=N][&follow=1] — recent log lines from the RAM history.
+// With follow=1 (or Accept: text/event-stream) the socket leaves the server for a live
+// SSE tail, freeing its connection slot.
+void handleApiLogs(HttpRequest& req, HttpResponse& res)
+{
+    char     arg[12];
+    uint32_t since = 0;
+    if (req.arg("since", arg, sizeof(arg)))
+        since = (uint32_t)strtoul(arg, nullptr, 10);
+
+    const char* accept    = req.header("Accept");
+    const char* lastEvent = req.header("Last-Event-ID");
+    bool        sse       = (req.arg("follow", arg, sizeof(arg)) && strcmp(arg, "0") != 0) ||
+                            (accept && strstr(accept, "text/event-stream"));
+    if (sse && lastEvent)
+        since = (uint32_t)strtoul(lastEvent, nullptr, 10); // EventSource reconnecting
+
+    if (sse && log_tail.subscribers() >= LOG_TAIL_MAX_SUBSCRIBERS)
+    {
+        res.send(503, "text/plain", "Too many log tails");
+        return;
+    }
+    res.sendHeader("Cache-Control", "no-store");
+    if (sse)
+        res.sendHandOff(200, "text/event-stream", adopt_log_tail, since);
+    else
+        res.sendStream(200, "text/plain; charset=utf-8", fill_logs, since);
+}
+
+// Device status pushed to /api/events subscribers this often, and to each on connecting
+#ifndef EVENTS_STATUS_MS
+#define EVENTS_STATUS_MS 10000
+#endif
+
+static void publish_status()
+{
+    char         data[EVENTS_MAX_LEN];
+    json::Writer w(data, sizeof(data));
+    w.beginObject().key("uptime_s").number(millis() / 1000);
+    w.key("heap_free").number(ESP.getFreeHeap());
+    w.key("wifi").string(WifiLink::stateName(WifiLink::state()));
+    w.key("power").string(PowerManager::profileName(PowerManager::profile()));
+    w.key("queue").number((uint32_t)WakeQueue::depth());
+    w.key("clients").number((uint32_t)events.subscribers());
+    w.endObject();
+    if (w.ok())
+        events.publish("status", data);
+}
+
+// Set when a subscriber joins: it gets the status with the next poll, together with
+// any others joining meanwhile
+static bool status_due = false;
+
+// Publish what changed and write it out to the subscribers
+static void poll_events(uint32_t nowMs)
+{
+    static uint32_t lastStatusMs = 0;
+    WakeEvents::poll(nowMs);
+    if (events.subscribers() && (status_due || nowMs - lastStatusMs >= EVENTS_STATUS_MS))
+    {
+        status_due = false;
+        publish_status();
+        lastStatusMs = nowMs;
+    }
+    events.poll(nowMs);
+}
+
+static bool adopt_subscriber(int fd, uint32_t lastEventId)
+{
+    if (!events.adopt(fd, lastEventId, millis()))
+        return false;
+    status_due = true;
+    return true;
+}
+
+// Handler: GET /api/events — Server-Sent Events: "wake" (job progress, see WakeEvents),
+// "status" (device status) and "hosts" (the saved hosts changed). Once the headers are
+// out the socket leaves the server for the event stream, freeing its connection slot.
+void handleApiEvents(HttpRequest& req, HttpResponse& res)
+{
+    if (events.subscribers() >= EVENTS_MAX_SUBSCRIBERS)
+    {
+        res.send(503, "text/plain", "Too many event subscribers");
+        return;
+    }
+    const char* lastEvent = req.header("Last-Event-ID");
+    res.sendHeader("Cache-Control", "no-store");
+    res.sendHandOff(200, "text/event-stream", adopt_subscriber,
+                    lastEvent ? (uint32_t)strtoul(lastEvent, nullptr, 10) : 0);
+}
+
+static metrics::Histogram loop_time;
+
+// Stream fill for /api/metrics: the registry renders straight into the response buffer
+static size_t fill_metrics(HttpResponse::Stream& st, char* buf, size_t cap, uint32_t,
+                           bool& done)
+{
+    return metrics::render(st.cursor, buf, cap, done);
+}
+
+// Handler: GET /api/metrics — Prometheus text exposition of every registered metric
+void handleApiMetrics(HttpRequest&, HttpResponse& res)
+{
+    res.sendHeader("Cache-Control", "no-store");
+    res.sendStream(200, "text/plain; version=0.0.4", fill_metrics, 0);
+}
+
+// Everything on /api/metrics apart from the per-route latencies, which the server adds
+static void register_metrics()
+{
+    WakeOnLan::Stats& wol      = WakeOnLan::stats();
+    const char*       failures = "Magic packet sends that failed, by cause.";
+    metrics::add("wol_packets_sent_total", "Magic packets handed to the network.", wol.sent);
+    metrics::add("wol_send_failures_total", failures, wol.parseFailures, "cause", "parse");
+    metrics::add("wol_send_failures_total", failures, wol.socketFailures, "cause", "udp_begin");
+    metrics::add("wol_send_failures_total", failures, wol.sendFailures, "cause", "end_packet");
+    metrics::addCounter("wol_verify_up_total", "Verified wakes whose machine answered.",
+                        [] { return WakeVerifier::upCount(); });
+    metrics::addCounter("wol_verify_timeouts_total",
+                        "Verified wakes whose machine never answered.",
+                        [] { return WakeVerifier::timeoutCount(); });
+    WakeRelay::Stats& relay = WakeRelay::stats();
+    const char*       wakes = "Wakes relayed between nodes, by direction.";
+    metrics::add("relay_wakes_total", wakes, relay.forwarded, "direction", "out");
+    metrics::add("relay_wakes_total", wakes, relay.accepted, "direction", "in");
+    metrics::add("relay_rejected_total",
+                 "Relay datagrams dropped: bad tag, unknown sender or replayed.", relay.rejected);
+    metrics::add("relay_failed_total", "Relayed wakes never acknowledged.", relay.failed);
+    metrics::addGauge("relay_peers", "Relay nodes heard from recently.",
+                      [] { return WakeRelay::livePeers(); });
+    metrics::addCounter("http_connections_opened_total", "TCP connections accepted.",
+                        [] { return server.connectionsOpened(); });
+    metrics::addCounter("http_connections_reused_total",
+                        "Requests served on an already open connection.",
+                        [] { return server.connectionsReused(); });
+    const char* shed = "Requests refused before reaching a handler, by reason.";
+    metrics::add("http_shed_total", shed, limiter.shed(RateLimiter::Class::Api), "reason",
+                 "rate_api");
+    metrics::add("http_shed_total", shed, limiter.shed(RateLimiter::Class::Asset), "reason",
+                 "rate_asset");
+    metrics::add("http_shed_total", shed, server.shedBusy(), "reason", "busy");
+    metrics::addGauge("events_subscribers", "Open /api/events connections.",
+                      [] { return (uint32_t)events.subscribers(); });
+    metrics::addCounter("events_lagged_total",
+                        "Event subscribers closed for falling a whole ring behind.",
+                        [] { return events.lagged(); });
+    metrics::addGauge("heap_free_bytes", "Free heap.", [] { return ESP.getFreeHeap(); });
+    metrics::addGauge("heap_min_free_bytes", "Lowest free heap since boot.",
+                      [] { return ESP.getMinFreeHeap(); });
+    metrics::addGauge("heap_largest_free_block_bytes", "Largest allocatable heap block.",
+                      [] { return (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT); });
+    metrics::addGauge("boot_to_first_request_milliseconds",
+                      "Uptime when the first HTTP request was served, 0 before then.",
+                      [] { return server.firstRequestMs(); });
+    metrics::addGauge("wifi_connected_milliseconds",
+                      "Uptime when the station first got its address, 0 before then.",
+                      [] { return WifiLink::connectedAtMs(); });
+    metrics::addGauge("wifi_fast_connect",
+                      "1 if that connection used the cached BSSID and channel.",
+                      [] { return (uint32_t)WifiLink::fastConnected(); });
+    metrics::add("loop_duration_seconds", "Time spent in one loop() iteration.", loop_time);
+}
+
+// Open the listening socket once the network interface is up
+static void start_http_server(const char* mode)
+{
+    if (server.begin())
+        L_INFOF("HTTP server started (%s)", mode);
+    else
+        L_ERRORF("Failed to start HTTP server (%s)", mode);
+}
+
 // Start WiFi (AP or CONNECT) and HTTP server
 void startWebServer()
 {
     server.on("/", handleRoot);
     server.on("/wol", handleWol);
-    server.on("/api/wake", HTTP_POST, handleApiWake);
+    server.on("/api/wake", HttpMethod::Post, handleApiWake);
+    server.on("/api/wake/batch", HttpMethod::Post, handleApiWakeBatch);
+    server.on("/api/wake/status", HttpMethod::Get, handleApiWakeStatus);
+    server.on("/api/wake/verify", HttpMethod::Get, handleApiWakeVerify);
+    server.on("/api/wol/stats", HttpMethod::Get, handleApiWolStats);
+    server.on("/api/relay", HttpMethod::Get | HttpMethod::Post, handleApiRelay);
+    server.on("/api/relay/status", HttpMethod::Get, handleApiRelayStatus);
+    server.on("/api/hosts", HttpMethod::Get | HttpMethod::Post, handleApiHosts);
+    server.on("/api/hosts/*", handleApiHost);
+    server.on("/api/schedules", HttpMethod::Get | HttpMethod::Post, handleApiSchedules);
+    server.on("/api/schedules/*", handleApiSchedule);
+    server.on("/api/time", HttpMethod::Get | HttpMethod::Post, handleApiTime);
+    server.on("/api/power", HttpMethod::Get | HttpMethod::Post, handleApiPower);
+    server.on("/api/logs", HttpMethod::Get, handleApiLogs);
+    server.on("/api/events", HttpMethod::Get, handleApiEvents);
+    server.on("/api/metrics", HttpMethod::Get, handleApiMetrics);
     server.on("/api/version",
-              []()
-              {
-                  String v = firmware_version_raw;
-                  server.send(200, "text/plain", v);
-              });
+              [](HttpRequest&, HttpResponse& res)
+              { res.send(200, "text/plain", firmware_version_raw); });
+    server.onServed(PowerManager::observeRequest);
+    if (RATE_LIMIT)
+        server.onAdmit(admit_request);
     // Serve any /assets/* requests from embedded assets; fall back to 404
     server.onNotFound(
-        []()
+        [](HttpRequest& req, HttpResponse& res)
         {
-            String uri = server.uri();
+            const char* uri = req.path();
             // ensure paths under /assets/ are served
-            if (uri == "/")
+            if (strcmp(uri, "/") == 0)
             {
-                serve_embedded("/index.html");
+                serve_embedded(req, res, "/index.html");
                 return;
             }
-            if (uri.startsWith("/assets/"))
+            if (strncmp(uri, "/assets/", 8) == 0)
             {
                 // strip '/assets' prefix
-                String assetPath = uri.substring(8); // 8 = length of "/assets/"
-                serve_embedded(assetPath.c_str());
+                serve_embedded(req, res, uri + 7); // 7 = length of "/assets", keeps the '/'
                 return;
             }
             // Not an asset -> default 404
-            server.send(404, "text/plain", "Not found");
+            res.send(404, "text/plain", "Not found");
         });
 
     // Decide mode based on runtime wlan_mode_raw string. Accepts: CONNECT or AP or numeric '2'/'1'.
     bool want_connect = false;
     if (wlan_mode_raw[0] == 'C' || wlan_mode_raw[0] == 'c' || wlan_mode_raw[0] == '2')
         want_connect = true;
-    if (want_connect)
-    {
-        // Attempt to connect as station
-        const char* ssid = get_wlan_ssid();
-        const char* psk  = get_wlan_psk();
-        L_INFOF("Attempting to connect to SSID '%s'", ssid);
-        WiFi.mode(WIFI_STA);
-        WiFi.begin(ssid, psk);
-
-        const unsigned long CONNECT_TIMEOUT_MS = 20000UL; // 20s
-        unsigned long       start              = millis();
-        while (WiFi.status() != WL_CONNECTED && (millis() - start) < CONNECT_TIMEOUT_MS)
-        {
-            delay(200);
-        }
-
-        if (WiFi.status() == WL_CONNECTED)
-        {
-            L_INFOF("Connected to SSID '%s' IP %s", ssid, WiFi.localIP().toString().c_str());
-            server.begin();
-            L_INFO("HTTP server started (STA)");
-            return;
-        }
-        else
-        {
-            L_WARNINGF("Failed to connect to '%s' within timeout; falling back to AP mode", ssid);
-            // fallthrough to AP mode
-        }
-    }
-
-    // Start AP mode
-    WiFi.mode(WIFI_AP);
-    const char* ap_ssid   = get_wlan_ssid();
-    const char* ap_psk    = get_wlan_psk();
-    bool        apStarted = WiFi.softAP(ap_ssid, ap_psk);
-    if (!apStarted)
-    {
-        L_ERROR("Failed to start WiFi AP");
-        return;
-    }
-    IPAddress ip = WiFi.softAPIP();
-    L_INFOF("Started AP '%s' at %s", ap_ssid, ip.toString().c_str());
-
-    server.begin();
-    L_INFO("HTTP server started (AP)");
+    // The station associates in the background (the AP, if any, serves meanwhile), so the
+    // server can listen at once
+    if (want_connect && sta_ap_ssid)
+        WifiLink::begin(get_wlan_ssid(), get_wlan_psk(), sta_ap_ssid, sta_ap_psk);
+    else if (want_connect)
+        WifiLink::begin(get_wlan_ssid(), get_wlan_psk(), get_wlan_ssid(), get_wlan_psk(),
+                        false);
+    else
+        WifiLink::begin(nullptr, nullptr, get_wlan_ssid(), get_wlan_psk());
+    start_http_server(!want_connect ? "AP" : sta_ap_ssid ? "AP+STA" : "STA");
 }
 
 void setup()
 {
     Serial.begin(SERIAL_BAUD_RATE);
+    logger::begin();
     pinMode(LED_BUILTIN, OUTPUT);
     delay(100);
+    WakeQueue::begin();
+    HostRegistry::begin();
+    Scheduler::begin();
+    register_metrics();
     startWebServer();
+    WakeRelay::begin();
+    PowerManager::begin();
+    WakeEvents::begin(events);
 }
 
 void loop()
 {
-    server.handleClient();
+    uint32_t start = micros();
+    server.poll(millis());
+    WifiLink::poll(millis());
+    Scheduler::poll(millis());
+    WakeVerifier::poll(millis());
+    WakeRelay::poll(millis());
+    poll_events(millis());
+    log_tail.poll(millis());
+    loop_time.observe(micros() - start);
+    PowerManager::idle([](uint32_t timeoutMs) { server.wait(timeoutMs); });
 }
\ No newline at end of file
@@ -0,0 +1,194 @@
+// Metrics.cpp
+#include "Metrics.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace metrics
+{
+
+enum class Kind : uint8_t
+{
+    Counter,
+    Gauge,
+    Histogram,
+};
+
+struct Series
+{
+    const char*      name;
+    const char*      help;
+    Kind             kind;
+    const char*      labelName;
+    const char*      labelValue;
+    const Counter*   counter;
+    const Histogram* histogram;
+    Reader           read;
+};
+
+static Series series[METRICS_MAX_SERIES];
+static size_t seriesCount = 0;
+
+static const char* typeName(Kind kind)
+{
+    switch (kind)
+    {
+        case Kind::Counter:
+            return "counter";
+        case Kind::Gauge:
+            return "gauge";
+        default:
+            return "histogram";
+    }
+}
+
+static bool insert(const Series& s)
+{
+    if (seriesCount >= METRICS_MAX_SERIES)
+        return false;
+
+    // Keep each family contiguous: a new series goes right after the last of its name
+    size_t at = seriesCount;
+    for (size_t i = 0; i < seriesCount; ++i)
+    {
+        if (strcmp(series[i].name, s.name) == 0)
+            at = i + 1;
+    }
+    memmove(&series[at + 1], &series[at], (seriesCount - at) * sizeof(Series));
+    series[at] = s;
+    seriesCount++;
+    return true;
+}
+
+bool add(const char* name, const char* help, const Counter& counter, const char* labelName,
+         const char* labelValue)
+{
+    return insert({name, help, Kind::Counter, labelName, labelValue, &counter, nullptr, nullptr});
+}
+
+bool add(const char* name, const char* help, const Histogram& histogram, const char* labelName,
+         const char* labelValue)
+{
+    return insert(
+        {name, help, Kind::Histogram, labelName, labelValue, nullptr, &histogram, nullptr});
+}
+
+bool addGauge(const char* name, const char* help, Reader read)
+{
+    return insert({name, help, Kind::Gauge, nullptr, nullptr, nullptr, nullptr, read});
+}
+
+bool addCounter(const char* name, const char* help, Reader read)
+{
+    return insert({name, help, Kind::Counter, nullptr, nullptr, nullptr, nullptr, read});
+}
+
+// Appends to a fixed buffer; once anything fails to fit, the whole series is abandoned
+struct Writer
+{
+    char*  buf;
+    size_t cap;
+    size_t pos = 0;
+    bool   ok  = true;
+
+    void print(const char* fmt, ...) __attribute__((format(printf, 2, 3)))
+    {
+        if (!ok)
+            return;
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(buf + pos, cap - pos, fmt, args);
+        va_end(args);
+        if (n < 0 || (size_t)n >= cap - pos)
+            ok = false;
+        else
+            pos += (size_t)n;
+    }
+};
+
+// Microseconds as decimal seconds without trailing zeros: 2500 -> "0.0025"
+static void formatSeconds(uint64_t us, char* out, size_t outLen)
+{
+    int n = snprintf(out, outLen, "%u.%06u", (unsigned)(us / 1000000), (unsigned)(us % 1000000));
+    while (n > 0 && out[n - 1] == '0')
+        out[--n] = '\0';
+    if (n > 0 && out[n - 1] == '.')
+        out[--n] = '\0';
+}
+
+static void writeSeries(Writer& w, const Series& s, bool first)
+{
+    if (first)
+    {
+        w.print("# HELP %s %s\n", s.name, s.help);
+        w.print("# TYPE %s %s\n", s.name, typeName(s.kind));
+    }
+
+    if (s.kind != Kind::Histogram)
+    {
+        uint32_t value = s.read ? s.read() : s.counter->get();
+        if (s.labelName)
+            w.print("%s{%s=\"%s\"} %u\n", s.name, s.labelName, s.labelValue, (unsigned)value);
+        else
+            w.print("%s %u\n", s.name, (unsigned)value);
+        return;
+    }
+
+    // `label` is 'name="value",' ready to go in front of le, or empty
+    char label[64] = "";
+    if (s.labelName)
+        snprintf(label, sizeof(label), "%s=\"%s\",", s.labelName, s.labelValue);
+    size_t labelLen = strlen(label);
+
+    const Histogram& h     = *s.histogram;
+    uint32_t         total = 0;
+    char             le[16];
+    for (size_t i = 0; i < LATENCY_BUCKETS; ++i)
+    {
+        total += h.bucket(i);
+        if (i < LATENCY_BUCKETS - 1)
+            formatSeconds(LATENCY_BOUNDS_US[i], le, sizeof(le));
+        else
+            strcpy(le, "+Inf");
+        w.print("%s_bucket{%sle=\"%s\"} %u\n", s.name, label, le, (unsigned)total);
+    }
+
+    char sum[24];
+    formatSeconds(h.sumMicros(), sum, sizeof(sum));
+    if (labelLen)
+    {
+        label[labelLen - 1] = '\0'; // drop the trailing comma
+        w.print("%s_sum{%s} %s\n", s.name, label, sum);
+        w.print("%s_count{%s} %u\n", s.name, label, (unsigned)total);
+    }
+    else
+    {
+        w.print("%s_sum %s\n", s.name, sum);
+        w.print("%s_count %u\n", s.name, (unsigned)total);
+    }
+}
+
+size_t render(uint32_t& cursor, char* buf, size_t cap, bool& done)
+{
+    Writer w{buf, cap};
+    while (cursor < seriesCount)
+    {
+        const Series& s     = series[cursor];
+        bool          first = cursor == 0 || strcmp(series[cursor - 1].name, s.name) != 0;
+        size_t        mark  = w.pos;
+        writeSeries(w, s, first);
+        if (!w.ok)
+        {
+            w.pos = mark;
+            // A series that cannot fit an empty buffer would stall the page; skip it
+            if (mark == 0)
+                cursor++;
+            break;
+        }
+        cursor++;
+    }
+    done = cursor >= seriesCount;
+    return w.pos;
+}
+
+} // namespace metrics
@@ -0,0 +1,241 @@
+// WifiLink.cpp
+#define LOG_MODULE_LEVEL LOG_LEVEL_MAIN
+#include "WifiLink.h"
+#include <Preferences.h>
+#include <WiFi.h>
+#include "Logger.h"
+
+static constexpr const char* NVS_NAMESPACE = "wifi";
+static constexpr const char* CACHE_KEY     = "sta";
+
+// The last good station connection. `ssidHash` ties it to the network it was made on.
+struct Cache
+{
+    uint32_t ssidHash;
+    uint32_t ip; // network byte order, as the three below
+    uint32_t gateway;
+    uint32_t mask;
+    uint32_t dns;
+    uint8_t  bssid[6];
+    uint8_t  channel;
+};
+
+static WifiLink::State linkState   = WifiLink::State::AccessPoint;
+static const char*     staSsid     = nullptr;
+static const char*     staPsk      = nullptr;
+static const char*     softApSsid  = nullptr;
+static const char*     softApPsk   = nullptr;
+static Preferences     prefs;
+static bool            prefsReady  = false;
+static Cache           cache       = {};
+static bool            cacheValid  = false;
+static bool            fastAttempt = false; // associating with the cached BSSID
+static bool            fastResult  = false;
+static bool            apOn        = false;
+static bool            apAlways    = false; // the AP also serves after a link loss
+static uint32_t        apDueMs     = 0; // when a station still connecting brings up the AP
+static uint32_t        attemptMs   = 0; // start of the current association attempt
+static uint32_t        lostMs      = 0;
+static uint32_t        firstUpMs   = 0;
+static uint32_t        lastPollMs  = 0;
+
+static uint32_t hashSsid(const char* s)
+{
+    uint32_t h = 2166136261u; // FNV-1a
+    while (*s)
+        h = (h ^ (uint8_t)*s++) * 16777619u;
+    return h;
+}
+
+static void startAp()
+{
+    if (WiFi.softAP(softApSsid, softApPsk))
+    {
+        IPAddress ip = WiFi.softAPIP();
+        L_INFOF("AP '%s' up at %s", softApSsid, ip.toString().c_str());
+        apOn = true;
+    }
+    else
+    {
+        L_ERROR("Failed to start WiFi AP");
+    }
+}
+
+static void stopAp()
+{
+    WiFi.softAPdisconnect(false);
+    WiFi.mode(WIFI_STA);
+    apOn = false;
+}
+
+// Join with a scan and DHCP, the slow but sure way
+static void connectScanning(uint32_t nowMs)
+{
+    WiFi.disconnect();
+    WiFi.config(IPAddress(), IPAddress(), IPAddress()); // back to DHCP
+    WiFi.begin(staSsid, staPsk);
+    fastAttempt = false;
+    attemptMs   = nowMs;
+}
+
+// Store the link just made if it differs from the cached one
+static void saveCache()
+{
+    Cache c    = {};
+    c.ssidHash = hashSsid(staSsid);
+    c.ip       = (uint32_t)WiFi.localIP();
+    c.gateway  = (uint32_t)WiFi.gatewayIP();
+    c.mask     = (uint32_t)WiFi.subnetMask();
+    c.dns      = (uint32_t)WiFi.dnsIP();
+    c.channel  = (uint8_t)WiFi.channel();
+    if (const uint8_t* bssid = WiFi.BSSID())
+        memcpy(c.bssid, bssid, sizeof(c.bssid));
+    if (cacheValid && memcmp(&c, &cache, sizeof(c)) == 0)
+        return;
+    cache      = c;
+    cacheValid = true;
+    if (!prefsReady || prefs.putBytes(CACHE_KEY, &c, sizeof(c)) != sizeof(c))
+        L_WARNING("Could not save the WiFi connection for a fast reconnect");
+}
+
+static void onConnected(uint32_t nowMs)
+{
+    bool first = !firstUpMs;
+    if (first)
+    {
+        firstUpMs  = nowMs ? nowMs : 1;
+        fastResult = fastAttempt;
+    }
+    L_INFOF("Connected to '%s' IP %s, %u ms %s%s", staSsid, WiFi.localIP().toString().c_str(),
+            (unsigned)(first ? nowMs : nowMs - lostMs), first ? "after boot" : "after the drop",
+            fastAttempt ? " (cached BSSID)" : "");
+    linkState   = WifiLink::State::Connected;
+    fastAttempt = false;
+    saveCache();
+    if (apOn)
+        stopAp();
+}
+
+void WifiLink::begin(const char* ssid, const char* psk, const char* apSsid, const char* apPsk,
+                     bool apAtBoot)
+{
+    staSsid    = ssid;
+    staPsk     = psk;
+    softApSsid = apSsid;
+    softApPsk  = apPsk;
+    apAlways   = apAtBoot;
+    if (!ssid)
+    {
+        WiFi.mode(WIFI_AP);
+        startAp();
+        linkState = State::AccessPoint;
+        return;
+    }
+
+    bool apNow = apSsid && apAtBoot;
+    WiFi.mode(apNow ? WIFI_AP_STA : WIFI_STA);
+    WiFi.setAutoReconnect(true);
+    if (apNow)
+        startAp();
+
+    prefsReady = prefs.begin(NVS_NAMESPACE, false);
+    cacheValid = prefsReady &&
+                 prefs.getBytes(CACHE_KEY, &cache, sizeof(cache)) == sizeof(cache) &&
+                 cache.ssidHash == hashSsid(ssid) && cache.channel;
+    uint32_t now = millis();
+    L_INFOF("Connecting to SSID '%s'%s", ssid, cacheValid ? " on the cached BSSID" : "");
+    if (cacheValid)
+    {
+        if (WIFI_REUSE_LEASE && cache.ip)
+            WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.mask),
+                        IPAddress(cache.dns));
+        WiFi.begin(ssid, psk, cache.channel, cache.bssid);
+        fastAttempt = true;
+        attemptMs   = now;
+    }
+    else
+    {
+        WiFi.begin(ssid, psk);
+        attemptMs = now;
+    }
+    apDueMs   = now + WIFI_CONNECT_TIMEOUT_MS;
+    linkState = State::Connecting;
+}
+
+void WifiLink::poll(uint32_t nowMs)
+{
+    if (linkState == State::AccessPoint || nowMs - lastPollMs < 100)
+        return;
+    lastPollMs = nowMs;
+
+    bool up = WiFi.status() == WL_CONNECTED;
+    switch (linkState)
+    {
+        case State::Connecting:
+            if (up)
+                onConnected(nowMs);
+            else if (fastAttempt && nowMs - attemptMs > WIFI_FAST_CONNECT_MS)
+            {
+                L_WARNING("Cached BSSID did not answer; scanning for the network");
+                connectScanning(nowMs);
+            }
+            else if (!apOn && softApSsid && (int32_t)(nowMs - apDueMs) >= 0)
+            {
+                L_WARNINGF("No connection to '%s' after %u ms; starting the AP", staSsid,
+                           (unsigned)WIFI_CONNECT_TIMEOUT_MS);
+                WiFi.mode(WIFI_AP_STA);
+                startAp();
+                apDueMs = nowMs + WIFI_CONNECT_TIMEOUT_MS; // retry later if it failed
+            }
+            break;
+        case State::Connected:
+            if (!up)
+            {
+                L_WARNINGF("Lost the connection to '%s'", staSsid);
+                linkState = State::Lost;
+                lostMs    = nowMs;
+            }
+            break;
+        case State::Lost:
+            if (up)
+                onConnected(nowMs);
+            else if (!apOn && softApSsid && apAlways && nowMs - lostMs > WIFI_AP_FALLBACK_MS)
+            {
+                WiFi.mode(WIFI_AP_STA);
+                startAp();
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+WifiLink::State WifiLink::state()
+{
+    return linkState;
+}
+
+const char* WifiLink::stateName(State s)
+{
+    switch (s)
+    {
+        case State::Connecting:
+            return "connecting";
+        case State::Connected:
+            return "connected";
+        case State::Lost:
+            return "lost";
+        default:
+            return "ap";
+    }
+}
+
+uint32_t WifiLink::connectedAtMs()
+{
+    return firstUpMs;
+}
+
+bool WifiLink::fastConnected()
+{
+    return fastResult;
+}
@@ -0,0 +1,212 @@
+// PowerManager.cpp
+#define LOG_MODULE_LEVEL LOG_LEVEL_MAIN
+#include "PowerManager.h"
+#include <Preferences.h>
+#include <WiFi.h>
+#include <esp_pm.h>
+#include "Logger.h"
+
+static constexpr const char* NVS_NAMESPACE = "power";
+static constexpr const char* PROFILE_KEY   = "profile";
+
+// Datasheet currents (ESP32 v4 datasheet, table 5-4, and the WiFi power-save guide)
+// the estimate is built from. Only the split of time between states is measured.
+static constexpr uint32_t RADIO_ON_UA    = 95000; // listening, CPU idle at any clock
+static constexpr uint32_t MODEM_SLEEP_UA = 25000; // modem sleep, CPU idle at 40-80 MHz
+
+struct ProfileConfig
+{
+    const char*    name;
+    uint16_t       maxMhz;
+    uint16_t       minMhz; // clock while nothing holds a lock
+    bool           lightSleep;
+    wifi_ps_type_t modem;
+    uint16_t       idleWaitMs; // longest the loop blocks; 0 never blocks
+    uint32_t       activeUa;   // working, radio listening
+    uint32_t       idleUa;     // waiting, with this profile's sleep modes
+};
+
+static const ProfileConfig CONFIGS[PowerManager::PROFILES] = {
+    {"low-latency", 240, 240, false, WIFI_PS_NONE, 0, 110000, RADIO_ON_UA},
+    {"balanced", 240, 80, false, WIFI_PS_MIN_MODEM, 20, 110000, MODEM_SLEEP_UA},
+    {"low-power", 160, 40, true, WIFI_PS_MAX_MODEM, 250, 90000, 2500},
+};
+
+static PowerManager::Profile current = PowerManager::Profile::Balanced;
+static bool                  dfs     = false; // esp_pm accepted the clock range
+static bool                  sleeps  = false; // ...and automatic light sleep
+static esp_pm_lock_handle_t  cpuLock = nullptr;
+static Preferences           prefs;
+static bool                  prefsReady = false;
+static uint32_t              markUs     = 0; // end of the last accounted interval
+
+static PowerManager::Usage usages[PowerManager::PROFILES];
+static metrics::Histogram  latencies[PowerManager::PROFILES];
+static metrics::Counter    activeMs[PowerManager::PROFILES];
+static metrics::Counter    idleMs[PowerManager::PROFILES];
+static uint32_t            activeRemUs[PowerManager::PROFILES];
+static uint32_t            idleRemUs[PowerManager::PROFILES];
+
+static void apply(PowerManager::Profile profile)
+{
+    const ProfileConfig&  c  = CONFIGS[(size_t)profile];
+    esp_pm_config_esp32_t pm = {};
+    pm.max_freq_mhz          = c.maxMhz;
+    pm.min_freq_mhz          = c.minMhz;
+    pm.light_sleep_enable    = c.lightSleep;
+    esp_err_t err            = esp_pm_configure(&pm);
+    if (err != ESP_OK && pm.light_sleep_enable)
+    {
+        // Automatic light sleep needs CONFIG_FREERTOS_USE_TICKLESS_IDLE in the SDK
+        L_WARNING("Light sleep is not available in this build; scaling the clock only");
+        pm.light_sleep_enable = false;
+        err                   = esp_pm_configure(&pm);
+    }
+    dfs    = err == ESP_OK;
+    sleeps = dfs && pm.light_sleep_enable;
+    if (!dfs)
+    {
+        L_WARNINGF("Clock scaling unavailable (%d); running at %u MHz", (int)err,
+                   (unsigned)c.maxMhz);
+        setCpuFrequencyMhz(c.maxMhz);
+    }
+    WiFi.setSleep(c.modem);
+    current = profile;
+    L_INFOF("Power profile %s: %u-%u MHz%s", c.name, (unsigned)(dfs ? c.minMhz : c.maxMhz),
+            (unsigned)c.maxMhz, sleeps ? ", light sleep" : "");
+}
+
+// Add `us` to a profile's time in one state, keeping the ms counter for /api/metrics
+static void account(uint64_t& total, metrics::Counter& ms, uint32_t& remUs, uint32_t us,
+                    uint32_t ua)
+{
+    total += us;
+    usages[(size_t)current].chargeUaUs += (uint64_t)ua * us;
+    remUs += us;
+    if (remUs >= 1000)
+    {
+        ms.inc(remUs / 1000);
+        remUs %= 1000;
+    }
+}
+
+void PowerManager::begin()
+{
+    prefsReady      = prefs.begin(NVS_NAMESPACE, false);
+    uint8_t saved   = 0xFF;
+    Profile profile = Profile::Balanced;
+    if (prefsReady && prefs.getBytes(PROFILE_KEY, &saved, 1) == 1 && saved < PROFILES)
+        profile = (Profile)saved;
+    else if (!parseProfile(POWER_PROFILE, profile))
+        L_WARNINGF("Unknown POWER_PROFILE '%s'", POWER_PROFILE);
+
+    for (size_t i = 0; i < PROFILES; ++i)
+    {
+        const char* name = CONFIGS[i].name;
+        metrics::add("power_request_duration_seconds",
+                     "Time from request parsed to last response byte written, by profile.",
+                     latencies[i], "profile", name);
+        metrics::add("power_active_milliseconds_total",
+                     "Time the main loop spent working, by profile.", activeMs[i],
+                     "profile", name);
+        metrics::add("power_idle_milliseconds_total",
+                     "Time the main loop spent waiting for network activity, by profile.",
+                     idleMs[i], "profile", name);
+    }
+
+    // Held whenever the loop is working, so requests run at full clock
+    if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "loop", &cpuLock) == ESP_OK)
+        esp_pm_lock_acquire(cpuLock);
+    else
+        cpuLock = nullptr;
+    apply(profile);
+    markUs = micros();
+}
+
+bool PowerManager::setProfile(Profile profile)
+{
+    if (profile != current)
+        apply(profile);
+    uint8_t v = (uint8_t)profile;
+    return prefsReady && prefs.putBytes(PROFILE_KEY, &v, 1) == 1;
+}
+
+PowerManager::Profile PowerManager::profile()
+{
+    return current;
+}
+
+const char* PowerManager::profileName(Profile profile)
+{
+    return CONFIGS[(size_t)profile].name;
+}
+
+bool PowerManager::parseProfile(const char* name, Profile& out)
+{
+    for (size_t i = 0; i < PROFILES; ++i)
+    {
+        if (strcmp(name, CONFIGS[i].name) == 0)
+        {
+            out = (Profile)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PowerManager::clockScaling()
+{
+    return dfs;
+}
+
+bool PowerManager::lightSleep()
+{
+    return sleeps;
+}
+
+void PowerManager::idle(Waiter wait)
+{
+    const ProfileConfig& c = CONFIGS[(size_t)current];
+    size_t               i = (size_t)current;
+    uint32_t             t = micros();
+    account(usages[i].activeUs, activeMs[i], activeRemUs[i], t - markUs, c.activeUa);
+    markUs = t;
+    if (!c.idleWaitMs)
+        return;
+
+    if (cpuLock)
+        esp_pm_lock_release(cpuLock);
+    wait(c.idleWaitMs);
+    if (cpuLock)
+        esp_pm_lock_acquire(cpuLock);
+
+    // A soft AP keeps the radio on whatever the power-save mode
+    uint32_t ua = (WiFi.getMode() & WIFI_AP) ? RADIO_ON_UA
+                  : c.lightSleep && !sleeps  ? MODEM_SLEEP_UA
+                                             : c.idleUa;
+    t = micros();
+    account(usages[i].idleUs, idleMs[i], idleRemUs[i], t - markUs, ua);
+    markUs = t;
+}
+
+void PowerManager::observeRequest(uint32_t us)
+{
+    latencies[(size_t)current].observe(us);
+}
+
+const PowerManager::Usage& PowerManager::usage(Profile profile)
+{
+    return usages[(size_t)profile];
+}
+
+const metrics::Histogram& PowerManager::latency(Profile profile)
+{
+    return latencies[(size_t)profile];
+}
+
+uint32_t PowerManager::estimatedCurrentUa(Profile profile)
+{
+    const Usage& u     = usages[(size_t)profile];
+    uint64_t     total = u.activeUs + u.idleUs;
+    return total ? (uint32_t)(u.chargeUaUs / total) : 0;
+}
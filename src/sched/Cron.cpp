@@ -0,0 +1,300 @@
+// Cron.cpp
+#include "Cron.h"
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+
+static const char* const MONTH_NAMES[] = {"jan", "feb", "mar", "apr", "may", "jun",
+                                          "jul", "aug", "sep", "oct", "nov", "dec"};
+static const char* const DAY_NAMES[]   = {"sun", "mon", "tue", "wed", "thu", "fri", "sat"};
+
+static const struct
+{
+    const char* name;
+    const char* expr;
+} MACROS[] = {
+    {"@yearly", "0 0 1 1 *"}, {"@annually", "0 0 1 1 *"}, {"@monthly", "0 0 1 * *"},
+    {"@weekly", "0 0 * * 0"}, {"@daily", "0 0 * * *"},    {"@midnight", "0 0 * * *"},
+    {"@hourly", "0 * * * *"},
+};
+
+// A number, or a three-letter name from `names` (numbered from `base`)
+static bool parseValue(const char*& p, const char* const* names, int nameCount, int base,
+                       int& out)
+{
+    if (isdigit((unsigned char)*p))
+    {
+        out = 0;
+        while (isdigit((unsigned char)*p) && out < 1000)
+            out = out * 10 + (*p++ - '0');
+        return true;
+    }
+    for (int i = 0; names && i < nameCount; ++i)
+    {
+        if (strncasecmp(p, names[i], 3) == 0)
+        {
+            out = base + i;
+            p += 3;
+            return true;
+        }
+    }
+    return false;
+}
+
+struct Field
+{
+    int                lo, hi;
+    const char* const* names; // accepted instead of numbers, numbered from `lo`
+    int                nameCount;
+};
+
+static const Field FIELDS[5] = {
+    {0, 59, nullptr, 0},      // minute
+    {0, 23, nullptr, 0},      // hour
+    {1, 31, nullptr, 0},      // day of month
+    {1, 12, MONTH_NAMES, 12}, // month
+    {0, 7, DAY_NAMES, 7},     // day of week, 0 and 7 = Sunday
+};
+
+// One field: comma-separated items of '*', 'a', 'a-b', each optionally '/step'
+static bool parseField(const char*& p, const Field& field, uint64_t& mask, bool& star)
+{
+    const int lo = field.lo;
+    const int hi = field.hi;
+    mask = 0;
+    star = *p == '*';
+    while (true)
+    {
+        int  a, b, step = 1;
+        bool range = true;
+        if (*p == '*')
+        {
+            a = lo;
+            b = hi;
+            p++;
+        }
+        else
+        {
+            if (!parseValue(p, field.names, field.nameCount, lo, a))
+                return false;
+            b     = a;
+            range = false;
+            if (*p == '-')
+            {
+                p++;
+                if (!parseValue(p, field.names, field.nameCount, lo, b))
+                    return false;
+                range = true;
+            }
+        }
+        if (*p == '/')
+        {
+            p++;
+            if (!parseValue(p, nullptr, 0, 0, step) || step < 1)
+                return false;
+            if (!range)
+                b = hi; // "5/15" means 5-hi/15
+        }
+        if (a < lo || b > hi || a > b)
+            return false;
+        for (int v = a; v <= b; v += step)
+            mask |= 1ull << v;
+        if (*p != ',')
+            break;
+        p++;
+    }
+    return *p == '\0' || *p == ' ' || *p == '\t';
+}
+
+bool CronExpr::parse(const char* text, CronExpr& out)
+{
+    if (!text)
+        return false;
+    while (*text == ' ' || *text == '\t')
+        text++;
+    if (*text == '@')
+    {
+        for (const auto& m : MACROS)
+        {
+            if (strcasecmp(text, m.name) == 0)
+                return parse(m.expr, out);
+        }
+        return false;
+    }
+
+    uint64_t    masks[5];
+    bool        stars[5];
+    const char* p = text;
+    for (int f = 0; f < 5; ++f)
+    {
+        const Field& field = FIELDS[f];
+        while (*p == ' ' || *p == '\t')
+            p++;
+        if (!parseField(p, field, masks[f], stars[f]))
+            return false;
+    }
+    while (*p == ' ' || *p == '\t')
+        p++;
+    if (*p)
+        return false;
+
+    out.minutes    = masks[0];
+    out.hours      = (uint32_t)masks[1];
+    out.days       = (uint32_t)masks[2];
+    out.months     = (uint16_t)masks[3];
+    out.weekdays   = (uint8_t)((masks[4] | masks[4] >> 7) & 0x7F); // 7 is Sunday too
+    out.anyDay     = stars[2];
+    out.anyWeekday = stars[4];
+    return true;
+}
+
+bool CronExpr::matchesDay(const struct tm& tm) const
+{
+    bool day     = days >> tm.tm_mday & 1;
+    bool weekday = weekdays >> tm.tm_wday & 1;
+    if (anyDay || anyWeekday)
+        return day && weekday;
+    return day || weekday;
+}
+
+// Lowest set bit of `mask` at or above `from`, or -1
+static int nextBit(uint64_t mask, int from)
+{
+    if (from >= 64)
+        return -1;
+    mask &= ~0ull << from;
+    return mask ? __builtin_ctzll(mask) : -1;
+}
+
+static int daysInMonth(int year, int mon)
+{
+    static const uint8_t DAYS[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int                  y      = year + 1900;
+    bool                 leap   = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    return DAYS[mon] + (mon == 1 && leap);
+}
+
+// Carry what next() lets overflow (minute 60, hour 24, the day after the month's last,
+// month 12) on the wall clock, where every day has 24 hours, and set the weekday
+static void carry(struct tm& tm)
+{
+    if (tm.tm_min >= 60)
+    {
+        tm.tm_min = 0;
+        tm.tm_hour++;
+    }
+    if (tm.tm_hour >= 24)
+    {
+        tm.tm_hour = 0;
+        tm.tm_mday++;
+    }
+    if (tm.tm_mon < 12 && tm.tm_mday > daysInMonth(tm.tm_year, tm.tm_mon))
+    {
+        tm.tm_mday = 1;
+        tm.tm_mon++;
+    }
+    if (tm.tm_mon >= 12)
+    {
+        tm.tm_mon = 0;
+        tm.tm_year++;
+    }
+    // Sakamoto's method, 0 = Sunday
+    static const uint8_t T[] = {0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4};
+    int                  y   = tm.tm_year + 1900 - (tm.tm_mon < 2);
+    tm.tm_wday               = (y + y / 4 - y / 100 + y / 400 + T[tm.tm_mon] + tm.tm_mday) % 7;
+}
+
+// Orders wall-clock readings to the minute
+static int64_t wallKey(const struct tm& tm)
+{
+    return ((((int64_t)tm.tm_year * 12 + tm.tm_mon) * 31 + tm.tm_mday) * 24 + tm.tm_hour) * 60 +
+           tm.tm_min;
+}
+
+// When the local clock first reads `wall`. A reading skipped when the clocks go forward
+// is due at the jump; one repeated when they go back counts at its first occurrence.
+static time_t instant(const struct tm& wall)
+{
+    const int64_t want  = wallKey(wall);
+    time_t        first = 0, lo = 0, hi = 0;
+    bool          found = false, any = false;
+    for (int dst = 0; dst <= 1; ++dst)
+    {
+        struct tm t = wall;
+        t.tm_sec    = 0;
+        t.tm_isdst  = dst;
+        time_t c    = mktime(&t);
+        if (c == (time_t)-1)
+            continue;
+        if (wallKey(t) == want && (!found || c < first))
+        {
+            first = c;
+            found = true;
+        }
+        lo  = any && lo < c ? lo : c;
+        hi  = any && hi > c ? hi : c;
+        any = true;
+    }
+    if (found || !any)
+        return first;
+
+    // Read as standard and as daylight time, `wall` lands either side of the jump
+    while (hi - lo > 1)
+    {
+        time_t    mid = lo + (hi - lo) / 2;
+        struct tm t;
+        localtime_r(&mid, &t);
+        (wallKey(t) < want ? lo : hi) = mid;
+    }
+    return hi;
+}
+
+time_t CronExpr::next(time_t after) const
+{
+    // The search runs on the wall clock; daylight saving only matters for a match
+    struct tm tm;
+    localtime_r(&after, &tm);
+    tm.tm_sec = 0;
+    tm.tm_min++;
+    carry(tm);
+    const int lastYear = tm.tm_year + 5;
+
+    // Move to the next candidate field by field
+    while (tm.tm_year <= lastYear)
+    {
+        int v;
+        if (!(months >> (tm.tm_mon + 1) & 1))
+        {
+            v          = nextBit(months, tm.tm_mon + 2);
+            tm.tm_mon  = v < 0 ? 12 : v - 1;
+            tm.tm_mday = 1;
+            tm.tm_hour = 0;
+            tm.tm_min  = 0;
+        }
+        else if (!matchesDay(tm))
+        {
+            tm.tm_mday++;
+            tm.tm_hour = 0;
+            tm.tm_min  = 0;
+        }
+        else if ((v = nextBit(hours, tm.tm_hour)) != tm.tm_hour)
+        {
+            tm.tm_hour = v < 0 ? 24 : v;
+            tm.tm_min  = 0;
+        }
+        else if ((v = nextBit(minutes, tm.tm_min)) != tm.tm_min)
+        {
+            tm.tm_min = v < 0 ? 60 : v;
+        }
+        else
+        {
+            // In the second run of a repeated hour, the match has already come
+            time_t t = instant(tm);
+            if (t > after)
+                return t;
+            tm.tm_min++;
+        }
+        carry(tm);
+    }
+    return 0;
+}
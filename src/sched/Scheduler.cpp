@@ -0,0 +1,394 @@
+// Scheduler.cpp
+#define LOG_MODULE_LEVEL LOG_LEVEL_WOL
+#include "Scheduler.h"
+#include <Preferences.h>
+#include <atomic>
+#include <esp_sntp.h>
+#include <stdlib.h>
+#include <time.h>
+#include "HostRegistry.h"
+#include "Logger.h"
+#include "TimingWheel.h"
+#include "WakeQueue.h"
+
+static constexpr const char* NVS_NAMESPACE = "sched";
+static constexpr const char* TZ_KEY        = "tz";
+static constexpr size_t      TZ_LEN        = 64;
+static constexpr uint32_t    VALID_AFTER   = 1600000000; // a clock before 2020 was never set
+static constexpr size_t      PAGES =
+    (SCHEDULE_MAX + SCHEDULE_NVS_PAGE_SIZE - 1) / SCHEDULE_NVS_PAGE_SIZE;
+
+// A schedule as stored in NVS; the cron expression is compiled again on load. A removed
+// schedule keeps its id (with used = 0) so the slot's next id differs from it.
+struct Record
+{
+    uint32_t id;
+    uint32_t at;
+    uint32_t hostId;
+    uint32_t broadcast;
+    uint16_t port;
+    uint8_t  used;
+    uint8_t  mac[WakeOnLan::MAC_LEN];
+    char     name[Scheduler::NAME_LEN];
+    char     cron[Scheduler::CRON_LEN];
+};
+
+static Scheduler::Schedule       schedules[SCHEDULE_MAX];
+static TimingWheel<SCHEDULE_MAX> wheel; // one tick per second, timer id = table slot
+static bool                      wheelRunning = false;
+static size_t                    used         = 0;
+static Preferences               prefs;
+static bool                      ready = false;
+static Record                    page[SCHEDULE_NVS_PAGE_SIZE]; // staging for one blob
+static char                      tz[TZ_LEN] = SCHEDULE_TZ;
+static uint32_t                  lastPollMs = 0;
+
+// Manual time: Unix seconds at a millis() reading, until NTP syncs
+static bool              manualSet   = false;
+static uint32_t          manualEpoch = 0;
+static uint32_t          manualAtMs  = 0;
+static std::atomic<bool> ntpSynced{false}; // set from the SNTP task
+
+static size_t slotOf(uint32_t id)
+{
+    return (id - 1) % SCHEDULE_MAX;
+}
+
+static void pageKey(size_t p, char key[8])
+{
+    snprintf(key, 8, "p%u", (unsigned)p);
+}
+
+// Write the page holding `slot` back to NVS
+static bool savePage(size_t slot)
+{
+    if (!ready)
+        return false;
+    size_t first = slot - slot % SCHEDULE_NVS_PAGE_SIZE;
+    bool   empty = true;
+    memset(page, 0, sizeof(page));
+    for (size_t i = 0; i < SCHEDULE_NVS_PAGE_SIZE && first + i < SCHEDULE_MAX; ++i)
+    {
+        const Scheduler::Schedule& s = schedules[first + i];
+        Record&                    r = page[i];
+        r.id                         = s.id;
+        r.at                         = s.at;
+        r.hostId                     = s.hostId;
+        r.broadcast                  = s.broadcast;
+        r.port                       = s.port;
+        r.used                       = s.used;
+        memcpy(r.mac, s.mac, sizeof(r.mac));
+        memcpy(r.name, s.name, sizeof(r.name));
+        memcpy(r.cron, s.cron, sizeof(r.cron));
+        empty = empty && s.id == 0;
+    }
+    char key[8];
+    pageKey(first / SCHEDULE_NVS_PAGE_SIZE, key);
+    if (empty)
+        return prefs.getBytesLength(key) == 0 || prefs.remove(key);
+    return prefs.putBytes(key, page, sizeof(page)) == sizeof(page);
+}
+
+static void onNtpSync(struct timeval*)
+{
+    ntpSynced.store(true);
+}
+
+static void applyTimezone()
+{
+    setenv("TZ", tz, 1);
+    tzset();
+}
+
+static void drop(Scheduler::Schedule& s)
+{
+    wheel.cancel(slotOf(s.id));
+    s.used = false;
+    s.next = 0;
+    used--;
+    if (!savePage(slotOf(s.id)))
+        L_ERRORF("Could not save the removal of schedule %u", (unsigned)s.id);
+}
+
+// Work out when `s` is next due after Unix time `t` and arm its timer. Returns false
+// for a one-shot that was missed by more than SCHEDULE_GRACE_S.
+static bool plan(Scheduler::Schedule& s, uint32_t t)
+{
+    if (s.cron[0])
+        s.next = (uint32_t)s.expr.next((time_t)t);
+    else if (s.at > t)
+        s.next = s.at;
+    else if (t - s.at <= SCHEDULE_GRACE_S)
+        s.next = t; // late: fires on the next tick
+    else
+        return false;
+
+    if (s.next)
+        wheel.arm(slotOf(s.id), s.next);
+    else
+        wheel.cancel(slotOf(s.id)); // a cron expression that never matches
+    return true;
+}
+
+static void planAll(uint32_t t)
+{
+    wheel.start(t);
+    wheelRunning = true;
+    for (auto& s : schedules)
+    {
+        if (s.used && !plan(s, t))
+        {
+            L_WARNINGF("Dropping schedule %u, missed at %u", (unsigned)s.id, (unsigned)s.at);
+            drop(s);
+        }
+    }
+}
+
+static void wake(Scheduler::Schedule& s)
+{
+    uint32_t job = 0;
+    if (s.hostId)
+    {
+        const HostRegistry::Host* h = HostRegistry::find(s.hostId);
+        if (!h)
+        {
+            L_WARNINGF("Schedule %u: host %u no longer exists", (unsigned)s.id,
+                       (unsigned)s.hostId);
+            return;
+        }
+        job = WakeQueue::enqueue(h->mac, IPAddress(h->broadcast), h->port, h->packet);
+    }
+    else
+    {
+        job = WakeQueue::enqueue(s.mac, IPAddress(s.broadcast), s.port);
+    }
+    s.lastJob = job;
+    if (job)
+        L_INFOF("Schedule %u queued wake job %u", (unsigned)s.id, (unsigned)job);
+    else
+        L_ERRORF("Schedule %u: wake queue full", (unsigned)s.id);
+}
+
+static void fire(size_t slot)
+{
+    Scheduler::Schedule& s = schedules[slot];
+    if (!s.used)
+        return;
+    wake(s);
+    if (s.cron[0])
+        plan(s, s.next);
+    else
+        drop(s);
+}
+
+bool Scheduler::begin()
+{
+    if (ready)
+        return true;
+    if (!prefs.begin(NVS_NAMESPACE, false))
+    {
+        L_ERROR("Could not open NVS for the scheduler");
+        return false;
+    }
+    ready = true;
+
+    // configTime() sets TZ itself, so ours goes on after it
+    char saved[TZ_LEN];
+    size_t n = prefs.getBytes(TZ_KEY, saved, sizeof(saved));
+    if (n > 1 && saved[n - 1] == '\0')
+        memcpy(tz, saved, n);
+    sntp_set_time_sync_notification_cb(onNtpSync);
+    configTime(0, 0, SCHEDULE_NTP_SERVER);
+    applyTimezone();
+
+    for (size_t p = 0; p < PAGES; ++p)
+    {
+        char key[8];
+        pageKey(p, key);
+        if (prefs.getBytesLength(key) != sizeof(page) ||
+            prefs.getBytes(key, page, sizeof(page)) != sizeof(page))
+            continue;
+        for (size_t i = 0; i < SCHEDULE_NVS_PAGE_SIZE; ++i)
+        {
+            const Record& r    = page[i];
+            size_t        slot = p * SCHEDULE_NVS_PAGE_SIZE + i;
+            if (slot >= SCHEDULE_MAX || r.id == 0 || slotOf(r.id) != slot)
+                continue;
+            Schedule& s = schedules[slot];
+            s.id        = r.id;
+            memcpy(s.cron, r.cron, sizeof(s.cron));
+            s.cron[CRON_LEN - 1] = '\0';
+            if (!r.used || (s.cron[0] && !CronExpr::parse(s.cron, s.expr)))
+                continue;
+            memcpy(s.name, r.name, sizeof(s.name));
+            s.name[NAME_LEN - 1] = '\0';
+            memcpy(s.mac, r.mac, sizeof(s.mac));
+            s.at        = r.at;
+            s.hostId    = r.hostId;
+            s.broadcast = r.broadcast;
+            s.port      = r.port;
+            s.used      = true;
+            used++;
+        }
+    }
+    L_INFOF("Scheduler: %u schedules loaded, TZ %s", (unsigned)used, tz);
+    return true;
+}
+
+void Scheduler::poll(uint32_t nowMs)
+{
+    // Ticks are whole seconds; looking a few times a second is plenty
+    if (wheelRunning && nowMs - lastPollMs < 200)
+        return;
+    lastPollMs = nowMs;
+
+    uint32_t t = now();
+    if (!t)
+        return;
+    if (!wheelRunning)
+    {
+        L_INFOF("Time known (%s), planning %u schedules", timeSourceName(timeSource()),
+                (unsigned)used);
+        planAll(t);
+        return;
+    }
+    int32_t jump = (int32_t)(t - wheel.current());
+    if (jump < 0 || jump > SCHEDULE_MAX_CATCHUP_S)
+    {
+        L_WARNINGF("Clock moved by %d s, planning schedules again", (int)jump);
+        planAll(t);
+        return;
+    }
+    wheel.advance(t, fire);
+}
+
+Scheduler::Result Scheduler::add(const Schedule& in, uint32_t& id)
+{
+    size_t slot = 0;
+    while (slot < SCHEDULE_MAX && schedules[slot].used)
+        slot++;
+    if (slot == SCHEDULE_MAX)
+        return Result::Full;
+
+    Schedule& s   = schedules[slot];
+    Schedule  old = s;
+    uint32_t  gen = s.id;
+    s             = in;
+    s.id          = gen ? gen + SCHEDULE_MAX : (uint32_t)slot + 1;
+    s.used        = true;
+    s.next        = 0;
+    s.lastJob     = 0;
+    s.name[NAME_LEN - 1] = '\0';
+    s.cron[CRON_LEN - 1] = '\0';
+    if (s.cron[0] && !CronExpr::parse(s.cron, s.expr))
+        s.cron[0] = '\0';
+    if (!savePage(slot))
+    {
+        s = old;
+        return Result::StorageFailed;
+    }
+    used++;
+    id = s.id;
+    if (wheelRunning && !plan(s, now()))
+        drop(s);
+    return Result::Ok;
+}
+
+Scheduler::Result Scheduler::remove(uint32_t id)
+{
+    if (!find(id))
+        return Result::NotFound;
+    Schedule& s = schedules[slotOf(id)];
+    s.used      = false;
+    if (!savePage(slotOf(id)))
+    {
+        s.used = true;
+        return Result::StorageFailed;
+    }
+    wheel.cancel(slotOf(id));
+    used--;
+    return Result::Ok;
+}
+
+const Scheduler::Schedule* Scheduler::find(uint32_t id)
+{
+    if (id == 0)
+        return nullptr;
+    const Schedule& s = schedules[slotOf(id)];
+    return s.used && s.id == id ? &s : nullptr;
+}
+
+const Scheduler::Schedule* Scheduler::next(uint32_t& cursor)
+{
+    while (cursor < SCHEDULE_MAX)
+    {
+        const Schedule& s = schedules[cursor++];
+        if (s.used)
+            return &s;
+    }
+    return nullptr;
+}
+
+size_t Scheduler::count()
+{
+    return used;
+}
+
+uint32_t Scheduler::now()
+{
+    if (manualSet && !ntpSynced.load())
+        return manualEpoch + (millis() - manualAtMs) / 1000;
+    time_t t = time(nullptr);
+    return t >= (time_t)VALID_AFTER ? (uint32_t)t : 0;
+}
+
+Scheduler::TimeSource Scheduler::timeSource()
+{
+    if (ntpSynced.load())
+        return TimeSource::Ntp;
+    if (manualSet)
+        return TimeSource::Manual;
+    return time(nullptr) >= (time_t)VALID_AFTER ? TimeSource::System : TimeSource::None;
+}
+
+const char* Scheduler::timeSourceName(TimeSource source)
+{
+    switch (source)
+    {
+        case TimeSource::System:
+            return "system";
+        case TimeSource::Ntp:
+            return "ntp";
+        case TimeSource::Manual:
+            return "manual";
+        default:
+            return "none";
+    }
+}
+
+void Scheduler::setTime(uint32_t unixSeconds)
+{
+    manualEpoch = unixSeconds;
+    manualAtMs  = millis();
+    manualSet   = true;
+    // poll() sees the jump and plans every schedule again
+}
+
+bool Scheduler::setTimezone(const char* zone)
+{
+    size_t len = strlen(zone);
+    if (len == 0 || len >= TZ_LEN)
+        return false;
+    if (ready && prefs.putBytes(TZ_KEY, zone, len + 1) != len + 1)
+        return false;
+    memcpy(tz, zone, len + 1);
+    applyTimezone();
+    if (wheelRunning)
+        planAll(wheel.current());
+    return true;
+}
+
+const char* Scheduler::timezone()
+{
+    return tz;
+}
@@ -0,0 +1,121 @@
+// WakeEvents.cpp
+#include "WakeEvents.h"
+#include "Json.h"
+#include "WakeQueue.h"
+#include "WakeVerifier.h"
+
+struct Tracked
+{
+    uint32_t            job; // 0 = free
+    uint32_t            hostId;
+    uint32_t            verifyId;
+    WakeQueue::Report   last;
+    WakeVerifier::State verifyState;
+    bool                done;
+};
+
+static EventStream* stream = nullptr;
+static Tracked      tracked[WAKE_EVENTS_TRACKED];
+static uint32_t     seenJob = 0; // newest job taken from the queue
+
+static Tracked& slotFor(uint32_t job)
+{
+    Tracked& t = tracked[job % WAKE_EVENTS_TRACKED];
+    if (t.job != job)
+    {
+        t             = {};
+        t.job         = job;
+        t.verifyState = WakeVerifier::State::Unknown;
+    }
+    return t;
+}
+
+static void publish(const Tracked& t, const WakeVerifier::Status* verify)
+{
+    char         data[EVENTS_MAX_LEN];
+    json::Writer w(data, sizeof(data));
+    w.beginObject().key("job").number(t.job);
+    if (t.hostId)
+        w.key("host").number(t.hostId);
+    w.key("state").string(WakeQueue::stateName(t.last.state));
+    w.key("planned").number(t.last.planned);
+    w.key("sent").number(t.last.sent);
+    w.key("failed").number(t.last.failed);
+    if (verify)
+    {
+        w.key("verify").string(WakeVerifier::stateName(verify->state));
+        if (verify->state == WakeVerifier::State::Up)
+            w.key("time_to_wake_ms").number(verify->elapsedMs);
+    }
+    w.endObject();
+    if (w.ok())
+        stream->publish("wake", data);
+}
+
+static void follow(Tracked& t)
+{
+    WakeQueue::Report r;
+    if (!WakeQueue::report(t.job, r))
+    {
+        t.done = true; // aged out of the queue's history
+        return;
+    }
+    if (r.state != t.last.state || r.sent != t.last.sent || r.failed != t.last.failed)
+    {
+        t.last = r;
+        publish(t, nullptr);
+    }
+    if (r.state != WakeQueue::JobState::Sent && r.state != WakeQueue::JobState::Failed)
+        return;
+    if (!t.verifyId || r.state == WakeQueue::JobState::Failed)
+    {
+        t.done = true;
+        return;
+    }
+
+    WakeVerifier::Status v;
+    if (!WakeVerifier::status(t.verifyId, v))
+    {
+        t.done = true;
+        return;
+    }
+    if (v.state != t.verifyState)
+    {
+        t.verifyState = v.state;
+        publish(t, &v);
+    }
+    t.done = v.state != WakeVerifier::State::Resolving && v.state != WakeVerifier::State::Probing;
+}
+
+void WakeEvents::begin(EventStream& events)
+{
+    stream = &events;
+}
+
+void WakeEvents::annotate(uint32_t job, uint32_t hostId, uint32_t verifyId)
+{
+    if (!job)
+        return;
+    Tracked& t = slotFor(job);
+    t.hostId   = hostId;
+    t.verifyId = verifyId;
+}
+
+void WakeEvents::poll(uint32_t)
+{
+    if (!stream)
+        return;
+
+    // Jobs queued since the last call; only the newest fit when there were too many
+    uint32_t last = WakeQueue::lastId();
+    if (last < seenJob || last - seenJob > WAKE_EVENTS_TRACKED)
+        seenJob = last > WAKE_EVENTS_TRACKED ? last - WAKE_EVENTS_TRACKED : 0;
+    while (seenJob != last)
+        slotFor(++seenJob);
+
+    for (Tracked& t : tracked)
+    {
+        if (t.job && !t.done)
+            follow(t);
+    }
+}
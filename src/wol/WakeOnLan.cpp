@@ -8,89 +8,96 @@ static const size_t   MAC_LEN  = WakeOnLan::MAC_LEN;
 
 bool WakeOnLan::parseMac(const char* macStr, uint8_t mac[MAC_LEN])
 {
-    if (!macStr || !mac)
-        return false;
-    // Copy to a modifiable buffer
-    constexpr size_t BUF_SZ = 32;
-    char             buf[BUF_SZ];
-    size_t           len = strlen(macStr);
-    if (len >= sizeof(buf))
-        return false;
-    strcpy(buf, macStr);
+    return wol::parseMac(macStr, mac);
+}
 
-    // Remove separators
-    char*            p                   = buf;
-    constexpr size_t CLEANED_SZ          = 13; // 12 hex digits + null
-    constexpr size_t CLEANED_HEX         = 12;
-    char             cleaned[CLEANED_SZ] = {0};
-    size_t           ci                  = 0;
-    while (*p && ci < CLEANED_HEX)
-    {
-        if (*p == ':' || *p == '-' || *p == ' ')
-        {
-            p++;
-            continue;
-        }
-        cleaned[ci++] = *p++;
-    }
-    if (ci != CLEANED_HEX)
-        return false;
+void WakeOnLan::buildPacket(const uint8_t mac[MAC_LEN], uint8_t packet[PACKET_LEN])
+{
+    wol::fillPacket(mac, packet);
+}
 
-    // Convert pairs
-    for (size_t i = 0; i < MAC_LEN; ++i)
+IPAddress WakeOnLan::resolveBroadcast(const char* broadcastIp)
+{
+    IPAddress dest;
+    if (!broadcastIp || !dest.fromString(broadcastIp))
     {
-        char           pair[3]     = {cleaned[i * 2], cleaned[i * 2 + 1], '\0'};
-        char*          endptr      = nullptr;
-        constexpr int  STRTOL_BASE = 16;
-        constexpr long BYTE_MAX    = 0xFF;
-        long           val         = strtol(pair, &endptr, STRTOL_BASE);
-        if (endptr == pair || val < 0 || val > BYTE_MAX)
-            return false;
-        mac[i] = (uint8_t)val;
+        // fallback to global broadcast
+        constexpr uint8_t BROADCAST_OCTET = 255;
+        dest = IPAddress(BROADCAST_OCTET, BROADCAST_OCTET, BROADCAST_OCTET, BROADCAST_OCTET);
     }
-    return true;
+    return dest;
 }
 
-bool WakeOnLan::send(const char* macStr, const char* broadcastIp, uint16_t port)
+WakeOnLan::Sender& WakeOnLan::sender()
 {
-    if (!macStr)
-        return false;
+    static Sender instance;
+    return instance;
+}
 
-    uint8_t mac[MAC_LEN];
-    if (!parseMac(macStr, mac))
-        return false;
+WakeOnLan::Stats& WakeOnLan::stats()
+{
+    static Stats instance;
+    return instance;
+}
 
-    // Build magic packet: 6 x 0xFF followed by MAC repeated 16 times
-    constexpr size_t  SYNC_COUNT = 6;
-    constexpr size_t  MAC_REP    = 16;
-    constexpr uint8_t SYNC_BYTE  = 0xFF;
-    const size_t      packetSize = SYNC_COUNT + MAC_REP * MAC_LEN;
-    uint8_t           packet[packetSize];
-    for (size_t i = 0; i < SYNC_COUNT; ++i)
-        packet[i] = SYNC_BYTE;
-    for (size_t i = 0; i < MAC_REP; ++i)
+bool WakeOnLan::Sender::ensureSocket()
+{
+    if (!udpReady)
+        udpReady = (udp.begin(0) != 0);
+    return udpReady;
+}
+
+const uint8_t* WakeOnLan::Sender::packetFor(const uint8_t mac[MAC_LEN])
+{
+    // Linear scan is the right call at this size; track the least recently used slot
+    // (empty slots have lastUse == 0 and win) in the same pass.
+    Entry* victim = &cache[0];
+    for (size_t i = 0; i < CACHE_SIZE; ++i)
     {
-        memcpy(&packet[SYNC_COUNT + i * MAC_LEN], mac, MAC_LEN);
+        Entry& e = cache[i];
+        if (e.lastUse != 0 && memcmp(e.mac, mac, MAC_LEN) == 0)
+        {
+            e.lastUse = ++useClock;
+            hits++;
+            return e.packet;
+        }
+        if (e.lastUse < victim->lastUse)
+            victim = &e;
     }
 
-    WiFiUDP udp;
-    if (udp.begin(0) == 0)
+    misses++;
+    memcpy(victim->mac, mac, MAC_LEN);
+    buildPacket(mac, victim->packet);
+    victim->lastUse = ++useClock;
+    return victim->packet;
+}
+
+bool WakeOnLan::Sender::send(const uint8_t mac[MAC_LEN], const IPAddress& dest, uint16_t port)
+{
+    return sendPacket(packetFor(mac), dest, port);
+}
+
+bool WakeOnLan::Sender::sendPacket(const uint8_t packet[PACKET_LEN], const IPAddress& dest,
+                                   uint16_t port)
+{
+    if (!ensureSocket())
     {
         // couldn't start UDP
+        stats().socketFailures.inc();
         return false;
     }
 
-    IPAddress dest;
-    if (!dest.fromString(broadcastIp))
+    udp.beginPacket(dest, port == 0 ? WOL_PORT : port);
+    udp.write(packet, PACKET_LEN);
+    if (udp.endPacket() == 1)
     {
-        // fallback to global broadcast
-        constexpr uint8_t BROADCAST_OCTET = 255;
-        dest = IPAddress(BROADCAST_OCTET, BROADCAST_OCTET, BROADCAST_OCTET, BROADCAST_OCTET);
+        stats().sent.inc();
+        return true;
     }
 
-    udp.beginPacket(dest, port == 0 ? WOL_PORT : port);
-    udp.write(packet, packetSize);
-    bool ok = (udp.endPacket() == 1);
+    // The socket may have gone stale (e.g. interface came back up); rebind next time
+    stats().sendFailures.inc();
     udp.stop();
-    return ok;
+    udpReady = false;
+    return false;
 }
@@ -0,0 +1,299 @@
+// WakeQueue.cpp
+#define LOG_MODULE_LEVEL LOG_LEVEL_WOL
+#include "WakeQueue.h"
+#include "Logger.h"
+#include "SpscRing.h"
+
+static constexpr uint32_t    WORKER_STACK    = 4096;
+static constexpr UBaseType_t WORKER_PRIORITY = 2; // above the loop task (1)
+static constexpr uint32_t    STATE_BITS      = 3;
+static constexpr uint32_t    STATE_MASK      = (1u << STATE_BITS) - 1;
+static constexpr uint32_t    MAX_JOB_ID      = UINT32_MAX >> STATE_BITS;
+
+static_assert(WOL_BURST_MAX_ADDRS * WOL_BURST_MAX_PORTS * WOL_BURST_MAX_REPEATS <= 255,
+              "a burst's transmissions are counted in 8 bits");
+
+// A burst between rounds, owned by the worker
+struct Active
+{
+    WakeQueue::Job job;
+    uint32_t       dueMs; // next round
+    uint8_t        round; // rounds done
+    uint8_t        sent;
+    uint8_t        failed;
+};
+
+static SpscRing<WakeQueue::Job, WOL_QUEUE_DEPTH> ring;
+static TaskHandle_t                              worker    = nullptr;
+static uint32_t                                  nextId    = 1;
+static size_t                                    maxDepth  = 0;
+static uint32_t                                  fullCount = 0;
+static uint32_t                                  lastJob   = 0;
+
+// Bursts with rounds still to go; worker only
+static Active active[WOL_ACTIVE_BURSTS];
+static size_t activeCount = 0;
+
+// Recent job states, slot = id % WOL_JOB_HISTORY. Each slot packs (id << 3 | state)
+// into one word so the two tasks never see an id paired with another job's state. The
+// counts in `counts` (planned << 16 | sent << 8 | failed) are stored before the state.
+static std::atomic<uint32_t> history[WOL_JOB_HISTORY];
+static std::atomic<uint32_t> counts[WOL_JOB_HISTORY];
+
+static void setState(uint32_t id, WakeQueue::JobState state)
+{
+    history[id % WOL_JOB_HISTORY].store((id << STATE_BITS) | (uint32_t)state,
+                                        std::memory_order_release);
+}
+
+static void setCounts(uint32_t id, size_t planned, uint8_t sent, uint8_t failed)
+{
+    counts[id % WOL_JOB_HISTORY].store((uint32_t)planned << 16 | (uint32_t)sent << 8 | failed,
+                                       std::memory_order_release);
+}
+
+// Send one round of a burst and publish the counts. Returns true when it was the last.
+static bool runRound(WakeOnLan::Sender& sender, Active& a)
+{
+    const WakeQueue::Job&   job = a.job;
+    const WakeQueue::Burst& b   = job.burst;
+    for (size_t i = 0; i < b.addrCount; ++i)
+    {
+        IPAddress dest(b.addrs[i]);
+        for (size_t p = 0; p < b.portCount; ++p)
+        {
+            bool ok = job.prebuilt ? sender.sendPacket(job.packet, dest, b.ports[p])
+                                   : sender.send(job.mac, dest, b.ports[p]);
+            if (ok)
+                a.sent++;
+            else
+                a.failed++;
+        }
+    }
+    a.round++;
+
+    bool last = a.round >= b.repeats;
+    setCounts(job.id, b.transmissions(), a.sent, a.failed);
+    if (!last)
+        setState(job.id, WakeQueue::JobState::Sending);
+    else if (a.sent)
+        setState(job.id, WakeQueue::JobState::Sent);
+    else
+    {
+        setState(job.id, WakeQueue::JobState::Failed);
+        L_ERRORF("Wake job %u failed", (unsigned)job.id);
+    }
+    return last;
+}
+
+static void workerTask(void*)
+{
+    WakeOnLan::Sender& sender = WakeOnLan::sender();
+    for (;;)
+    {
+        // Sleep until a job is pushed or the next round is due. Notifications are
+        // counted, so a push that lands between the last pop and this call still wakes us.
+        uint32_t   now  = millis();
+        TickType_t wait = portMAX_DELAY;
+        for (size_t i = 0; i < activeCount; ++i)
+        {
+            int32_t left = (int32_t)(active[i].dueMs - now);
+            if (left <= 0)
+                wait = 0;
+            else if (pdMS_TO_TICKS(left) < wait)
+                wait = pdMS_TO_TICKS(left);
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+        now = millis();
+
+        for (size_t i = 0; i < activeCount;)
+        {
+            Active& a = active[i];
+            if ((int32_t)(now - a.dueMs) < 0)
+            {
+                ++i;
+                continue;
+            }
+            if (runRound(sender, a))
+                a = active[--activeCount];
+            else
+                a.dueMs = millis() + a.job.burst.intervalMs;
+        }
+
+        // A new job's first round goes out at once; jobs wait in the ring while every
+        // burst slot is busy
+        WakeQueue::Job job;
+        while (activeCount < WOL_ACTIVE_BURSTS && ring.pop(job))
+        {
+            Active& a = active[activeCount];
+            a.job     = job;
+            a.round   = 0;
+            a.sent    = 0;
+            a.failed  = 0;
+            if (!runRound(sender, a))
+            {
+                a.dueMs = millis() + job.burst.intervalMs;
+                activeCount++;
+            }
+        }
+    }
+}
+
+WakeQueue::Burst WakeQueue::Burst::single(const IPAddress& dest, uint16_t port)
+{
+    Burst b      = {};
+    b.repeats    = 1;
+    b.intervalMs = 0;
+    b.addAddr(dest);
+    b.addPort(port);
+    return b;
+}
+
+bool WakeQueue::Burst::addAddr(const IPAddress& addr)
+{
+    uint32_t a = (uint32_t)addr;
+    for (size_t i = 0; i < addrCount; ++i)
+        if (addrs[i] == a)
+            return true;
+    if (addrCount == WOL_BURST_MAX_ADDRS)
+        return false;
+    addrs[addrCount++] = a;
+    return true;
+}
+
+bool WakeQueue::Burst::addPort(uint16_t port)
+{
+    if (port == 0)
+        port = WakeOnLan::DEFAULT_PORT;
+    for (size_t i = 0; i < portCount; ++i)
+        if (ports[i] == port)
+            return true;
+    if (portCount == WOL_BURST_MAX_PORTS)
+        return false;
+    ports[portCount++] = port;
+    return true;
+}
+
+bool WakeQueue::begin()
+{
+    if (worker)
+        return true;
+    BaseType_t rc = xTaskCreatePinnedToCore(workerTask, "wol_send", WORKER_STACK, nullptr,
+                                            WORKER_PRIORITY, &worker, WOL_WORKER_CORE);
+    if (rc != pdPASS)
+    {
+        worker = nullptr;
+        L_ERROR("Failed to start WOL send worker");
+        return false;
+    }
+    L_INFOF("WOL send worker running on core %d", WOL_WORKER_CORE);
+    return true;
+}
+
+uint32_t WakeQueue::enqueue(const uint8_t mac[WakeOnLan::MAC_LEN], const IPAddress& broadcast,
+                            uint16_t port, const uint8_t* packet)
+{
+    return enqueue(mac, Burst::single(broadcast, port), packet);
+}
+
+uint32_t WakeQueue::enqueue(const uint8_t mac[WakeOnLan::MAC_LEN], const Burst& burst,
+                            const uint8_t* packet)
+{
+    if (!worker || burst.transmissions() == 0)
+        return 0;
+
+    Job job;
+    job.id = nextId;
+    memcpy(job.mac, mac, WakeOnLan::MAC_LEN);
+    job.prebuilt = packet != nullptr;
+    if (packet)
+        memcpy(job.packet, packet, WakeOnLan::PACKET_LEN);
+    job.burst = burst;
+
+    // Publish the state first so a fast worker's Sent/Failed is never overwritten
+    setCounts(job.id, burst.transmissions(), 0, 0);
+    setState(job.id, JobState::Queued);
+    if (!ring.push(job))
+    {
+        setState(job.id, JobState::Unknown);
+        fullCount++;
+        return 0;
+    }
+    lastJob = job.id;
+    nextId  = (nextId == MAX_JOB_ID) ? 1 : nextId + 1;
+
+    size_t d = ring.size();
+    if (d > maxDepth)
+        maxDepth = d;
+    xTaskNotifyGive(worker);
+    return job.id;
+}
+
+uint32_t WakeQueue::lastId()
+{
+    return lastJob;
+}
+
+WakeQueue::JobState WakeQueue::state(uint32_t id)
+{
+    if (id == 0 || id > MAX_JOB_ID)
+        return JobState::Unknown;
+    uint32_t v = history[id % WOL_JOB_HISTORY].load(std::memory_order_acquire);
+    if ((v >> STATE_BITS) != id)
+        return JobState::Unknown;
+    return (JobState)(v & STATE_MASK);
+}
+
+bool WakeQueue::report(uint32_t id, Report& out)
+{
+    if (id == 0 || id > MAX_JOB_ID)
+        return false;
+    // The worker stores the counts before the state, so an unchanged state word around
+    // the read means the counts belong to this job
+    std::atomic<uint32_t>& slot = history[id % WOL_JOB_HISTORY];
+    uint32_t               v, c;
+    do
+    {
+        v = slot.load(std::memory_order_acquire);
+        c = counts[id % WOL_JOB_HISTORY].load(std::memory_order_acquire);
+    } while (slot.load(std::memory_order_acquire) != v);
+    if ((v >> STATE_BITS) != id)
+        return false;
+    out.state   = (JobState)(v & STATE_MASK);
+    out.planned = (uint8_t)(c >> 16);
+    out.sent    = (uint8_t)(c >> 8);
+    out.failed  = (uint8_t)c;
+    return true;
+}
+
+const char* WakeQueue::stateName(JobState state)
+{
+    switch (state)
+    {
+        case JobState::Queued:
+            return "queued";
+        case JobState::Sent:
+            return "sent";
+        case JobState::Failed:
+            return "failed";
+        case JobState::Sending:
+            return "sending";
+        default:
+            return "unknown";
+    }
+}
+
+size_t WakeQueue::depth()
+{
+    return ring.size();
+}
+
+size_t WakeQueue::highWater()
+{
+    return maxDepth;
+}
+
+uint32_t WakeQueue::rejected()
+{
+    return fullCount;
+}
@@ -0,0 +1,778 @@
+// WakeRelay.cpp
+#define LOG_MODULE_LEVEL LOG_LEVEL_WOL
+#include "WakeRelay.h"
+#include <Preferences.h>
+#include <WiFi.h>
+#include <esp_system.h>
+#include <lwip/sockets.h>
+#include <unistd.h>
+#include "Logger.h"
+#include "SipHash.h"
+
+static constexpr const char* NVS_NAMESPACE = "relay";
+static constexpr const char* CONFIG_KEY    = "config";
+
+// A datagram is a header, a body, and the first TAG_LEN bytes of SipHash-2-4 over both.
+// Header: 'S' 'R', version, type, sender's boot nonce, receiver's boot nonce (0 when not
+// known yet), sender's sequence number.
+static constexpr uint8_t MAGIC_0     = 'S';
+static constexpr uint8_t MAGIC_1     = 'R';
+static constexpr uint8_t VERSION     = 1;
+static constexpr size_t  HEADER_LEN  = 16;
+static constexpr size_t  TAG_LEN     = 8;
+static constexpr size_t  MAX_MESSAGE = 64;
+static constexpr size_t  GOSSIP_MAX  = 4;  // peers named in one hello
+static constexpr size_t  ANSWERS     = 16; // wake answers kept for duplicates
+static constexpr uint8_t WINDOW      = 32; // sequence numbers tracked behind the newest
+
+// Hello: subnet, prefix, count, then count x (address, port)
+static constexpr size_t HELLO_LEN = 6 + GOSSIP_MAX * 6;
+// Wake: address, MAC, repeats, interval, port count, ports
+static constexpr size_t WAKE_LEN = 4 + WakeOnLan::MAC_LEN + 4 + WOL_BURST_MAX_PORTS * 2;
+// Ack: sequence number answered, outcome, job
+static constexpr size_t ACK_LEN = 9;
+static_assert(HEADER_LEN + HELLO_LEN + TAG_LEN <= MAX_MESSAGE, "hello too long");
+static_assert(HEADER_LEN + WAKE_LEN + TAG_LEN <= MAX_MESSAGE, "wake too long");
+static_assert(HEADER_LEN + ACK_LEN + TAG_LEN <= MAX_MESSAGE, "ack too long");
+
+enum class Type : uint8_t
+{
+    Hello = 1,
+    Wake  = 2,
+    Ack   = 3,
+};
+
+enum class Outcome : uint8_t
+{
+    Queued  = 1,
+    Full    = 2,
+    NotMine = 3, // the address is not in the receiver's subnet
+};
+
+using State = WakeRelay::State;
+using Peer  = WakeRelay::Peer;
+
+struct Message
+{
+    uint8_t bytes[MAX_MESSAGE];
+    size_t  len;
+
+    void put8(uint8_t v) { bytes[len++] = v; }
+    void put16(uint16_t v)
+    {
+        put8((uint8_t)(v >> 8));
+        put8((uint8_t)v);
+    }
+    void put32(uint32_t v)
+    {
+        put16((uint16_t)(v >> 16));
+        put16((uint16_t)v);
+    }
+    // An address already in network byte order
+    void putAddr(uint32_t addr)
+    {
+        memcpy(bytes + len, &addr, 4);
+        len += 4;
+    }
+};
+
+struct Reader
+{
+    const uint8_t* p;
+    size_t         left;
+    bool           ok;
+
+    uint8_t get8()
+    {
+        if (!left)
+        {
+            ok = false;
+            return 0;
+        }
+        left--;
+        return *p++;
+    }
+    uint16_t get16()
+    {
+        uint16_t hi = get8();
+        return (uint16_t)(hi << 8 | get8());
+    }
+    uint32_t get32()
+    {
+        uint32_t hi = get16();
+        return hi << 16 | get16();
+    }
+    uint32_t getAddr()
+    {
+        uint32_t addr = 0;
+        if (left < 4)
+        {
+            ok   = false;
+            left = 0;
+            return 0;
+        }
+        memcpy(&addr, p, 4);
+        p += 4;
+        left -= 4;
+        return addr;
+    }
+};
+
+struct Forward
+{
+    uint32_t id; // 0 = never used
+    State    state;
+    uint32_t addr;
+    uint16_t port;
+    uint32_t seq;
+    uint32_t job;
+    uint8_t  attempts;
+    uint32_t nextMs;
+    uint32_t backoffMs;
+    Message  msg;
+};
+
+// How a wake from a peer was answered, to answer its retransmissions the same way
+struct Answer
+{
+    uint32_t addr;
+    uint16_t port;
+    uint32_t nonce;
+    uint32_t seq;
+    Outcome  outcome;
+    uint32_t job;
+};
+
+static WakeRelay::Config cfg;
+static Peer              peerTable[RELAY_MAX_PEERS];
+static Forward           forwards[RELAY_PENDING];
+static Answer            answers[ANSWERS];
+static size_t            nextAnswer = 0;
+static int               sock       = -1;
+static uint32_t          nonce      = 0; // this boot's
+static uint32_t          nextSeq    = 1;
+static uint32_t          nextId     = 1;
+static uint32_t          helloDueMs = 0;
+static Preferences       prefs;
+static bool              prefsReady = false;
+
+static_assert(WakeRelay::KEY_LEN == siphash::KEY_LEN, "the relay key is a SipHash key");
+
+static void tag(const uint8_t* data, size_t len, uint8_t out[TAG_LEN])
+{
+    uint64_t h = siphash::hash24(cfg.key, data, len);
+    for (size_t i = 0; i < TAG_LEN; ++i, h >>= 8)
+        out[i] = (uint8_t)h;
+}
+
+static bool authentic(const uint8_t* data, size_t len)
+{
+    uint8_t expected[TAG_LEN];
+    tag(data, len - TAG_LEN, expected);
+    uint8_t diff = 0; // no early exit, so timing does not tell how much matched
+    for (size_t i = 0; i < TAG_LEN; ++i)
+        diff |= expected[i] ^ data[len - TAG_LEN + i];
+    return diff == 0;
+}
+
+static uint32_t start(Message& m, Type type, uint32_t to)
+{
+    uint32_t seq = nextSeq++;
+    m.len        = 0;
+    m.put8(MAGIC_0);
+    m.put8(MAGIC_1);
+    m.put8(VERSION);
+    m.put8((uint8_t)type);
+    m.put32(nonce);
+    m.put32(to);
+    m.put32(seq);
+    return seq;
+}
+
+static void seal(Message& m)
+{
+    tag(m.bytes, m.len, m.bytes + m.len);
+    m.len += TAG_LEN;
+}
+
+static void sendTo(uint32_t addr, uint16_t port, const Message& m)
+{
+    sockaddr_in to     = {};
+    to.sin_family      = AF_INET;
+    to.sin_addr.s_addr = addr;
+    to.sin_port        = htons(port);
+    sendto(sock, m.bytes, m.len, 0, (const sockaddr*)&to, sizeof(to));
+}
+
+static bool contains(uint32_t net, uint8_t prefix, uint32_t addr)
+{
+    if (prefix == 0 || prefix > 32)
+        return false; // a node without a subnet owns nothing
+    uint32_t mask = htonl(prefix == 32 ? 0xFFFFFFFFu : ~(0xFFFFFFFFu >> prefix));
+    return (addr & mask) == (net & mask);
+}
+
+// The station's subnet; none while it is not connected
+static uint8_t ownSubnet(uint32_t& net)
+{
+    net = 0;
+    if (WiFi.status() != WL_CONNECTED)
+        return 0;
+    uint32_t mask = (uint32_t)WiFi.subnetMask();
+    net           = (uint32_t)WiFi.localIP() & mask;
+    return (uint8_t)__builtin_popcount(mask);
+}
+
+static bool isSeed(const Peer& p)
+{
+    for (const WakeRelay::Seed& s : cfg.seeds)
+    {
+        if (s.addr && s.addr == p.addr && s.port == p.port)
+            return true;
+    }
+    return false;
+}
+
+static Peer* find(uint32_t addr, uint16_t port)
+{
+    for (Peer& p : peerTable)
+    {
+        if (p.addr == addr && p.port == port)
+            return &p;
+    }
+    return nullptr;
+}
+
+// Find or add the peer at addr:port. A new one takes a free slot, or the one of a node
+// that stopped answering; nullptr when every slot holds a live node or a seed.
+static Peer* learn(uint32_t addr, uint16_t port, uint32_t nowMs)
+{
+    Peer* p = find(addr, port);
+    if (p)
+        return p;
+    for (Peer& q : peerTable)
+    {
+        if (!q.addr || (!WakeRelay::alive(q, nowMs) && !isSeed(q)))
+        {
+            q         = {};
+            q.addr    = addr;
+            q.port    = port;
+            q.heardMs = nowMs;
+            return &q;
+        }
+    }
+    return nullptr;
+}
+
+enum class Seq
+{
+    New,
+    Duplicate,
+    Stale, // too far behind the newest to tell
+};
+
+// Sliding window over a peer's sequence numbers, as IPsec's anti-replay check
+static Seq accept(Peer& p, uint32_t seq)
+{
+    if (seq > p.highSeq)
+    {
+        uint32_t shift = seq - p.highSeq;
+        p.seen         = (shift >= WINDOW ? 0 : p.seen << shift) | 1;
+        p.highSeq      = seq;
+        return Seq::New;
+    }
+    uint32_t back = p.highSeq - seq;
+    if (back >= WINDOW)
+        return Seq::Stale;
+    if (p.seen & (1u << back))
+        return Seq::Duplicate;
+    p.seen |= 1u << back;
+    return Seq::New;
+}
+
+static void sendHello(const Peer& to, uint32_t nowMs)
+{
+    Message m;
+    start(m, Type::Hello, to.nonce);
+    uint32_t net;
+    uint8_t  prefix = ownSubnet(net);
+    m.putAddr(net);
+    m.put8(prefix);
+    // Name the live nodes it may not know, so one seed is enough to join
+    size_t countAt = m.len;
+    m.put8(0);
+    for (const Peer& p : peerTable)
+    {
+        if (m.bytes[countAt] == GOSSIP_MAX)
+            break;
+        if (&p == &to || !WakeRelay::alive(p, nowMs))
+            continue;
+        m.putAddr(p.addr);
+        m.put16(p.port);
+        m.bytes[countAt]++;
+    }
+    seal(m);
+    sendTo(to.addr, to.port, m);
+}
+
+static void sendAck(const Peer& to, uint32_t seq, Outcome outcome, uint32_t job)
+{
+    Message m;
+    start(m, Type::Ack, to.nonce);
+    m.put32(seq);
+    m.put8((uint8_t)outcome);
+    m.put32(job);
+    seal(m);
+    sendTo(to.addr, to.port, m);
+}
+
+static void onHello(Peer& p, uint32_t from, uint32_t to, uint32_t seq, Reader& r,
+                    uint32_t nowMs)
+{
+    uint32_t net    = r.getAddr();
+    uint8_t  prefix = r.get8();
+    uint8_t  count  = r.get8();
+    if (!r.ok || prefix > 32 || count > GOSSIP_MAX)
+        return;
+
+    if (from != p.nonce)
+    {
+        // A new boot of the node, or the first word from it. Once its nonce is known, a
+        // change has to name ours, so an old hello played back cannot reset the window.
+        if (p.nonce && to != nonce)
+        {
+            sendHello(p, nowMs);
+            return;
+        }
+        IPAddress ip(p.addr);
+        L_INFOF("Relay peer %u.%u.%u.%u:%u is up", ip[0], ip[1], ip[2], ip[3], (unsigned)p.port);
+        p.nonce   = from;
+        p.highSeq = 0;
+        p.seen    = 0;
+    }
+    if (accept(p, seq) != Seq::New)
+        return;
+    p.net     = net;
+    p.prefix  = prefix;
+    p.heardMs = nowMs;
+
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        uint32_t addr = r.getAddr();
+        uint16_t port = r.get16();
+        if (r.ok && addr && port)
+            learn(addr, port, nowMs);
+    }
+    // It does not know this boot of ours yet: tell it now rather than at the next round
+    if (to != nonce)
+        sendHello(p, nowMs);
+}
+
+static void answer(const Peer& p, uint32_t seq, Outcome outcome, uint32_t job)
+{
+    Answer& a = answers[nextAnswer++ % ANSWERS];
+    a.addr    = p.addr;
+    a.port    = p.port;
+    a.nonce   = p.nonce;
+    a.seq     = seq;
+    a.outcome = outcome;
+    a.job     = job;
+    sendAck(p, seq, outcome, job);
+}
+
+static void onWake(Peer& p, uint32_t seq, Reader& r)
+{
+    Seq s = accept(p, seq);
+    if (s == Seq::Stale)
+    {
+        WakeRelay::stats().rejected.inc();
+        return;
+    }
+    if (s == Seq::Duplicate)
+    {
+        // Our acknowledgement was lost: repeat it rather than wake twice
+        for (const Answer& a : answers)
+        {
+            if (a.seq == seq && a.nonce == p.nonce && a.addr == p.addr && a.port == p.port)
+                sendAck(p, seq, a.outcome, a.job);
+        }
+        return;
+    }
+
+    uint32_t dest = r.getAddr();
+    uint8_t  mac[WakeOnLan::MAC_LEN];
+    for (uint8_t& b : mac)
+        b = r.get8();
+    uint8_t  repeats    = r.get8();
+    uint16_t intervalMs = r.get16();
+    uint8_t  portCount  = r.get8();
+    uint16_t ports[WOL_BURST_MAX_PORTS];
+    for (uint8_t i = 0; i < portCount && i < WOL_BURST_MAX_PORTS; ++i)
+        ports[i] = r.get16();
+    if (!r.ok || repeats < 1 || repeats > WOL_BURST_MAX_REPEATS ||
+        intervalMs > WOL_BURST_MAX_INTERVAL_MS || portCount < 1 ||
+        portCount > WOL_BURST_MAX_PORTS)
+    {
+        WakeOnLan::stats().parseFailures.inc();
+        WakeRelay::stats().rejected.inc();
+        return;
+    }
+
+    uint32_t net;
+    uint8_t  prefix = ownSubnet(net);
+    if (!contains(net, prefix, dest))
+    {
+        answer(p, seq, Outcome::NotMine, 0);
+        return;
+    }
+    // The limited broadcast reaches this segment whatever address the sender gave
+    WakeQueue::Burst b = {};
+    b.addAddr(IPAddress(255, 255, 255, 255));
+    for (uint8_t i = 0; i < portCount; ++i)
+        b.addPort(ports[i]);
+    b.repeats    = repeats;
+    b.intervalMs = intervalMs;
+
+    uint32_t job = WakeQueue::enqueue(mac, b);
+    answer(p, seq, job ? Outcome::Queued : Outcome::Full, job);
+    if (!job)
+        return;
+    WakeRelay::stats().accepted.inc();
+    IPAddress ip(p.addr);
+    L_INFOF("Relayed wake for %02x:%02x:%02x:%02x:%02x:%02x from %u.%u.%u.%u queued as job %u",
+            mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], ip[0], ip[1], ip[2], ip[3],
+            (unsigned)job);
+}
+
+static void onAck(const Peer& p, Reader& r)
+{
+    uint32_t seq     = r.get32();
+    uint8_t  outcome = r.get8();
+    uint32_t job     = r.get32();
+    if (!r.ok)
+        return;
+    for (Forward& f : forwards)
+    {
+        if (f.state != State::Pending || f.seq != seq || f.addr != p.addr || f.port != p.port)
+            continue;
+        f.job   = job;
+        f.state = outcome == (uint8_t)Outcome::Queued ? State::Queued : State::Refused;
+        if (f.state == State::Refused)
+            L_WARNINGF("Relay %u refused by its owner (%u)", (unsigned)f.id, (unsigned)outcome);
+        return;
+    }
+}
+
+static void handle(const uint8_t* data, size_t len, uint32_t addr, uint16_t port,
+                   uint32_t nowMs)
+{
+    if (len < HEADER_LEN + TAG_LEN || data[0] != MAGIC_0 || data[1] != MAGIC_1 ||
+        data[2] != VERSION || !authentic(data, len))
+    {
+        WakeRelay::stats().rejected.inc();
+        return;
+    }
+    Reader   r    = {data, len - TAG_LEN, true};
+    uint32_t head = r.get32();
+    Type     type = (Type)(head & 0xFF);
+    uint32_t from = r.get32();
+    uint32_t to   = r.get32();
+    uint32_t seq  = r.get32();
+
+    Peer* p = find(addr, port);
+    if (from == nonce)
+    {
+        // Our own hello, sent to a seed or a gossiped address that is this node
+        if (p && !isSeed(*p))
+            *p = {};
+        return;
+    }
+    if (type == Type::Hello)
+    {
+        p = p ? p : learn(addr, port, nowMs);
+        if (p)
+            onHello(*p, from, to, seq, r, nowMs);
+        return;
+    }
+    // Anything else must come from this boot of a known node, for this boot of ours
+    if (!p || !p->nonce || from != p->nonce || to != nonce)
+    {
+        WakeRelay::stats().rejected.inc();
+        return;
+    }
+    if (type == Type::Wake)
+        onWake(*p, seq, r);
+    else if (type == Type::Ack && accept(*p, seq) == Seq::New)
+        onAck(*p, r);
+}
+
+static void receive(uint32_t nowMs)
+{
+    uint8_t     buf[MAX_MESSAGE + 1]; // one more, so an oversized datagram shows
+    sockaddr_in from;
+    socklen_t   fromLen = sizeof(from);
+    ssize_t     n;
+    while ((n = recvfrom(sock, buf, sizeof(buf), 0, (sockaddr*)&from, &fromLen)) >= 0)
+    {
+        if ((size_t)n <= MAX_MESSAGE)
+            handle(buf, (size_t)n, from.sin_addr.s_addr, ntohs(from.sin_port), nowMs);
+        else
+            WakeRelay::stats().rejected.inc();
+        fromLen = sizeof(from);
+    }
+}
+
+static void retransmit(uint32_t nowMs)
+{
+    for (Forward& f : forwards)
+    {
+        if (f.state != State::Pending || (int32_t)(nowMs - f.nextMs) < 0)
+            continue;
+        if (f.attempts >= RELAY_ATTEMPTS)
+        {
+            f.state = State::Failed;
+            WakeRelay::stats().failed.inc();
+            IPAddress ip(f.addr);
+            L_WARNINGF("Relay %u: no acknowledgement from %u.%u.%u.%u:%u", (unsigned)f.id,
+                       ip[0], ip[1], ip[2], ip[3], (unsigned)f.port);
+            continue;
+        }
+        sendTo(f.addr, f.port, f.msg);
+        f.attempts++;
+        f.nextMs = nowMs + f.backoffMs;
+        f.backoffMs *= 2;
+    }
+}
+
+static void announce(uint32_t nowMs)
+{
+    for (Peer& p : peerTable)
+    {
+        if (!p.addr)
+            continue;
+        // Gossiped addresses that never answered, and nodes gone quiet, are dropped
+        if (!isSeed(p) && nowMs - p.heardMs > RELAY_PEER_TTL_MS)
+        {
+            p = {};
+            continue;
+        }
+        if (!WakeRelay::alive(p, nowMs))
+            p.nonce = 0;
+        sendHello(p, nowMs);
+    }
+}
+
+static void restart()
+{
+    if (sock >= 0)
+        close(sock);
+    sock = -1;
+    for (Peer& p : peerTable)
+        p = {};
+    for (Forward& f : forwards)
+    {
+        if (f.state == State::Pending)
+            f.state = State::Failed;
+    }
+    if (!WakeRelay::enabled())
+        return;
+
+    uint32_t nowMs = millis();
+    for (const WakeRelay::Seed& s : cfg.seeds)
+    {
+        if (s.addr && s.port)
+            learn(s.addr, s.port, nowMs);
+    }
+
+    sockaddr_in addr     = {};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port        = htons(cfg.port);
+    sock                 = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0 || bind(sock, (const sockaddr*)&addr, sizeof(addr)) != 0 ||
+        fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK) < 0)
+    {
+        if (sock >= 0)
+            close(sock);
+        sock = -1;
+        L_ERRORF("Could not open relay port %u", (unsigned)cfg.port);
+        return;
+    }
+    helloDueMs = nowMs;
+    L_INFOF("Relay listening on port %u", (unsigned)cfg.port);
+}
+
+void WakeRelay::begin()
+{
+    while (!nonce)
+        nonce = esp_random();
+    prefsReady = prefs.begin(NVS_NAMESPACE, false);
+    if (!prefsReady || prefs.getBytes(CONFIG_KEY, &cfg, sizeof(cfg)) != sizeof(cfg))
+    {
+        cfg      = {};
+        cfg.port = RELAY_PORT;
+        if (RELAY_KEY[0] && !parseKey(RELAY_KEY, cfg.key))
+            L_WARNING("RELAY_KEY is not 32 hex digits; relaying stays off");
+    }
+    restart();
+}
+
+const WakeRelay::Config& WakeRelay::config()
+{
+    return cfg;
+}
+
+bool WakeRelay::configure(const Config& c)
+{
+    cfg = c;
+    restart();
+    return prefsReady && prefs.putBytes(CONFIG_KEY, &cfg, sizeof(cfg)) == sizeof(cfg);
+}
+
+bool WakeRelay::enabled()
+{
+    uint8_t any = 0;
+    for (uint8_t b : cfg.key)
+        any |= b;
+    return cfg.port && any;
+}
+
+bool WakeRelay::parseKey(const char* hex, uint8_t key[KEY_LEN])
+{
+    if (!hex || strlen(hex) != 2 * KEY_LEN)
+        return false;
+    for (size_t i = 0; i < 2 * KEY_LEN; ++i)
+    {
+        char    c = hex[i];
+        uint8_t v;
+        if (c >= '0' && c <= '9')
+            v = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            v = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            v = c - 'A' + 10;
+        else
+            return false;
+        key[i / 2] = (uint8_t)(i & 1 ? key[i / 2] | v : v << 4);
+    }
+    return true;
+}
+
+void WakeRelay::poll(uint32_t nowMs)
+{
+    if (sock < 0)
+        return;
+    receive(nowMs);
+    retransmit(nowMs);
+    if ((int32_t)(nowMs - helloDueMs) >= 0)
+    {
+        helloDueMs = nowMs + RELAY_HELLO_MS;
+        announce(nowMs);
+    }
+}
+
+const WakeRelay::Peer* WakeRelay::owner(const IPAddress& dest)
+{
+    uint32_t d = (uint32_t)dest;
+    uint32_t net;
+    uint8_t  prefix = ownSubnet(net);
+    if (sock < 0 || d == 0xFFFFFFFFu || contains(net, prefix, d))
+        return nullptr;
+    // The most specific subnet wins, as in a routing table
+    uint32_t    nowMs = millis();
+    const Peer* best  = nullptr;
+    for (const Peer& p : peerTable)
+    {
+        if (alive(p, nowMs) && contains(p.net, p.prefix, d) && (!best || p.prefix > best->prefix))
+            best = &p;
+    }
+    return best;
+}
+
+uint32_t WakeRelay::forward(const uint8_t mac[WakeOnLan::MAC_LEN], const IPAddress& dest,
+                            const WakeQueue::Burst& burst)
+{
+    const Peer* p = owner(dest);
+    Forward&    f = forwards[nextId % RELAY_PENDING];
+    if (!p || f.state == State::Pending || burst.portCount == 0)
+        return 0;
+
+    f       = {};
+    f.id    = nextId++;
+    f.state = State::Pending;
+    f.addr  = p->addr;
+    f.port  = p->port;
+    f.seq   = start(f.msg, Type::Wake, p->nonce);
+    f.msg.putAddr((uint32_t)dest);
+    for (size_t i = 0; i < WakeOnLan::MAC_LEN; ++i)
+        f.msg.put8(mac[i]);
+    f.msg.put8(burst.repeats);
+    f.msg.put16(burst.intervalMs);
+    f.msg.put8(burst.portCount);
+    for (size_t i = 0; i < burst.portCount; ++i)
+        f.msg.put16(burst.ports[i]);
+    seal(f.msg);
+
+    uint32_t nowMs = millis();
+    sendTo(f.addr, f.port, f.msg);
+    f.attempts  = 1;
+    f.nextMs    = nowMs + RELAY_RETRY_MS;
+    f.backoffMs = RELAY_RETRY_MS * 2;
+    stats().forwarded.inc();
+    return f.id;
+}
+
+bool WakeRelay::status(uint32_t id, Status& out)
+{
+    const Forward& f = forwards[id % RELAY_PENDING];
+    if (!id || f.id != id)
+        return false;
+    out.state    = f.state;
+    out.peerAddr = f.addr;
+    out.peerPort = f.port;
+    out.job      = f.job;
+    out.attempts = f.attempts;
+    return true;
+}
+
+const char* WakeRelay::stateName(State state)
+{
+    switch (state)
+    {
+        case State::Pending:
+            return "pending";
+        case State::Queued:
+            return "queued";
+        case State::Refused:
+            return "refused";
+        case State::Failed:
+            return "failed";
+        default:
+            return "unknown";
+    }
+}
+
+const WakeRelay::Peer* WakeRelay::peers()
+{
+    return peerTable;
+}
+
+bool WakeRelay::alive(const Peer& p, uint32_t nowMs)
+{
+    return p.addr && p.nonce && nowMs - p.heardMs <= RELAY_PEER_TTL_MS;
+}
+
+uint32_t WakeRelay::livePeers()
+{
+    uint32_t nowMs = millis();
+    uint32_t n     = 0;
+    for (const Peer& p : peerTable)
+        n += alive(p, nowMs);
+    return n;
+}
+
+WakeRelay::Stats& WakeRelay::stats()
+{
+    static Stats instance;
+    return instance;
+}
@@ -0,0 +1,377 @@
+// WakeVerifier.cpp
+#define LOG_MODULE_LEVEL LOG_LEVEL_WOL
+#include "WakeVerifier.h"
+#include <WiFi.h>
+#include <lwip/etharp.h>
+#include <lwip/priv/tcpip_priv.h>
+#include <lwip/sockets.h>
+#include <unistd.h>
+#include "Logger.h"
+
+static constexpr uint8_t  ICMP_ECHO_REPLY   = 0;
+static constexpr uint8_t  ICMP_ECHO_REQUEST = 8;
+static constexpr uint16_t ECHO_ID           = 0x574C; // "WL", tells our replies apart
+static constexpr uint32_t MAX_SWEEP_HOSTS   = 1022;   // a /22; larger subnets are not swept
+
+using State = WakeVerifier::State;
+
+struct Entry
+{
+    uint32_t id; // 0 = never used
+    uint32_t job;
+    uint32_t hostId;
+    uint8_t  mac[WakeOnLan::MAC_LEN];
+    uint32_t ip; // network byte order, 0 while resolving
+    State    state;
+    uint32_t startMs;
+    uint32_t nextMs;    // next ping
+    uint32_t backoffMs; // wait after the next ping
+    uint32_t doneMs;    // elapsed when it finished
+    uint16_t probes;
+};
+
+// ICMP echo header and our payload: the verification id, checked in the reply
+struct Echo
+{
+    uint8_t  type;
+    uint8_t  code;
+    uint16_t checksum;
+    uint16_t id;
+    uint16_t seq; // entry slot
+    uint32_t verification;
+};
+
+static Entry    entries[WOL_VERIFY_MAX];
+static size_t   pending    = 0; // entries resolving or probing
+static size_t   nextSlot   = 0; // where the search for a free slot starts
+static int      sock       = -1;
+static bool     sockFailed = false;
+static uint32_t ups        = 0;
+static uint32_t timeouts   = 0;
+
+static WakeVerifier::HostStats stats[WOL_VERIFY_HOST_STATS];
+static uint32_t                statsClock = 0;
+
+// The ARP sweep: host numbers 1..sweepHosts of sweepNet, in turn
+static uint32_t sweepNet   = 0; // host byte order
+static uint32_t sweepHosts = 0;
+static uint32_t sweepNext  = 1;
+static uint32_t arpDueMs   = 0;
+
+static bool isPending(const Entry& e)
+{
+    return e.state == State::Resolving || e.state == State::Probing;
+}
+
+static bool openSocket()
+{
+    if (sock >= 0 || sockFailed)
+        return sock >= 0;
+    sock = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
+    if (sock < 0 || fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK) < 0)
+    {
+        if (sock >= 0)
+            close(sock);
+        sock       = -1;
+        sockFailed = true;
+        L_ERROR("Could not open an ICMP socket; wakes cannot be verified");
+        return false;
+    }
+    return true;
+}
+
+static uint16_t checksum(const void* data, size_t len)
+{
+    const uint8_t* p   = (const uint8_t*)data;
+    uint32_t       sum = 0;
+    for (size_t i = 0; i + 1 < len; i += 2)
+        sum += (uint32_t)p[i] << 8 | p[i + 1];
+    if (len & 1)
+        sum += (uint32_t)p[len - 1] << 8;
+    while (sum >> 16)
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    return htons((uint16_t)~sum);
+}
+
+static void sendEcho(Entry& e, size_t slot)
+{
+    Echo echo         = {};
+    echo.type         = ICMP_ECHO_REQUEST;
+    echo.id           = htons(ECHO_ID);
+    echo.seq          = htons((uint16_t)slot);
+    echo.verification = e.id;
+    echo.checksum     = checksum(&echo, sizeof(echo));
+
+    sockaddr_in to     = {};
+    to.sin_family      = AF_INET;
+    to.sin_addr.s_addr = e.ip;
+    sendto(sock, &echo, sizeof(echo), 0, (const sockaddr*)&to, sizeof(to));
+    e.probes++;
+}
+
+static WakeVerifier::HostStats* statsFor(uint32_t hostId, bool create)
+{
+    WakeVerifier::HostStats* oldest = &stats[0];
+    for (auto& s : stats)
+    {
+        if (s.hostId == hostId)
+        {
+            if (create)
+                s.lastUse = ++statsClock; // a new measurement, not a read
+            return &s;
+        }
+        if (s.lastUse < oldest->lastUse)
+            oldest = &s;
+    }
+    if (!create)
+        return nullptr;
+    *oldest         = {};
+    oldest->hostId  = hostId;
+    oldest->lastUse = ++statsClock;
+    return oldest;
+}
+
+static void finish(Entry& e, State state, uint32_t nowMs)
+{
+    e.state  = state;
+    e.doneMs = nowMs - e.startMs;
+    pending--;
+    IPAddress ip(e.ip);
+    if (state == State::Up)
+    {
+        ups++;
+        L_INFOF("Wake job %u: %u.%u.%u.%u up after %u ms", (unsigned)e.job, ip[0], ip[1],
+                ip[2], ip[3], (unsigned)e.doneMs);
+    }
+    else if (state == State::TimedOut)
+    {
+        timeouts++;
+        if (e.ip)
+            L_WARNINGF("Wake job %u: no answer after %u pings", (unsigned)e.job,
+                       (unsigned)e.probes);
+        else
+            L_WARNINGF("Wake job %u: MAC never showed up in the ARP table", (unsigned)e.job);
+    }
+    if (!e.hostId || (state != State::Up && state != State::TimedOut))
+        return;
+
+    WakeVerifier::HostStats* s = statsFor(e.hostId, true);
+    if (state == State::TimedOut)
+    {
+        s->timeouts++;
+        return;
+    }
+    size_t b = 0;
+    while (b < WakeVerifier::BUCKETS - 1 && e.doneMs > WakeVerifier::BOUNDS_S[b] * 1000u)
+        b++;
+    s->buckets[b]++;
+    s->count++;
+    s->sumMs += e.doneMs;
+    if (e.doneMs > s->maxMs)
+        s->maxMs = e.doneMs;
+}
+
+// Collect every echo reply that has arrived. Raw sockets hand over the IP header too
+// on lwIP, so it is skipped when present.
+static void readReplies(uint32_t nowMs)
+{
+    uint8_t     buf[128];
+    sockaddr_in from;
+    socklen_t   fromLen = sizeof(from);
+    ssize_t     n;
+    while ((n = recvfrom(sock, buf, sizeof(buf), 0, (sockaddr*)&from, &fromLen)) > 0)
+    {
+        fromLen    = sizeof(from);
+        size_t off = (buf[0] >> 4) == 4 ? (size_t)(buf[0] & 0x0F) * 4 : 0;
+        if ((size_t)n < off + sizeof(Echo))
+            continue;
+        Echo echo;
+        memcpy(&echo, buf + off, sizeof(echo));
+        uint16_t slot = ntohs(echo.seq);
+        if (echo.type != ICMP_ECHO_REPLY || ntohs(echo.id) != ECHO_ID || slot >= WOL_VERIFY_MAX)
+            continue;
+        Entry& e = entries[slot];
+        if (e.id == echo.verification && e.state == State::Probing &&
+            e.ip == from.sin_addr.s_addr)
+            finish(e, State::Up, nowMs);
+    }
+}
+
+// Set the sweep to the subnet the board is on, or leave it empty when that is too big
+static void planSweep()
+{
+    uint32_t ip, mask;
+    if (WiFi.status() == WL_CONNECTED)
+    {
+        ip   = ntohl((uint32_t)WiFi.localIP());
+        mask = ntohl((uint32_t)WiFi.subnetMask());
+    }
+    else
+    {
+        ip   = ntohl((uint32_t)WiFi.softAPIP());
+        mask = 0xFFFFFF00; // the ESP32 core's soft AP is a /24
+    }
+    sweepNet   = ip & mask;
+    sweepHosts = ~mask > MAX_SWEEP_HOSTS + 1 || ~mask < 2 || !ip ? 0 : ~mask - 1;
+    if (sweepNext > sweepHosts)
+        sweepNext = 1;
+}
+
+// Runs on the tcpip thread while the loop task waits: looks for the MACs being resolved
+// in the ARP table, then sends the next batch of the sweep
+static err_t arpStep(struct tcpip_api_call_data*)
+{
+    for (size_t i = 0; i < ARP_TABLE_SIZE; ++i)
+    {
+        ip4_addr_t*      ip;
+        struct netif*    netif;
+        struct eth_addr* eth;
+        if (!etharp_get_entry(i, &ip, &netif, &eth))
+            continue;
+        for (auto& e : entries)
+            if (e.state == State::Resolving && memcmp(eth->addr, e.mac, sizeof(e.mac)) == 0)
+                e.ip = ip->addr;
+    }
+    if (!netif_default)
+        return ERR_IF;
+    for (size_t n = 0; n < WOL_VERIFY_ARP_BATCH && sweepHosts; ++n)
+    {
+        ip4_addr_t target;
+        target.addr = htonl(sweepNet + sweepNext);
+        sweepNext   = sweepNext == sweepHosts ? 1 : sweepNext + 1;
+        etharp_request(netif_default, &target);
+    }
+    return ERR_OK;
+}
+
+uint32_t WakeVerifier::start(uint32_t job, const uint8_t mac[WakeOnLan::MAC_LEN],
+                             const IPAddress& ip, uint32_t hostId)
+{
+    size_t slot = 0;
+    while (slot < WOL_VERIFY_MAX && isPending(entries[(nextSlot + slot) % WOL_VERIFY_MAX]))
+        slot++;
+    if (slot == WOL_VERIFY_MAX)
+        return 0;
+    slot     = (nextSlot + slot) % WOL_VERIFY_MAX;
+    nextSlot = (slot + 1) % WOL_VERIFY_MAX;
+
+    Entry&   e   = entries[slot];
+    uint32_t now = millis();
+    uint32_t id  = e.id ? e.id + WOL_VERIFY_MAX : (uint32_t)slot + 1;
+    e            = {};
+    e.id         = id;
+    e.job        = job;
+    e.hostId     = hostId;
+    e.ip         = (uint32_t)ip;
+    e.startMs    = now;
+    e.nextMs     = now + WOL_VERIFY_FIRST_PROBE_MS;
+    e.backoffMs  = WOL_VERIFY_FIRST_PROBE_MS;
+    memcpy(e.mac, mac, sizeof(e.mac));
+
+    if (!e.ip)
+        planSweep();
+    if (!openSocket() || (!e.ip && !sweepHosts))
+    {
+        e.state = State::Failed;
+        return id;
+    }
+    e.state = e.ip ? State::Probing : State::Resolving;
+    if (e.state == State::Resolving)
+        arpDueMs = now;
+    pending++;
+    return id;
+}
+
+void WakeVerifier::poll(uint32_t nowMs)
+{
+    if (!pending)
+        return;
+    readReplies(nowMs);
+
+    bool resolving = false;
+    for (size_t slot = 0; slot < WOL_VERIFY_MAX; ++slot)
+    {
+        Entry& e = entries[slot];
+        if (!isPending(e))
+            continue;
+        if (nowMs - e.startMs >= WOL_VERIFY_TIMEOUT_MS)
+        {
+            finish(e, State::TimedOut, nowMs);
+            continue;
+        }
+        if (e.state == State::Resolving && e.ip)
+        {
+            IPAddress ip(e.ip);
+            L_INFOF("Wake job %u: MAC found at %u.%u.%u.%u", (unsigned)e.job, ip[0], ip[1],
+                    ip[2], ip[3]);
+            e.state  = State::Probing;
+            e.nextMs = nowMs;
+        }
+        if (e.state == State::Resolving)
+            resolving = true;
+        else if ((int32_t)(nowMs - e.nextMs) >= 0)
+        {
+            sendEcho(e, slot);
+            e.nextMs    = nowMs + e.backoffMs;
+            e.backoffMs = e.backoffMs * 2 < WOL_VERIFY_MAX_BACKOFF_MS ? e.backoffMs * 2
+                                                                      : WOL_VERIFY_MAX_BACKOFF_MS;
+        }
+    }
+
+    if (resolving && (int32_t)(nowMs - arpDueMs) >= 0)
+    {
+        arpDueMs = nowMs + WOL_VERIFY_ARP_PERIOD_MS;
+        tcpip_api_call_data call = {};
+        tcpip_api_call(arpStep, &call);
+    }
+}
+
+bool WakeVerifier::status(uint32_t id, Status& out)
+{
+    if (id == 0)
+        return false;
+    const Entry& e = entries[(id - 1) % WOL_VERIFY_MAX];
+    if (e.id != id)
+        return false;
+    out.state     = e.state;
+    out.job       = e.job;
+    out.hostId    = e.hostId;
+    out.ip        = IPAddress(e.ip);
+    out.probes    = e.probes;
+    out.elapsedMs = isPending(e) ? millis() - e.startMs : e.doneMs;
+    return true;
+}
+
+const char* WakeVerifier::stateName(State state)
+{
+    switch (state)
+    {
+        case State::Resolving:
+            return "resolving";
+        case State::Probing:
+            return "probing";
+        case State::Up:
+            return "up";
+        case State::TimedOut:
+            return "timed_out";
+        case State::Failed:
+            return "failed";
+        default:
+            return "unknown";
+    }
+}
+
+const WakeVerifier::HostStats* WakeVerifier::hostStats(uint32_t hostId)
+{
+    return hostId ? statsFor(hostId, false) : nullptr;
+}
+
+uint32_t WakeVerifier::upCount()
+{
+    return ups;
+}
+
+uint32_t WakeVerifier::timeoutCount()
+{
+    return timeouts;
+}
@@ -0,0 +1,137 @@
+// test_api.cpp
+// The firmware's API handlers (src/main.cpp), called directly with a parsed request as
+// HttpServer would: status lines, bodies and registry state. Saved data goes to a
+// fresh NVS directory under /tmp.
+//   pio test -e native_app -f test_api
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unity.h>
+#include "HostRegistry.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "Scheduler.h"
+
+void handleApiHosts(HttpRequest& req, HttpResponse& res);
+void handleApiHost(HttpRequest& req, HttpResponse& res);
+void handleApiSchedules(HttpRequest& req, HttpResponse& res);
+
+static HttpRequest  req;
+static HttpResponse res;
+
+void setUp()
+{
+    req.reset();
+    res.reset();
+}
+
+void tearDown() {}
+
+// Parse `text` as one request, run `handler` on it and return the response as sent
+static std::string call(void (*handler)(HttpRequest&, HttpResponse&), const char* text)
+{
+    size_t len = strlen(text);
+    TEST_ASSERT_TRUE(len <= req.writeSpace());
+    memcpy(req.writePtr(), text, len);
+    TEST_ASSERT_EQUAL((int)HttpRequest::State::Complete, (int)req.commit(len));
+    handler(req, res);
+
+    std::string wire;
+    size_t      n;
+    while (const uint8_t* p = res.pending(n))
+    {
+        wire.append(reinterpret_cast<const char*>(p), n);
+        res.advance(n);
+    }
+    req.reset();
+    res.reset();
+    return wire;
+}
+
+static std::string post(void (*handler)(HttpRequest&, HttpResponse&), const char* path,
+                        const char* body)
+{
+    char text[512];
+    snprintf(text, sizeof(text),
+             "POST %s HTTP/1.1\r\nContent-Type: application/json\r\nContent-Length: %u\r\n"
+             "\r\n%s",
+             path, (unsigned)strlen(body), body);
+    return call(handler, text);
+}
+
+// First line of `wire`; valid until the next call
+static const char* statusLine(const std::string& wire)
+{
+    static std::string line;
+    line = wire.substr(0, wire.find("\r\n"));
+    return line.c_str();
+}
+
+static void test_new_host_is_created()
+{
+    std::string wire = post(handleApiHosts, "/api/hosts",
+                            "{\"name\":\"desk\",\"mac\":\"02:00:00:00:00:01\"}");
+    TEST_ASSERT_EQUAL_STRING("HTTP/1.1 201 Created", statusLine(wire));
+    TEST_ASSERT_TRUE(wire.find("\"name\":\"desk\"") != std::string::npos);
+
+    // The same target again is answered with the saved host
+    wire = post(handleApiHosts, "/api/hosts", "{\"name\":\"again\",\"mac\":\"02:00:00:00:00:01\"}");
+    TEST_ASSERT_EQUAL_STRING("HTTP/1.1 200 OK", statusLine(wire));
+    TEST_ASSERT_TRUE(wire.find("\"name\":\"desk\"") != std::string::npos);
+}
+
+static void test_edit_into_a_duplicate_conflicts()
+{
+    post(handleApiHosts, "/api/hosts", "{\"mac\":\"02:00:00:00:00:02\"}");
+    std::string wire = post(handleApiHosts, "/api/hosts", "{\"mac\":\"02:00:00:00:00:03\"}");
+    unsigned    id   = (unsigned)atoi(wire.c_str() + wire.find("\"id\":") + 5);
+
+    char text[256];
+    snprintf(text, sizeof(text),
+             "PUT /api/hosts/%u HTTP/1.1\r\nContent-Length: 27\r\n\r\n"
+             "{\"mac\":\"02:00:00:00:00:02\"}",
+             id);
+    wire = call(handleApiHost, text);
+    TEST_ASSERT_EQUAL_STRING("HTTP/1.1 409 Conflict", statusLine(wire));
+    TEST_ASSERT_EQUAL(3, HostRegistry::find(id)->mac[5]);
+}
+
+static void test_new_schedule_is_created()
+{
+    std::string wire = post(handleApiSchedules, "/api/schedules",
+                            "{\"name\":\"mornings\",\"cron\":\"30 7 * * mon-fri\","
+                            "\"mac\":\"02:00:00:00:00:04\"}");
+    TEST_ASSERT_EQUAL_STRING("HTTP/1.1 201 Created", statusLine(wire));
+    TEST_ASSERT_TRUE(wire.find("\"name\":\"mornings\"") != std::string::npos);
+}
+
+// Every status the server or a handler answers with has its reason phrase
+static void test_every_status_has_a_reason()
+{
+    static const int SENT[] = {200, 201, 202, 204, 304, 400, 404, 405, 408,
+                               409, 413, 429, 431, 500, 501, 503, 505, 507};
+    for (int code : SENT)
+    {
+        char what[8];
+        snprintf(what, sizeof(what), "%d", code);
+        TEST_ASSERT_TRUE_MESSAGE(HttpResponse::statusText(code)[0] != '\0', what);
+    }
+}
+
+int main(int, char**)
+{
+    char dir[] = "/tmp/sprout-test-api-XXXXXX";
+    if (!mkdtemp(dir))
+        return 1;
+    setenv("NATIVE_NVS_DIR", dir, 1);
+    HostRegistry::begin();
+    Scheduler::begin();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_new_host_is_created);
+    RUN_TEST(test_edit_into_a_duplicate_conflicts);
+    RUN_TEST(test_new_schedule_is_created);
+    RUN_TEST(test_every_status_has_a_reason);
+    return UNITY_END();
+}
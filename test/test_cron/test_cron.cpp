@@ -0,0 +1,176 @@
+// test_cron.cpp
+// Cron expressions (Cron.h): parsing, and next() across month and year ends, leap days
+// and daylight-saving changes, in POSIX zones so no tz database is needed.
+//   pio test -e native_app -f test_cron
+#include <stdlib.h>
+#include <time.h>
+#include <unity.h>
+#include "Cron.h"
+
+static const char* const UTC = "UTC0";
+static const char* const CET = "CET-1CEST,M3.5.0,M10.5.0/3"; // 02:00 -> 03:00, 03:00 -> 02:00
+static const char* const CHL = "<-04>4<-03>,M9.1.6/24,M4.1.6/24"; // jumps at midnight
+
+static void zone(const char* tz)
+{
+    setenv("TZ", tz, 1);
+    tzset();
+}
+
+static time_t utc(int year, int mon, int day, int hour, int min)
+{
+    struct tm tm = {};
+    tm.tm_year   = year - 1900;
+    tm.tm_mon    = mon - 1;
+    tm.tm_mday   = day;
+    tm.tm_hour   = hour;
+    tm.tm_min    = min;
+    return timegm(&tm);
+}
+
+static time_t next(const char* expr, time_t after)
+{
+    CronExpr c;
+    TEST_ASSERT_TRUE_MESSAGE(CronExpr::parse(expr, c), expr);
+    return c.next(after);
+}
+
+void setUp()
+{
+    zone(UTC);
+}
+
+void tearDown() {}
+
+static void test_parse_fields()
+{
+    CronExpr c;
+    TEST_ASSERT_TRUE(CronExpr::parse("*/15 8-18/2 1,15 jan-mar mon-fri", c));
+    TEST_ASSERT_EQUAL_HEX64((1ull << 0) | (1ull << 15) | (1ull << 30) | (1ull << 45), c.minutes);
+    TEST_ASSERT_EQUAL_HEX64((1u << 8) | (1u << 10) | (1u << 12) | (1u << 14) | (1u << 16) |
+                                (1u << 18),
+                            c.hours);
+    TEST_ASSERT_EQUAL_HEX64((1u << 1) | (1u << 15), c.days);
+    TEST_ASSERT_EQUAL_HEX64((1u << 1) | (1u << 2) | (1u << 3), c.months);
+    TEST_ASSERT_EQUAL_HEX64(0x3E, c.weekdays);
+    TEST_ASSERT_FALSE(c.anyDay);
+    TEST_ASSERT_FALSE(c.anyWeekday);
+
+    TEST_ASSERT_TRUE(CronExpr::parse("0 0 * * 7", c)); // 7 is Sunday too
+    TEST_ASSERT_EQUAL_HEX64(0x01, c.weekdays);
+    TEST_ASSERT_TRUE(CronExpr::parse("5/20 * * * *", c)); // 5-59/20
+    TEST_ASSERT_EQUAL_HEX64((1ull << 5) | (1ull << 25) | (1ull << 45), c.minutes);
+    TEST_ASSERT_TRUE(CronExpr::parse("  0   12 * * SUN ", c));
+    TEST_ASSERT_TRUE(CronExpr::parse("@daily", c));
+    TEST_ASSERT_EQUAL_HEX64(1, c.minutes);
+    TEST_ASSERT_EQUAL_HEX64(1, c.hours);
+    TEST_ASSERT_TRUE(c.anyDay);
+}
+
+static void test_parse_rejects()
+{
+    static const char* const BAD[] = {
+        "", "* * * *", "* * * * * *", "60 * * * *", "* 24 * * *", "* * 0 * *", "* * 32 * *",
+        "* * * 13 *", "* * * * 8", "5-1 * * * *", "*/0 * * * *", "a * * * *", "1,,2 * * * *",
+        "1- * * * *", "@reboot", "* * * foo *",
+    };
+    CronExpr c;
+    for (const char* text : BAD)
+        TEST_ASSERT_FALSE_MESSAGE(CronExpr::parse(text, c), text);
+    TEST_ASSERT_FALSE(CronExpr::parse(nullptr, c));
+}
+
+static void test_next_basic()
+{
+    time_t t = utc(2026, 10, 16, 10, 7);
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 10, 16, 10, 8), next("* * * * *", t));
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 10, 16, 10, 8), next("* * * * *", t + 59));
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 10, 16, 10, 15), next("*/15 * * * *", t));
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 10, 17, 7, 30), next("30 7 * * *", t));
+    // 2026-10-16 is a Friday
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 10, 19, 7, 30), next("30 7 * * mon-thu", t));
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 10, 18, 0, 0), next("@weekly", t));
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 11, 1, 0, 0), next("@monthly", t));
+    TEST_ASSERT_EQUAL_INT64(utc(2027, 1, 1, 0, 0), next("@yearly", t));
+    TEST_ASSERT_EQUAL_INT64(utc(2027, 1, 1, 0, 0), next("@yearly", utc(2026, 12, 31, 23, 59)));
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 12, 31, 23, 59), next("59 23 31 12 *", t));
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 10, 31, 0, 0), next("0 0 31 * *", t));
+    t = utc(2026, 10, 31, 0, 0);
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 12, 31, 0, 0), next("0 0 31 * *", t));
+}
+
+static void test_either_day_field()
+{
+    // Both day fields restricted: the 13th or any Friday, whichever comes first. The
+    // 16th is a Friday, and so is 2026-11-13.
+    time_t fri = utc(2026, 10, 16, 1, 0);
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 10, 23, 0, 0), next("0 0 13 * fri", fri));
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 11, 13, 0, 0), next("0 0 13 * fri", utc(2026, 11, 7, 0, 0)));
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 11, 2, 0, 0), next("0 0 2 * sat", utc(2026, 11, 1, 0, 0)));
+    // Only one restricted: that one alone decides
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 11, 13, 0, 0), next("0 0 13 * *", fri));
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 10, 18, 0, 0), next("0 0 * * sun", fri));
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 11, 1, 0, 0), next("0 0 * 11 sun", fri));
+}
+
+static void test_leap_day()
+{
+    TEST_ASSERT_EQUAL_INT64(utc(2028, 2, 29, 0, 0), next("0 0 29 2 *", utc(2026, 3, 1, 0, 0)));
+    TEST_ASSERT_EQUAL_INT64(utc(2032, 2, 29, 0, 0), next("0 0 29 2 *", utc(2028, 2, 29, 0, 0)));
+    TEST_ASSERT_EQUAL_INT64(utc(2028, 3, 1, 0, 0), next("0 0 1 3 *", utc(2028, 2, 28, 0, 0)));
+    TEST_ASSERT_EQUAL_INT64(utc(2028, 2, 29, 0, 0), next("0 0 * 2 *", utc(2028, 2, 28, 0, 0)));
+    // 2100 is not a leap year, so from 2096 the next 29 February is out of reach
+    TEST_ASSERT_EQUAL_INT64(0, next("0 0 29 2 *", utc(2096, 3, 1, 0, 0)));
+    TEST_ASSERT_EQUAL_INT64(utc(2104, 2, 29, 0, 0), next("0 0 29 2 *", utc(2099, 3, 1, 0, 0)));
+    TEST_ASSERT_EQUAL_INT64(utc(2100, 3, 1, 0, 0), next("0 0 * 2-3 *", utc(2100, 2, 28, 0, 0)));
+    TEST_ASSERT_EQUAL_INT64(0, next("0 0 30 2 *", utc(2026, 1, 1, 0, 0)));
+    TEST_ASSERT_EQUAL_INT64(0, next("0 0 31 4,6,9,11 *", utc(2026, 1, 1, 0, 0)));
+}
+
+static void test_spring_forward()
+{
+    zone(CET);
+    // 2026-03-29: 01:59 CET is followed by 03:00 CEST (01:00 UTC)
+    time_t before = utc(2026, 3, 28, 12, 0);
+    time_t jump   = utc(2026, 3, 29, 1, 0);
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 3, 29, 0, 59), next("59 1 * * *", before));
+    TEST_ASSERT_EQUAL_INT64(jump, next("0 2 * * *", before));
+    TEST_ASSERT_EQUAL_INT64(jump, next("30 2 * * *", before));
+    TEST_ASSERT_EQUAL_INT64(jump, next("0 3 * * *", before));
+    TEST_ASSERT_EQUAL_INT64(jump, next("*/15 * * * *", utc(2026, 3, 29, 0, 50)));
+    // Once, and back to normal the day after
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 3, 30, 0, 30), next("30 2 * * *", jump));
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 3, 29, 1, 15), next("*/15 * * * *", jump));
+
+    zone(CHL);
+    // 2026-09-06: the day starts at 01:00 (04:00 UTC)
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 9, 6, 4, 0), next("0 0 * * *", utc(2026, 9, 5, 12, 0)));
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 9, 7, 3, 0), next("0 0 * * *", utc(2026, 9, 6, 4, 0)));
+}
+
+static void test_fall_back()
+{
+    zone(CET);
+    // 2026-10-25: 02:00-02:59 comes twice, as CEST (00:xx UTC) and then as CET (01:xx UTC)
+    time_t first = utc(2026, 10, 25, 0, 30);
+    TEST_ASSERT_EQUAL_INT64(first, next("30 2 * * *", utc(2026, 10, 24, 12, 0)));
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 10, 26, 1, 30), next("30 2 * * *", first));
+    // From inside the repeat, a time already passed in the first run is not due again
+    time_t repeat = utc(2026, 10, 25, 1, 10);
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 10, 26, 1, 30), next("30 2 * * *", repeat));
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 10, 25, 2, 11), next("11 * * * *", repeat));
+    TEST_ASSERT_EQUAL_INT64(utc(2026, 10, 25, 2, 0), next("0 3 * * *", first));
+}
+
+int main(int, char**)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_fields);
+    RUN_TEST(test_parse_rejects);
+    RUN_TEST(test_next_basic);
+    RUN_TEST(test_either_day_field);
+    RUN_TEST(test_leap_day);
+    RUN_TEST(test_spring_forward);
+    RUN_TEST(test_fall_back);
+    return UNITY_END();
+}
@@ -0,0 +1,222 @@
+// test_http_request.cpp
+// The incremental request parser (HttpRequest.h): requests whole, byte by byte and
+// pipelined, query arguments, connection semantics, and the status each malformed or
+// oversized request is refused with.
+//   pio test -e native_app -f test_http_request
+#include <initializer_list>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "HttpRequest.h"
+
+static HttpRequest req;
+
+void setUp()
+{
+    req.reset();
+}
+
+void tearDown() {}
+
+// Deliver `text` in pieces of `step` bytes (0 = all at once); returns the final state
+static HttpRequest::State feed(const char* text, size_t step = 0)
+{
+    size_t              len = strlen(text);
+    HttpRequest::State st   = req.state();
+    for (size_t at = 0; at < len;)
+    {
+        size_t n = step && step < len - at ? step : len - at;
+        if (n > req.writeSpace())
+            n = req.writeSpace();
+        if (n == 0)
+            break;
+        memcpy(req.writePtr(), text + at, n);
+        at += n;
+        st = req.commit(n);
+        if (st == HttpRequest::State::Error || st == HttpRequest::State::Complete)
+            break;
+    }
+    return st;
+}
+
+static void test_get_with_query()
+{
+    TEST_ASSERT_EQUAL((int)HttpRequest::State::Complete,
+                      (int)feed("GET /wol?mac=AA%3ABB%3acc:DD:EE:FF&name=my+pc&flag HTTP/1.1\r\n"
+                                "Host: sprout\r\n"
+                                "X-Spaced:   padded value \t\r\n"
+                                "\r\n"));
+    TEST_ASSERT_EQUAL((int)HttpMethod::Get, (int)req.method());
+    TEST_ASSERT_EQUAL_STRING("GET", req.methodName());
+    TEST_ASSERT_EQUAL_STRING("/wol", req.path());
+    TEST_ASSERT_EQUAL_STRING("sprout", req.header("host"));
+    TEST_ASSERT_EQUAL_STRING("padded value", req.header("X-Spaced"));
+    TEST_ASSERT_NULL(req.header("Content-Length"));
+    TEST_ASSERT_FALSE(req.isHttp10());
+    TEST_ASSERT_TRUE(req.keepAlive());
+    TEST_ASSERT_EQUAL(0, req.bodyLength());
+    TEST_ASSERT_EQUAL_STRING("", req.body());
+
+    char out[32];
+    TEST_ASSERT_TRUE(req.arg("mac", out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING("AA:BB:cc:DD:EE:FF", out);
+    TEST_ASSERT_TRUE(req.arg("name", out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING("my pc", out);
+    TEST_ASSERT_TRUE(req.hasArg("flag"));
+    TEST_ASSERT_TRUE(req.arg("flag", out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING("", out);
+    TEST_ASSERT_FALSE(req.hasArg("ma"));
+    TEST_ASSERT_FALSE(req.arg("missing", out, sizeof(out)));
+    TEST_ASSERT_FALSE(req.arg("mac", out, 8)); // does not fit
+    TEST_ASSERT_EQUAL_STRING("", out);
+}
+
+static void test_post_body_in_any_pieces()
+{
+    static const char TEXT[] = "POST /api/wake HTTP/1.1\r\n"
+                               "Content-Type: application/json\r\n"
+                               "Content-Length: 27\r\n"
+                               "\r\n"
+                               "{\"mac\":\"aa:bb:cc:dd:ee:ff\"}";
+    for (size_t step : {0, 1, 2, 7, 64})
+    {
+        req.reset();
+        char what[16];
+        snprintf(what, sizeof(what), "step %u", (unsigned)step);
+        TEST_ASSERT_EQUAL_MESSAGE((int)HttpRequest::State::Complete, (int)feed(TEXT, step), what);
+        TEST_ASSERT_EQUAL((int)HttpMethod::Post, (int)req.method());
+        TEST_ASSERT_EQUAL(27, req.bodyLength());
+        TEST_ASSERT_EQUAL_STRING("{\"mac\":\"aa:bb:cc:dd:ee:ff\"}", req.body());
+    }
+}
+
+static void test_waits_for_the_body()
+{
+    TEST_ASSERT_EQUAL((int)HttpRequest::State::Body,
+                      (int)feed("PUT /api/hosts/1 HTTP/1.1\r\n"
+                                "Content-Length: 10\r\n"
+                                "Expect: 100-continue\r\n"
+                                "\r\n"
+                                "12345"));
+    TEST_ASSERT_TRUE(req.expectsContinue());
+    TEST_ASSERT_EQUAL((int)HttpRequest::State::Complete, (int)feed("67890"));
+    TEST_ASSERT_EQUAL_STRING("1234567890", req.body());
+}
+
+static void test_pipelined_requests()
+{
+    TEST_ASSERT_EQUAL((int)HttpRequest::State::Complete,
+                      (int)feed("POST /a HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc"
+                                "GET /b HTTP/1.1\r\n\r\n"
+                                "GET /c HT"));
+    TEST_ASSERT_EQUAL_STRING("/a", req.path());
+    TEST_ASSERT_EQUAL_STRING("abc", req.body()); // NUL-terminated before the next request
+    TEST_ASSERT_EQUAL((int)HttpRequest::State::Complete, (int)req.next());
+    TEST_ASSERT_EQUAL_STRING("/b", req.path());
+    TEST_ASSERT_EQUAL((int)HttpRequest::State::RequestLine, (int)req.next());
+    TEST_ASSERT_EQUAL((int)HttpRequest::State::Complete, (int)feed("TP/1.1\r\n\r\n"));
+    TEST_ASSERT_EQUAL_STRING("/c", req.path());
+}
+
+static void test_connection_semantics()
+{
+    feed("GET / HTTP/1.1\r\nConnection: close\r\n\r\n");
+    TEST_ASSERT_FALSE(req.keepAlive());
+    req.reset();
+    feed("GET / HTTP/1.1\r\nConnection: Upgrade, Close\r\n\r\n");
+    TEST_ASSERT_FALSE(req.keepAlive());
+    req.reset();
+    feed("GET / HTTP/1.0\r\n\r\n");
+    TEST_ASSERT_TRUE(req.isHttp10());
+    TEST_ASSERT_FALSE(req.keepAlive());
+    req.reset();
+    feed("GET / HTTP/1.0\r\nConnection: keep-alive\r\n\r\n");
+    TEST_ASSERT_TRUE(req.keepAlive());
+    req.reset();
+    // Stray blank lines ahead of the request line are skipped; a bare LF ends a line
+    TEST_ASSERT_EQUAL((int)HttpRequest::State::Complete, (int)feed("\r\n\nHEAD /x HTTP/1.1\n\n"));
+    TEST_ASSERT_EQUAL((int)HttpMethod::Head, (int)req.method());
+}
+
+static void test_refused_requests()
+{
+    static const struct
+    {
+        const char* text;
+        int         status;
+    } CASES[] = {
+        {"GET\r\n\r\n", 400},
+        {"GET /\r\n\r\n", 400},
+        {"GET / HTTP/2.0\r\n\r\n", 505},
+        {"GET http://host/ HTTP/1.1\r\n\r\n", 400},
+        {"GET / HTTP/1.1\r\nNo colon here\r\n\r\n", 400},
+        {"GET / HTTP/1.1\r\n: empty name\r\n\r\n", 400},
+        {"GET / HTTP/1.1\r\nX-A: 1\r\n folded\r\n\r\n", 400},
+        {"POST / HTTP/1.1\r\nContent-Length: 12x\r\n\r\n", 400},
+        {"POST / HTTP/1.1\r\nContent-Length: -1\r\n\r\n", 400},
+        {"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n", 501},
+        {"POST / HTTP/1.1\r\nContent-Length: 99999\r\n\r\n", 413},
+    };
+    for (const auto& c : CASES)
+    {
+        req.reset();
+        TEST_ASSERT_EQUAL_MESSAGE((int)HttpRequest::State::Error, (int)feed(c.text), c.text);
+        TEST_ASSERT_EQUAL_MESSAGE(c.status, req.errorStatus(), c.text);
+    }
+
+    // A head that never ends fills the buffer
+    req.reset();
+    static char big[HTTP_REQUEST_BUFFER_SIZE + 64];
+    memset(big, 'a', sizeof(big) - 1);
+    memcpy(big, "GET /", 5);
+    TEST_ASSERT_EQUAL((int)HttpRequest::State::Error, (int)feed(big));
+    TEST_ASSERT_EQUAL(431, req.errorStatus());
+}
+
+// Past HTTP_MAX_HEADERS, headers are dropped, but never the ones that frame the request
+static void test_framing_headers_survive_a_full_table()
+{
+    static char text[HTTP_REQUEST_BUFFER_SIZE];
+    size_t      n = (size_t)snprintf(text, sizeof(text), "POST /api/wake HTTP/1.1\r\n");
+    for (int i = 0; i < HTTP_MAX_HEADERS + 4; ++i)
+        n += (size_t)snprintf(text + n, sizeof(text) - n, "X-Filler-%d: %d\r\n", i, i);
+    snprintf(text + n, sizeof(text) - n,
+             "Connection: close\r\nContent-Length: 5\r\nExpect: 100-continue\r\n\r\nhello");
+    TEST_ASSERT_EQUAL((int)HttpRequest::State::Complete, (int)feed(text));
+    TEST_ASSERT_EQUAL_STRING("hello", req.body());
+    TEST_ASSERT_FALSE(req.keepAlive());
+    TEST_ASSERT_TRUE(req.expectsContinue());
+    TEST_ASSERT_EQUAL_STRING("0", req.header("X-Filler-0"));
+    TEST_ASSERT_NULL(req.header("X-Filler-19"));
+
+    // A chunked body announced late is still refused rather than read as the next request
+    req.reset();
+    n = (size_t)snprintf(text, sizeof(text), "POST / HTTP/1.1\r\n");
+    for (int i = 0; i < HTTP_MAX_HEADERS; ++i)
+        n += (size_t)snprintf(text + n, sizeof(text) - n, "X-Filler-%d: %d\r\n", i, i);
+    snprintf(text + n, sizeof(text) - n, "Transfer-Encoding: chunked\r\n\r\n");
+    TEST_ASSERT_EQUAL((int)HttpRequest::State::Error, (int)feed(text));
+    TEST_ASSERT_EQUAL(501, req.errorStatus());
+
+    // Only framing headers, more than fit: nothing can make room
+    req.reset();
+    n = (size_t)snprintf(text, sizeof(text), "GET / HTTP/1.1\r\n");
+    for (int i = 0; i <= HTTP_MAX_HEADERS; ++i)
+        n += (size_t)snprintf(text + n, sizeof(text) - n, "Connection: keep-alive\r\n");
+    snprintf(text + n, sizeof(text) - n, "\r\n");
+    TEST_ASSERT_EQUAL((int)HttpRequest::State::Error, (int)feed(text));
+    TEST_ASSERT_EQUAL(431, req.errorStatus());
+}
+
+int main(int, char**)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_get_with_query);
+    RUN_TEST(test_post_body_in_any_pieces);
+    RUN_TEST(test_waits_for_the_body);
+    RUN_TEST(test_pipelined_requests);
+    RUN_TEST(test_connection_semantics);
+    RUN_TEST(test_refused_requests);
+    RUN_TEST(test_framing_headers_survive_a_full_table);
+    return UNITY_END();
+}
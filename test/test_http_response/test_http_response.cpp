@@ -0,0 +1,113 @@
+// test_http_response.cpp
+// Streamed responses (HttpResponse.h): chunk framing, the unframed HTTP/1.0 body, and
+// that a stream ending on an empty piece still finishes instead of waiting for the idle
+// timeout.
+//   pio test -e native_app -f test_http_response
+#include <string.h>
+#include <string>
+#include <unity.h>
+#include "HttpResponse.h"
+
+static HttpResponse res;
+
+void setUp()
+{
+    res.reset();
+}
+
+void tearDown() {}
+
+// Pieces: "hello", then (nothing, done)
+static size_t helloThenEmpty(HttpResponse::Stream& s, char* buf, size_t cap, uint32_t,
+                             bool& done)
+{
+    if (s.cursor++ == 0 && cap >= 5)
+    {
+        memcpy(buf, "hello", 5);
+        return 5;
+    }
+    done = true;
+    return 0;
+}
+
+// Nothing at all: done on the first fill
+static size_t emptyStream(HttpResponse::Stream&, char*, size_t, uint32_t, bool& done)
+{
+    done = true;
+    return 0;
+}
+
+// Write everything pending, refilling as the server does; returns the bytes on the wire
+static std::string drain(int maxRefills = 8)
+{
+    std::string wire;
+    for (int i = 0; i < maxRefills && !res.finished();)
+    {
+        size_t         len = 0;
+        const uint8_t* p   = res.pending(len);
+        if (p && len)
+        {
+            wire.append(reinterpret_cast<const char*>(p), len);
+            res.advance(len);
+            continue;
+        }
+        ++i;
+        if (!res.refill(0))
+            break;
+    }
+    return wire;
+}
+
+// Everything after the blank line that ends the headers
+static std::string body(const std::string& wire)
+{
+    size_t end = wire.find("\r\n\r\n");
+    return end == std::string::npos ? wire : wire.substr(end + 4);
+}
+
+static void test_chunked_stream()
+{
+    res.setKeepAlive(true);
+    res.sendStream(200, "text/plain", helloThenEmpty, 0);
+    std::string wire = drain();
+    TEST_ASSERT_TRUE(res.finished());
+    TEST_ASSERT_TRUE(wire.find("Transfer-Encoding: chunked\r\n") != std::string::npos);
+    TEST_ASSERT_EQUAL_STRING("5\r\nhello\r\n0\r\n\r\n", body(wire).c_str());
+}
+
+static void test_http10_stream_ends_on_an_empty_piece()
+{
+    res.setHttp10(true);
+    res.setKeepAlive(true);
+    res.sendStream(200, "text/plain", helloThenEmpty, 0);
+    TEST_ASSERT_FALSE(res.keepAlive());
+    std::string wire = drain();
+    TEST_ASSERT_TRUE(res.finished());
+    TEST_ASSERT_TRUE(wire.find("Transfer-Encoding") == std::string::npos);
+    TEST_ASSERT_EQUAL_STRING("hello", body(wire).c_str());
+}
+
+static void test_http10_stream_with_no_body()
+{
+    res.setHttp10(true);
+    res.sendStream(200, "text/plain", emptyStream, 0);
+    std::string wire = drain();
+    TEST_ASSERT_TRUE(res.finished());
+    TEST_ASSERT_EQUAL_STRING("", body(wire).c_str());
+}
+
+static void test_nothing_queued_is_not_finished()
+{
+    TEST_ASSERT_FALSE(res.started());
+    TEST_ASSERT_FALSE(res.finished());
+}
+
+int main(int, char**)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_chunked_stream);
+    RUN_TEST(test_http10_stream_ends_on_an_empty_piece);
+    RUN_TEST(test_http10_stream_with_no_body);
+    RUN_TEST(test_nothing_queued_is_not_finished);
+    return UNITY_END();
+}
@@ -0,0 +1,493 @@
+// test_json.cpp
+// The JSON tokenizer and writer (Json.h): known inputs with the answer they must get,
+// then a mutation fuzzer that checks every verdict against a small recursive-descent
+// reference parser and the token index of every accepted input against its shape.
+//   pio test -e native_app -f test_json
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "Json.h"
+
+static json::Document doc;
+
+void setUp() {}
+void tearDown() {}
+
+static json::Error parse(const char* text)
+{
+    return doc.parse(text, strlen(text));
+}
+
+// --- Reference parser: RFC 8259, written for clarity rather than speed ---
+
+struct Reference
+{
+    const char* p;
+    const char* end;
+    size_t      depth;
+    size_t      maxDepth;
+    size_t      tokens;
+
+    void ws()
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+            p++;
+    }
+
+    bool lit(const char* w)
+    {
+        size_t n = strlen(w);
+        if ((size_t)(end - p) < n || memcmp(p, w, n) != 0)
+            return false;
+        p += n;
+        return true;
+    }
+
+    static bool digit(char c) { return c >= '0' && c <= '9'; }
+
+    static bool hex(char c)
+    {
+        return digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+    }
+
+    bool string()
+    {
+        if (p == end || *p++ != '"')
+            return false;
+        while (p < end && *p != '"')
+        {
+            if ((unsigned char)*p < 0x20)
+                return false;
+            if (*p++ != '\\')
+                continue;
+            if (p == end)
+                return false;
+            char e = *p++;
+            if (e == 'u')
+            {
+                for (int i = 0; i < 4; ++i)
+                    if (p == end || !hex(*p++))
+                        return false;
+            }
+            else if (!strchr("\"\\/bfnrt", e) || e == '\0')
+                return false;
+        }
+        if (p == end)
+            return false;
+        p++;
+        tokens++;
+        return true;
+    }
+
+    bool number()
+    {
+        if (p < end && *p == '-')
+            p++;
+        if (p == end || !digit(*p))
+            return false;
+        if (*p++ != '0')
+            while (p < end && digit(*p))
+                p++;
+        if (p < end && *p == '.')
+        {
+            p++;
+            if (p == end || !digit(*p))
+                return false;
+            while (p < end && digit(*p))
+                p++;
+        }
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            p++;
+            if (p < end && (*p == '+' || *p == '-'))
+                p++;
+            if (p == end || !digit(*p))
+                return false;
+            while (p < end && digit(*p))
+                p++;
+        }
+        tokens++;
+        return true;
+    }
+
+    bool container(char open, char close)
+    {
+        p++;
+        tokens++;
+        if (++depth > maxDepth)
+            maxDepth = depth;
+        ws();
+        if (p < end && *p == close)
+        {
+            p++;
+            depth--;
+            return true;
+        }
+        for (;;)
+        {
+            ws();
+            if (open == '{')
+            {
+                if (!string())
+                    return false;
+                ws();
+                if (p == end || *p++ != ':')
+                    return false;
+            }
+            if (!value())
+                return false;
+            ws();
+            if (p == end)
+                return false;
+            char c = *p++;
+            if (c == close)
+                break;
+            if (c != ',')
+                return false;
+        }
+        depth--;
+        return true;
+    }
+
+    bool value()
+    {
+        ws();
+        if (p == end)
+            return false;
+        switch (*p)
+        {
+            case '{':
+                return container('{', '}');
+            case '[':
+                return container('[', ']');
+            case '"':
+                return string();
+            case 't':
+                return lit("true") && ++tokens;
+            case 'f':
+                return lit("false") && ++tokens;
+            case 'n':
+                return lit("null") && ++tokens;
+            default:
+                return number();
+        }
+    }
+
+    bool document(const char* text, size_t length)
+    {
+        p        = text;
+        end      = text + length;
+        depth    = 0;
+        maxDepth = 0;
+        tokens   = 0;
+        if (!value())
+            return false;
+        ws();
+        return p == end;
+    }
+};
+
+// Spans and member counts of an accepted document agree with its tokens
+static void checkShape(size_t length)
+{
+    TEST_ASSERT_EQUAL(doc.size(), doc[0].span);
+    for (size_t i = 0; i < doc.size(); ++i)
+    {
+        const json::Token& t = doc[i];
+        TEST_ASSERT_TRUE((size_t)t.start + t.length <= length);
+        TEST_ASSERT_TRUE(t.span >= 1 && i + t.span <= doc.size());
+        if (!doc.is(i, json::Type::Object) && !doc.is(i, json::Type::Array))
+        {
+            TEST_ASSERT_EQUAL(1, t.span);
+            continue;
+        }
+        size_t perMember = doc.is(i, json::Type::Object) ? 2 : 1;
+        size_t c         = doc.child(i);
+        for (size_t n = 0; n < t.count * perMember; ++n)
+            c = doc.next(c);
+        TEST_ASSERT_EQUAL(doc.next(i), c);
+    }
+}
+
+// --- Known inputs ---
+
+static void test_accepts_valid_documents()
+{
+    static const char* const VALID[] = {
+        "{}",
+        "[]",
+        "0",
+        "-0",
+        "-12.5e+10",
+        "1E-3",
+        "\"\"",
+        "true",
+        " \t\r\n[ null , false ]\n",
+        "{\"mac\":\"AA:BB:CC:DD:EE:FF\",\"broadcast\":\"192.168.1.255\",\"port\":9}",
+        "[{\"mac\":\"aa-bb-cc-dd-ee-ff\",\"burst\":{\"repeats\":3,\"ports\":[7,9]}}]",
+        "\"\\\"\\\\\\/\\b\\f\\n\\r\\t\\u00e9\\uD83D\\uDE00\"",
+        "[[[[[[[[1]]]]]]]]", // JSON_MAX_DEPTH deep
+    };
+    for (const char* text : VALID)
+    {
+        TEST_ASSERT_EQUAL_MESSAGE((int)json::Error::None, (int)parse(text), text);
+        checkShape(strlen(text));
+    }
+}
+
+static void test_rejects_invalid_documents()
+{
+    static const struct
+    {
+        const char* text;
+        json::Error error;
+        size_t      offset;
+    } INVALID[] = {
+        {"", json::Error::Syntax, 0},
+        {"   ", json::Error::Syntax, 3},
+        {"{", json::Error::Syntax, 1},
+        {"[1,]", json::Error::Syntax, 3},
+        {"{\"a\"}", json::Error::Syntax, 4},
+        {"{\"a\":1,}", json::Error::Syntax, 7},
+        {"{1:2}", json::Error::Syntax, 1},
+        {"[1 2]", json::Error::Syntax, 3},
+        {"[}", json::Error::Syntax, 1},
+        {"{]", json::Error::Syntax, 1},
+        {"[1]]", json::Error::Syntax, 3},
+        {"01", json::Error::Syntax, 1},
+        {"1.", json::Error::Syntax, 0},
+        {".5", json::Error::Syntax, 0},
+        {"-", json::Error::Syntax, 0},
+        {"1e", json::Error::Syntax, 0},
+        {"+1", json::Error::Syntax, 0},
+        {"12abc", json::Error::Syntax, 2},
+        {"tru", json::Error::Syntax, 0},
+        {"truex", json::Error::Syntax, 4},
+        {"nul", json::Error::Syntax, 0},
+        {"\"abc", json::Error::Syntax, 4},
+        {"\"\\x\"", json::Error::Syntax, 1},
+        {"\"\\u12G4\"", json::Error::Syntax, 1},
+        {"\"tab\there\"", json::Error::Syntax, 4},
+        {"[[[[[[[[[1]]]]]]]]]", json::Error::TooDeep, 8},
+    };
+    for (const auto& c : INVALID)
+    {
+        TEST_ASSERT_EQUAL_MESSAGE((int)c.error, (int)parse(c.text), c.text);
+        TEST_ASSERT_EQUAL_MESSAGE(c.offset, doc.errorOffset(), c.text);
+        TEST_ASSERT_EQUAL_MESSAGE(0, doc.size(), c.text);
+    }
+}
+
+static void test_token_limit()
+{
+    // "[0,0,...]" with exactly JSON_MAX_TOKENS tokens, then one more
+    static char text[JSON_MAX_TOKENS * 2 + 2];
+    size_t      n = 0;
+    text[n++]     = '[';
+    for (size_t i = 0; i < JSON_MAX_TOKENS - 1; ++i)
+    {
+        text[n++] = '0';
+        text[n++] = ',';
+    }
+    text[n - 1] = ']';
+    TEST_ASSERT_EQUAL((int)json::Error::None, (int)doc.parse(text, n));
+    TEST_ASSERT_EQUAL(JSON_MAX_TOKENS, doc.size());
+    text[n - 1] = ',';
+    text[n++]   = '0';
+    text[n++]   = ']';
+    TEST_ASSERT_EQUAL((int)json::Error::TooLarge, (int)doc.parse(text, n));
+}
+
+static void test_find_and_decode()
+{
+    static const char TEXT[] = "{\"name\":\"caf\\u00e9 \\ud83d\\ude00\",\"host\":4294967295,"
+                               "\"big\":4294967296,\"neg\":-1,\"frac\":1.5,\"odd\":\"\\udc00\"}";
+    TEST_ASSERT_EQUAL((int)json::Error::None, (int)parse(TEXT));
+    char     out[32];
+    uint32_t v = 0;
+    TEST_ASSERT_TRUE(doc.string(doc.find(0, "name"), out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING("caf\xc3\xa9 \xf0\x9f\x98\x80", out);
+    TEST_ASSERT_TRUE(doc.equals(doc.find(0, "name"), "caf\xc3\xa9 \xf0\x9f\x98\x80"));
+    TEST_ASSERT_FALSE(doc.equals(doc.find(0, "name"), "caf"));
+    TEST_ASSERT_FALSE(doc.string(doc.find(0, "name"), out, 8)); // does not fit
+    TEST_ASSERT_EQUAL_STRING("", out);
+    TEST_ASSERT_TRUE(doc.string(doc.find(0, "odd"), out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING("\xef\xbf\xbd", out); // unpaired surrogate: U+FFFD
+
+    TEST_ASSERT_TRUE(doc.number(doc.find(0, "host"), v));
+    TEST_ASSERT_EQUAL_UINT32(4294967295u, v);
+    TEST_ASSERT_FALSE(doc.number(doc.find(0, "big"), v));
+    TEST_ASSERT_FALSE(doc.number(doc.find(0, "neg"), v));
+    TEST_ASSERT_FALSE(doc.number(doc.find(0, "frac"), v));
+    TEST_ASSERT_FALSE(doc.number(doc.find(0, "name"), v));
+    TEST_ASSERT_EQUAL(json::Document::NONE, doc.find(0, "missing"));
+    TEST_ASSERT_EQUAL(json::Document::NONE, doc.find(doc.find(0, "host"), "x"));
+}
+
+static void test_writer()
+{
+    char         buf[96];
+    json::Writer w(buf, sizeof(buf));
+    w.beginObject().key("s").string("a\"b\\c\n\x01").key("n").number(4294967295u);
+    w.key("l").beginArray().boolean(true).null().beginObject().endObject().endArray();
+    w.endObject();
+    TEST_ASSERT_TRUE(w.ok());
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"s\":\"a\\\"b\\\\c\\n\\u0001\",\"n\":4294967295,\"l\":[true,null,{}]}", buf);
+
+    // What the writer renders, the tokenizer reads back
+    TEST_ASSERT_EQUAL((int)json::Error::None, (int)doc.parse(buf, w.length()));
+    char out[16];
+    TEST_ASSERT_TRUE(doc.string(doc.find(0, "s"), out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING("a\"b\\c\n\x01", out);
+
+    char         small[8];
+    json::Writer s(small, sizeof(small));
+    s.beginArray().string("overflowing").endArray();
+    TEST_ASSERT_FALSE(s.ok());
+    TEST_ASSERT_TRUE(strlen(small) < sizeof(small));
+
+    // Once over, later calls change nothing, even ones that would fit
+    char   before[sizeof(small)];
+    size_t length = s.length();
+    memcpy(before, small, sizeof(small));
+    s.number(1).null();
+    TEST_ASSERT_FALSE(s.ok());
+    TEST_ASSERT_EQUAL(length, s.length());
+    TEST_ASSERT_EQUAL_STRING(before, small);
+
+    // An exact fit is not an overflow: 6 characters and the NUL in 7 bytes
+    char         exact[7];
+    json::Writer e(exact, sizeof(exact));
+    e.beginArray().number(1234).endArray();
+    TEST_ASSERT_TRUE(e.ok());
+    TEST_ASSERT_EQUAL_STRING("[1234]", exact);
+}
+
+// Only plain unsigned integers that fit in 32 bits read as numbers
+static void test_number_edges()
+{
+    static const struct
+    {
+        const char* text;
+        bool        ok;
+        uint32_t    value;
+    } CASES[] = {
+        {"0", true, 0},
+        {"4294967295", true, 4294967295u},
+        {"4294967296", false, 0},
+        {"99999999999999999999999", false, 0},
+        {"-0", false, 0},
+        {"1e2", false, 0},
+        {"1.0", false, 0},
+        {"\"7\"", false, 0},
+    };
+    for (const auto& c : CASES)
+    {
+        TEST_ASSERT_EQUAL_MESSAGE((int)json::Error::None, (int)parse(c.text), c.text);
+        uint32_t v = 12345;
+        TEST_ASSERT_EQUAL_MESSAGE(c.ok, doc.number(0, v), c.text);
+        if (c.ok)
+            TEST_ASSERT_EQUAL_UINT32(c.value, v);
+    }
+}
+
+// --- Mutation fuzzing ---
+
+static uint32_t rng = 0x9E3779B9;
+
+static uint32_t nextRandom()
+{
+    rng ^= rng << 13; // xorshift32: the same run every time
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static void test_mutations_match_reference()
+{
+    static const char* const SEEDS[] = {
+        "{\"mac\":\"AA:BB:CC:DD:EE:FF\",\"broadcast\":\"192.168.1.255\",\"port\":9}",
+        "[{\"mac\":\"aa:bb:cc:dd:ee:01\"},{\"mac\":\"aa:bb:cc:dd:ee:02\",\"burst\":{\"repeats\":3,"
+        "\"interval_ms\":100,\"ports\":[7,9]}}]",
+        "{\"name\":\"caf\\u00e9\",\"cron\":\"30 7 * * mon-fri\",\"host\":1,\"on\":true}",
+        "[true,false,null,-0,1.5e-3,\"\\\"\\\\\\/\\b\\f\\n\\r\\t\",[[[]]],{}]",
+    };
+    static const char ALPHABET[] = "{}[]\":,\\ \t\n0123456789-+.eEtrueflasnu\x01\x7f\xc3";
+
+    Reference ref;
+    char      buf[256];
+    size_t    accepted = 0;
+    for (int iter = 0; iter < 50000; ++iter)
+    {
+        const char* seed = SEEDS[nextRandom() % (sizeof(SEEDS) / sizeof(SEEDS[0]))];
+        size_t      len  = strlen(seed);
+        memcpy(buf, seed, len);
+        for (uint32_t m = 1 + nextRandom() % 3; m > 0; --m)
+        {
+            size_t at = len ? nextRandom() % len : 0;
+            char   c  = ALPHABET[nextRandom() % (sizeof(ALPHABET) - 1)];
+            switch (nextRandom() % 4)
+            {
+                case 0: // replace
+                    if (len)
+                        buf[at] = c;
+                    break;
+                case 1: // insert
+                    if (len < sizeof(buf) - 1)
+                    {
+                        memmove(buf + at + 1, buf + at, len - at);
+                        buf[at] = c;
+                        len++;
+                    }
+                    break;
+                case 2: // delete
+                    if (len)
+                    {
+                        memmove(buf + at, buf + at + 1, len - at - 1);
+                        len--;
+                    }
+                    break;
+                default: // truncate
+                    len = at;
+                    break;
+            }
+        }
+        buf[len] = '\0';
+
+        bool        valid = ref.document(buf, len);
+        json::Error e     = doc.parse(buf, len);
+        if (!valid)
+        {
+            TEST_ASSERT_TRUE_MESSAGE(e != json::Error::None, buf);
+            TEST_ASSERT_TRUE_MESSAGE(doc.errorOffset() <= len, buf);
+            TEST_ASSERT_EQUAL_MESSAGE(0, doc.size(), buf);
+        }
+        else if (ref.maxDepth > JSON_MAX_DEPTH)
+        {
+            TEST_ASSERT_EQUAL_MESSAGE((int)json::Error::TooDeep, (int)e, buf);
+        }
+        else
+        {
+            TEST_ASSERT_EQUAL_MESSAGE((int)json::Error::None, (int)e, buf);
+            TEST_ASSERT_EQUAL_MESSAGE(ref.tokens, doc.size(), buf);
+            checkShape(len);
+            accepted++;
+        }
+    }
+    // Mutants that stay valid JSON must come up often enough for the check to matter
+    TEST_ASSERT_TRUE(accepted > 1000);
+}
+
+int main(int, char**)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_accepts_valid_documents);
+    RUN_TEST(test_rejects_invalid_documents);
+    RUN_TEST(test_token_limit);
+    RUN_TEST(test_find_and_decode);
+    RUN_TEST(test_writer);
+    RUN_TEST(test_number_edges);
+    RUN_TEST(test_mutations_match_reference);
+    return UNITY_END();
+}
@@ -0,0 +1,86 @@
+// test_siphash.cpp
+// SipHash-2-4 against the reference implementation's test vectors: key 00 01 .. 0f and
+// messages 00 01 .. (n-1), covering every tail length and more than one block.
+//   pio test -e native_app -f test_siphash
+#include <stdio.h>
+#include <unity.h>
+#include "SipHash.h"
+
+static uint8_t key[siphash::KEY_LEN];
+static uint8_t msg[64];
+
+void setUp()
+{
+    for (size_t i = 0; i < sizeof(key); ++i)
+        key[i] = (uint8_t)i;
+    for (size_t i = 0; i < sizeof(msg); ++i)
+        msg[i] = (uint8_t)i;
+}
+
+void tearDown() {}
+
+// Output bytes as the reference prints them, i.e. the hash in little-endian order
+static uint64_t fromBytes(const uint8_t (&b)[8])
+{
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i)
+        v = v << 8 | b[i];
+    return v;
+}
+
+static void test_reference_vectors()
+{
+    static const struct
+    {
+        size_t  len;
+        uint8_t out[8];
+    } VECTORS[] = {
+        {0, {0x31, 0x0e, 0x0e, 0xdd, 0x47, 0xdb, 0x6f, 0x72}},
+        {1, {0xfd, 0x67, 0xdc, 0x93, 0xc5, 0x39, 0xf8, 0x74}},
+        {2, {0x5a, 0x4f, 0xa9, 0xd9, 0x09, 0x80, 0x6c, 0x0d}},
+        {3, {0x2d, 0x7e, 0xfb, 0xd7, 0x96, 0x66, 0x67, 0x85}},
+        {4, {0xb7, 0x87, 0x71, 0x27, 0xe0, 0x94, 0x27, 0xcf}},
+        {5, {0x8d, 0xa6, 0x99, 0xcd, 0x64, 0x55, 0x76, 0x18}},
+        {6, {0xce, 0xe3, 0xfe, 0x58, 0x6e, 0x46, 0xc9, 0xcb}},
+        {7, {0x37, 0xd1, 0x01, 0x8b, 0xf5, 0x00, 0x02, 0xab}},
+        {8, {0x62, 0x24, 0x93, 0x9a, 0x79, 0xf5, 0xf5, 0x93}},
+        {15, {0xe5, 0x45, 0xbe, 0x49, 0x61, 0xca, 0x29, 0xa1}},
+        {16, {0xdb, 0x9b, 0xc2, 0x57, 0x7f, 0xcc, 0x2a, 0x3f}},
+        {63, {0x72, 0x45, 0x06, 0xeb, 0x4c, 0x32, 0x8a, 0x95}},
+    };
+    for (const auto& v : VECTORS)
+    {
+        char what[16];
+        snprintf(what, sizeof(what), "len %u", (unsigned)v.len);
+        TEST_ASSERT_EQUAL_HEX64_MESSAGE(fromBytes(v.out), siphash::hash24(key, msg, v.len),
+                                        what);
+    }
+}
+
+// The example in the SipHash paper's appendix
+static void test_paper_example()
+{
+    TEST_ASSERT_EQUAL_HEX64(0xa129ca6149be45e5ULL, siphash::hash24(key, msg, 15));
+}
+
+static void test_depends_on_key_and_every_byte()
+{
+    uint64_t h = siphash::hash24(key, msg, 24);
+    for (size_t i = 0; i < 24; ++i)
+    {
+        msg[i] ^= 0x01;
+        TEST_ASSERT_TRUE(siphash::hash24(key, msg, 24) != h);
+        msg[i] ^= 0x01;
+    }
+    key[15] ^= 0x80;
+    TEST_ASSERT_TRUE(siphash::hash24(key, msg, 24) != h);
+}
+
+int main(int, char**)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_reference_vectors);
+    RUN_TEST(test_paper_example);
+    RUN_TEST(test_depends_on_key_and_every_byte);
+    return UNITY_END();
+}
@@ -0,0 +1,154 @@
+// test_timing_wheel.cpp
+// The scheduler's timing wheel (TimingWheel.h): every timer fires once, on its tick,
+// whichever level it waited in, across the 32-bit tick wrap and beyond the top level.
+//   pio test -e native_app -f test_timing_wheel
+#include <stdint.h>
+#include <unity.h>
+#include "TimingWheel.h"
+
+static constexpr size_t TIMERS = 64;
+using Wheel                    = TimingWheel<TIMERS>;
+
+static Wheel    wheel;
+static uint32_t firedAt[TIMERS];
+static uint32_t fireCount[TIMERS];
+
+void setUp()
+{
+    wheel.start(0);
+    for (size_t i = 0; i < TIMERS; ++i)
+    {
+        firedAt[i]   = 0;
+        fireCount[i] = 0;
+    }
+}
+
+void tearDown() {}
+
+static void advance(uint32_t to)
+{
+    wheel.advance(to,
+                  [](size_t id)
+                  {
+                      firedAt[id] = wheel.current();
+                      fireCount[id]++;
+                  });
+}
+
+// Arm one timer `delay` ticks out from `start` and check it fires on that tick, not before
+static void fireAfter(uint32_t start, uint32_t delay)
+{
+    setUp();
+    wheel.start(start);
+    wheel.arm(0, start + delay);
+    advance(start + delay - 1);
+    TEST_ASSERT_EQUAL_UINT32(0, fireCount[0]);
+    TEST_ASSERT_TRUE(wheel.armed(0));
+    advance(start + delay);
+    TEST_ASSERT_EQUAL_UINT32(1, fireCount[0]);
+    TEST_ASSERT_EQUAL_UINT32(start + delay, firedAt[0]);
+    TEST_ASSERT_FALSE(wheel.armed(0));
+}
+
+static void test_fires_on_its_tick_at_every_level()
+{
+    // Either side of each level's span (64, 4096, 262144 and 16777216 ticks)
+    static const uint32_t DELAYS[] = {
+        1,        2,        63,       64,      65,   // level 0
+        1000,     4095,     4096,     4097,          // level 1
+        100000,   262143,   262144,   262145,        // level 2
+        5000000,  16777215, 16777216, 16777217,      // level 3
+        40000000,                                    // beyond the top level's span
+    };
+    for (uint32_t delay : DELAYS)
+    {
+        fireAfter(0, delay);
+        fireAfter(12345, delay); // not on a slot boundary
+    }
+}
+
+static void test_across_the_tick_wrap()
+{
+    fireAfter(0xFFFFFFF0u, 0x20);
+    fireAfter(0xFFFFFF00u, 0x1000);
+    fireAfter(0xFFFF0000u, 0x20000);
+}
+
+static void test_past_and_present_fire_next_tick()
+{
+    wheel.start(1000);
+    wheel.arm(0, 1000);
+    wheel.arm(1, 10);
+    advance(1001);
+    TEST_ASSERT_EQUAL_UINT32(1001, firedAt[0]);
+    TEST_ASSERT_EQUAL_UINT32(1001, firedAt[1]);
+}
+
+static void test_cancel_and_rearm()
+{
+    wheel.arm(0, 100);
+    wheel.arm(1, 100);
+    wheel.arm(2, 5000);
+    wheel.cancel(1);
+    wheel.cancel(1); // twice is harmless
+    wheel.arm(2, 50); // moves it
+    advance(10000);
+    TEST_ASSERT_EQUAL_UINT32(100, firedAt[0]);
+    TEST_ASSERT_EQUAL_UINT32(0, fireCount[1]);
+    TEST_ASSERT_EQUAL_UINT32(1, fireCount[2]);
+    TEST_ASSERT_EQUAL_UINT32(50, firedAt[2]);
+
+    // start() disarms everything
+    wheel.arm(3, 20000);
+    wheel.start(10000);
+    TEST_ASSERT_FALSE(wheel.armed(3));
+    advance(30000);
+    TEST_ASSERT_EQUAL_UINT32(0, fireCount[3]);
+}
+
+static void test_rearm_from_fire()
+{
+    // A recurring timer: fire() arms it again, as the scheduler does
+    wheel.arm(0, 7);
+    wheel.advance(1000,
+                  [](size_t id)
+                  {
+                      fireCount[id]++;
+                      TEST_ASSERT_EQUAL_UINT32(7 * fireCount[id], wheel.current());
+                      wheel.arm(id, wheel.current() + 7);
+                  });
+    TEST_ASSERT_EQUAL_UINT32(1000 / 7, fireCount[0]);
+}
+
+static void test_many_timers_in_one_jump()
+{
+    // Expiries spread over every level, all passed in one advance() call
+    uint32_t rng = 0x12345678;
+    uint32_t due[TIMERS];
+    for (size_t i = 0; i < TIMERS; ++i)
+    {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        due[i] = 1 + (rng >> (i % 4 * 6)) % 300000;
+        wheel.arm(i, due[i]);
+    }
+    advance(300000);
+    for (size_t i = 0; i < TIMERS; ++i)
+    {
+        TEST_ASSERT_EQUAL_UINT32(1, fireCount[i]);
+        TEST_ASSERT_EQUAL_UINT32(due[i], firedAt[i]);
+    }
+}
+
+int main(int, char**)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fires_on_its_tick_at_every_level);
+    RUN_TEST(test_across_the_tick_wrap);
+    RUN_TEST(test_past_and_present_fire_next_tick);
+    RUN_TEST(test_cancel_and_rearm);
+    RUN_TEST(test_rearm_from_fire);
+    RUN_TEST(test_many_timers_in_one_jump);
+    return UNITY_END();
+}